@@ -1,6 +1,10 @@
 #include "SuffixArray.h"
 
+#include "util/exception.hh"
+#include "util/suffix_array.hh"
+
 #include <fstream>
+#include <map>
 #include <string>
 #include <cstdlib>
 #include <cstring>
@@ -17,7 +21,6 @@ using namespace std;
 SuffixArray::SuffixArray()
   : m_array(NULL),
     m_index(NULL),
-    m_buffer(NULL),
     m_wordInSentence(NULL),
     m_sentence(NULL),
     m_sentenceLength(NULL),
@@ -32,6 +35,7 @@ SuffixArray::SuffixArray()
 
 SuffixArray::~SuffixArray()
 {
+  if (m_mapping.get() != NULL) return; // arrays point into the loaded file
   free(m_array);
   free(m_index);
   free(m_wordInSentence);
@@ -41,7 +45,7 @@ SuffixArray::~SuffixArray()
   free(m_documentName);
 }
 
-void SuffixArray::Create(const string& fileName )
+void SuffixArray::Create(const string& fileName, size_t threads, const string& tempPrefix )
 {
   m_vcb.StoreIfNew( "<uNk>" );
   m_endOfSentence = m_vcb.StoreIfNew( "<s>" );
@@ -115,12 +119,10 @@ void SuffixArray::Create(const string& fileName )
     vector< WORD_ID >::const_iterator i;
 
     for( i=words.begin(); i!=words.end(); i++) {
-      m_index[ wordIndex ] = wordIndex;
       m_sentence[ wordIndex ] = sentenceId;
       m_wordInSentence[ wordIndex ] = i-words.begin();
       m_array[ wordIndex++ ] = *i;
     }
-    m_index[ wordIndex ] = wordIndex;
     m_array[ wordIndex++ ] = m_endOfSentence;
     m_sentenceLength[ sentenceId++ ] = words.size();
   }
@@ -128,16 +130,18 @@ void SuffixArray::Create(const string& fileName )
   cerr << "done reading " << wordIndex << " words, " << sentenceId << " sentences." << endl;
   // List(0,9);
 
-  // sort
-  m_buffer = (INDEX*) calloc( sizeof( INDEX ), m_size );
-
-  if (m_buffer == NULL) {
-    cerr << "Error: cannot allocate memory to m_buffer" << endl;
-    exit(1);
+  // sort by words in lexical order, which is the order of the vocabulary's
+  // lookup map; the ranks are computed in place of the suffix array
+  vector< WORD_ID > lexicalRank( m_vcb.vocab.size() );
+  WORD_ID rank = 0;
+  map< WORD, WORD_ID >::const_iterator w;
+  for( w=m_vcb.lookup.begin(); w!=m_vcb.lookup.end(); w++) {
+    lexicalRank[ w->second ] = rank++;
   }
-
-  Sort( 0, m_size-1 );
-  free( m_buffer );
+  for(INDEX i=0; i<m_size; i++) {
+    m_index[ i ] = lexicalRank[ m_array[ i ] ];
+  }
+  util::BuildSuffixArray( m_index, m_size, m_index, threads, tempPrefix );
   cerr << "done sorting" << endl;
 }
 
@@ -180,52 +184,6 @@ bool SuffixArray::ProcessDocumentLine( const char *line, const size_t sentenceId
   return true;
 }
 
-// good ol' quick sort
-void SuffixArray::Sort(INDEX start, INDEX end)
-{
-  if (start == end) return;
-  INDEX mid = (start+end+1)/2;
-  Sort( start, mid-1 );
-  Sort( mid, end );
-
-  // merge
-  INDEX i = start;
-  INDEX j = mid;
-  INDEX k = 0;
-  INDEX length = end-start+1;
-  while( k<length ) {
-    if (i == mid ) {
-      m_buffer[ k++ ] = m_index[ j++ ];
-    } else if (j > end ) {
-      m_buffer[ k++ ] = m_index[ i++ ];
-    } else {
-      if (CompareIndex( m_index[i], m_index[j] ) < 0) {
-        m_buffer[ k++ ] = m_index[ i++ ];
-      } else {
-        m_buffer[ k++ ] = m_index[ j++ ];
-      }
-    }
-  }
-
-  memcpy( ((char*)m_index) + sizeof( INDEX ) * start,
-          ((char*)m_buffer), sizeof( INDEX ) * (end-start+1) );
-}
-
-int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
-{
-  // skip over identical words
-  INDEX offset = 0;
-  while( a+offset < m_size &&
-         b+offset < m_size &&
-         m_array[ a+offset ] == m_array[ b+offset ] ) {
-    offset++;
-  }
-
-  if( a+offset == m_size ) return -1;
-  if( b+offset == m_size ) return 1;
-  return CompareWord( m_array[ a+offset ], m_array[ b+offset ] );
-}
-
 inline int SuffixArray::CompareWord( WORD_ID a, WORD_ID b ) const
 {
   return m_vcb.GetWord(a).compare( m_vcb.GetWord(b) );
@@ -402,33 +360,74 @@ SuffixArray::INDEX SuffixArray::GetDocument( INDEX sentence ) const
 
 void SuffixArray::Save(const string& fileName ) const
 {
-  FILE *pFile = fopen ( fileName.c_str() , "w" );
-  if (pFile == NULL) Error("cannot open",fileName);
+  util::SuffixArrayFile file;
+  file.header.has_documents = m_useDocument;
+  file.header.size = m_size;
+  file.header.sentence_count = m_sentenceCount;
+  file.header.document_count = m_useDocument ? m_documentCount : 0;
+  file.header.document_name_length = m_useDocument ? m_documentNameLength : 0;
+  file.text = m_array;                        // corpus
+  file.index = m_index;                       // suffix array
+  file.word_in_sentence = m_wordInSentence;   // word index
+  file.sentence = m_sentence;                 // sentence index
+  file.sentence_length = m_sentenceLength;    // sentence length
+  file.document = m_document;
+  file.document_name = m_documentName;
+  file.document_name_buffer = m_documentNameBuffer;
+  try {
+    util::WriteSuffixArrayFile( fileName.c_str(), file );
+  } catch (const util::Exception &e) {
+    Error( e.what(), fileName );
+  }
 
-  fwrite( &m_size, sizeof(INDEX), 1, pFile );
-  fwrite( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
-  fwrite( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
-  fwrite( m_wordInSentence, sizeof(char), m_size, pFile); // word index
-  fwrite( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
+  m_vcb.Save( fileName + ".src-vcb" );
+}
+
+// maps the file, so the arrays are used in place and shared between
+// processes that load the same model
+void SuffixArray::Load(const string& fileName )
+{
+  if (!util::IsSuffixArrayFile( fileName.c_str() )) {
+    LoadLegacy( fileName );
+    return;
+  }
+
+  cerr << "loading from " << fileName << endl;
+  util::SuffixArrayFile file;
+  try {
+    util::MapSuffixArrayFile( fileName.c_str(), file, m_mapping );
+  } catch (const util::Exception &e) {
+    Error( e.what(), fileName );
+  }
 
-  fwrite( &m_sentenceCount, sizeof(INDEX), 1, pFile );
-  fwrite( m_sentenceLength, sizeof(char), m_sentenceCount, pFile); // sentence length
+  // the mapping is read-only, but nothing writes to the arrays after Create()
+  m_size = file.header.size;
+  cerr << "words in corpus: " << m_size << endl;
+  m_array = const_cast< WORD_ID* >( file.text );
+  m_index = const_cast< INDEX* >( file.index );
+  m_wordInSentence = const_cast< char* >( file.word_in_sentence );
+  m_sentence = const_cast< INDEX* >( file.sentence );
+  m_sentenceCount = file.header.sentence_count;
+  cerr << "sentences in corpus: " << m_sentenceCount << endl;
+  m_sentenceLength = const_cast< char* >( file.sentence_length );
 
-  char useDocument = m_useDocument; // not sure if that is needed
-  fwrite( &useDocument, sizeof(char), 1, pFile );
   if (m_useDocument) {
-    fwrite( &m_documentCount, sizeof(INDEX), 1, pFile );
-    fwrite( m_document, sizeof(INDEX), m_documentCount, pFile );
-    fwrite( m_documentName, sizeof(INDEX), m_documentCount, pFile );
-    fwrite( &m_documentNameLength, sizeof(INDEX), 1, pFile );
-    fwrite( m_documentNameBuffer, sizeof(char), m_documentNameLength, pFile );
+    if (!file.header.has_documents) {
+      cerr << "Error: stored suffix array does not have a document index\n";
+      exit(1);
+    }
+    m_documentCount = file.header.document_count;
+    m_document = const_cast< INDEX* >( file.document );
+    m_documentName = const_cast< INDEX* >( file.document_name );
+    m_documentNameLength = file.header.document_name_length;
+    m_documentNameBuffer = const_cast< char* >( file.document_name_buffer );
   }
-  fclose( pFile );
 
-  m_vcb.Save( fileName + ".src-vcb" );
+  m_vcb.Load( fileName + ".src-vcb" );
 }
 
-void SuffixArray::Load(const string& fileName )
+// format written before suffix array files could be mapped
+void SuffixArray::LoadLegacy(const string& fileName )
 {
   FILE *pFile = fopen ( fileName.c_str() , "r" );
   if (pFile == NULL) Error("no such file or directory", fileName);
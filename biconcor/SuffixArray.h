@@ -2,6 +2,8 @@
 
 #include "Vocabulary.h"
 
+#include "util/mmap.hh"
+
 class SuffixArray
 {
 public:
@@ -10,7 +12,6 @@ public:
 private:
   WORD_ID *m_array;
   INDEX *m_index;
-  INDEX *m_buffer;
   char *m_wordInSentence;
   INDEX *m_sentence;
   char *m_sentenceLength;
@@ -24,6 +25,8 @@ private:
   Vocabulary m_vcb;
   INDEX m_size;
   INDEX m_sentenceCount;
+  // set when the arrays point into a loaded file instead of being allocated
+  util::scoped_memory m_mapping;
 
   // No copying allowed.
   SuffixArray(const SuffixArray&);
@@ -33,10 +36,8 @@ public:
   SuffixArray();
   ~SuffixArray();
 
-  void Create(const std::string& fileName );
+  void Create(const std::string& fileName, size_t threads = 1, const std::string& tempPrefix = "" );
   bool ProcessDocumentLine( const char* const, const size_t );
-  void Sort(INDEX start, INDEX end);
-  int CompareIndex( INDEX a, INDEX b ) const;
   inline int CompareWord( WORD_ID a, WORD_ID b ) const;
   int Count( const std::vector< WORD > &phrase );
   bool MinCount( const std::vector< WORD > &phrase, INDEX min );
@@ -77,6 +78,7 @@ public:
   }
   void Save(const std::string& fileName ) const;
   void Load(const std::string& fileName );
+  void LoadLegacy(const std::string& fileName );
   void CheckAllocation(bool, const char *dataStructure) const;
   bool Error( const char* message, const std::string& fileName) const;
 };
@@ -4,6 +4,7 @@
 #include "PhrasePairCollection.h"
 #include <getopt.h>
 #include "base64.h"
+#include "util/file.hh"
 
 using namespace std;
 
@@ -24,7 +25,9 @@ int main(int argc, char* argv[])
   int stdioFlag = false;  // receive requests from STDIN, respond to STDOUT
   int max_translation = 20;
   int max_example = 50;
-  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n";
+  size_t threads = 1;
+  string tempPrefix = "";
+  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n\t[--threads count]\n\t[--temp-dir directory]\n";
   while(1) {
     static struct option long_options[] = {
       {"load", required_argument, 0, 'l'},
@@ -38,10 +41,12 @@ int main(int argc, char* argv[])
       {"stdio", no_argument, 0, 'i'},
       {"translations", required_argument, 0, 'o'},
       {"examples", required_argument, 0, 'e'},
+      {"threads", required_argument, 0, 'j'},
+      {"temp-dir", required_argument, 0, 'T'},
       {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:", long_options, &option_index);
+    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:j:T:", long_options, &option_index);
     if (c == -1) break;
     switch (c) {
     case 'l':
@@ -76,6 +81,13 @@ int main(int argc, char* argv[])
     case 'e':
       max_example = atoi(optarg);
       break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 'T':
+      tempPrefix = string(optarg);
+      util::NormalizeTempPrefix(tempPrefix);
+      break;
     case 'p':
       prettyFlag = true;
       break;
@@ -119,7 +131,7 @@ int main(int argc, char* argv[])
   if (createFlag) {
     cerr << "will create\n";
     cerr << "source corpus is in " << fileNameSource << endl;
-    suffixArray.Create( fileNameSource );
+    suffixArray.Create( fileNameSource, threads, tempPrefix );
     cerr << "target corpus is in " << fileNameTarget << endl;
     targetCorpus.Create( fileNameTarget );
     cerr << "alignment is in " << fileNameAlignment << endl;
@@ -2,6 +2,7 @@
 
 #include "../TranslationModel/Memory/PhraseTableMemory.h"
 #include "../TranslationModel/ProbingPT.h"
+#include "../TranslationModel/CompactPT/PhraseTableCompact.h"
 #include "../TranslationModel/UnknownWordPenalty.h"
 
 #include "../LM/KENLM.h"
@@ -51,6 +52,7 @@ FeatureRegistry::FeatureRegistry()
 
   MOSES_FNAME2("PhraseDictionaryMemory", PhraseTableMemory);
   MOSES_FNAME(ProbingPT);
+  MOSES_FNAME2("PhraseDictionaryCompact", PhraseTableCompact);
   MOSES_FNAME(UnknownWordPenalty);
 
   Add("KENLM", new KenFactory());
@@ -4,6 +4,7 @@
  *  Created on: 4 Nov 2015
  *      Author: hieu
  */
+#include <algorithm>
 #include <boost/foreach.hpp>
 #include <sstream>
 #include <vector>
@@ -88,7 +89,10 @@ private:
 /////////////////////////////////////////////////////////////////
 KENLMBatch::KENLMBatch(size_t startInd, const std::string &line)
 :StatefulFeatureFunction(startInd, line)
+,m_batchSize(0)
+,m_batchLatency(0)
 ,m_numHypos(0)
+,m_leading(false)
 {
   cerr << "KENLMBatch::KENLMBatch" << endl;
   ReadParameters();
@@ -336,6 +340,12 @@ void KENLMBatch::SetParameter(const std::string& key,
       UTIL_THROW2("Unknown KenLM load method " << value);
     }
   }
+  else if (key == "batch-size") {
+    m_batchSize = Scan<size_t>(value);
+  }
+  else if (key == "batch-latency") {
+    m_batchLatency = Scan<size_t>(value);
+  }
   else {
     StatefulFeatureFunction::SetParameter(key, value);
   }
@@ -343,40 +353,167 @@ void KENLMBatch::SetParameter(const std::string& key,
   //cerr << "SetParameter done" << endl;
 }
 
-void KENLMBatch::EvaluateWhenAppliedBatch(
-    const Batch &batch) const
+/////////////////////////////////////////////////////////////////
+// A batch submitted by one decoder thread.  The thread waits until a leader,
+// possibly itself, has scored it.
+struct KENLMBatch::Request
 {
+  explicit Request(const Batch &b) :
+      batch(&b), done(false)
   {
-    // write lock
-    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-    m_batches.push_back(&batch);
-    m_numHypos += batch.size();
   }
-  //cerr << "m_numHypos=" << m_numHypos << endl;
 
-  if (m_numHypos > 0) {
-    // process batch
-    EvaluateWhenAppliedBatch();
+  const Batch *batch;
+  bool done;
+  std::string error;
+};
 
-    m_batches.clear();
-    m_numHypos = 0;
+// Held by the thread that is scoring for the others.  However the round
+// ends, it hands back the lead and wakes the waiting threads, failing the
+// requests it took if scoring did not finish, so nobody waits forever on
+// m_done.  Constructed and destroyed with m_mutex held by lock.
+class KENLMBatch::Lead
+{
+public:
+  Lead(const KENLMBatch &lm, boost::unique_lock<boost::mutex> &lock, Request &own) :
+      m_lm(lm), m_lock(lock), m_own(own), m_finished(false)
+  {
+    m_lm.m_leading = true;
+  }
 
-    m_threadNeeded.notify_all();
+  ~Lead()
+  {
+    if (!m_lock.owns_lock()) m_lock.lock();
+    BOOST_FOREACH(Request *taken, requests) {
+      if (!m_finished && taken->error.empty()) {
+        taken->error = "Batched language model scoring failed";
+      }
+      taken->done = true;
+    }
+    if (!m_finished) {
+      // the leader's own request lives on the stack its exception unwinds
+      std::vector<Request*> &pending = m_lm.m_pending;
+      std::vector<Request*>::iterator own = std::find(pending.begin(), pending.end(), &m_own);
+      if (own != pending.end()) {
+        m_lm.m_numHypos -= m_own.batch->size();
+        pending.erase(own);
+      }
+    }
+    m_lm.m_leading = false;
+    m_lm.m_done.notify_all();
   }
-  else {
-    boost::mutex::scoped_lock lock(m_mutex);
-    m_threadNeeded.wait(lock);
+
+  void Finished()
+  {
+    m_finished = true;
   }
+
+  std::vector<Request*> requests;
+
+private:
+  const KENLMBatch &m_lm;
+  boost::unique_lock<boost::mutex> &m_lock;
+  Request &m_own;
+  bool m_finished;
+};
+
+// Hypotheses ahead of the one being scored whose first lookup is prefetched.
+static const size_t PREFETCH_AHEAD = 8;
+
+void KENLMBatch::EvaluateWhenAppliedBatch(
+    const System &system,
+    const Batch &batch) const
+{
+  Request request(batch);
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  m_pending.push_back(&request);
+  m_numHypos += batch.size();
+  m_arrived.notify_one();
+
+  while (!request.done) {
+    if (m_leading) {
+      m_done.wait(lock);
+      continue;
+    }
+
+    // nobody is scoring. Lead, giving other threads until the latency budget
+    // runs out to add their batches
+    Lead lead(*this, lock, request);
+    if (m_batchLatency) {
+      boost::system_time deadline = boost::get_system_time()
+          + boost::posix_time::microseconds(m_batchLatency);
+      while ((m_batchSize == 0 || m_numHypos < m_batchSize)
+          && m_arrived.timed_wait(lock, deadline)) {
+      }
+    }
+
+    TakePending(lead.requests);
+
+    lock.unlock();
+    EvaluateRequests(lead.requests);
+    lock.lock();
+    lead.Finished();
+  }
+  lock.unlock();
+
+  UTIL_THROW_IF2(!request.error.empty(), request.error);
+}
+
+// Take the oldest pending requests, up to the batch size but at least one.
+// Called with m_mutex held.
+void KENLMBatch::TakePending(std::vector<Request*> &requests) const
+{
+  size_t numHypos = 0, taken = 0;
+  for (; taken < m_pending.size(); ++taken) {
+    size_t size = m_pending[taken]->batch->size();
+    if (taken && m_batchSize && numHypos + size > m_batchSize) break;
+    numHypos += size;
+  }
+  requests.assign(m_pending.begin(), m_pending.begin() + taken);
+  m_pending.erase(m_pending.begin(), m_pending.begin() + taken);
+  m_numHypos -= numHypos;
 }
 
-void KENLMBatch::EvaluateWhenAppliedBatch() const
+// Score the hypotheses of all requests as one stream, prefetching the table
+// entries of the first lookup of later hypotheses so the cache misses
+// overlap.
+void KENLMBatch::EvaluateRequests(const std::vector<Request*> &requests) const
 {
-  BOOST_FOREACH(const Batch *batch, m_batches) {
-    //cerr << "batch=" << batch->size() << endl;
-    BOOST_FOREACH(Hypothesis *hypo, *batch) {
-      hypo->EvaluateWhenApplied(*this);
+  std::vector<std::pair<Hypothesis*, Request*> > hypos;
+  BOOST_FOREACH(Request *request, requests) {
+    BOOST_FOREACH(Hypothesis *hypo, *request->batch) {
+      hypos.push_back(std::make_pair(hypo, request));
     }
   }
+
+  for (size_t i = 0; i < std::min(PREFETCH_AHEAD, hypos.size()); ++i) {
+    Prefetch(*hypos[i].first);
+  }
+
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    if (i + PREFETCH_AHEAD < hypos.size()) {
+      Prefetch(*hypos[i + PREFETCH_AHEAD].first);
+    }
+
+    Request &request = *hypos[i].second;
+    if (!request.error.empty()) continue;
+    try {
+      hypos[i].first->EvaluateWhenApplied(*this);
+    }
+    catch (const std::exception &e) {
+      request.error = e.what();
+    }
+  }
+}
+
+void KENLMBatch::Prefetch(const Hypothesis &hypo) const
+{
+  if (!hypo.GetTargetPhrase().GetSize()) return;
+
+  const lm::ngram::State &in_state =
+      static_cast<const KenLMState*>(hypo.GetPrevHypo()->GetState(GetStatefulInd()))->state;
+  m_ngram->Prefetch(in_state, TranslateID(hypo.GetTargetPhrase()[0]));
 }
 
 void KENLMBatch::EvaluateWhenApplied(const SCFG::Manager &mgr,
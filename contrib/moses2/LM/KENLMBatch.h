@@ -59,7 +59,10 @@ public:
       const SCFG::Hypothesis &hypo, int featureID, Scores &scores,
       FFState &state) const;
 
+  // Decoder threads calling this concurrently have their batches coalesced
+  // and scored together, see batch-size and batch-latency.
   virtual void EvaluateWhenAppliedBatch(
+      const System &system,
       const Batch &batch) const;
 
 protected:
@@ -86,15 +89,23 @@ protected:
   std::vector<lm::WordIndex> m_lmIdLookup;
 
   // batch
-  mutable std::vector<const Batch*> m_batches;
+  // Hypotheses a leader collects before scoring, 0 for no limit.
+  size_t m_batchSize;
+  // Microseconds a leader waits for other threads' batches.
+  size_t m_batchLatency;
+
+  struct Request;
+  class Lead;
+  mutable std::vector<Request*> m_pending;
   mutable size_t m_numHypos;
-
-  mutable boost::shared_mutex m_accessLock;
+  mutable bool m_leading;
 
   mutable boost::mutex m_mutex;
-  mutable boost::condition_variable m_threadNeeded;
+  mutable boost::condition_variable m_arrived, m_done;
 
-  void EvaluateWhenAppliedBatch() const;
+  void TakePending(std::vector<Request*> &requests) const;
+  void EvaluateRequests(const std::vector<Request*> &requests) const;
+  void Prefetch(const Hypothesis &hypo) const;
 
 };
 
@@ -20,6 +20,13 @@ using namespace std;
 
 namespace Moses2
 {
+namespace
+{
+void NoCleanup(MemPool *)
+{
+}
+}
+
 ManagerBase::ManagerBase(System &sys, const TranslationTask &task,
     const std::string &inputStr, long translationId)
 :system(sys)
@@ -29,6 +36,8 @@ ManagerBase::ManagerBase(System &sys, const TranslationTask &task,
 ,m_pool(NULL)
 ,m_systemPool(NULL)
 ,m_hypoRecycle(NULL)
+,m_workerPools(false)
+,m_workerPool(NoCleanup)
 {
 }
 
@@ -11,6 +11,7 @@
 #include <cstddef>
 #include <string>
 #include <deque>
+#include <boost/thread/tss.hpp>
 #include "Phrase.h"
 #include "MemPool.h"
 #include "Recycler.h"
@@ -46,7 +47,22 @@ public:
   virtual std::string OutputTransOpt() = 0;
 
   MemPool &GetPool() const
-  {  return *m_pool; }
+  {
+    if (m_workerPools) {
+      MemPool *pool = m_workerPool.get();
+      if (pool) {
+        return *pool;
+      }
+    }
+    return *m_pool;
+  }
+
+  // For searches that score hypotheses on several threads: make GetPool()
+  // return pool on the calling thread, NULL to return to the manager's pool.
+  void EnableWorkerPools()
+  {  m_workerPools = true; }
+  void SetWorkerPool(MemPool *pool) const
+  {  m_workerPool.reset(pool); }
 
   MemPool &GetSystemPool() const
   {  return *m_systemPool; }
@@ -68,6 +84,9 @@ protected:
   mutable MemPool *m_pool, *m_systemPool;
   mutable Recycler<HypothesisBase*> *m_hypoRecycle;
 
+  bool m_workerPools;
+  mutable boost::thread_specific_ptr<MemPool> m_workerPool; // not owned
+
   void InitPools();
 
 };
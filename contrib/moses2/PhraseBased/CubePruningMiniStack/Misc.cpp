@@ -5,6 +5,7 @@
  *      Author: hieu
  */
 
+#include <boost/foreach.hpp>
 #include "Misc.h"
 #include "Stack.h"
 #include "../Manager.h"
@@ -21,7 +22,8 @@ namespace NSCubePruningMiniStack
 {
 
 ////////////////////////////////////////////////////////////////////////
-QueueItem *QueueItem::Create(QueueItem *currItem, Manager &mgr, CubeEdge &edge,
+QueueItem *QueueItem::Create(QueueItem *currItem, Manager &mgr,
+    CubeMemory &memory, CubeEdge &edge,
     size_t hypoIndex, size_t tpIndex,
     QueueItemRecycler &queueItemRecycler)
 {
@@ -29,41 +31,41 @@ QueueItem *QueueItem::Create(QueueItem *currItem, Manager &mgr, CubeEdge &edge,
   if (currItem) {
     // reuse incoming queue item to create new item
     ret = currItem;
-    ret->Init(mgr, edge, hypoIndex, tpIndex);
+    ret->Init(mgr, memory, edge, hypoIndex, tpIndex);
   }
   else if (!queueItemRecycler.empty()) {
     // use item from recycle bin
     ret = queueItemRecycler.back();
-    ret->Init(mgr, edge, hypoIndex, tpIndex);
+    ret->Init(mgr, memory, edge, hypoIndex, tpIndex);
     queueItemRecycler.pop_back();
   }
   else {
     // create new item
-    ret = new (mgr.GetPool().Allocate<QueueItem>()) QueueItem(mgr, edge,
-        hypoIndex, tpIndex);
+    ret = new (memory.mgrPool.Allocate<QueueItem>()) QueueItem(mgr, memory,
+        edge, hypoIndex, tpIndex);
   }
 
   return ret;
 }
 
-QueueItem::QueueItem(Manager &mgr, CubeEdge &edge, size_t hypoIndex,
-    size_t tpIndex) :
+QueueItem::QueueItem(Manager &mgr, CubeMemory &memory, CubeEdge &edge,
+    size_t hypoIndex, size_t tpIndex) :
     edge(&edge), hypoIndex(hypoIndex), tpIndex(tpIndex)
 {
-  CreateHypothesis(mgr);
+  CreateHypothesis(mgr, memory);
 }
 
-void QueueItem::Init(Manager &mgr, CubeEdge &edge, size_t hypoIndex,
-    size_t tpIndex)
+void QueueItem::Init(Manager &mgr, CubeMemory &memory, CubeEdge &edge,
+    size_t hypoIndex, size_t tpIndex)
 {
   this->edge = &edge;
   this->hypoIndex = hypoIndex;
   this->tpIndex = tpIndex;
 
-  CreateHypothesis(mgr);
+  CreateHypothesis(mgr, memory);
 }
 
-void QueueItem::CreateHypothesis(Manager &mgr)
+void QueueItem::CreateHypothesis(Manager &mgr, CubeMemory &memory)
 {
   const Hypothesis *prevHypo =
       static_cast<const Hypothesis*>(edge->hypos[hypoIndex]);
@@ -74,7 +76,7 @@ void QueueItem::CreateHypothesis(Manager &mgr)
   //cerr << prevHypo << endl;
   //cerr << *prevHypo << endl;
 
-  hypo = Hypothesis::Create(mgr.GetSystemPool(), mgr);
+  hypo = Hypothesis::Create(memory.systemPool, mgr, memory.hypoRecycler);
   hypo->Init(mgr, *prevHypo, edge->path, tp, edge->newBitmap,
       edge->estimatedScore);
 
@@ -109,22 +111,22 @@ bool CubeEdge::SetSeenPosition(const size_t x, const size_t y,
   return pairRet.second;
 }
 
-void CubeEdge::CreateFirst(Manager &mgr, Queue &queue,
+void CubeEdge::CreateFirst(Manager &mgr, CubeMemory &memory, Queue &queue,
     SeenPositions &seenPositions,
     QueueItemRecycler &queueItemRecycler)
 {
   assert(hypos.size());
   assert(tps.GetSize());
 
-  QueueItem *item = QueueItem::Create(NULL, mgr, *this, 0, 0,
+  QueueItem *item = QueueItem::Create(NULL, mgr, memory, *this, 0, 0,
       queueItemRecycler);
   queue.push(item);
   bool setSeen = SetSeenPosition(0, 0, seenPositions);
   assert(setSeen);
 }
 
-void CubeEdge::CreateNext(Manager &mgr, QueueItem *item, Queue &queue,
-    SeenPositions &seenPositions,
+void CubeEdge::CreateNext(Manager &mgr, CubeMemory &memory, QueueItem *item,
+    Queue &queue, SeenPositions &seenPositions,
     QueueItemRecycler &queueItemRecycler)
 {
   size_t hypoIndex = item->hypoIndex;
@@ -133,8 +135,8 @@ void CubeEdge::CreateNext(Manager &mgr, QueueItem *item, Queue &queue,
   if (hypoIndex + 1 < hypos.size()
       && SetSeenPosition(hypoIndex + 1, tpIndex, seenPositions)) {
     // reuse incoming queue item to create new item
-    QueueItem *newItem = QueueItem::Create(item, mgr, *this, hypoIndex + 1,
-        tpIndex, queueItemRecycler);
+    QueueItem *newItem = QueueItem::Create(item, mgr, memory, *this,
+        hypoIndex + 1, tpIndex, queueItemRecycler);
     assert(newItem == item);
     queue.push(newItem);
     item = NULL;
@@ -142,8 +144,8 @@ void CubeEdge::CreateNext(Manager &mgr, QueueItem *item, Queue &queue,
 
   if (tpIndex + 1 < tps.GetSize()
       && SetSeenPosition(hypoIndex, tpIndex + 1, seenPositions)) {
-    QueueItem *newItem = QueueItem::Create(item, mgr, *this, hypoIndex,
-        tpIndex + 1, queueItemRecycler);
+    QueueItem *newItem = QueueItem::Create(item, mgr, memory, *this,
+        hypoIndex, tpIndex + 1, queueItemRecycler);
     queue.push(newItem);
     item = NULL;
   }
@@ -154,6 +156,122 @@ void CubeEdge::CreateNext(Manager &mgr, QueueItem *item, Queue &queue,
   }
 }
 
+////////////////////////////////////////////////////////////////////////
+MiniStackCube::MiniStackCube(CubeWorker &worker) :
+    worker(worker)
+, m_queue(QueueItemOrderer(),
+    std::vector<QueueItem*, MemPoolAllocator<QueueItem*> >(
+        MemPoolAllocator<QueueItem*>(worker.memory.mgrPool)))
+, m_seenPositions(
+    MemPoolAllocator<CubeEdge::SeenPositionItem>(worker.memory.mgrPool))
+, m_queueItemRecycler(MemPoolAllocator<QueueItem*>(worker.memory.mgrPool))
+, m_taken(0)
+{
+}
+
+void MiniStackCube::Expand(Manager &mgr, const std::vector<CubeEdge*> &edges,
+    size_t maxPops)
+{
+  BOOST_FOREACH(CubeEdge *edge, edges) {
+    edge->CreateFirst(mgr, worker.memory, m_queue, m_seenPositions,
+        m_queueItemRecycler);
+  }
+
+  while (!m_queue.empty() && m_popped.size() < maxPops) {
+    Pop(mgr);
+  }
+}
+
+Hypothesis *MiniStackCube::Next(Manager &mgr)
+{
+  if (m_taken == m_popped.size()) {
+    Pop(mgr);
+  }
+  return m_popped[m_taken++].hypo;
+}
+
+void MiniStackCube::Pop(Manager &mgr)
+{
+  QueueItem *item = m_queue.top();
+  m_queue.pop();
+
+  Popped popped;
+  popped.hypo = item->hypo;
+  popped.score = item->hypo->GetFutureScore();
+  popped.first = item->hypoIndex == 0 && item->tpIndex == 0;
+
+  if (mgr.system.options.cube.lazy_scoring) {
+    popped.hypo->EvaluateWhenApplied();
+  }
+  m_popped.push_back(popped);
+
+  // may reuse item
+  item->edge->CreateNext(mgr, worker.memory, item, m_queue, m_seenPositions,
+      m_queueItemRecycler);
+}
+
+void MiniStackCube::Finish(Manager &mgr, Stack &stack)
+{
+  bool diversity = mgr.system.options.cube.diversity;
+  Recycler<HypothesisBase*> &hypoRecycler = worker.memory.hypoRecycler;
+
+  for (size_t i = m_taken; i < m_popped.size(); ++i) {
+    const Popped &popped = m_popped[i];
+    if (diversity && popped.first) {
+      stack.Add(popped.hypo, hypoRecycler, mgr.arcLists);
+    }
+    else {
+      hypoRecycler.Recycle(popped.hypo);
+    }
+  }
+  m_popped.clear();
+  m_taken = 0;
+
+  std::vector<QueueItem*, MemPoolAllocator<QueueItem*> > &container = Container(
+      m_queue);
+  BOOST_FOREACH(QueueItem *item, container) {
+    if (diversity && item->hypoIndex == 0 && item->tpIndex == 0) {
+      stack.Add(item->hypo, hypoRecycler, mgr.arcLists);
+    }
+    else {
+      hypoRecycler.Recycle(item->hypo);
+    }
+    m_queueItemRecycler.push_back(item);
+  }
+  container.clear();
+
+  m_seenPositions.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+CubeWorker::CubeWorker(Manager &mgr) :
+    memory(mgr.GetSystemPool(), mgr.GetPool(), mgr.GetHypoRecycle())
+{
+}
+
+CubeWorker::CubeWorker() :
+    memory(m_pool, m_pool, m_hypoRecycler)
+{
+}
+
+CubeWorker::~CubeWorker()
+{
+  RemoveAllInColl(m_cubes);
+}
+
+MiniStackCube *CubeWorker::GetCube()
+{
+  if (!m_cubeRecycler.empty()) {
+    MiniStackCube *cube = m_cubeRecycler.back();
+    m_cubeRecycler.pop_back();
+    return cube;
+  }
+
+  MiniStackCube *cube = new MiniStackCube(*this);
+  m_cubes.push_back(cube);
+  return cube;
+}
+
 }
 
 }
@@ -31,24 +31,44 @@ class CubeEdge;
 class QueueItem;
 typedef std::deque<QueueItem*, MemPoolAllocator<QueueItem*> > QueueItemRecycler;
 
+///////////////////////////////////////////
+// Where queue items and hypotheses are allocated. The sequential search uses
+// the manager's pools, each parallel search worker has its own.
+struct CubeMemory
+{
+  MemPool &systemPool; // hypotheses
+  MemPool &mgrPool; // queue items
+  Recycler<HypothesisBase*> &hypoRecycler;
+
+  CubeMemory(MemPool &systemPool, MemPool &mgrPool,
+      Recycler<HypothesisBase*> &hypoRecycler)
+  :systemPool(systemPool)
+  ,mgrPool(mgrPool)
+  ,hypoRecycler(hypoRecycler)
+  {}
+};
+
 ///////////////////////////////////////////
 class QueueItem
 {
   ~QueueItem(); // NOT IMPLEMENTED. Use MemPool
 public:
-  static QueueItem *Create(QueueItem *currItem, Manager &mgr, CubeEdge &edge,
+  static QueueItem *Create(QueueItem *currItem, Manager &mgr,
+      CubeMemory &memory, CubeEdge &edge,
       size_t hypoIndex, size_t tpIndex,
       QueueItemRecycler &queueItemRecycler);
-  QueueItem(Manager &mgr, CubeEdge &edge, size_t hypoIndex, size_t tpIndex);
+  QueueItem(Manager &mgr, CubeMemory &memory, CubeEdge &edge,
+      size_t hypoIndex, size_t tpIndex);
 
-  void Init(Manager &mgr, CubeEdge &edge, size_t hypoIndex, size_t tpIndex);
+  void Init(Manager &mgr, CubeMemory &memory, CubeEdge &edge,
+      size_t hypoIndex, size_t tpIndex);
 
   CubeEdge *edge;
   size_t hypoIndex, tpIndex;
   Hypothesis *hypo;
 
 protected:
-  void CreateHypothesis(Manager &mgr);
+  void CreateHypothesis(Manager &mgr, CubeMemory &memory);
 };
 
 ///////////////////////////////////////////
@@ -85,11 +105,12 @@ public:
   bool SetSeenPosition(const size_t x, const size_t y,
       SeenPositions &seenPositions) const;
 
-  void CreateFirst(Manager &mgr, Queue &queue, SeenPositions &seenPositions,
-      QueueItemRecycler &queueItemRecycler);
-  void CreateNext(Manager &mgr, QueueItem *item, Queue &queue,
+  void CreateFirst(Manager &mgr, CubeMemory &memory, Queue &queue,
       SeenPositions &seenPositions,
       QueueItemRecycler &queueItemRecycler);
+  void CreateNext(Manager &mgr, CubeMemory &memory, QueueItem *item,
+      Queue &queue, SeenPositions &seenPositions,
+      QueueItemRecycler &queueItemRecycler);
 
   std::string Debug(const System &system) const;
 
@@ -97,6 +118,82 @@ protected:
 
 };
 
+///////////////////////////////////////////
+// Cube pruning over the edges that lead to one mini-stack. The parallel
+// search expands every cube ahead on a worker, then takes hypotheses from
+// the cubes in the order that one queue over all edges would have popped
+// them, so the result is the same as the sequential search.
+class CubeWorker;
+
+class MiniStackCube
+{
+public:
+  CubeWorker &worker;
+
+  MiniStackCube(CubeWorker &worker);
+
+  // Create the first hypothesis of each edge and pop up to maxPops ahead.
+  void Expand(Manager &mgr, const std::vector<CubeEdge*> &edges,
+      size_t maxPops);
+
+  bool HasNext() const
+  { return m_taken < m_popped.size() || !m_queue.empty(); }
+
+  // score the next hypothesis had in the queue
+  SCORE GetNextScore() const
+  {
+    return m_taken < m_popped.size() ?
+        m_popped[m_taken].score : m_queue.top()->hypo->GetFutureScore();
+  }
+
+  Hypothesis *Next(Manager &mgr);
+
+  // Add the leftover first hypotheses of each edge to stack if
+  // cube-pruning-diversity is set, recycle everything else.
+  void Finish(Manager &mgr, Stack &stack);
+
+protected:
+  struct Popped
+  {
+    Hypothesis *hypo;
+    SCORE score;
+    bool first;
+  };
+
+  CubeEdge::Queue m_queue;
+  CubeEdge::SeenPositions m_seenPositions;
+  QueueItemRecycler m_queueItemRecycler;
+
+  std::vector<Popped> m_popped;
+  size_t m_taken;
+
+  void Pop(Manager &mgr);
+};
+
+///////////////////////////////////////////
+// Memory of one parallel search worker. Hypotheses can be recycled by any
+// worker, the pools all live until the end of the sentence.
+class CubeWorker
+{
+public:
+  CubeMemory memory;
+
+  // uses the manager's pools, for the decoding thread
+  CubeWorker(Manager &mgr);
+  // with its own pools
+  CubeWorker();
+  ~CubeWorker();
+
+  MiniStackCube *GetCube();
+  void Recycle(MiniStackCube *cube)
+  { m_cubeRecycler.push_back(cube); }
+
+protected:
+  MemPool m_pool;
+  Recycler<HypothesisBase*> m_hypoRecycler;
+  std::vector<MiniStackCube*> m_cubes, m_cubeRecycler;
+};
+
 }
 
 }
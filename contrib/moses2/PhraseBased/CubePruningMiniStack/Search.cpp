@@ -18,6 +18,8 @@
 #include "../../TranslationTask.h"
 #include "../../legacy/Util2.h"
 #include "../../PhraseBased/TargetPhrases.h"
+#include "../../legacy/ThreadPool.h"
+#include "util/exception.hh"
 
 using namespace std;
 
@@ -27,6 +29,34 @@ namespace Moses2
 namespace NSCubePruningMiniStack
 {
 
+namespace
+{
+class WorkerTask: public Task
+{
+public:
+  WorkerTask(Search &search, size_t workerInd)
+  :m_search(search)
+  ,m_workerInd(workerInd)
+  {}
+
+  void Run()
+  {  m_search.RunWorker(m_workerInd); }
+
+protected:
+  Search &m_search;
+  size_t m_workerInd;
+};
+
+class CubeOrderer
+{
+public:
+  bool operator()(const MiniStackCube *a, const MiniStackCube *b) const
+  {
+    return a->GetNextScore() < b->GetNextScore();
+  }
+};
+}
+
 ////////////////////////////////////////////////////////////////////////
 Search::Search(Manager &mgr) :
         		Moses2::Search(mgr), m_stack(mgr), m_cubeEdgeAlloc(mgr.GetPool())
@@ -40,11 +70,22 @@ Search::Search(Manager &mgr) :
 
 , m_queueItemRecycler(MemPoolAllocator<QueueItem*>(mgr.GetPool()))
 
+, m_memory(mgr.GetSystemPool(), mgr.GetPool(), mgr.GetHypoRecycle())
+, m_threadPool(mgr.system.GetSearchThreadPool())
 {
+	if (m_threadPool) {
+		mgr.EnableWorkerPools();
+
+		m_workers.push_back(new CubeWorker(mgr));
+		for (size_t i = 1; i < mgr.system.options.cube.threads; ++i) {
+			m_workers.push_back(new CubeWorker());
+		}
+	}
 }
 
 Search::~Search()
 {
+	RemoveAllInColl(m_workers);
 }
 
 void Search::Decode()
@@ -72,7 +113,12 @@ void Search::Decode()
 			++stackInd) {
 		//cerr << "stackInd=" << stackInd << endl;
 		m_stack.Clear();
-		Decode(stackInd);
+		if (m_threadPool) {
+			DecodeParallel(stackInd);
+		}
+		else {
+			Decode(stackInd);
+		}
 		PostDecode(stackInd);
 
 		//m_stack.DebugCounts();
@@ -106,7 +152,8 @@ void Search::Decode(size_t stackInd)
 
 	BOOST_FOREACH(CubeEdge *edge, edges){
 		//cerr << *edge << " ";
-		edge->CreateFirst(mgr, m_queue, m_seenPositions, m_queueItemRecycler);
+		edge->CreateFirst(mgr, m_memory, m_queue, m_seenPositions,
+				m_queueItemRecycler);
 	}
 
 	/*
@@ -139,7 +186,8 @@ void Search::Decode(size_t stackInd)
 		//cerr << "hypo=" << *hypo << " " << hypo->GetBitmap() << endl;
 		m_stack.Add(hypo, hypoRecycler, mgr.arcLists);
 
-		edge->CreateNext(mgr, item, m_queue, m_seenPositions, m_queueItemRecycler);
+		edge->CreateNext(mgr, m_memory, item, m_queue, m_seenPositions,
+				m_queueItemRecycler);
 
 		++pops;
 	}
@@ -160,6 +208,122 @@ void Search::Decode(size_t stackInd)
 	}
 }
 
+void Search::DecodeParallel(size_t stackInd)
+{
+	// one group of edges per mini-stack, in the order the edges were created
+	CubeEdges &edges = *m_cubeEdges[stackInd];
+
+	m_groupInds.clear();
+	size_t numGroups = 0;
+	BOOST_FOREACH(CubeEdge *edge, edges){
+		Stack::HypoCoverage key(&edge->newBitmap, edge->path.range.GetEndPos());
+		std::pair<boost::unordered_map<Stack::HypoCoverage, size_t>::iterator, bool> ret =
+				m_groupInds.insert(std::make_pair(key, numGroups));
+		if (ret.second) {
+			if (m_groups.size() == numGroups) {
+				m_groups.resize(numGroups + 1);
+			}
+			m_groups[numGroups].clear();
+			++numGroups;
+		}
+		m_groups[ret.first->second].push_back(edge);
+	}
+	m_groups.resize(numGroups);
+
+	if (numGroups == 0) {
+		return;
+	}
+
+	// expand every cube ahead by its share of the pop limit
+	size_t popLimit = mgr.system.options.cube.pop_limit;
+	m_maxPops = popLimit / numGroups + 1;
+	m_cubes.assign(numGroups, NULL);
+	m_nextGroup = 0;
+	m_error.clear();
+
+	m_workersRunning = std::min(m_workers.size(), numGroups);
+	for (size_t i = 1; i < m_workersRunning; ++i) {
+		boost::shared_ptr<Task> task(new WorkerTask(*this, i));
+		m_threadPool->Submit(task);
+	}
+	RunWorker(0);
+
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while (m_workersRunning) {
+			m_workersDone.wait(lock);
+		}
+	}
+	UTIL_THROW_IF2(!m_error.empty(), m_error);
+
+	// take hypos in the order one queue over all cubes would have popped them.
+	// A cube that runs out of hypos popped ahead pops more on this thread
+	std::priority_queue<MiniStackCube*, std::vector<MiniStackCube*>, CubeOrderer> cubes;
+	BOOST_FOREACH(MiniStackCube *cube, m_cubes){
+		if (cube->HasNext()) {
+			cubes.push(cube);
+		}
+	}
+
+	size_t pops = 0;
+	while (!cubes.empty() && pops < popLimit) {
+		MiniStackCube *cube = cubes.top();
+		cubes.pop();
+
+		Hypothesis *hypo = cube->Next(mgr);
+		m_stack.Add(hypo, cube->worker.memory.hypoRecycler, mgr.arcLists);
+
+		if (cube->HasNext()) {
+			cubes.push(cube);
+		}
+		++pops;
+	}
+
+	BOOST_FOREACH(MiniStackCube *cube, m_cubes){
+		cube->Finish(mgr, m_stack);
+		cube->worker.Recycle(cube);
+	}
+}
+
+void Search::RunWorker(size_t workerInd)
+{
+	CubeWorker &worker = *m_workers[workerInd];
+	if (workerInd) {
+		// feature functions allocate state from mgr.GetPool()
+		mgr.SetWorkerPool(&worker.memory.mgrPool);
+	}
+
+	try {
+		while (true) {
+			size_t groupInd;
+			{
+				boost::unique_lock<boost::mutex> lock(m_mutex);
+				if (m_nextGroup == m_groups.size() || !m_error.empty()) {
+					break;
+				}
+				groupInd = m_nextGroup++;
+			}
+
+			MiniStackCube *cube = worker.GetCube();
+			m_cubes[groupInd] = cube;
+			cube->Expand(mgr, m_groups[groupInd], m_maxPops);
+		}
+	}
+	catch (const std::exception &e) {
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		m_error = e.what();
+	}
+
+	if (workerInd) {
+		mgr.SetWorkerPool(NULL);
+	}
+
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	if (--m_workersRunning == 0) {
+		m_workersDone.notify_all();
+	}
+}
+
 void Search::PostDecode(size_t stackInd)
 {
 	MemPool &pool = mgr.GetPool();
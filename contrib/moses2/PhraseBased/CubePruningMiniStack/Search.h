@@ -7,6 +7,9 @@
 
 #pragma once
 #include <boost/pool/pool_alloc.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
 #include "../Search.h"
 #include "Misc.h"
 #include "Stack.h"
@@ -20,6 +23,7 @@ class Hypothesis;
 class InputPath;
 class TargetPhrases;
 class TargetPhraseImpl;
+class ThreadPool;
 
 namespace NSCubePruningMiniStack
 {
@@ -35,6 +39,10 @@ public:
 
   void AddInitialTrellisPaths(TrellisPaths<TrellisPath> &paths) const;
 
+  // expand mini-stack cubes until there are none left. Called on the search
+  // threads, workerInd 0 is the decoding thread
+  void RunWorker(size_t workerInd);
+
 protected:
   Stack m_stack;
 
@@ -48,10 +56,28 @@ protected:
   std::vector<CubeEdges*> m_cubeEdges;
 
   QueueItemRecycler m_queueItemRecycler;
+  CubeMemory m_memory;
+
+  // PARALLEL CUBE PRUNING
+  // the edges of a stack are split by the mini-stack they lead to, each
+  // mini-stack's cube is expanded on a worker
+  ThreadPool *m_threadPool;
+  std::vector<CubeWorker*> m_workers;
+
+  boost::unordered_map<Stack::HypoCoverage, size_t> m_groupInds;
+  std::vector<std::vector<CubeEdge*> > m_groups;
+  std::vector<MiniStackCube*> m_cubes;
+  size_t m_maxPops;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_workersDone;
+  size_t m_nextGroup, m_workersRunning;
+  std::string m_error;
 
   // CUBE PRUNING
   // decoding
   void Decode(size_t stackInd);
+  void DecodeParallel(size_t stackInd);
   void PostDecode(size_t stackInd);
 };
 
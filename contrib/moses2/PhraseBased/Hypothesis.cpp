@@ -22,11 +22,16 @@ using namespace std;
 namespace Moses2
 {
 Hypothesis *Hypothesis::Create(MemPool &pool, Manager &mgr)
+{
+  return Create(pool, mgr, mgr.GetHypoRecycle());
+}
+
+Hypothesis *Hypothesis::Create(MemPool &pool, Manager &mgr,
+    Recycler<HypothesisBase*> &recycler)
 {
 //	++g_numHypos;
   Hypothesis *ret;
 
-  Recycler<HypothesisBase*> &recycler = mgr.GetHypoRecycle();
   ret = static_cast<Hypothesis*>(recycler.Get());
   if (ret) {
     // got new hypo from recycler. Do nothing
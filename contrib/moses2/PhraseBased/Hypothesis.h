@@ -15,6 +15,7 @@
 #include "../TargetPhrase.h"
 #include "../InputPathBase.h"
 #include "../HypothesisBase.h"
+#include "../Recycler.h"
 #include "../legacy/Range.h"
 
 namespace Moses2
@@ -31,6 +32,8 @@ class Hypothesis: public HypothesisBase
 public:
 
   static Hypothesis *Create(MemPool &pool, Manager &mgr);
+  static Hypothesis *Create(MemPool &pool, Manager &mgr,
+      Recycler<HypothesisBase*> &recycler);
   virtual ~Hypothesis();
 
   // initial, empty hypo
@@ -13,6 +13,7 @@
 #include "FF/FeatureFunction.h"
 #include "TranslationModel/UnknownWordPenalty.h"
 #include "legacy/Util2.h"
+#include "legacy/ThreadPool.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -61,6 +62,10 @@ System::System(const Parameter &paramsArg) :
 
   UTIL_THROW_IF2(options.input.xml_policy == XmlConstraint, "XmlConstraint not supported");
 
+  if (options.cube.threads > 1) {
+    m_searchThreadPool.reset(new ThreadPool(options.cube.threads));
+  }
+
   // max spans for scfg decoding
   if (!isPb) {
     section = params.GetParam("max-chart-span");
@@ -33,6 +33,7 @@ class FeatureFunction;
 class StatefulFeatureFunction;
 class PhraseTable;
 class HypothesisBase;
+class ThreadPool;
 
 class System
 {
@@ -63,6 +64,11 @@ public:
 
   Batch &GetBatch(MemPool &pool) const;
 
+  // threads shared by all sentences for intra-sentence parallel search.
+  // NULL unless cube-pruning-threads > 1
+  ThreadPool *GetSearchThreadPool() const
+  {  return m_searchThreadPool.get(); }
+
 protected:
   mutable FactorCollection m_vocab;
   mutable boost::thread_specific_ptr<MemPool> m_managerPool;
@@ -72,6 +78,8 @@ protected:
 
   mutable boost::thread_specific_ptr<Batch> m_batch;
 
+  boost::shared_ptr<ThreadPool> m_searchThreadPool;
+
   void LoadWeights();
   void LoadMappings();
   void LoadDecodeGraphBackoff();
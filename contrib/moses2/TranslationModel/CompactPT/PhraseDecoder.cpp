@@ -0,0 +1,438 @@
+/*
+ * PhraseDecoder.cpp
+ *
+ * Port of moses/TranslationModel/CompactPT/PhraseDecoder.cpp.
+ */
+#include "PhraseDecoder.h"
+#include "PhraseTableCompact.h"
+
+using namespace std;
+
+namespace Moses2
+{
+
+namespace
+{
+
+inline size_t GetREncType(unsigned encodedSymbol)
+{
+  return (encodedSymbol >> 30) + 1;
+}
+
+inline size_t GetPREncType(unsigned encodedSymbol)
+{
+  return (encodedSymbol >> 31) + 1;
+}
+
+inline unsigned DecodeREncSymbol1(unsigned encodedSymbol)
+{
+  return encodedSymbol & ~(3 << 30);
+}
+
+inline unsigned DecodeREncSymbol2Rank(unsigned encodedSymbol)
+{
+  return encodedSymbol & ~(255 << 24);
+}
+
+inline unsigned DecodeREncSymbol2Position(unsigned encodedSymbol)
+{
+  encodedSymbol &= ~(3 << 30);
+  encodedSymbol >>= 24;
+  return encodedSymbol;
+}
+
+inline unsigned DecodeREncSymbol3(unsigned encodedSymbol)
+{
+  return encodedSymbol & ~(3 << 30);
+}
+
+inline unsigned DecodePREncSymbol1(unsigned encodedSymbol)
+{
+  return encodedSymbol & ~(1 << 31);
+}
+
+inline int DecodePREncSymbol2Left(unsigned encodedSymbol)
+{
+  return ((encodedSymbol >> 25) & 63) - 32;
+}
+
+inline int DecodePREncSymbol2Right(unsigned encodedSymbol)
+{
+  return ((encodedSymbol >> 19) & 63) - 32;
+}
+
+inline unsigned DecodePREncSymbol2Rank(unsigned encodedSymbol)
+{
+  return (encodedSymbol & 524287);
+}
+
+}
+
+PhraseDecoder::PhraseDecoder(PhraseTableCompact &phraseTable,
+    size_t numScoreComponent)
+:m_coding(None)
+,m_numScoreComponent(numScoreComponent)
+,m_containsAlignmentInfo(true)
+,m_maxRank(0)
+,m_maxPhraseLength(0)
+,m_symbolTree(0)
+,m_multipleScoreTrees(false)
+,m_scoreTrees(1)
+,m_alignTree(0)
+,m_phraseTable(phraseTable)
+{
+}
+
+PhraseDecoder::~PhraseDecoder()
+{
+  delete m_symbolTree;
+  for (size_t i = 0; i < m_scoreTrees.size(); i++) {
+    delete m_scoreTrees[i];
+  }
+  delete m_alignTree;
+}
+
+size_t PhraseDecoder::Load(std::FILE* in)
+{
+  size_t start = std::ftell(in);
+  size_t read = 0;
+
+  read += std::fread(&m_coding, sizeof(m_coding), 1, in);
+  read += std::fread(&m_numScoreComponent, sizeof(m_numScoreComponent), 1, in);
+  read += std::fread(&m_containsAlignmentInfo, sizeof(m_containsAlignmentInfo), 1, in);
+  read += std::fread(&m_maxRank, sizeof(m_maxRank), 1, in);
+  read += std::fread(&m_maxPhraseLength, sizeof(m_maxPhraseLength), 1, in);
+
+  if (m_coding == REnc) {
+    m_sourceSymbols.load(in);
+
+    size_t size;
+    read += std::fread(&size, sizeof(size_t), 1, in);
+    m_lexicalTableIndex.resize(size);
+    read += std::fread(&m_lexicalTableIndex[0], sizeof(size_t), size, in);
+
+    read += std::fread(&size, sizeof(size_t), 1, in);
+    m_lexicalTable.resize(size);
+    read += std::fread(&m_lexicalTable[0], sizeof(SrcTrg), size, in);
+  }
+
+  m_targetSymbols.load(in);
+
+  m_symbolTree = new CanonicalHuffman<unsigned>(in);
+
+  read += std::fread(&m_multipleScoreTrees, sizeof(m_multipleScoreTrees), 1, in);
+  if (m_multipleScoreTrees) {
+    m_scoreTrees.resize(m_numScoreComponent);
+    for (size_t i = 0; i < m_numScoreComponent; i++) {
+      m_scoreTrees[i] = new CanonicalHuffman<float>(in);
+    }
+  }
+  else {
+    m_scoreTrees.resize(1);
+    m_scoreTrees[0] = new CanonicalHuffman<float>(in);
+  }
+
+  if (m_containsAlignmentInfo) {
+    m_alignTree = new CanonicalHuffman<AlignPoint>(in);
+  }
+
+  size_t end = std::ftell(in);
+  return end - start;
+}
+
+std::string PhraseDecoder::GetTargetSymbol(unsigned idx) const
+{
+  if (idx < m_targetSymbols.size()) {
+    return m_targetSymbols[idx];
+  }
+  return std::string("##ERROR##");
+}
+
+PhraseDecoder::Cache &PhraseDecoder::GetCache()
+{
+  Cache *cache = m_cache.get();
+  if (cache == NULL) {
+    cache = new Cache();
+    m_cache.reset(cache);
+  }
+  return *cache;
+}
+
+unsigned PhraseDecoder::GetSourceSymbolId(const std::string& symbol)
+{
+  SourceSymbolMap *symbols = m_sourceSymbolsMap.get();
+  if (symbols == NULL) {
+    symbols = new SourceSymbolMap();
+    m_sourceSymbolsMap.reset(symbols);
+  }
+
+  SourceSymbolMap::const_iterator it = symbols->find(symbol);
+  if (it != symbols->end()) {
+    return it->second;
+  }
+
+  unsigned idx = m_sourceSymbols.find(symbol);
+  (*symbols)[symbol] = idx;
+  return idx;
+}
+
+TPCompactVectorPtr PhraseDecoder::CreateTargetPhraseCollection(
+    const std::vector<std::string> &sourceWords, size_t start, size_t end,
+    bool topLevel)
+{
+  std::string key = sourceWords[start];
+  for (size_t i = start + 1; i <= end; ++i) {
+    key += " ";
+    key += sourceWords[i];
+  }
+
+  TPCompactVectorPtr tpv(new TPCompactVector());
+  size_t bitsLeft = 0;
+
+  if (m_coding == PREnc) {
+    Cache &cache = GetCache();
+    Cache::const_iterator cached = cache.find(key);
+    if (cached != cache.end()) {
+      // Complete, or does not need to be completed
+      if (!topLevel || cached->second.second == 0) {
+        return cached->second.first;
+      }
+      // Cached, but incomplete
+      bitsLeft = cached->second.second;
+      *tpv = *cached->second.first;
+    }
+  }
+
+  key += " ||| ";
+  size_t sourcePhraseId = m_phraseTable.m_hash[key];
+  if (sourcePhraseId == m_phraseTable.m_hash.GetSize()) {
+    return TPCompactVectorPtr();
+  }
+
+  // Retrieve compressed and encoded target phrase collection
+  std::string encodedPhraseCollection;
+  if (m_phraseTable.m_inMemory) {
+    encodedPhraseCollection =
+        m_phraseTable.m_targetPhrasesMemory[sourcePhraseId].str();
+  }
+  else {
+    encodedPhraseCollection =
+        m_phraseTable.m_targetPhrasesMapped[sourcePhraseId].str();
+  }
+
+  BitWrapper<> encodedBitStream(encodedPhraseCollection);
+  if (m_coding == PREnc && bitsLeft) {
+    encodedBitStream.SeekFromEnd(bitsLeft);
+  }
+
+  key.resize(key.size() - 5);
+  return DecodeCollection(tpv, encodedBitStream, sourceWords, start, end,
+      topLevel, key);
+}
+
+TPCompactVectorPtr PhraseDecoder::DecodeCollection(TPCompactVectorPtr tpv,
+    BitWrapper<> &encodedBitStream,
+    const std::vector<std::string> &sourceWords, size_t start, size_t end,
+    bool topLevel, const std::string &key)
+{
+  bool extending = tpv->size();
+  size_t bitsLeft = encodedBitStream.TellFromEnd();
+  const size_t srcSize = end - start + 1;
+  const bool useAlignmentInfo = m_phraseTable.m_useAlignmentInfo;
+
+  std::vector<unsigned> sourceSymbols;
+  if (m_coding == REnc) {
+    for (size_t i = start; i <= end; i++) {
+      sourceSymbols.push_back(GetSourceSymbolId(sourceWords[i]));
+    }
+  }
+
+  unsigned phraseStopSymbol = 0;
+  AlignPoint alignStopSymbol(-1, -1);
+
+  enum DecodeState
+  {
+    New, Symbol, Score, Alignment, Add
+  } state = New;
+
+  TPCompact* targetPhrase = NULL;
+  while (encodedBitStream.TellFromEnd()) {
+
+    if (state == New) {
+      tpv->push_back(TPCompact());
+      targetPhrase = &tpv->back();
+      state = Symbol;
+    }
+
+    if (state == Symbol) {
+      unsigned symbol = m_symbolTree->Read(encodedBitStream);
+      if (symbol == phraseStopSymbol) {
+        state = Score;
+      }
+      else if (m_coding == REnc) {
+        unsigned word = 0;
+        size_t type = GetREncType(symbol);
+
+        if (type == 1) {
+          word = DecodeREncSymbol1(symbol);
+        }
+        else if (type == 2) {
+          size_t rank = DecodeREncSymbol2Rank(symbol);
+          size_t srcPos = DecodeREncSymbol2Position(symbol);
+
+          if (srcPos >= sourceSymbols.size()) {
+            return TPCompactVectorPtr();
+          }
+
+          word = GetTranslation(sourceSymbols[srcPos], rank);
+          if (useAlignmentInfo) {
+            targetPhrase->alignment.insert(
+                std::pair<size_t, size_t>(srcPos, targetPhrase->words.size()));
+          }
+        }
+        else if (type == 3) {
+          size_t rank = DecodeREncSymbol3(symbol);
+          size_t srcPos = targetPhrase->words.size();
+
+          if (srcPos >= sourceSymbols.size()) {
+            return TPCompactVectorPtr();
+          }
+
+          word = GetTranslation(sourceSymbols[srcPos], rank);
+          if (useAlignmentInfo) {
+            targetPhrase->alignment.insert(
+                std::pair<size_t, size_t>(srcPos, srcPos));
+          }
+        }
+
+        targetPhrase->words.push_back(word);
+      }
+      else if (m_coding == PREnc) {
+        // if the symbol is just a word
+        if (GetPREncType(symbol) == 1) {
+          targetPhrase->words.push_back(DecodePREncSymbol1(symbol));
+        }
+        // if the symbol is a subphrase pointer
+        else {
+          int left = DecodePREncSymbol2Left(symbol);
+          int right = DecodePREncSymbol2Right(symbol);
+          unsigned rank = DecodePREncSymbol2Rank(symbol);
+
+          int srcStart = left + targetPhrase->words.size();
+          int srcEnd = srcSize - right - 1;
+
+          // false positive consistency check
+          if (0 > srcStart || srcStart > srcEnd || unsigned(srcEnd) >= srcSize) {
+            return TPCompactVectorPtr();
+          }
+
+          // false positive consistency check
+          if (m_maxRank && rank > m_maxRank) {
+            return TPCompactVectorPtr();
+          }
+
+          // set subphrase by default to itself
+          TPCompactVectorPtr subTpv = tpv;
+
+          // if range smaller than source phrase retrieve subphrase
+          if (unsigned(srcEnd - srcStart + 1) != srcSize) {
+            subTpv = CreateTargetPhraseCollection(sourceWords,
+                start + srcStart, start + srcEnd, false);
+          }
+          else if (rank >= tpv->size() - 1) {
+            // false positive consistency check
+            return TPCompactVectorPtr();
+          }
+
+          // false positive consistency check
+          if (subTpv == NULL || rank >= subTpv->size()) {
+            return TPCompactVectorPtr();
+          }
+
+          // insert the subphrase into the main target phrase.  subTp may be
+          // in tpv itself, so copy before tpv can reallocate.
+          TPCompact subTp = subTpv->at(rank);
+          // tpv may have reallocated during the recursive call.
+          targetPhrase = &tpv->back();
+          if (useAlignmentInfo) {
+            // reconstruct the alignment data based on the alignment of the subphrase
+            for (std::set<std::pair<size_t, size_t> >::const_iterator it =
+                subTp.alignment.begin(); it != subTp.alignment.end(); ++it) {
+              targetPhrase->alignment.insert(std::pair<size_t, size_t>(
+                  srcStart + it->first, targetPhrase->words.size() + it->second));
+            }
+          }
+          targetPhrase->words.insert(targetPhrase->words.end(),
+              subTp.words.begin(), subTp.words.end());
+        }
+      }
+      else {
+        targetPhrase->words.push_back(symbol);
+      }
+    }
+    else if (state == Score) {
+      size_t idx = m_multipleScoreTrees ? targetPhrase->scores.size() : 0;
+      targetPhrase->scores.push_back(m_scoreTrees[idx]->Read(encodedBitStream));
+
+      if (targetPhrase->scores.size() == m_numScoreComponent) {
+        state = m_containsAlignmentInfo ? Alignment : Add;
+      }
+    }
+    else if (state == Alignment) {
+      AlignPoint alignPoint = m_alignTree->Read(encodedBitStream);
+      if (alignPoint == alignStopSymbol) {
+        state = Add;
+      }
+      else if (useAlignmentInfo) {
+        targetPhrase->alignment.insert(
+            std::pair<size_t, size_t>(alignPoint.first, alignPoint.second));
+      }
+    }
+
+    if (state == Add) {
+      if (useAlignmentInfo) {
+        size_t targetSize = targetPhrase->words.size();
+        for (std::set<std::pair<size_t, size_t> >::const_iterator it =
+            targetPhrase->alignment.begin(); it != targetPhrase->alignment.end();
+            ++it) {
+          if (it->first >= srcSize || it->second >= targetSize) {
+            return TPCompactVectorPtr();
+          }
+        }
+      }
+
+      if (m_coding == PREnc) {
+        if (!m_maxRank || tpv->size() <= m_maxRank) {
+          bitsLeft = encodedBitStream.TellFromEnd();
+        }
+
+        if (!topLevel && m_maxRank && tpv->size() >= m_maxRank) {
+          break;
+        }
+      }
+
+      if (encodedBitStream.TellFromEnd() <= 8) {
+        break;
+      }
+
+      state = New;
+    }
+  }
+
+  if (m_coding == PREnc && !extending) {
+    bitsLeft = bitsLeft > 8 ? bitsLeft : 0;
+    GetCache()[key] = std::make_pair(tpv, bitsLeft);
+  }
+
+  return tpv;
+}
+
+void PhraseDecoder::PruneCache(size_t maxSize)
+{
+  Cache *cache = m_cache.get();
+  if (cache && cache->size() > maxSize) {
+    cache->clear();
+  }
+}
+
+}
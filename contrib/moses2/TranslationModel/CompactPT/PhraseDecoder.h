@@ -0,0 +1,116 @@
+/*
+ * PhraseDecoder.h
+ *
+ * Decoder for the target phrase collections of phrase tables binarized with
+ * processPhraseTableMin.  Same coding as moses/TranslationModel/CompactPT,
+ * but target phrases are decoded into plain target symbol ids so that the
+ * phrase table can build MemPool-allocated TargetPhraseImpl objects from them.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "../../legacy/CompactPT/CanonicalHuffman.h"
+#include "../../legacy/CompactPT/StringVector.h"
+
+namespace Moses2
+{
+
+class PhraseTableCompact;
+
+// A decoded target phrase: target symbol ids, scores and word alignment.
+struct TPCompact
+{
+  std::vector<unsigned> words;
+  std::vector<float> scores;
+  std::set<std::pair<size_t, size_t> > alignment;
+};
+
+typedef std::vector<TPCompact> TPCompactVector;
+typedef boost::shared_ptr<TPCompactVector> TPCompactVectorPtr;
+
+class PhraseDecoder
+{
+public:
+  PhraseDecoder(PhraseTableCompact &phraseTable, size_t numScoreComponent);
+  ~PhraseDecoder();
+
+  size_t Load(std::FILE* in);
+
+  size_t GetMaxSourcePhraseLength() const
+  { return m_maxPhraseLength; }
+
+  size_t GetNumTargetSymbols() const
+  { return m_targetSymbols.size(); }
+
+  std::string GetTargetSymbol(unsigned idx) const;
+
+  // sourceWords are the strings of the input factors of each source word.
+  // Decodes the target phrases of sourceWords[start, end].  Returns NULL if
+  // there are none.
+  TPCompactVectorPtr CreateTargetPhraseCollection(
+      const std::vector<std::string> &sourceWords, size_t start, size_t end,
+      bool topLevel = false);
+
+  // Clear this thread's decoding cache if it has grown past maxSize entries.
+  void PruneCache(size_t maxSize);
+
+protected:
+  typedef std::pair<unsigned char, unsigned char> AlignPoint;
+  typedef std::pair<unsigned, unsigned> SrcTrg;
+
+  enum Coding
+  {
+    None, REnc, PREnc
+  } m_coding;
+
+  size_t m_numScoreComponent;
+  bool m_containsAlignmentInfo;
+  size_t m_maxRank;
+  size_t m_maxPhraseLength;
+
+  StringVector<unsigned char, unsigned, std::allocator> m_sourceSymbols;
+  StringVector<unsigned char, unsigned, std::allocator> m_targetSymbols;
+
+  std::vector<size_t> m_lexicalTableIndex;
+  std::vector<SrcTrg> m_lexicalTable;
+
+  CanonicalHuffman<unsigned>* m_symbolTree;
+
+  bool m_multipleScoreTrees;
+  std::vector<CanonicalHuffman<float>*> m_scoreTrees;
+
+  CanonicalHuffman<AlignPoint>* m_alignTree;
+
+  PhraseTableCompact &m_phraseTable;
+
+  // Per-thread cache of decoded collections, keyed by source phrase, with
+  // the number of bits left to decode (PREnc decodes lower ranks lazily).
+  typedef boost::unordered_map<std::string, std::pair<TPCompactVectorPtr, size_t> > Cache;
+  mutable boost::thread_specific_ptr<Cache> m_cache;
+
+  // Per-thread source word string -> source symbol id (REnc).
+  typedef boost::unordered_map<std::string, unsigned> SourceSymbolMap;
+  mutable boost::thread_specific_ptr<SourceSymbolMap> m_sourceSymbolsMap;
+
+  Cache &GetCache();
+
+  unsigned GetSourceSymbolId(const std::string& s);
+
+  unsigned GetTranslation(unsigned srcIdx, size_t rank) const
+  { return m_lexicalTable[m_lexicalTableIndex[srcIdx] + rank].second; }
+
+  TPCompactVectorPtr DecodeCollection(TPCompactVectorPtr tpv,
+      BitWrapper<> &encodedBitStream,
+      const std::vector<std::string> &sourceWords, size_t start, size_t end,
+      bool topLevel, const std::string &key);
+};
+
+}
@@ -0,0 +1,198 @@
+/*
+ * PhraseTableCompact.cpp
+ */
+#include <boost/algorithm/string/predicate.hpp>
+#include "PhraseTableCompact.h"
+#include "PhraseDecoder.h"
+#include "../../System.h"
+#include "../../Scores.h"
+#include "../../AlignmentInfoCollection.h"
+#include "../../legacy/FactorCollection.h"
+#include "../../legacy/Util2.h"
+#include "../../FF/FeatureFunctions.h"
+#include "../../PhraseBased/InputPath.h"
+#include "../../PhraseBased/Manager.h"
+#include "../../PhraseBased/TargetPhraseImpl.h"
+#include "../../PhraseBased/TargetPhrases.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace Moses2
+{
+
+PhraseTableCompact::PhraseTableCompact(size_t startInd, const std::string &line)
+:PhraseTable(startInd, line)
+,m_inMemory(false)
+,m_useAlignmentInfo(true)
+,m_hash(10, 16)
+,m_phraseDecoder(NULL)
+,m_file(NULL)
+{
+  ReadParameters();
+}
+
+PhraseTableCompact::~PhraseTableCompact()
+{
+  delete m_phraseDecoder;
+  if (m_file) {
+    std::fclose(m_file);
+  }
+}
+
+void PhraseTableCompact::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "in-memory") {
+    m_inMemory = Scan<bool>(value);
+  }
+  else if (key == "alignment-info") {
+    m_useAlignmentInfo = Scan<bool>(value);
+  }
+  else {
+    PhraseTable::SetParameter(key, value);
+  }
+}
+
+void PhraseTableCompact::Load(System &system)
+{
+  std::string tFilePath = m_path;
+
+  std::string suffix = ".minphr";
+  if (!boost::algorithm::ends_with(tFilePath, suffix)) {
+    tFilePath += suffix;
+  }
+  UTIL_THROW_IF2(!FileExists(tFilePath),
+      "Error: File " << tFilePath << " does not exist.");
+
+  m_phraseDecoder = new PhraseDecoder(*this, m_numScores);
+
+  // the hash index keeps the handle, so it stays open until destruction
+  m_file = std::fopen(tFilePath.c_str(), "r");
+  UTIL_THROW_IF2(m_file == NULL,
+      "Error: Could not open " << tFilePath);
+
+  size_t indexSize = m_hash.Load(m_file);
+  size_t coderSize = m_phraseDecoder->Load(m_file);
+
+  size_t phraseSize;
+  if (m_inMemory) {
+    // Load target phrase collections into memory
+    phraseSize = m_targetPhrasesMemory.load(m_file, false);
+  }
+  else {
+    // Keep target phrase collections on disk
+    phraseSize = m_targetPhrasesMapped.load(m_file, true);
+  }
+
+  UTIL_THROW_IF2(indexSize == 0 || coderSize == 0 || phraseSize == 0,
+      "Not successfully loaded");
+
+  // Target symbols are "factor|factor|..." strings.  Resolve them to factors
+  // once so that lookup does no string handling on the target side.
+  FactorCollection &vocab = system.GetVocab();
+  size_t numSymbols = m_phraseDecoder->GetNumTargetSymbols();
+  m_targetFactors.resize(numSymbols * m_output.size(), NULL);
+  for (unsigned i = 0; i < numSymbols; ++i) {
+    vector<string> toks = Tokenize(m_phraseDecoder->GetTargetSymbol(i), "|");
+    for (size_t j = 0; j < m_output.size() && j < toks.size(); ++j) {
+      m_targetFactors[i * m_output.size() + j] =
+          vocab.AddFactor(toks[j], system, false);
+    }
+  }
+}
+
+TargetPhrases* PhraseTableCompact::Lookup(const Manager &mgr, MemPool &pool,
+    InputPath &inputPath) const
+{
+  const SubPhrase<Moses2::Word> &sourcePhrase = inputPath.subPhrase;
+  size_t sourceSize = sourcePhrase.GetSize();
+
+  // There is no such source phrase if source phrase is longer than longest
+  // observed source phrase during compilation
+  if (sourceSize > m_phraseDecoder->GetMaxSourcePhraseLength()) {
+    return NULL;
+  }
+
+  vector<string> sourceWords(sourceSize);
+  for (size_t i = 0; i < sourceSize; ++i) {
+    sourceWords[i] = sourcePhrase[i].GetString(m_input);
+  }
+
+  m_phraseDecoder->PruneCache(m_maxCacheSize);
+  TPCompactVectorPtr decoded = m_phraseDecoder->CreateTargetPhraseCollection(
+      sourceWords, 0, sourceSize - 1, true);
+  if (decoded == NULL || decoded->empty()) {
+    return NULL;
+  }
+
+  const System &system = mgr.system;
+  const FeatureFunctions &ffs = system.featureFunctions;
+  size_t numFactors = m_output.size();
+
+  TargetPhrases *tps = new (pool.Allocate<TargetPhrases>()) TargetPhrases(pool,
+      decoded->size());
+
+  for (size_t i = 0; i < decoded->size(); ++i) {
+    const TPCompact &tpCompact = (*decoded)[i];
+    size_t targetSize = tpCompact.words.size();
+
+    TargetPhraseImpl *tp = new (pool.Allocate<TargetPhraseImpl>())
+        TargetPhraseImpl(pool, *this, system, targetSize);
+
+    for (size_t pos = 0; pos < targetSize; ++pos) {
+      unsigned symbol = tpCompact.words[pos];
+      UTIL_THROW_IF2(symbol >= m_phraseDecoder->GetNumTargetSymbols(),
+          "Unknown target symbol " << symbol);
+
+      Word &word = (*tp)[pos];
+      for (size_t j = 0; j < numFactors; ++j) {
+        word[m_output[j]] = m_targetFactors[symbol * numFactors + j];
+      }
+    }
+
+    // scores are stored log-transformed
+    tp->GetScores().PlusEquals(system, *this, tpCompact.scores);
+    tp->SetAlignTerm(*AlignmentInfoCollection::Instance().Add(tpCompact.alignment));
+
+    ffs.EvaluateInIsolation(pool, system, sourcePhrase, *tp);
+    tps->AddTargetPhrase(*tp);
+  }
+
+  tps->SortAndPrune(m_tableLimit);
+  ffs.EvaluateAfterTablePruning(pool, *tps, sourcePhrase);
+
+  return tps;
+}
+
+// scfg
+void PhraseTableCompact::InitActiveChart(
+    MemPool &pool,
+    const SCFG::Manager &mgr,
+    SCFG::InputPath &path) const
+{
+  UTIL_THROW2("PhraseTableCompact does not support SCFG decoding");
+}
+
+void PhraseTableCompact::Lookup(
+    MemPool &pool,
+    const SCFG::Manager &mgr,
+    size_t maxChartSpan,
+    const SCFG::Stacks &stacks,
+    SCFG::InputPath &path) const
+{
+  UTIL_THROW2("PhraseTableCompact does not support SCFG decoding");
+}
+
+void PhraseTableCompact::LookupGivenNode(
+    MemPool &pool,
+    const SCFG::Manager &mgr,
+    const SCFG::ActiveChartEntry &prevEntry,
+    const SCFG::Word &wordSought,
+    const Moses2::Hypotheses *hypos,
+    const Moses2::Range &subPhraseRange,
+    SCFG::InputPath &outPath) const
+{
+  UTIL_THROW2("PhraseTableCompact does not support SCFG decoding");
+}
+
+}
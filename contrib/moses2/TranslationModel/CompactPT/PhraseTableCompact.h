@@ -0,0 +1,72 @@
+/*
+ * PhraseTableCompact.h
+ *
+ * Phrase-based lookup in phrase tables binarized with processPhraseTableMin
+ * (.minphr).
+ */
+#pragma once
+
+#include <cstdio>
+#include <vector>
+#include "../PhraseTable.h"
+#include "../../legacy/CompactPT/BlockHashIndex.h"
+#include "../../legacy/CompactPT/MmapAllocator.h"
+#include "../../legacy/CompactPT/StringVector.h"
+
+namespace Moses2
+{
+class Factor;
+class PhraseDecoder;
+
+class PhraseTableCompact: public PhraseTable
+{
+  friend class PhraseDecoder;
+
+public:
+  PhraseTableCompact(size_t startInd, const std::string &line);
+  virtual ~PhraseTableCompact();
+
+  virtual void SetParameter(const std::string& key, const std::string& value);
+  virtual void Load(System &system);
+
+  virtual TargetPhrases *Lookup(const Manager &mgr, MemPool &pool,
+      InputPath &inputPath) const;
+
+  // scfg
+  virtual void InitActiveChart(
+      MemPool &pool,
+      const SCFG::Manager &mgr,
+      SCFG::InputPath &path) const;
+
+  virtual void Lookup(
+      MemPool &pool,
+      const SCFG::Manager &mgr,
+      size_t maxChartSpan,
+      const SCFG::Stacks &stacks,
+      SCFG::InputPath &path) const;
+
+protected:
+  bool m_inMemory;
+  bool m_useAlignmentInfo;
+
+  BlockHashIndex m_hash;
+  PhraseDecoder *m_phraseDecoder;
+  std::FILE *m_file;
+
+  StringVector<unsigned char, size_t, MmapAllocator>  m_targetPhrasesMapped;
+  StringVector<unsigned char, size_t, std::allocator> m_targetPhrasesMemory;
+
+  // target symbol id * m_output.size() + factor -> factor
+  std::vector<const Factor*> m_targetFactors;
+
+  virtual void LookupGivenNode(
+      MemPool &pool,
+      const SCFG::Manager &mgr,
+      const SCFG::ActiveChartEntry &prevEntry,
+      const SCFG::Word &wordSought,
+      const Moses2::Hypotheses *hypos,
+      const Moses2::Range &subPhraseRange,
+      SCFG::InputPath &outPath) const;
+};
+
+}
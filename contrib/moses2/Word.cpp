@@ -128,7 +128,7 @@ std::string Word::GetString(const FactorList &factorTypes) const
   ret << m_factors[factorTypes[0]]->GetString();
   for (size_t i = 1; i < factorTypes.size(); ++i) {
     FactorType factorType = factorTypes[i];
-    ret << "|" << m_factors[factorType];
+    ret << "|" << m_factors[factorType]->GetString();
   }
   return ret.str();
 }
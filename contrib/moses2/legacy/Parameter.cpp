@@ -144,6 +144,8 @@ Parameter::Parameter()
       "Don't fully score a hypothesis until it is popped");
   AddParam(cube_opts, "cube-pruning-deterministic-search", "cbds",
       "Break ties deterministically during search");
+  AddParam(cube_opts, "cube-pruning-threads",
+      "Threads that expand the stacks of one sentence in parallel (default = 1)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // minimum bayes risk decoding
@@ -0,0 +1,96 @@
+#include "lm/filter/arpa_io.hh"
+#include "lm/filter/format.hh"
+#include "lm/filter/vocab.hh"
+#include "lm/filter/wrapper.hh"
+#include "lm/read_arpa.hh"
+#include "util/file_piece.hh"
+
+#define BOOST_TEST_MODULE ARPAIOTest
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace lm {
+namespace {
+
+const char kInput[] = "arpa_io_test_input.arpa";
+const char kOutput[] = "arpa_io_test_output.arpa";
+
+void WriteInput() {
+  std::ofstream out(kInput);
+  out << "\n\\data\\\nngram 1=7\nngram 2=5\n\n\\1-grams:\n"
+    "-1\t<unk>\t0\n"
+    "-1\t<s>\t-0.5\n"
+    "-1\t</s>\n"
+    "-1\ta\t-0.5\n"
+    "-1\tb\t-0.5\n"
+    "-1\tc\t-0.5\n"
+    "-1\td\t-0.5\n"
+    "\n\\2-grams:\n"
+    "-0.5\t<s> a\n"
+    "-0.5\ta b\n"
+    "-0.5\tb c\n"
+    "-0.5\tc d\n"
+    "-0.5\ta </s>\n"
+    "\n\\end\\\n";
+}
+
+// Read an ARPA file strictly: each section has as many n-grams as the header
+// says.
+std::vector<uint64_t> CheckCounts(const char *name) {
+  util::FilePiece in(name);
+  std::vector<uint64_t> number;
+  ReadARPACounts(in, number);
+  for (unsigned int i = 0; i < number.size(); ++i) {
+    ReadNGramHeader(in, i + 1);
+    for (uint64_t j = 0; j < number[i]; ++j) {
+      BOOST_CHECK(!in.ReadLine().empty());
+    }
+  }
+  ReadEnd(in);
+  return number;
+}
+
+BOOST_AUTO_TEST_CASE(FilteredCounts) {
+  WriteInput();
+  vocab::Single::Words words;
+  words.insert("a");
+  words.insert("b");
+  words.insert("</s>");
+  {
+    util::FilePiece in(kInput);
+    ARPAOutput out(kOutput);
+    BinaryFilter<vocab::Single> filter((vocab::Single(words)));
+    ARPAFormat::RunFilter(in, filter, out);
+  }
+  std::vector<uint64_t> number = CheckCounts(kOutput);
+  BOOST_REQUIRE_EQUAL(2, number.size());
+  // <unk>, <s>, </s>, a, b
+  BOOST_CHECK_EQUAL(5, number[0]);
+  // <s> a, a b, a </s>
+  BOOST_CHECK_EQUAL(3, number[1]);
+  unlink(kInput);
+  unlink(kOutput);
+}
+
+BOOST_AUTO_TEST_CASE(CopiedCounts) {
+  WriteInput();
+  {
+    util::FilePiece in(kInput);
+    ARPAOutput out(kOutput);
+    ARPAFormat::Copy(in, out);
+  }
+  std::vector<uint64_t> number = CheckCounts(kOutput);
+  BOOST_REQUIRE_EQUAL(2, number.size());
+  BOOST_CHECK_EQUAL(7, number[0]);
+  BOOST_CHECK_EQUAL(5, number[1]);
+  unlink(kInput);
+  unlink(kOutput);
+}
+
+} // namespace
+} // namespace lm
@@ -7,6 +7,7 @@
 #include "lm/filter/vocab.hh"
 #include "lm/filter/wrapper.hh"
 #include "util/exception.hh"
+#include "util/file.hh"
 #include "util/file_piece.hh"
 
 #include <boost/ptr_container/ptr_vector.hpp>
@@ -15,13 +16,14 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
 
 namespace lm {
 namespace {
 
 void DisplayHelp(const char *name) {
   std::cerr
-    << "Usage: " << name << " mode [context] [phrase] [raw|arpa] [threads:m] [batch_size:m] (vocab|model):input_file output_file\n\n"
+    << "Usage: " << name << " mode [context] [phrase] [phrase_index:file] [raw|arpa] [threads:m] [batch_size:m] (vocab|model):input_file output_file\n\n"
     "copy mode just copies, but makes the format nicer for e.g. irstlm's broken\n"
     "    parser.\n"
     "single mode treats the entire input as a single sentence.\n"
@@ -35,6 +37,12 @@ void DisplayHelp(const char *name) {
     "phrase means that the vocabulary is actually tab-delimited phrases and that the\n"
     "    phrases can generate the n-gram when assembled in arbitrary order and\n"
     "    clipped.  Currently works with multiple or union mode.\n\n"
+    "phrase_index:file keeps the phrases in an index file.  If the file exists and\n"
+    "    was built from the same vocabulary (by size and modification time), it is\n"
+    "    mapped and the vocabulary is not read, so filtering several models for\n"
+    "    the same input starts without parsing the phrases again.  Otherwise the\n"
+    "    vocabulary is read and the index is written to file.  Requires phrase and\n"
+    "    a vocabulary in a regular file.\n\n"
     "The file format is set by [raw|arpa] with default arpa:\n"
     "raw means space-separated tokens, optionally followed by a tab and arbitrary\n"
     "    text.  This is useful for ngram count files.\n"
@@ -77,6 +85,9 @@ struct Config {
   size_t threads;
 #endif
   bool phrase;
+  std::string phrase_index;
+  // Vocabulary file, empty for stdin.
+  std::string vocab_file;
   bool context;
   FilterMode mode;
   Format format;
@@ -110,12 +121,34 @@ template <class Format, class Binary> void DispatchBinaryFilter(const Config &co
   RunContextFilter<Format, Filter, BinaryOutputBuffer, typename Format::Output>(config, in_lm, Filter(binary), out);
 }
 
+// Read the phrases, or map them from the index if it was built from the same
+// vocabulary.
+unsigned int ReadPhrases(const Config &config, std::istream &in_vocab, phrase::Substrings &substrings) {
+  if (config.phrase_index.empty()) return phrase::ReadMultiple(in_vocab, substrings);
+  phrase::IndexSource source;
+  {
+    util::scoped_fd vocab_fd(config.vocab_file.empty() ? util::DupOrThrow(0) : util::OpenReadOrThrow(config.vocab_file.c_str()));
+    UTIL_THROW_IF(!phrase::GetIndexSource(vocab_fd.get(), source), util::Exception, "phrase_index needs the vocabulary in a regular file, so that a stale index can be detected.");
+  }
+  if (std::ifstream(config.phrase_index.c_str())) {
+    unsigned int sentences;
+    if (substrings.Map(config.phrase_index.c_str(), source, sentences)) {
+      std::cerr << "Loading phrases from the index " << config.phrase_index << std::endl;
+      return sentences;
+    }
+    std::cerr << "The index " << config.phrase_index << " is damaged or was built from another vocabulary.  Rebuilding it." << std::endl;
+  }
+  unsigned int sentences = phrase::ReadMultiple(in_vocab, substrings);
+  substrings.Write(config.phrase_index.c_str(), sentences, source);
+  return sentences;
+}
+
 template <class Format> void DispatchFilterModes(const Config &config, std::istream &in_vocab, util::FilePiece &in_lm, const char *out_name) {
   if (config.mode == MODE_MULTIPLE) {
     if (config.phrase) {
       typedef phrase::Multiple Filter;
       phrase::Substrings substrings;
-      typename Format::Multiple out(out_name, phrase::ReadMultiple(in_vocab, substrings));
+      typename Format::Multiple out(out_name, ReadPhrases(config, in_vocab, substrings));
       RunContextFilter<Format, Filter, MultipleOutputBuffer, typename Format::Multiple>(config, in_lm, Filter(substrings), out);
     } else {
       typedef vocab::Multiple Filter;
@@ -143,7 +176,7 @@ template <class Format> void DispatchFilterModes(const Config &config, std::istr
   if (config.mode == MODE_UNION) {
     if (config.phrase) {
       phrase::Substrings substrings;
-      phrase::ReadMultiple(in_vocab, substrings);
+      ReadPhrases(config, in_vocab, substrings);
       DispatchBinaryFilter<Format, phrase::Union>(config, in_lm, phrase::Union(substrings), out);
     } else {
       vocab::Union::Words words;
@@ -179,6 +212,8 @@ int main(int argc, char *argv[]) {
         config.mode = lm::MODE_UNION;
       } else if (!std::strcmp(str, "phrase")) {
         config.phrase = true;
+      } else if (!std::strncmp(str, "phrase_index:", 13)) {
+        config.phrase_index = str + 13;
       } else if (!std::strcmp(str, "context")) {
         config.context = true;
       } else if (!std::strcmp(str, "arpa")) {
@@ -215,6 +250,11 @@ int main(int argc, char *argv[]) {
       return 1;
     }
 
+    if (!config.phrase_index.empty() && !config.phrase) {
+      std::cerr << "phrase_index only applies to phrase filtering." << std::endl;
+      return 1;
+    }
+
     bool cmd_is_model = true;
     const char *cmd_input = argv[argc - 2];
     if (!strncmp(cmd_input, "vocab:", 6)) {
@@ -236,6 +276,7 @@ int main(int argc, char *argv[]) {
       cmd_file.open(cmd_input, std::ios::in);
       UTIL_THROW_IF(!cmd_file, util::ErrnoException, "Failed to open " << cmd_input);
       vocab = &cmd_file;
+      config.vocab_file = cmd_input;
     }
 
     util::FilePiece model(cmd_is_model ? util::OpenReadOrThrow(cmd_input) : 0, cmd_is_model ? cmd_input : NULL, &std::cerr);
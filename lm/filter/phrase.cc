@@ -1,15 +1,25 @@
 #include "lm/filter/phrase.hh"
 
 #include "lm/filter/format.hh"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/scoped.hh"
+#include "util/string_stream.hh"
 
 #include <algorithm>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <queue>
 #include <string>
 #include <vector>
 
 #include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace lm {
 namespace phrase {
@@ -48,9 +58,126 @@ unsigned int ReadMultiple(std::istream &in, Substrings &out) {
   return sentence_id + sentence_content;
 }
 
+namespace {
+
+const char kIndexMagic[8] = {'l', 'm', 'p', 'h', 'r', 'a', 's', '2'};
+
+struct IndexHeader {
+  char magic[8];
+  IndexSource source;
+  uint64_t sentences;
+  // Size in bytes of the hash table that follows.
+  uint64_t table_size;
+  // Number of sentence ids after the hash table.
+  uint64_t ids;
+};
+
+} // namespace
+
+bool GetIndexSource(int fd, IndexSource &source) {
+  struct stat info;
+  UTIL_THROW_IF(fstat(fd, &info), util::ErrnoException, "fstat failed on the vocabulary");
+  if (!S_ISREG(info.st_mode)) return false;
+  source.size = info.st_size;
+  source.mtime = info.st_mtime;
+  return true;
+}
+
+void Substrings::Write(const char *file, unsigned int sentences, const IndexSource &source) const {
+  UTIL_THROW_IF(mapped_.get(), util::Exception, "Writing a mapped phrase index again is not supported.");
+  IndexHeader header;
+  std::memset(&header, 0, sizeof(IndexHeader));
+  std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+  header.source = source;
+  header.sentences = sentences;
+  header.table_size = MappedTable::Size(table_.size(), 1.5);
+  util::scoped_malloc table_memory(util::CallocOrThrow(header.table_size));
+  MappedTable table(table_memory.get(), header.table_size);
+
+  std::vector<unsigned int> ids;
+  for (Table::const_iterator i = table_.begin(); i != table_.end(); ++i) {
+    const std::vector<unsigned int> *sets[4] = {&i->second.substring, &i->second.left, &i->second.right, &i->second.phrase};
+    MappedEntry entry;
+    entry.key = MappedKey(i->first);
+    entry.offset = ids.size();
+    for (unsigned int s = 0; s < 4; ++s) {
+      entry.size[s] = sets[s]->size();
+      ids.insert(ids.end(), sets[s]->begin(), sets[s]->end());
+    }
+    MappedTable::MutableIterator found;
+    if (table.FindOrInsert(entry, found)) {
+      // Hashes 0 and 1 share a key, so store the union of their sets.
+      std::vector<unsigned int> merged;
+      std::size_t existing = found->offset, adding = entry.offset;
+      for (unsigned int s = 0; s < 4; ++s) {
+        std::size_t before = merged.size();
+        std::set_union(ids.begin() + existing, ids.begin() + existing + found->size[s], ids.begin() + adding, ids.begin() + adding + entry.size[s], std::back_inserter(merged));
+        existing += found->size[s];
+        adding += entry.size[s];
+        found->size[s] = merged.size() - before;
+      }
+      found->offset = ids.size();
+      ids.insert(ids.end(), merged.begin(), merged.end());
+    }
+  }
+  header.ids = ids.size();
+
+  // Other filter runs may map the index while it is written, so write a
+  // temporary file of this process and rename it into place.
+  util::StringStream tmp_name;
+  tmp_name << file << ".tmp." << getpid();
+  const std::string tmp = tmp_name.str();
+  try {
+    util::scoped_fd out(util::CreateOrThrow(tmp.c_str()));
+    util::WriteOrThrow(out.get(), &header, sizeof(IndexHeader));
+    util::WriteOrThrow(out.get(), table_memory.get(), header.table_size);
+    if (!ids.empty()) util::WriteOrThrow(out.get(), &ids[0], ids.size() * sizeof(unsigned int));
+  } catch (...) {
+    std::remove(tmp.c_str());
+    throw;
+  }
+  UTIL_THROW_IF(std::rename(tmp.c_str(), file), util::ErrnoException, "Failed to rename " << tmp << " to " << file);
+}
+
+bool Substrings::Map(const char *file, const IndexSource &source, unsigned int &sentences) {
+  util::scoped_fd in(util::OpenReadOrThrow(file));
+  uint64_t size = util::SizeOrThrow(in.get());
+  if (size < sizeof(IndexHeader)) return false;
+  IndexHeader header;
+  util::ReadOrThrow(in.get(), &header, sizeof(IndexHeader));
+  if (std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic))) return false;
+  // Compare in a way that cannot overflow with a damaged header.
+  uint64_t body = size - sizeof(IndexHeader);
+  if (header.table_size > body || header.ids != (body - header.table_size) / sizeof(unsigned int) || (body - header.table_size) % sizeof(unsigned int)) return false;
+  if (header.table_size < sizeof(MappedEntry) || header.table_size % sizeof(MappedEntry)) return false;
+  if (header.source.size != source.size || header.source.mtime != source.mtime) return false;
+  util::scoped_memory mapping;
+  util::MapRead(util::POPULATE_OR_READ, in.get(), 0, size, mapping);
+  uint8_t *base = static_cast<uint8_t*>(mapping.get()) + sizeof(IndexHeader);
+  // Every entry's sets must lie within the ids, or lookups read past them.
+  const MappedEntry *entries = reinterpret_cast<const MappedEntry*>(base);
+  for (uint64_t i = 0; i < header.table_size / sizeof(MappedEntry); ++i) {
+    if (!entries[i].key) continue;
+    if (entries[i].offset > header.ids) return false;
+    uint64_t remaining = header.ids - entries[i].offset;
+    for (unsigned int s = 0; s < 4; ++s) {
+      if (entries[i].size[s] > remaining) return false;
+      remaining -= entries[i].size[s];
+    }
+  }
+  std::size_t mapping_size = mapping.size();
+  util::scoped_memory::Alloc mapping_source = mapping.source();
+  mapped_.reset(mapping.steal(), mapping_size, mapping_source);
+  // Lookups never write, so a read-only mapping is fine.
+  mapped_table_ = MappedTable(base, header.table_size);
+  mapped_ids_ = reinterpret_cast<const unsigned int*>(base + header.table_size);
+  Table().swap(table_);
+  sentences = header.sentences;
+  return true;
+}
+
 namespace {
 typedef unsigned int Sentence;
-typedef std::vector<Sentence> Sentences;
 } // namespace
 
 namespace detail {
@@ -153,8 +280,8 @@ void Arc::LowerBound(const Sentence to) {
 }
 
 void Arc::Set(Vertex &to, const Sentences &sentences) {
-  current_ = &*sentences.begin();
-  last_ = &*sentences.end();
+  current_ = sentences.begin();
+  last_ = sentences.end();
   to.AddIncoming(this);
 }
 
@@ -196,7 +323,7 @@ void BuildGraph(const Substrings &phrase, const std::vector<Hash> &hashes, detai
   const Hash *const last_word = &*hashes.end() - 1;
 
   Hash hash = 0;
-  const Sentences *found;
+  Sentences found;
   // Phrases starting at or before the first word in the n-gram.
   {
     Vertex *vertex = vertices;
@@ -205,11 +332,11 @@ void BuildGraph(const Substrings &phrase, const std::vector<Hash> &hashes, detai
       // Now hash is [hashes.begin(), word].
       if (word == last_word) {
         if (phrase.FindSubstring(hash, found))
-          (free_arc++)->SetRight(*vertex, *found);
+          (free_arc++)->SetRight(*vertex, found);
         break;
       }
       if (!phrase.FindRight(hash, found)) break;
-      (free_arc++)->SetRight(*vertex, *found);
+      (free_arc++)->SetRight(*vertex, found);
     }
   }
 
@@ -224,11 +351,11 @@ void BuildGraph(const Substrings &phrase, const std::vector<Hash> &hashes, detai
       // Now hash covers [word_from, word_to].
       if (word_to == last_word) {
         if (phrase.FindLeft(hash, found))
-          (free_arc++)->SetPhrase(*vertex_from, *vertex_to, *found);
+          (free_arc++)->SetPhrase(*vertex_from, *vertex_to, found);
         break;
       }
       if (!phrase.FindPhrase(hash, found)) break;
-      (free_arc++)->SetPhrase(*vertex_from, *vertex_to, *found);
+      (free_arc++)->SetPhrase(*vertex_from, *vertex_to, found);
     }
   }
 }
@@ -1,20 +1,26 @@
 #ifndef LM_FILTER_PHRASE_H
 #define LM_FILTER_PHRASE_H
 
+#include "util/mmap.hh"
 #include "util/murmur_hash.hh"
+#include "util/probing_hash_table.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
 
+#include <boost/range/iterator_range.hpp>
 #include <boost/unordered_map.hpp>
 
 #include <iosfwd>
 #include <vector>
 
-#define LM_FILTER_PHRASE_METHOD(caps, lower) \
-bool Find##caps(Hash key, const std::vector<unsigned int> *&out) const {\
+#include <stdint.h>
+
+#define LM_FILTER_PHRASE_METHOD(caps, lower, index) \
+bool Find##caps(Hash key, Sentences &out) const {\
+  if (mapped_.get()) return FindMapped(key, index, out); \
   Table::const_iterator i(table_.find(key));\
   if (i==table_.end()) return false; \
-  out = &i->second.lower; \
+  out = MakeSentences(i->second.lower); \
   return true; \
 }
 
@@ -23,6 +29,19 @@ namespace phrase {
 
 typedef uint64_t Hash;
 
+// Sentence ids in increasing order.
+typedef boost::iterator_range<const unsigned int*> Sentences;
+
+// Identifies the vocabulary file behind a phrase index so that a stale index
+// is noticed.
+struct IndexSource {
+  uint64_t size;
+  int64_t mtime;
+};
+
+// Get the IndexSource of fd.  Returns false unless fd is a regular file.
+bool GetIndexSource(int fd, IndexSource &source);
+
 class Substrings {
   private:
     /* This is the value in a hash table where the key is a string.  It indicates
@@ -45,17 +64,32 @@ class Substrings {
     typedef boost::unordered_map<Hash, SentenceRelation> Table;
 
   public:
-    Substrings() {}
+    Substrings() : mapped_ids_(NULL) {}
 
-    /* If the string isn't a substring of any phrase, return NULL.  Otherwise,
-     * return a pointer to std::vector<unsigned int> listing sentences with
-     * matching phrases.  This set may be empty for Left, Right, or Phrase.
-     * Example: const std::vector<unsigned int> *FindSubstring(Hash key)
+    /* If the string isn't a substring of any phrase, return false.  Otherwise,
+     * set out to the sentences with matching phrases.  This set may be empty
+     * for Left, Right, or Phrase.
+     * Example: bool FindSubstring(Hash key, Sentences &out)
      */
-    LM_FILTER_PHRASE_METHOD(Substring, substring)
-    LM_FILTER_PHRASE_METHOD(Left, left)
-    LM_FILTER_PHRASE_METHOD(Right, right)
-    LM_FILTER_PHRASE_METHOD(Phrase, phrase)
+    LM_FILTER_PHRASE_METHOD(Substring, substring, 0)
+    LM_FILTER_PHRASE_METHOD(Left, left, 1)
+    LM_FILTER_PHRASE_METHOD(Right, right, 2)
+    LM_FILTER_PHRASE_METHOD(Phrase, phrase, 3)
+
+    /* Save the phrases added so far to an index file.  Loading the index with
+     * Map is much faster than reading the phrases again and the mapped index
+     * is shared read-only by all filter threads, so one index can serve every
+     * model filtered for the same input.  sentences is the count returned by
+     * ReadMultiple; Map returns it.  source identifies the vocabulary file the
+     * phrases were read from.
+     */
+    void Write(const char *file, unsigned int sentences, const IndexSource &source) const;
+
+    /* Replace the contents with an index file from Write and set sentences.
+     * Returns false, leaving the contents alone, if the file is not a complete
+     * index or was built from a vocabulary other than source.
+     */
+    bool Map(const char *file, const IndexSource &source, unsigned int &sentences);
 
 #pragma GCC diagnostic ignored "-Wuninitialized" // end != finish so there's always an initialization
     // sentence_id must be non-decreasing.  Iterators are over words in the phrase.
@@ -81,7 +115,43 @@ class Substrings {
       if (vec.empty() || vec.back() != sentence_id) vec.push_back(sentence_id);
     }
 
+    static Sentences MakeSentences(const std::vector<unsigned int> &vec) {
+      if (vec.empty()) return Sentences();
+      return Sentences(&vec.front(), &vec.front() + vec.size());
+    }
+
+    /* In the index, an entry holds the four sets of a key one after another
+     * in one array of sentence ids.  Key 0 marks an empty bucket, so hash 0 is
+     * stored as 1, which like any collision only makes the filter slightly
+     * more permissive.
+     */
+    struct MappedEntry {
+      typedef Hash Key;
+      Key key;
+      uint64_t offset;
+      uint32_t size[4];
+
+      Key GetKey() const { return key; }
+      void SetKey(Key to) { key = to; }
+    };
+    typedef util::ProbingHashTable<MappedEntry, util::IdentityHash> MappedTable;
+
+    static Hash MappedKey(Hash key) { return key ? key : 1; }
+
+    bool FindMapped(Hash key, unsigned int set, Sentences &out) const {
+      MappedTable::ConstIterator i;
+      if (!mapped_table_.Find(MappedKey(key), i)) return false;
+      const unsigned int *begin = mapped_ids_ + i->offset;
+      for (unsigned int s = 0; s < set; ++s) begin += i->size[s];
+      out = Sentences(begin, begin + i->size[set]);
+      return true;
+    }
+
     Table table_;
+
+    util::scoped_memory mapped_;
+    MappedTable mapped_table_;
+    const unsigned int *mapped_ids_;
 };
 
 // Read a file with one sentence per line containing tab-delimited phrases of
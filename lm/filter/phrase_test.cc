@@ -0,0 +1,176 @@
+#include "lm/filter/phrase.hh"
+
+#define BOOST_TEST_MODULE PhraseTest
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace lm {
+namespace phrase {
+namespace {
+
+const char kIndex[] = "phrase_test.index";
+
+// The word hash that makes a one word phrase hash to key.  AddPhrase hashes
+// 8 zero bytes with the word hash as seed, and every step of MurmurHash64A
+// can be undone for that input, so the test can reach keys 0 and 1, which
+// share a bucket in the index.
+Hash WordForKey(Hash key) {
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  uint64_t inverse = m;
+  for (unsigned int i = 0; i < 5; ++i) inverse *= 2 - m * inverse;
+  uint64_t h = key;
+  h ^= h >> 47;
+  h *= inverse;
+  h ^= h >> 47;
+  h *= inverse;
+  Hash word = h ^ (8 * m);
+  Hash zero = 0;
+  BOOST_REQUIRE_EQUAL(key, util::MurmurHashNative(&zero, sizeof(Hash), word));
+  return word;
+}
+
+void AddWord(Substrings &substrings, unsigned int sentence_id, Hash word) {
+  substrings.AddPhrase(sentence_id, &word, &word + 1);
+}
+
+Hash WordsHash(const std::string &words) {
+  std::vector<Hash> hashes;
+  std::istringstream in(words);
+  std::string word;
+  while (in >> word) hashes.push_back(util::MurmurHashNative(word.data(), word.size()));
+  Hash hash = 0;
+  for (std::vector<Hash>::const_iterator i = hashes.begin(); i != hashes.end(); ++i) {
+    hash = util::MurmurHashNative(&hash, sizeof(uint64_t), *i);
+  }
+  return hash;
+}
+
+// All four sets of key, or "none" if the key is missing.
+std::string Describe(const Substrings &substrings, Hash key) {
+  std::ostringstream out;
+  Sentences sentences;
+  if (!substrings.FindSubstring(key, sentences)) return "none";
+  for (unsigned int set = 0; set < 4; ++set) {
+    switch (set) {
+      case 0: break;
+      case 1: BOOST_REQUIRE(substrings.FindLeft(key, sentences)); break;
+      case 2: BOOST_REQUIRE(substrings.FindRight(key, sentences)); break;
+      case 3: BOOST_REQUIRE(substrings.FindPhrase(key, sentences)); break;
+    }
+    out << '|';
+    for (const unsigned int *i = sentences.begin(); i != sentences.end(); ++i) out << ' ' << *i;
+  }
+  return out.str();
+}
+
+const char *kKeys[] = {"a", "b", "c", "a b", "b c", "a b c", "d", "c d", "e"};
+
+IndexSource Source() {
+  IndexSource source;
+  source.size = 42;
+  source.mtime = 1234;
+  return source;
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip) {
+  Substrings built;
+  std::istringstream vocab("a b c\tc d\nb c\n\nd\n");
+  unsigned int sentences = ReadMultiple(vocab, built);
+  BOOST_CHECK_EQUAL(3, sentences);
+  AddWord(built, 0, WordForKey(0));
+  AddWord(built, 1, WordForKey(1));
+  AddWord(built, 2, WordForKey(0));
+  AddWord(built, 2, WordForKey(1));
+  built.Write(kIndex, sentences, Source());
+
+  Substrings mapped;
+  unsigned int mapped_sentences = 0;
+  BOOST_REQUIRE(mapped.Map(kIndex, Source(), mapped_sentences));
+  BOOST_CHECK_EQUAL(sentences, mapped_sentences);
+  for (unsigned int i = 0; i < sizeof(kKeys) / sizeof(const char*); ++i) {
+    Hash key = WordsHash(kKeys[i]);
+    BOOST_CHECK_EQUAL(Describe(built, key), Describe(mapped, key));
+  }
+  BOOST_CHECK_EQUAL("| 0 1| 1| 0 1| 1", Describe(built, WordsHash("b c")));
+  BOOST_CHECK_EQUAL("| 0| 0||", Describe(built, WordsHash("a b")));
+  BOOST_CHECK_EQUAL("none", Describe(mapped, WordsHash("e")));
+  // Hashes 0 and 1 are stored as the union of their sets.
+  BOOST_CHECK_EQUAL("| 0 1 2| 0 1 2| 0 1 2| 0 1 2", Describe(mapped, 0));
+  BOOST_CHECK_EQUAL("| 0 1 2| 0 1 2| 0 1 2| 0 1 2", Describe(mapped, 1));
+  unlink(kIndex);
+}
+
+BOOST_AUTO_TEST_CASE(Unusable) {
+  Substrings built;
+  std::istringstream vocab("a b c\n");
+  unsigned int sentences = ReadMultiple(vocab, built);
+  built.Write(kIndex, sentences, Source());
+
+  unsigned int mapped_sentences = 0;
+  // Built from another vocabulary.
+  IndexSource other(Source());
+  ++other.mtime;
+  {
+    Substrings mapped;
+    BOOST_CHECK(!mapped.Map(kIndex, other, mapped_sentences));
+  }
+  // An entry whose sets lie past the sentence ids.
+  {
+    std::string index;
+    {
+      std::ifstream in(kIndex, std::ios::binary);
+      index.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    // 48 byte header, then entries of key, offset and four sizes.
+    const std::size_t kHeader = 48, kEntry = 32;
+    std::size_t entry = kHeader;
+    for (; entry + kEntry <= index.size(); entry += kEntry) {
+      Hash key;
+      std::memcpy(&key, &index[entry], sizeof(Hash));
+      if (key) break;
+    }
+    BOOST_REQUIRE(entry + kEntry <= index.size());
+    const uint64_t offset = 1000000;
+    std::memcpy(&index[entry + sizeof(Hash)], &offset, sizeof(uint64_t));
+    std::ofstream out(kIndex, std::ios::binary);
+    out << index;
+  }
+  {
+    Substrings mapped;
+    BOOST_CHECK(!mapped.Map(kIndex, Source(), mapped_sentences));
+  }
+  built.Write(kIndex, sentences, Source());
+  // Truncated, e.g. by a crash in the middle of an earlier Write.
+  BOOST_REQUIRE_EQUAL(0, truncate(kIndex, 60));
+  {
+    Substrings mapped;
+    BOOST_CHECK(!mapped.Map(kIndex, Source(), mapped_sentences));
+  }
+  BOOST_REQUIRE_EQUAL(0, truncate(kIndex, 4));
+  {
+    Substrings mapped;
+    BOOST_CHECK(!mapped.Map(kIndex, Source(), mapped_sentences));
+  }
+  // Not an index.
+  {
+    std::ofstream out(kIndex);
+    out << std::string(200, 'x');
+  }
+  {
+    Substrings mapped;
+    BOOST_CHECK(!mapped.Map(kIndex, Source(), mapped_sentences));
+  }
+  unlink(kIndex);
+}
+
+} // namespace
+} // namespace phrase
+} // namespace lm
@@ -102,6 +102,15 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
       return Search::kDifferentRest ? InternalUnRest(pointers_begin, pointers_end, first_length) : 0.0;
     }
 
+    /* Hint that FullScore(in_state, new_word, ...) will be called soon, so the
+     * table entries it probes can be fetched into cache meanwhile.  Issuing
+     * this for several queries before scoring them overlaps their cache
+     * misses.  Only the probing models do anything.
+     */
+    void Prefetch(const State &in_state, const WordIndex new_word) const {
+      search_.Prefetch(new_word, in_state.words, in_state.words + in_state.length);
+    }
+
   private:
     FullScoreReturn ScoreExceptBackoff(const WordIndex *const context_rbegin, const WordIndex *const context_rend, const WordIndex new_word, State &out_state) const;
 
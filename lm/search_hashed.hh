@@ -136,6 +136,24 @@ template <class Value> class HashedSearch {
       return true;
     }
 
+    // Prefetch the entries that scoring new_word after the context will probe.
+    // The context is in reverse order, as in State.
+    void Prefetch(WordIndex new_word, const WordIndex *context_rbegin, const WordIndex *context_rend) const {
+#if defined(__GNUC__)
+      __builtin_prefetch(&unigram_.Lookup(new_word), 0, 0);
+      Node node = static_cast<Node>(new_word);
+      for (const WordIndex *i = context_rbegin; i != context_rend; ++i) {
+        node = CombineWordHash(node, *i);
+        std::size_t order_minus_2 = i - context_rbegin;
+        if (order_minus_2 == middle_.size()) {
+          __builtin_prefetch(longest_.Ideal(node), 0, 0);
+          return;
+        }
+        __builtin_prefetch(middle_[order_minus_2].Ideal(node), 0, 0);
+      }
+#endif
+    }
+
   private:
     // Interpret config's rest cost build policy and pass the right template argument to ApplyBuild.
     void DispatchBuild(util::FilePiece &f, const std::vector<uint64_t> &counts, const Config &config, const ProbingVocabulary &vocab, PositiveProbWarn &warn);
@@ -99,6 +99,10 @@ template <class Quant, class Bhiksha> class TrieSearch {
       return true;
     }
 
+    // Each trie lookup starts from the result of the previous one, so there
+    // is nothing to fetch ahead.
+    void Prefetch(WordIndex /*new_word*/, const WordIndex * /*context_rbegin*/, const WordIndex * /*context_rend*/) const {}
+
   private:
     friend void BuildTrie<Quant, Bhiksha>(SortedFiles &files, std::vector<uint64_t> &counts, const Config &config, TrieSearch<Quant, Bhiksha> &out, Quant &quant, SortedVocabulary &vocab, BinaryFormat &backing);
 
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <stdexcept>
 
+#include <boost/static_assert.hpp>
+
 #include "util/exception.hh"
 #include "Ngram.h"
 #include "Reference.h"
@@ -21,6 +23,8 @@ using namespace std;
 namespace
 {
 
+BOOST_STATIC_ASSERT(MosesTuning::kBleuNgramOrder <= MosesTuning::PackedNgramCounts::kMaxOrder);
+
 // configure regularisation
 const char KEY_REFLEN[] = "reflen";
 const char REFLEN_AVERAGE[] = "average";
@@ -145,6 +149,7 @@ void BleuScorer::ProcessReferenceLine(const std::string& line, Reference* ref) c
     if (newcount > oldcount) {
       ref->get_counts()->operator[](ngram) = newcount;
     }
+    ref->get_packed_counts().Max(&ngram[0], ngram.size(), newcount);
   }
   //add in the length
   ref->push_back(length);
@@ -165,33 +170,43 @@ bool BleuScorer::GetNextReferenceFromStreams(std::vector<boost::shared_ptr<std::
 void BleuScorer::prepareStats(size_t sid, const string& text, ScoreStats& entry)
 {
   UTIL_THROW_IF2(sid >= m_references.size(), "Sentence id (" << sid << ") not found in reference set");
-  CalcBleuStats(*(m_references[sid]), text, entry);
+  m_tokens.clear();
+  TokenizeAndEncodeTesting(preprocessSentence(text), m_tokens);
+  CalcBleuStats(*(m_references[sid]), m_tokens, m_testcounts, entry);
 }
 
 void BleuScorer::CalcBleuStats(const Reference& ref, const std::string& text, ScoreStats& entry) const
 {
-  NgramCounts testcounts;
+  vector<int> tokens;
+  TokenizeAndEncodeTesting(preprocessSentence(text), tokens);
+  PackedNgramCounts testcounts;
+  CalcBleuStats(ref, tokens, testcounts, entry);
+}
+
+void BleuScorer::CalcBleuStats(const Reference& ref, const vector<int>& tokens,
+                               PackedNgramCounts& testcounts, ScoreStats& entry) const
+{
+  testcounts.clear();
+  const size_t length = tokens.size();
+  for (size_t k = 1; k <= kBleuNgramOrder && k <= length; ++k) {
+    for (size_t i = 0; i + k <= length; ++i) {
+      testcounts.Add(&tokens[i], k);
+    }
+  }
+
   // stats for this line
   vector<ScoreStatsType> stats(kBleuNgramOrder * 2);
-  string sentence = preprocessSentence(text);
-  const size_t length = CountNgrams(sentence, testcounts, kBleuNgramOrder, true);
-
   const int reference_len = CalcReferenceLength(ref, length);
   stats.push_back(reference_len);
 
   //precision on each ngram type
-  for (NgramCounts::const_iterator testcounts_it = testcounts.begin();
-       testcounts_it != testcounts.end(); ++testcounts_it) {
-    const NgramCounts::Value guess = testcounts_it->second;
-    const size_t len = testcounts_it->first.size();
-    NgramCounts::Value correct = 0;
-
-    NgramCounts::Value v = 0;
-    if (ref.get_counts()->Lookup(testcounts_it->first, &v)) {
-      correct = min(v, guess);
-    }
-    stats[len * 2 - 2] += correct;
-    stats[len * 2 - 1] += guess;
+  const PackedNgramCounts& refcounts = ref.get_packed_counts();
+  for (size_t i = 0; i < testcounts.size(); ++i) {
+    const PackedNgramCounts::Entry& ngram = testcounts[i];
+    const int guess = ngram.count;
+    const int correct = min(refcounts.Lookup(ngram), guess);
+    stats[ngram.order * 2 - 2] += correct;
+    stats[ngram.order * 2 - 1] += guess;
   }
   entry.set(stats);
 }
@@ -44,6 +44,13 @@ public:
 
   void CalcBleuStats(const Reference& ref, const std::string& text, ScoreStats& entry) const;
 
+  /**
+   * As above, for an already encoded hypothesis.  testcounts is scratch
+   * space, so that a caller scoring many hypotheses can reuse one table.
+   */
+  void CalcBleuStats(const Reference& ref, const std::vector<int>& tokens,
+                     PackedNgramCounts& testcounts, ScoreStats& entry) const;
+
   int CalcReferenceLength(const Reference& ref, std::size_t length) const;
 
   ReferenceLengthType GetReferenceLengthType() const {
@@ -83,6 +90,10 @@ protected:
   // reference translations.
   ScopedVector<Reference> m_references;
 
+  // scratch space of prepareStats(), reused across hypotheses
+  std::vector<int> m_tokens;
+  PackedNgramCounts m_testcounts;
+
   // constructor used by subclasses
   BleuScorer(const std::string& name, const std::string& config): StatisticsBasedScorer(name,config) {}
 
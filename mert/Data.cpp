@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <set>
 
 #include "Data.h"
 #include "Scorer.h"
@@ -141,25 +142,29 @@ void Data::loadNBest(const string &file, bool oneBest)
   TRACE_ERR("loading nbest from " << file << endl);
   util::FilePiece in(file.c_str());
 
-  ScoreStats scoreentry;
-  string sentence, feature_str, alignment;
+  // candidates are scored in batches, so that scorers can use threads
+  const size_t kBatchSize = 1000;
+  vector<size_t> indices;
+  vector<string> sentences, features;
+  set<int> batchIndices;
+  string sentence, alignment;
   int sentence_index;
 
   while (true) {
+    bool eof = false;
     try {
       StringPiece line = in.ReadLine();
       if (line.empty()) continue;
-      // adding statistics for error measures
-      scoreentry.clear();
 
       util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
 
       sentence_index = ParseInt(*it);
-      if (oneBest && m_score_data->exists(sentence_index)) continue;
+      if (oneBest && (m_score_data->exists(sentence_index)
+                      || !batchIndices.insert(sentence_index).second)) continue;
       ++it;
       sentence = it->as_string();
       ++it;
-      feature_str = it->as_string();
+      features.push_back(it->as_string());
       ++it;
 
       if (it) {
@@ -179,16 +184,31 @@ void Data::loadNBest(const string &file, bool oneBest)
         sentence += "|||";
         sentence += alignment;
       }
-      m_scorer->prepareStats(sentence_index, sentence, scoreentry);
-
-      m_score_data->add(scoreentry, sentence_index);
+      indices.push_back(sentence_index);
+      sentences.push_back(sentence);
+    } catch (util::EndOfFileException &e) {
+      eof = true;
+    }
 
-      // examine first line for name of features
-      if (!existsFeatureNames()) {
-        InitFeatureMap(feature_str);
+    if (sentences.size() >= kBatchSize || (eof && !sentences.empty())) {
+      // adding statistics for error measures
+      vector<ScoreStats> entries;
+      m_scorer->prepareStatsBatch(indices, sentences, entries);
+      for (size_t i = 0; i < entries.size(); ++i) {
+        m_score_data->add(entries[i], indices[i]);
+
+        // examine first line for name of features
+        if (!existsFeatureNames()) {
+          InitFeatureMap(features[i]);
+        }
+        AddFeatures(features[i], indices[i]);
       }
-      AddFeatures(feature_str, sentence_index);
-    } catch (util::EndOfFileException &e) {
+      indices.clear();
+      sentences.clear();
+      features.clear();
+      batchIndices.clear();
+    }
+    if (eof) {
       PrintUserTime("Loaded N-best lists");
       break;
     }
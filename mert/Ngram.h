@@ -2,9 +2,12 @@
 
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include <boost/unordered_map.hpp>
 
+#include "util/exception.hh"
+
 namespace MosesTuning
 {
 
@@ -118,5 +121,148 @@ private:
   boost::unordered_map<Key, Value> m_counts;
 };
 
+/** N-gram counts for n-grams of up to four words, packed into two 64 bit
+ * words (32 bits per word ID) and kept in an open-addressing table.
+ * Unlike NgramCounts, adding an n-gram allocates nothing, and clear()
+ * keeps the table so that one instance can be reused for many sentences.
+ */
+class PackedNgramCounts
+{
+public:
+  static const std::size_t kMaxOrder = 4;
+
+  struct Entry {
+    uint64_t words[2];
+    // 0 marks an empty slot
+    unsigned int order;
+    int count;
+  };
+
+  explicit PackedNgramCounts(std::size_t capacity = 8) : m_mask(0) {
+    std::size_t size = 16;
+    while (size < 2 * capacity) {
+      size <<= 1;
+    }
+    Resize(size);
+  }
+
+  /** add one to the count of the n-gram words[0..order-1] */
+  void Add(const int* words, std::size_t order) {
+    Find(words, order)->count++;
+  }
+
+  /** set the count of the n-gram to the larger of its count and count */
+  void Max(const int* words, std::size_t order, int count) {
+    Entry* entry = Find(words, order);
+    if (entry->count < count) {
+      entry->count = count;
+    }
+  }
+
+  /** count of the n-gram described by entry, which may belong to another table */
+  int Lookup(const Entry& entry) const {
+    std::size_t slot = Hash(entry.words, entry.order) & m_mask;
+    while (m_slots[slot].order) {
+      if (Equal(m_slots[slot], entry.words, entry.order)) {
+        return m_slots[slot].count;
+      }
+      slot = (slot + 1) & m_mask;
+    }
+    return 0;
+  }
+
+  void clear() {
+    for (std::size_t i = 0; i < m_used.size(); ++i) {
+      m_slots[m_used[i]].order = 0;
+    }
+    m_used.clear();
+  }
+
+  bool empty() const {
+    return m_used.empty();
+  }
+
+  std::size_t size() const {
+    return m_used.size();
+  }
+
+  /** i-th distinct n-gram, in order of insertion */
+  const Entry& operator[](std::size_t i) const {
+    return m_slots[m_used[i]];
+  }
+
+private:
+  static void Pack(const int* words, std::size_t order, uint64_t* packed) {
+    // order 0 marks an empty slot and longer n-grams do not fit in two words
+    UTIL_THROW_IF2(order == 0 || order > kMaxOrder,
+                   "Cannot pack an n-gram of order " << order << ", the maximum is "
+                   << static_cast<std::size_t>(kMaxOrder));
+    uint32_t w[kMaxOrder] = {0, 0, 0, 0};
+    for (std::size_t i = 0; i < order; ++i) {
+      w[i] = static_cast<uint32_t>(words[i]);
+    }
+    packed[0] = (static_cast<uint64_t>(w[0]) << 32) | w[1];
+    packed[1] = (static_cast<uint64_t>(w[2]) << 32) | w[3];
+  }
+
+  static std::size_t Hash(const uint64_t* packed, unsigned int order) {
+    uint64_t h = packed[0] * 0x9E3779B97F4A7C15ULL;
+    h ^= (packed[1] + order) * 0xC2B2AE3D27D4EB4FULL;
+    return static_cast<std::size_t>(h ^ (h >> 29));
+  }
+
+  static bool Equal(const Entry& entry, const uint64_t* packed, unsigned int order) {
+    return entry.order == order && entry.words[0] == packed[0] && entry.words[1] == packed[1];
+  }
+
+  Entry* Find(const int* words, std::size_t order) {
+    uint64_t packed[2];
+    Pack(words, order, packed);
+    std::size_t slot = Hash(packed, order) & m_mask;
+    while (m_slots[slot].order) {
+      if (Equal(m_slots[slot], packed, order)) {
+        return &m_slots[slot];
+      }
+      slot = (slot + 1) & m_mask;
+    }
+    // keep the table at most half full
+    if (2 * (m_used.size() + 1) > m_slots.size()) {
+      Resize(2 * m_slots.size());
+      return Find(words, order);
+    }
+    Entry& entry = m_slots[slot];
+    entry.words[0] = packed[0];
+    entry.words[1] = packed[1];
+    entry.order = order;
+    entry.count = 0;
+    m_used.push_back(slot);
+    return &entry;
+  }
+
+  void Resize(std::size_t size) {
+    std::vector<Entry> old;
+    old.swap(m_slots);
+    Entry empty = {{0, 0}, 0, 0};
+    m_slots.assign(size, empty);
+    m_mask = size - 1;
+    std::vector<std::size_t> used;
+    used.swap(m_used);
+    for (std::size_t i = 0; i < used.size(); ++i) {
+      const Entry& entry = old[used[i]];
+      std::size_t slot = Hash(entry.words, entry.order) & m_mask;
+      while (m_slots[slot].order) {
+        slot = (slot + 1) & m_mask;
+      }
+      m_slots[slot] = entry;
+      m_used.push_back(slot);
+    }
+  }
+
+  std::vector<Entry> m_slots;
+  // occupied slots in order of insertion
+  std::vector<std::size_t> m_used;
+  std::size_t m_mask;
+};
+
 }
 
@@ -86,3 +86,62 @@ BOOST_AUTO_TEST_CASE(ngram_lookup)
     BOOST_CHECK(!counts.Lookup(key, &v));
   }
 }
+
+BOOST_AUTO_TEST_CASE(packed_ngram_counts)
+{
+  PackedNgramCounts counts;
+  const int words[] = {1, 2, 4, -1};
+  counts.Add(words, 3);
+  counts.Add(words, 3);
+  counts.Add(words, 2);
+  counts.Add(words + 1, 2);
+  counts.Add(words + 3, 1);
+  BOOST_CHECK_EQUAL(counts.size(), 4);
+  BOOST_CHECK_EQUAL(counts[0].order, 3);
+  BOOST_CHECK_EQUAL(counts[0].count, 2);
+  BOOST_CHECK_EQUAL(counts[1].count, 1);
+
+  PackedNgramCounts other;
+  other.Max(words, 3, 1);
+  other.Max(words, 3, 3);
+  other.Max(words, 3, 2);
+  BOOST_CHECK_EQUAL(other.Lookup(counts[0]), 3);
+  // same words, different order
+  BOOST_CHECK_EQUAL(other.Lookup(counts[1]), 0);
+
+  counts.clear();
+  BOOST_CHECK(counts.empty());
+  BOOST_CHECK_EQUAL(counts.Lookup(other[0]), 0);
+}
+
+BOOST_AUTO_TEST_CASE(packed_ngram_counts_rejects_long_ngrams)
+{
+  PackedNgramCounts counts;
+  const int words[] = {1, 2, 3, 4, 5};
+  BOOST_CHECK_THROW(counts.Add(words, PackedNgramCounts::kMaxOrder + 1), util::Exception);
+  BOOST_CHECK_THROW(counts.Max(words, 0, 1), util::Exception);
+  BOOST_CHECK(counts.empty());
+}
+
+BOOST_AUTO_TEST_CASE(packed_ngram_counts_grow)
+{
+  PackedNgramCounts counts;
+  std::vector<int> words;
+  for (int i = 0; i < 1000; ++i) {
+    words.push_back(i % 37);
+  }
+  NgramCounts reference;
+  for (std::size_t n = 1; n <= PackedNgramCounts::kMaxOrder; ++n) {
+    for (std::size_t i = 0; i + n <= words.size(); ++i) {
+      counts.Add(&words[i], n);
+      reference.Add(NgramCounts::Key(words.begin() + i, words.begin() + i + n));
+    }
+  }
+  BOOST_REQUIRE_EQUAL(counts.size(), reference.size());
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    BOOST_CHECK_EQUAL(counts.Lookup(counts[i]), counts[i].count);
+  }
+  // unigrams come first, in order of appearance
+  NgramCounts::Key key(1, words[1]);
+  BOOST_CHECK_EQUAL(counts.Lookup(counts[1]), reference[key]);
+}
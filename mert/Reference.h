@@ -34,6 +34,14 @@ public:
     return m_counts;
   }
 
+  // the same counts as get_counts(), for fast lookups
+  PackedNgramCounts& get_packed_counts() {
+    return m_packed_counts;
+  }
+  const PackedNgramCounts& get_packed_counts() const {
+    return m_packed_counts;
+  }
+
   iterator begin() {
     return m_length.begin();
   }
@@ -62,10 +70,12 @@ public:
   void clear() {
     m_length.clear();
     m_counts->clear();
+    m_packed_counts.clear();
   }
 
 private:
   NgramCounts* m_counts;
+  PackedNgramCounts m_packed_counts;
 
   // multiple reference lengths
   std::vector<std::size_t> m_length;
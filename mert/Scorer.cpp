@@ -42,6 +42,17 @@ Scorer::~Scorer()
 #endif
 }
 
+void Scorer::prepareStatsBatch(const vector<size_t>& sindices,
+                               const vector<string>& texts,
+                               vector<ScoreStats>& entries)
+{
+  entries.resize(texts.size());
+  for (size_t i = 0; i < texts.size(); ++i) {
+    entries[i].clear();
+    prepareStats(sindices[i], texts[i], entries[i]);
+  }
+}
+
 void Scorer::InitConfig(const string& config)
 {
 //    cerr << "Scorer config string: " << config << endl;
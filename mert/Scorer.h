@@ -73,6 +73,15 @@ public:
     this->prepareStats(static_cast<std::size_t>(atoi(sindex.c_str())), text, entry);
   }
 
+  /**
+   * Process a batch of guessed texts, e.g. a chunk of an n-best list.
+   * The default calls prepareStats() for each text in turn; scorers with
+   * expensive statistics may spread the work over threads.
+   */
+  virtual void prepareStatsBatch(const std::vector<std::size_t>& sindices,
+                                 const std::vector<std::string>& texts,
+                                 std::vector<ScoreStats>& entries);
+
   /**
    * Score using each of the candidate index, then go through the diffs
    * applying each in turn, and calculating a new score each time.
@@ -0,0 +1,340 @@
+#include "TerCalculator.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace MosesTuning
+{
+
+namespace
+{
+const int kInfinite = 99999;
+
+struct CompareWord {
+  bool operator()(const pair<int, int>& a, int word) const {
+    return a.first < word;
+  }
+  bool operator()(int word, const pair<int, int>& a) const {
+    return word < a.first;
+  }
+};
+}
+
+TerCalculator::TerCalculator()
+  : m_maxShiftSize(10),
+    m_maxShiftDist(25),
+    m_maxShifts(10),
+    m_beamWidth(10) {}
+
+int TerCalculator::CalculateEdits(const vector<int>& hyp, const vector<int>& ref)
+{
+  m_refIndex.clear();
+  for (size_t i = 0; i < ref.size(); ++i) {
+    m_refIndex.push_back(make_pair(ref[i], static_cast<int>(i)));
+  }
+  sort(m_refIndex.begin(), m_refIndex.end());
+
+  vector<int> cur(hyp);
+  int edits = MinimizeEdits(cur, ref);
+  int shifts = 0;
+  while (FindBestShift(cur, ref, edits)) {
+    ++shifts;
+  }
+  return edits + shifts;
+}
+
+int TerCalculator::MinimizeEdits(const vector<int>& hyp, const vector<int>& ref)
+{
+  const int refSize = static_cast<int>(ref.size());
+  const int hypSize = static_cast<int>(hyp.size());
+  const int width = hypSize + 1;
+  m_cost.assign((refSize + 1) * width, -1);
+  m_path.assign((refSize + 1) * width, '0');
+
+  int currentBest = kInfinite;
+  int lastBest = kInfinite;
+  int currentFirstGood = 0;
+  int curLastGood = 0;
+  m_cost[0] = 0;
+  for (int j = 0; j <= hypSize; ++j) {
+    lastBest = currentBest;
+    currentBest = kInfinite;
+    const int firstGood = max(currentFirstGood, 0);
+    currentFirstGood = -1;
+    int lastGood = curLastGood;
+    curLastGood = -1;
+    for (int i = firstGood; i <= refSize && i <= lastGood; ++i) {
+      const int score = m_cost[i * width + j];
+      if (score < 0) {
+        continue;
+      }
+      if (j < hypSize && score > lastBest + m_beamWidth) {
+        continue;
+      }
+      if (currentFirstGood == -1) {
+        currentFirstGood = i;
+      }
+      if (i < refSize && j < hypSize) {
+        const bool match = (ref[i] == hyp[j]);
+        const int cost = score + (match ? 0 : 1);
+        int &diag = m_cost[(i + 1) * width + j + 1];
+        if (diag < 0 || cost < diag) {
+          diag = cost;
+          m_path[(i + 1) * width + j + 1] = match ? 'A' : 'S';
+          if (cost < currentBest) {
+            currentBest = cost;
+          }
+        } else if (match && cost < currentBest) {
+          currentBest = cost;
+        }
+      }
+      curLastGood = i + 1;
+      if (j < hypSize) {
+        const int icost = score + 1;
+        int &ins = m_cost[i * width + j + 1];
+        if (ins < 0 || ins > icost) {
+          ins = icost;
+          m_path[i * width + j + 1] = 'I';
+        }
+      }
+      if (i < refSize) {
+        const int dcost = score + 1;
+        int &del = m_cost[(i + 1) * width + j];
+        if (del < 0 || del > dcost) {
+          del = dcost;
+          m_path[(i + 1) * width + j] = 'D';
+          if (i >= lastGood) {
+            lastGood = i + 1;
+          }
+        }
+      }
+    }
+  }
+
+  m_alignment.clear();
+  int i = refSize;
+  int j = hypSize;
+  while (i > 0 || j > 0) {
+    const char step = m_path[i * width + j];
+    m_alignment.push_back(step);
+    if (step == 'A' || step == 'S') {
+      --i;
+      --j;
+    } else if (step == 'D') {
+      --i;
+    } else if (step == 'I') {
+      --j;
+    } else {
+      throw runtime_error("TER: invalid edit path");
+    }
+  }
+  reverse(m_alignment.begin(), m_alignment.end());
+  return m_cost[refSize * width + hypSize];
+}
+
+void TerCalculator::AlignErrors(const vector<char>& alignment, int hypSize, int refSize)
+{
+  m_herr.assign(hypSize + 1, false);
+  m_rerr.assign(refSize + 1, false);
+  m_ralign.assign(refSize + 1, -1);
+  int hpos = -1;
+  int rpos = -1;
+  for (size_t i = 0; i < alignment.size(); ++i) {
+    switch (alignment[i]) {
+    case 'A':
+    case 'S':
+      ++hpos;
+      ++rpos;
+      m_herr[hpos] = m_rerr[rpos] = (alignment[i] == 'S');
+      m_ralign[rpos] = hpos;
+      break;
+    case 'I':
+      ++hpos;
+      m_herr[hpos] = true;
+      break;
+    case 'D':
+      ++rpos;
+      m_rerr[rpos] = true;
+      m_ralign[rpos] = hpos + 1;
+      break;
+    }
+  }
+}
+
+void TerCalculator::FindShifts(const vector<int>& cur, const vector<int>& ref)
+{
+  m_shifts.resize(m_maxShiftSize + 1);
+  for (size_t i = 0; i < m_shifts.size(); ++i) {
+    m_shifts[i].clear();
+  }
+  const int hypSize = static_cast<int>(cur.size());
+  const int refSize = static_cast<int>(ref.size());
+  int numShifts = 0;
+
+  for (int start = 0; start < hypSize; ++start) {
+    // reference positions of the candidate phrase, narrowed as it grows
+    pair<vector<pair<int, int> >::const_iterator, vector<pair<int, int> >::const_iterator> range
+      = equal_range(m_refIndex.begin(), m_refIndex.end(), cur[start], CompareWord());
+    m_positions.clear();
+    for (; range.first != range.second; ++range.first) {
+      m_positions.push_back(range.first->second);
+    }
+
+    bool ok = false;
+    for (size_t p = 0; p < m_positions.size() && !ok; ++p) {
+      const int aligned = m_ralign[m_positions[p]];
+      if (start != aligned && aligned - start <= m_maxShiftDist
+          && start - aligned - 1 <= m_maxShiftDist) {
+        ok = true;
+      }
+    }
+    if (!ok) {
+      continue;
+    }
+
+    for (int end = start; ok && end < hypSize && end < start + m_maxShiftSize; ++end) {
+      const int length = end - start;
+      if (length > 0) {
+        size_t kept = 0;
+        for (size_t p = 0; p < m_positions.size(); ++p) {
+          const int pos = m_positions[p];
+          if (pos + length < refSize && ref[pos + length] == cur[end]) {
+            m_positions[kept++] = pos;
+          }
+        }
+        m_positions.resize(kept);
+      }
+      ok = false;
+      if (m_positions.empty()) {
+        continue;
+      }
+
+      // only move phrases that are not already correct
+      bool anyHerr = false;
+      for (int i = start; i <= end && !anyHerr; ++i) {
+        anyHerr = m_herr[i];
+      }
+      if (!anyHerr) {
+        ok = true;
+        continue;
+      }
+
+      for (size_t p = 0; p < m_positions.size(); ++p) {
+        const int moveto = m_positions[p];
+        const int aligned = m_ralign[moveto];
+        if (!(aligned != start && (aligned < start || aligned > end)
+              && aligned - start <= m_maxShiftDist && start - aligned <= m_maxShiftDist)) {
+          continue;
+        }
+        ok = true;
+
+        bool anyRerr = false;
+        for (int i = 0; i <= length && !anyRerr; ++i) {
+          anyRerr = m_rerr[moveto + i];
+        }
+        if (!anyRerr) {
+          continue;
+        }
+
+        for (int roff = -1; roff <= length; ++roff) {
+          Shift shift;
+          shift.start = start;
+          shift.end = end;
+          if (roff == -1 && moveto == 0) {
+            shift.newloc = -1;
+          } else if (start != m_ralign[moveto + roff]
+                     && (roff == 0 || m_ralign[moveto + roff] != aligned)) {
+            shift.newloc = m_ralign[moveto + roff];
+          } else {
+            continue;
+          }
+          // later candidates are counted but never kept
+          if (++numShifts > m_maxShifts) {
+            return;
+          }
+          m_shifts[length].push_back(shift);
+        }
+      }
+    }
+  }
+}
+
+bool TerCalculator::FindBestShift(vector<int>& cur, const vector<int>& ref, int& edits)
+{
+  AlignErrors(m_alignment, static_cast<int>(cur.size()), static_cast<int>(ref.size()));
+  FindShifts(cur, ref);
+
+  const int curErr = edits;
+  int bestEdits = edits;
+  int bestShiftCost = 0;
+  bool anyGain = false;
+  for (int i = static_cast<int>(m_shifts.size()) - 1; i >= 0; --i) {
+    const int maxFix = 2 * (1 + i);
+    int curFix = curErr - (bestShiftCost + bestEdits);
+    if (curFix > maxFix || (bestShiftCost != 0 && curFix == maxFix)) {
+      break;
+    }
+    for (size_t s = 0; s < m_shifts[i].size(); ++s) {
+      curFix = curErr - (bestShiftCost + bestEdits);
+      if (curFix > maxFix || (bestShiftCost != 0 && curFix == maxFix)) {
+        break;
+      }
+      Permute(cur, m_shifts[i][s], m_shifted);
+      const int shiftedEdits = MinimizeEdits(m_shifted, ref);
+      const int gain = (bestEdits + bestShiftCost) - (shiftedEdits + 1);
+      if (gain > 0 || (bestShiftCost == 0 && gain == 0)) {
+        anyGain = true;
+        bestShiftCost = 1;
+        bestEdits = shiftedEdits;
+        m_bestAlignment.swap(m_alignment);
+        m_bestShifted.swap(m_shifted);
+      }
+    }
+  }
+
+  if (!anyGain) {
+    return false;
+  }
+  cur.swap(m_bestShifted);
+  m_alignment.swap(m_bestAlignment);
+  edits = bestEdits;
+  return true;
+}
+
+void TerCalculator::Permute(const vector<int>& words, const Shift& shift, vector<int>& out)
+{
+  const int size = static_cast<int>(words.size());
+  const int start = shift.start;
+  const int end = shift.end;
+  const int newloc = min(shift.newloc, size - 1);
+  vector<int>::const_iterator w = words.begin();
+
+  out.clear();
+  if (newloc == -1) {
+    out.insert(out.end(), w + start, w + end + 1);
+    out.insert(out.end(), w, w + start);
+    out.insert(out.end(), w + end + 1, words.end());
+  } else if (newloc < start) {
+    out.insert(out.end(), w, w + newloc);
+    out.insert(out.end(), w + start, w + end + 1);
+    out.insert(out.end(), w + newloc, w + start);
+    out.insert(out.end(), w + end + 1, words.end());
+  } else if (newloc > end) {
+    out.insert(out.end(), w, w + start);
+    out.insert(out.end(), w + end + 1, w + newloc + 1);
+    out.insert(out.end(), w + start, w + end + 1);
+    out.insert(out.end(), w + newloc + 1, words.end());
+  } else {
+    // moving inside of itself
+    const int split = min(size - 1, end + (newloc - start));
+    out.insert(out.end(), w, w + start);
+    out.insert(out.end(), w + end + 1, w + split + 1);
+    out.insert(out.end(), w + start, w + end + 1);
+    out.insert(out.end(), w + split + 1, words.end());
+  }
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef MERT_TER_CALCULATOR_H_
+#define MERT_TER_CALCULATOR_H_
+
+#include <utility>
+#include <vector>
+
+namespace MosesTuning
+{
+
+/**
+ * Translation edit rate over encoded words.
+ *
+ * This follows the greedy shift search of the tercpp calculator in TER/
+ * decision for decision, so it counts the same number of edits, but it
+ * compares word IDs instead of strings, finds shift candidates from a
+ * sorted index of reference positions instead of a map of n-gram strings,
+ * and reuses flat buffers for the edit distance table.  An instance is
+ * not thread-safe; use one per thread.
+ */
+class TerCalculator
+{
+public:
+  TerCalculator();
+
+  /**
+   * Number of edits, shifts included, needed to turn hyp into ref.
+   * The argument order is that of terCalc::TER().
+   */
+  int CalculateEdits(const std::vector<int>& hyp, const std::vector<int>& ref);
+
+private:
+  struct Shift {
+    int start;
+    int end;
+    int newloc;
+  };
+
+  // beam-pruned edit distance; fills m_alignment with the edit path
+  int MinimizeEdits(const std::vector<int>& hyp, const std::vector<int>& ref);
+  // records for each reference position the aligned hypothesis position
+  void AlignErrors(const std::vector<char>& alignment, int hypSize, int refSize);
+  void FindShifts(const std::vector<int>& cur, const std::vector<int>& ref);
+  bool FindBestShift(std::vector<int>& cur, const std::vector<int>& ref, int& edits);
+  static void Permute(const std::vector<int>& words, const Shift& shift, std::vector<int>& out);
+
+  // search limits, as in terCalc
+  const int m_maxShiftSize;
+  const int m_maxShiftDist;
+  const int m_maxShifts;
+  const int m_beamWidth;
+
+  // edit distance table, (ref size + 1) x (hyp size + 1)
+  std::vector<int> m_cost;
+  std::vector<char> m_path;
+  std::vector<char> m_alignment;
+
+  // (word, position) of each reference word, sorted
+  std::vector<std::pair<int, int> > m_refIndex;
+  std::vector<int> m_positions;
+
+  std::vector<bool> m_herr;
+  std::vector<bool> m_rerr;
+  std::vector<int> m_ralign;
+
+  // candidate shifts by length - 1
+  std::vector<std::vector<Shift> > m_shifts;
+  std::vector<int> m_shifted;
+  std::vector<char> m_bestAlignment;
+  std::vector<int> m_bestShifted;
+};
+
+}
+
+#endif // MERT_TER_CALCULATOR_H_
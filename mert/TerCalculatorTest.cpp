@@ -0,0 +1,71 @@
+#include "TerCalculator.h"
+#include "TER/tercalc.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define BOOST_TEST_MODULE MertTerCalculator
+#include <boost/test/unit_test.hpp>
+
+using namespace MosesTuning;
+
+namespace
+{
+
+std::vector<int> MakeSentence(const int* words, std::size_t size)
+{
+  return std::vector<int>(words, words + size);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ter_calculator_identical)
+{
+  const int words[] = {1, 2, 3, 4};
+  std::vector<int> sentence = MakeSentence(words, 4);
+  TerCalculator calculator;
+  BOOST_CHECK_EQUAL(calculator.CalculateEdits(sentence, sentence), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ter_calculator_shift)
+{
+  // moving "3 4" to the front costs one shift instead of four edits
+  const int hypWords[] = {3, 4, 1, 2, 5};
+  const int refWords[] = {1, 2, 3, 4, 5};
+  std::vector<int> hyp = MakeSentence(hypWords, 5);
+  std::vector<int> ref = MakeSentence(refWords, 5);
+  TerCalculator calculator;
+  BOOST_CHECK_EQUAL(calculator.CalculateEdits(hyp, ref), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ter_calculator_matches_tercpp)
+{
+  std::srand(1234);
+  TerCalculator calculator;
+  for (int n = 0; n < 300; ++n) {
+    int vocab = 2 + std::rand() % 10;
+    std::vector<int> ref(1 + std::rand() % 30);
+    for (std::size_t i = 0; i < ref.size(); ++i) {
+      ref[i] = std::rand() % vocab;
+    }
+    std::vector<int> hyp(ref);
+    for (int edit = std::rand() % 6; edit > 0 && hyp.size() > 1; --edit) {
+      std::size_t pos = std::rand() % hyp.size();
+      switch (std::rand() % 3) {
+      case 0:
+        hyp[pos] = std::rand() % vocab;
+        break;
+      case 1:
+        hyp.erase(hyp.begin() + pos);
+        break;
+      default:
+        std::rotate(hyp.begin(), hyp.begin() + pos, hyp.end());
+        break;
+      }
+    }
+
+    TERCPPNS_TERCpp::terCalc reference;
+    double expected = reference.TER(hyp, ref).numEdits;
+    BOOST_CHECK_EQUAL(calculator.CalculateEdits(hyp, ref), static_cast<int>(expected));
+  }
+}
@@ -1,11 +1,18 @@
 #include "TerScorer.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <sstream>
 #include <stdexcept>
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 #include "ScoreStats.h"
-#include "TER/tercalc.h"
 #include "TER/terAlignment.h"
 #include "Util.h"
 
@@ -16,8 +23,27 @@ namespace MosesTuning
 {
 
 
+namespace
+{
+// stands in for the tokens of an empty sentence; never a vocabulary ID
+const int kEmptySentence = -2;
+}
+
 TerScorer::TerScorer(const string& config)
-  : StatisticsBasedScorer("TER",config), kLENGTH(2) {}
+  : StatisticsBasedScorer("TER",config), kLENGTH(2), m_threads(1)
+{
+  // mert and pro often run next to other jobs, so one thread unless asked
+  string threads = getConfig ( "threads", "1" );
+  m_threads = atoi ( threads.c_str() );
+#ifdef WITH_THREADS
+  if ( m_threads == 0 ) {
+    m_threads = boost::thread::hardware_concurrency();
+  }
+#endif
+  if ( m_threads == 0 ) {
+    m_threads = 1;
+  }
+}
 
 TerScorer::~TerScorer() {}
 
@@ -52,46 +78,52 @@ void TerScorer::setReferenceFiles ( const vector<string>& referenceFiles )
   m_references=m_multi_references.at(0);
 }
 
-void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry )
+void TerScorer::Encode(size_t sid, const string& text, vector<int>& tokens)
 {
+  for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
+    if ( sid >= m_multi_references.at(incRefs).size() ) {
+      stringstream msg;
+      msg << "Sentence id (" << sid << ") not found in reference set";
+      throw runtime_error ( msg.str() );
+    }
+  }
   string sentence = this->preprocessSentence(text);
+  TokenizeAndEncode(sentence, tokens);
+}
 
+void TerScorer::CalculateStats(size_t sid, const vector<int>& tokens,
+                               TerCalculator& calculator, ScoreStats& entry) const
+{
   terAlignment result;
   result.numEdits = 0.0 ;
   result.numWords = 0.0 ;
   result.averageWords = 0.0;
 
+  double averageLength=0.0;
   for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
-    if ( sid >= m_multi_references.at(incRefs).size() ) {
-      stringstream msg;
-      msg << "Sentence id (" << sid << ") not found in reference set";
-      throw runtime_error ( msg.str() );
-    }
+    averageLength+=(double)m_multi_references.at ( incRefs ).at ( sid ).size();
+  }
+  averageLength=averageLength/( double ) m_multi_references.size();
 
-    vector<int> testtokens;
-    vector<int> reftokens;
-    reftokens = m_multi_references.at ( incRefs ).at ( sid );
-    double averageLength=0.0;
-    for ( int incRefsBis = 0; incRefsBis < ( int ) m_multi_references.size(); incRefsBis++ ) {
-      if ( sid >= m_multi_references.at(incRefsBis).size() ) {
-        stringstream msg;
-        msg << "Sentence id (" << sid << ") not found in reference set";
-        throw runtime_error ( msg.str() );
-      }
-      averageLength+=(double)m_multi_references.at ( incRefsBis ).at ( sid ).size();
+  // the string-based calculator read an empty sentence as one empty word
+  vector<int> testtokens ( tokens );
+  if ( testtokens.empty() ) {
+    testtokens.push_back ( kEmptySentence );
+  }
+
+  for ( int incRefs = 0; incRefs < ( int ) m_multi_references.size(); incRefs++ ) {
+    vector<int> reftokens = m_multi_references.at ( incRefs ).at ( sid );
+    if ( reftokens.empty() ) {
+      reftokens.push_back ( kEmptySentence );
     }
-    averageLength=averageLength/( double ) m_multi_references.size();
-    TokenizeAndEncode(sentence, testtokens);
-    terCalc * evaluation=new terCalc();
-    evaluation->setDebugMode ( false );
-    terAlignment tmp_result = evaluation->TER ( reftokens, testtokens );
+    terAlignment tmp_result;
+    tmp_result.numEdits = calculator.CalculateEdits ( reftokens, testtokens );
     tmp_result.averageWords=averageLength;
     if ( ( result.numEdits == 0.0 ) && ( result.averageWords == 0.0 ) ) {
       result = tmp_result;
     } else if ( result.scoreAv() > tmp_result.scoreAv() ) {
       result = tmp_result;
     }
-    delete evaluation;
   }
   ostringstream stats;
   // multiplication by 100 in order to keep the average precision
@@ -101,6 +133,66 @@ void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry
   entry.set ( stats_str );
 }
 
+void TerScorer::prepareStats ( size_t sid, const string& text, ScoreStats& entry )
+{
+  vector<int> tokens;
+  Encode ( sid, text, tokens );
+  CalculateStats ( sid, tokens, m_calculator, entry );
+}
+
+void TerScorer::CalculateStatsStride(const vector<size_t>* sindices,
+                                     const vector<vector<int> >* tokens,
+                                     vector<ScoreStats>* entries,
+                                     size_t first, size_t step,
+                                     string* error) const
+{
+  TerCalculator calculator;
+  try {
+    for ( size_t i = first; i < tokens->size(); i += step ) {
+      CalculateStats ( sindices->at ( i ), tokens->at ( i ), calculator, entries->at ( i ) );
+    }
+  } catch ( const exception& e ) {
+    *error = e.what();
+  }
+}
+
+void TerScorer::prepareStatsBatch(const vector<size_t>& sindices,
+                                  const vector<string>& texts,
+                                  vector<ScoreStats>& entries)
+{
+  // encoding grows the shared vocabulary, so it stays in this thread
+  vector<vector<int> > tokens ( texts.size() );
+  for ( size_t i = 0; i < texts.size(); i++ ) {
+    Encode ( sindices[i], texts[i], tokens[i] );
+  }
+  entries.resize ( texts.size() );
+  for ( size_t i = 0; i < entries.size(); i++ ) {
+    entries[i].clear();
+  }
+
+  size_t threads = min ( m_threads, texts.size() );
+#ifdef WITH_THREADS
+  if ( threads > 1 ) {
+    vector<string> errors ( threads );
+    boost::thread_group workers;
+    for ( size_t t = 0; t < threads; t++ ) {
+      workers.create_thread ( boost::bind ( &TerScorer::CalculateStatsStride, this,
+                                            &sindices, &tokens, &entries, t, threads, &errors[t] ) );
+    }
+    workers.join_all();
+    for ( size_t t = 0; t < threads; t++ ) {
+      if ( !errors[t].empty() ) {
+        throw runtime_error ( errors[t] );
+      }
+    }
+    return;
+  }
+#endif
+  for ( size_t i = 0; i < texts.size(); i++ ) {
+    CalculateStats ( sindices[i], tokens[i], m_calculator, entries[i] );
+  }
+}
+
 float TerScorer::calculateScore(const vector<ScoreStatsType>& comps) const
 {
   float denom = 1.0 * comps[1];
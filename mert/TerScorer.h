@@ -7,6 +7,7 @@
 
 #include "Types.h"
 #include "StatisticsBasedScorer.h"
+#include "TerCalculator.h"
 
 namespace MosesTuning
 {
@@ -16,6 +17,9 @@ class ScoreStats;
 
 /**
  * TER scoring
+ *
+ * Batches of candidates can be scored in parallel; the "threads" config
+ * option sets the number of threads (default 1, 0 for one per core).
  */
 class TerScorer: public StatisticsBasedScorer
 {
@@ -25,6 +29,9 @@ public:
 
   virtual void setReferenceFiles(const std::vector<std::string>& referenceFiles);
   virtual void prepareStats(std::size_t sid, const std::string& text, ScoreStats& entry);
+  virtual void prepareStatsBatch(const std::vector<std::size_t>& sindices,
+                                 const std::vector<std::string>& texts,
+                                 std::vector<ScoreStats>& entries);
 
   virtual std::size_t NumberOfScores() const {
     // cerr << "TerScorer: " << (LENGTH + 1) << endl;
@@ -34,7 +41,18 @@ public:
   virtual float calculateScore(const std::vector<ScoreStatsType>& comps) const;
 
 private:
+  void Encode(std::size_t sid, const std::string& text, std::vector<int>& tokens);
+  void CalculateStats(std::size_t sid, const std::vector<int>& tokens,
+                      TerCalculator& calculator, ScoreStats& entry) const;
+  void CalculateStatsStride(const std::vector<std::size_t>* sindices,
+                            const std::vector<std::vector<int> >* tokens,
+                            std::vector<ScoreStats>* entries,
+                            std::size_t first, std::size_t step,
+                            std::string* error) const;
+
   const int kLENGTH;
+  std::size_t m_threads;
+  TerCalculator m_calculator;
 
   std::string m_java_env;
   std::string m_ter_com_env;
@@ -0,0 +1,18 @@
+#include <iostream>
+#include <string>
+
+#include "moses/Syntax/F2S/MappedHyperTree.h"
+
+using namespace Moses::Syntax::F2S;
+
+int main(int argc, char** argv)
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " rule-table output-file\n"
+              "Writes a memory-mapped HyperTree for forest-to-string and\n"
+              "tree-to-string decoding.  Give output-file as the path of the\n"
+              "RuleTable feature to use it.\n";
+    return 1;
+  }
+  return MappedHyperTree::Create(argv[1], argv[2]) ? 0 : 1;
+}
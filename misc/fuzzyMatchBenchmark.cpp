@@ -0,0 +1,80 @@
+// Times fuzzy-match rule extraction against a translation memory with the
+// A* parsing verification and with the bit-parallel one, and reports for
+// how many sentences the extracted rules differ.
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "moses/TranslationModel/fuzzy-match/FuzzyMatchWrapper.h"
+#include "moses/TranslationModel/fuzzy-match/SentenceAlignment.h"
+#include "util/usage.hh"
+
+using namespace std;
+
+namespace
+{
+
+typedef vector<pair<string, string> > RuleKeys;
+
+double Run(tmmt::FuzzyMatchWrapper &wrapper, const vector<string> &input,
+           vector<RuleKeys> &keys)
+{
+  keys.resize(input.size());
+  double start = util::WallTime();
+  for (size_t i = 0; i < input.size(); ++i) {
+    vector<tmmt::ExtractedRule> rules;
+    wrapper.Extract(i, input[i], rules);
+    for (size_t r = 0; r < rules.size(); ++r) {
+      keys[i].push_back(make_pair(rules[r].source, rules[r].target));
+    }
+    sort(keys[i].begin(), keys[i].end());
+  }
+  return util::WallTime() - start;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 5) {
+    cerr << "Usage: " << argv[0] << " source target alignment input [threads]" << endl;
+    return 1;
+  }
+  size_t threads = (argc > 5) ? atoi(argv[5]) : 1;
+
+  vector<string> input;
+  ifstream inputStream(argv[4]);
+  string line;
+  while (getline(inputStream, line)) {
+    input.push_back(line);
+  }
+
+  vector<RuleKeys> parseKeys, fastKeys;
+  double parseTime, fastTime;
+  {
+    tmmt::FuzzyMatchWrapper wrapper(argv[1], argv[2], argv[3]);
+    parseTime = Run(wrapper, input, parseKeys);
+  }
+  {
+    tmmt::FuzzyMatchWrapper wrapper(argv[1], argv[2], argv[3], true, threads);
+    fastTime = Run(wrapper, input, fastKeys);
+  }
+
+  size_t differ = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if (parseKeys[i] != fastKeys[i]) {
+      ++differ;
+    }
+  }
+
+  cout << "sentences: " << input.size() << endl
+       << "parse: " << parseTime << " s" << endl
+       << "bit-parallel (" << threads << " threads): " << fastTime << " s" << endl
+       << "sentences with different rules: " << differ << endl;
+  return 0;
+}
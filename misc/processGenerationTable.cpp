@@ -0,0 +1,53 @@
+#include <iostream>
+#include <string>
+
+#include "moses/InputFileStream.h"
+#include "moses/GenerationDictionary.h"
+
+using namespace Moses;
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in  string -- input generation table file name\n"
+            "\t-out string -- path of the generation table; writes path.gimage,\n"
+            "\t               which is loaded instead of the text table\n"
+            "If -in is not specified reads from stdin\n"
+            "\n";
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  std::string outFilePath;
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      ++i;
+      inFilePath = argv[i];
+    } else if("-out" == arg && i+1 < argc) {
+      ++i;
+      outFilePath = argv[i];
+    } else {
+      printHelp();
+      return 1;
+    }
+  }
+  if(outFilePath.empty()) {
+    printHelp();
+    return 1;
+  }
+
+  bool success = false;
+  if(inFilePath.empty()) {
+    std::cerr << "processing stdin to " << outFilePath << ".gimage\n";
+    success = GenerationDictionary::CreateImage(std::cin, outFilePath);
+  } else {
+    std::cerr << "processing " << inFilePath << " to " << outFilePath << ".gimage\n";
+    InputFileStream file(inFilePath);
+    success = GenerationDictionary::CreateImage(file, outFilePath);
+  }
+
+  return (success ? 0 : 1);
+}
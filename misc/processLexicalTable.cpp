@@ -15,6 +15,8 @@ void printHelp()
             "options: \n"
             "\t-in  string -- input table file name\n"
             "\t-out string -- prefix of binary table files\n"
+            "\t-image      -- write a single mmap-able image (prefix.lrimage)\n"
+            "\t               instead of the binary tree files\n"
             "If -in is not specified reads from stdin\n"
             "\n";
 }
@@ -24,6 +26,7 @@ int main(int argc, char** argv)
   std::cerr << "processLexicalTable v0.1 by Konrad Rawlik\n";
   std::string inFilePath;
   std::string outFilePath("out");
+  bool image = false;
   if(1 >= argc) {
     printHelp();
     return 1;
@@ -36,6 +39,8 @@ int main(int argc, char** argv)
     } else if("-out" == arg && i+1 < argc) {
       ++i;
       outFilePath = argv[i];
+    } else if("-image" == arg) {
+      image = true;
     } else {
       //somethings wrong... print help
       printHelp();
@@ -47,11 +52,15 @@ int main(int argc, char** argv)
 
   if(inFilePath.empty()) {
     std::cerr << "processing stdin to " << outFilePath << ".*\n";
-    success = LexicalReorderingTableTree::Create(std::cin, outFilePath);
+    success = image
+              ? LexicalReorderingTableImage::Create(std::cin, outFilePath)
+              : LexicalReorderingTableTree::Create(std::cin, outFilePath);
   } else {
     std::cerr << "processing " << inFilePath<< " to " << outFilePath << ".*\n";
     InputFileStream file(inFilePath);
-    success = LexicalReorderingTableTree::Create(file, outFilePath);
+    success = image
+              ? LexicalReorderingTableImage::Create(file, outFilePath)
+              : LexicalReorderingTableTree::Create(file, outFilePath);
   }
 
   return (success ? 0 : 1);
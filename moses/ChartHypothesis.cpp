@@ -31,6 +31,7 @@
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
+#include "moses/Profiler.h"
 
 using namespace std;
 
@@ -188,6 +189,7 @@ void ChartHypothesis::EvaluateWhenApplied()
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *sfs[i] )) {
+      ProfileScope profile(sfs[i]->GetProfileId());
       sfs[i]->EvaluateWhenApplied(*this,&m_currScoreBreakdown);
     }
   }
@@ -196,6 +198,7 @@ void ChartHypothesis::EvaluateWhenApplied()
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
     if (! staticData.IsFeatureFunctionIgnored( *ffs[i] )) {
+      ProfileScope profile(ffs[i]->GetProfileId());
       m_ffStates[i] = ffs[i]->EvaluateWhenApplied(*this,i,&m_currScoreBreakdown);
     }
   }
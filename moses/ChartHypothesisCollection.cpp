@@ -25,6 +25,7 @@
 #include "ChartHypothesis.h"
 #include "ChartManager.h"
 #include "HypergraphOutput.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 #include "parameters/AllOptions.h"
 
@@ -180,6 +181,9 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
 {
   if (m_maxHypoStackSize == 0) return; // no limit
 
+  static const size_t profileId = Profiler::Register("Search", "PruneToSize");
+  ProfileScope profile(profileId);
+
   if (GetSize() > m_maxHypoStackSize) { // ok, if not over the limit
     priority_queue<float> bestScores;
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationOptionCollection.h"
 #include "PartialTranslOptColl.h"
 #include "FactorCollection.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -152,8 +153,11 @@ ProcessInitialTransLEGACY(InputType const& source,
   const size_t tableLimit = phraseDictionary->GetTableLimit();
 
   const Range range(startPos, endPos);
-  TargetPhraseCollectionWithSourcePhrase::shared_ptr phraseColl
-  = phraseDictionary->GetTargetPhraseCollectionLEGACY(source,range);
+  TargetPhraseCollectionWithSourcePhrase::shared_ptr phraseColl;
+  {
+    ProfileScope profile(phraseDictionary->GetProfileLookupId());
+    phraseColl = phraseDictionary->GetTargetPhraseCollectionLEGACY(source,range);
+  }
 
   if (phraseColl != NULL) {
     IFVERBOSE(3) {
@@ -244,8 +248,11 @@ ProcessLEGACY(TranslationOption const& in,
   size_t const currSize = inPhrase.GetSize();
   size_t const tableLimit = pdict->GetTableLimit();
 
-  TargetPhraseCollectionWithSourcePhrase::shared_ptr phraseColl
-  = pdict->GetTargetPhraseCollectionLEGACY(toc->GetSource(),srcRange);
+  TargetPhraseCollectionWithSourcePhrase::shared_ptr phraseColl;
+  {
+    ProfileScope profile(pdict->GetProfileLookupId());
+    phraseColl = pdict->GetTargetPhraseCollectionLEGACY(toc->GetSource(),srcRange);
+  }
 
   if (phraseColl != NULL) {
     TargetPhraseCollection::const_iterator iterTargetPhrase, iterEnd;
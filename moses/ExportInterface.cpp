@@ -47,6 +47,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "FF/StatefulFeatureFunction.h"
 #include "FF/StatelessFeatureFunction.h"
 #include "TranslationTask.h"
+#include "Profiler.h"
 #include "ExportInterface.h"
 
 #ifdef HAVE_PROTOBUF
@@ -209,6 +210,12 @@ batch_run()
   std::string context_weights;
   params.SetParameter(context_weights,"context-weights",string(""));
 
+  // per-feature timing, see Profiler.h
+  std::string profile_output;
+  params.SetParameter(profile_output,"profile-output",string(""));
+  if (profile_output.size())
+    Profiler::Enable();
+
   // ... or the surrounding context (--context-window ...)
   size_t size_t_max = std::numeric_limits<size_t>::max();
   bool use_context_window = ioWrapper->GetLookAhead() || ioWrapper->GetLookBack();
@@ -296,6 +303,12 @@ batch_run()
   pool.Stop(true); //flush remaining jobs
 #endif
 
+  if (profile_output.size()) {
+    std::ofstream profile(profile_output.c_str());
+    UTIL_THROW_IF2(!profile, "Could not open profile output " << profile_output);
+    Profiler::Dump(profile);
+  }
+
 //  cerr << "g_numHypos=" << Moses::g_numHypos << endl;
 
   FeatureFunction::Destroy();
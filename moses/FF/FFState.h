@@ -4,6 +4,7 @@
 #include <vector>
 #include <stddef.h>
 #include "util/exception.hh"
+#include "moses/RecyclingAllocator.h"
 
 namespace Moses
 {
@@ -12,6 +13,16 @@ class FFState
 {
 public:
   virtual ~FFState();
+
+  // States are created and destroyed for every hypothesis.  The destructor is
+  // virtual, so operator delete receives the size of the derived class.
+  static void *operator new(size_t size) {
+    return RecyclingAllocator::Allocate(size);
+  }
+  static void operator delete(void *ptr, size_t size) {
+    RecyclingAllocator::Free(ptr, size);
+  }
+
   virtual size_t hash() const = 0;
   virtual bool operator==(const FFState& other) const = 0;
 
@@ -8,6 +8,7 @@
 #include "moses/TranslationOption.h"
 #include "moses/TranslationTask.h"
 #include "moses/Util.h"
+#include "moses/Profiler.h"
 #include "moses/FF/DistortionScoreProducer.h"
 
 #include <boost/foreach.hpp>
@@ -51,6 +52,7 @@ FeatureFunction(const std::string& line, bool registerNow)
   , m_verbosity(std::numeric_limits<std::size_t>::max())
   , m_numScoreComponents(1)
   , m_index(0)
+  , m_profileId(0)
 {
   m_numTuneableComponents = m_numScoreComponents;
   ParseLine(line);
@@ -64,6 +66,7 @@ FeatureFunction::FeatureFunction(size_t numScoreComponents, const std::string& l
   , m_verbosity(std::numeric_limits<std::size_t>::max())
   , m_numScoreComponents(numScoreComponents)
   , m_index(0)
+  , m_profileId(0)
 {
   m_numTuneableComponents = m_numScoreComponents;
   ParseLine(line);
@@ -77,6 +80,8 @@ Register(FeatureFunction* ff)
 {
   ScoreComponentCollection::RegisterScoreProducer(ff);
   s_staticColl.push_back(ff);
+  ff->m_profileId = Profiler::Register("EvaluateWhenApplied",
+                                       ff->GetScoreProducerDescription());
 }
 
 FeatureFunction::~FeatureFunction() {}
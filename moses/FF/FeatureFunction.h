@@ -45,6 +45,7 @@ protected:
   size_t m_verbosity;
   size_t m_numScoreComponents;
   size_t m_index; // index into vector covering ALL feature function values
+  size_t m_profileId; // Profiler counter for EvaluateWhenApplied()
   std::vector<bool> m_tuneableComponents;
   size_t m_numTuneableComponents;
   AllOptions::ptr m_options;
@@ -95,6 +96,10 @@ public:
     return m_description;
   }
 
+  size_t GetProfileId() const {
+    return m_profileId;
+  }
+
   FName GetFeatureName(const std::string& name) const {
     return FName(GetScoreProducerDescription(), name);
   }
@@ -8,6 +8,11 @@
 #include "moses/TargetPhrase.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/TranslationTask.h"
+#include "util/file.hh"
+#include "util/exception.hh"
+
+#include <algorithm>
+#include <cstring>
 
 #if !defined WIN32 || defined __MINGW32__ || defined HAVE_CMPH
 #include "moses/TranslationModel/CompactPT/LexicalReorderingTableCompact.h"
@@ -60,7 +65,10 @@ LoadAvailable(const std::string& filePath,
     return compactLexr;
 #endif
   LexicalReorderingTable* ret;
-  if (FileExists(filePath+".binlexr.idx") )
+  if (FileExists(filePath+".lrimage"))
+    ret = new LexicalReorderingTableImage(filePath, f_factors,
+                                          e_factors, c_factors);
+  else if (FileExists(filePath+".binlexr.idx") )
     ret = new LexicalReorderingTableTree(filePath, f_factors,
                                          e_factors, c_factors);
   else
@@ -127,7 +135,7 @@ DbgDump(std::ostream* out) const
 };
 
 std::string
-LexicalReorderingTableMemory::MakeKey(const Phrase& f,
+LexicalReorderingTable::MakeKey(const Phrase& f,
                                       const Phrase& e,
                                       const Phrase& c) const
 {
@@ -137,7 +145,7 @@ LexicalReorderingTableMemory::MakeKey(const Phrase& f,
 }
 
 std::string
-LexicalReorderingTableMemory::MakeKey(const std::string& f,
+LexicalReorderingTable::MakeKey(const std::string& f,
                                       const std::string& e,
                                       const std::string& c) const
 {
@@ -209,6 +217,202 @@ LoadFromFile(const std::string& filePath)
   std::cerr << "done.\n";
 }
 
+namespace
+{
+const char kImageMagic[8] = {'m','o','s','e','s','l','r','1'};
+
+// file layout: header, (numEntries+1) key offsets, key bytes padded to
+// a multiple of 8, numEntries*numScores floats.  Offsets are relative
+// to the start of the key bytes, so the image can be mapped anywhere.
+struct ImageHeader {
+  char magic[8];
+  uint64_t numEntries;
+  uint64_t numScores;
+  uint64_t keyBytes;
+};
+
+uint64_t PadTo8(uint64_t size)
+{
+  return (size + 7) & ~static_cast<uint64_t>(7);
+}
+}
+
+bool
+LexicalReorderingTableImage::
+Create(std::istream& inFile, const std::string& outFileName)
+{
+  typedef std::map< std::string, std::vector<float> > TableType;
+  TableType table;
+  std::string line;
+  size_t numScores = 0;
+  size_t lnc = 0;
+  while(getline(inFile, line)) {
+    ++lnc;
+    if(0 == lnc % 100000) TRACE_ERR(".");
+    std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
+    if(tokens.size() < 2) {
+      TRACE_ERR("ERROR: malformed line " << lnc << ": '" << line << "'\n");
+      return false;
+    }
+    std::string key;
+    for(size_t i = 0; i + 1 < tokens.size(); ++i) {
+      if(!key.empty()) key += "|||";
+      key += auxClearString(tokens[i]);
+    }
+    std::vector<float> p = Scan<float>(Tokenize(tokens.back()));
+    if(table.empty()) {
+      numScores = p.size();
+    } else if(p.size() != numScores) {
+      TRACE_ERR("ERROR: found inconsistent number of probabilities in line "
+                << lnc << "... found " << p.size() << " expected " << numScores << "\n");
+      return false;
+    }
+    std::transform(p.begin(),p.end(),p.begin(),TransformScore);
+    std::transform(p.begin(),p.end(),p.begin(),FloorScore);
+    table[key].swap(p);
+  }
+  TRACE_ERR("\n");
+
+  ImageHeader header;
+  std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.numEntries = table.size();
+  header.numScores = numScores;
+  header.keyBytes = 0;
+
+  std::vector<uint64_t> offsets;
+  offsets.reserve(table.size() + 1);
+  for(TableType::const_iterator i = table.begin(); i != table.end(); ++i) {
+    offsets.push_back(header.keyBytes);
+    header.keyBytes += i->first.size();
+  }
+  offsets.push_back(header.keyBytes);
+
+  util::scoped_fd out(util::CreateOrThrow((outFileName + ".lrimage").c_str()));
+  util::WriteOrThrow(out.get(), &header, sizeof(header));
+  util::WriteOrThrow(out.get(), &offsets[0], offsets.size() * sizeof(uint64_t));
+  for(TableType::const_iterator i = table.begin(); i != table.end(); ++i) {
+    util::WriteOrThrow(out.get(), i->first.data(), i->first.size());
+  }
+  const char padding[8] = {0};
+  util::WriteOrThrow(out.get(), padding, PadTo8(header.keyBytes) - header.keyBytes);
+  for(TableType::const_iterator i = table.begin(); i != table.end(); ++i) {
+    if(!i->second.empty())
+      util::WriteOrThrow(out.get(), &i->second[0], numScores * sizeof(float));
+  }
+  return true;
+}
+
+LexicalReorderingTableImage::
+LexicalReorderingTableImage(const std::string& filePath,
+                            const std::vector<FactorType>& f_factors,
+                            const std::vector<FactorType>& e_factors,
+                            const std::vector<FactorType>& c_factors)
+  : LexicalReorderingTable(f_factors, e_factors, c_factors)
+{
+  std::string fileName = filePath + ".lrimage";
+  util::scoped_fd fd(util::OpenReadOrThrow(fileName.c_str()));
+  uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(ImageHeader),
+                 "Reordering image " << fileName << " is truncated");
+  util::MapRead(util::LAZY, fd.get(), 0, size, m_Image);
+
+  const char* base = static_cast<const char*>(m_Image.get());
+  const ImageHeader* header = reinterpret_cast<const ImageHeader*>(base);
+  UTIL_THROW_IF2(std::memcmp(header->magic, kImageMagic, sizeof(kImageMagic)),
+                 "File " << fileName << " is not a lexical reordering image");
+  m_NumEntries = header->numEntries;
+  m_NumScores = header->numScores;
+  m_KeyBytes = header->keyBytes;
+
+  // check the sections against the file size before computing any pointer,
+  // without overflowing on a damaged header
+  uint64_t remaining = size - sizeof(ImageHeader);
+  bool fits = header->numEntries < remaining / sizeof(uint64_t);
+  if(fits) {
+    remaining -= (header->numEntries + 1) * sizeof(uint64_t);
+    fits = header->keyBytes <= remaining && PadTo8(header->keyBytes) <= remaining;
+  }
+  if(fits) {
+    remaining -= PadTo8(header->keyBytes);
+    fits = header->numScores
+           ? header->numEntries <= remaining / sizeof(float) / header->numScores
+             && remaining == header->numEntries * header->numScores * sizeof(float)
+           : remaining == 0;
+  }
+  UTIL_THROW_IF2(!fits, "Reordering image " << fileName << " has the wrong size");
+
+  const char* ptr = base + sizeof(ImageHeader);
+  m_KeyOffsets = reinterpret_cast<const uint64_t*>(ptr);
+  ptr += (m_NumEntries + 1) * sizeof(uint64_t);
+  m_Keys = ptr;
+  ptr += PadTo8(header->keyBytes);
+  m_Scores = reinterpret_cast<const float*>(ptr);
+  // the other offsets are checked as GetKey reads them
+  UTIL_THROW_IF2(m_KeyOffsets[0] != 0 || m_KeyOffsets[m_NumEntries] != m_KeyBytes,
+                 "Reordering image " << fileName << " has corrupt key offsets");
+}
+
+StringPiece
+LexicalReorderingTableImage::
+GetKey(size_t i) const
+{
+  const uint64_t begin = m_KeyOffsets[i], end = m_KeyOffsets[i+1];
+  UTIL_THROW_IF2(begin > end || end > m_KeyBytes,
+                 "Reordering image has corrupt key offsets at entry " << i);
+  return StringPiece(m_Keys + begin, end - begin);
+}
+
+bool
+LexicalReorderingTableImage::
+Find(const std::string& key, Scores& scores) const
+{
+  // keys are sorted bytewise, as written from std::map<std::string, ...>
+  size_t begin = 0, end = m_NumEntries;
+  const StringPiece needle(key);
+  while(begin < end) {
+    size_t mid = begin + (end - begin) / 2;
+    int cmp = GetKey(mid).compare(needle);
+    if(cmp == 0) {
+      const float* s = m_Scores + mid * m_NumScores;
+      scores.assign(s, s + m_NumScores);
+      return true;
+    }
+    if(cmp < 0) begin = mid + 1;
+    else end = mid;
+  }
+  return false;
+}
+
+std::vector<float>
+LexicalReorderingTableImage::
+GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
+{
+  // same back-off over context as LexicalReorderingTableMemory
+  Scores ret;
+  if(0 == c.GetSize()) {
+    Find(MakeKey(f,e,c), ret);
+  } else {
+    for(size_t i = 0; i <= c.GetSize(); ++i) {
+      Phrase sub_c(c.GetSubString(Range(i,c.GetSize()-1)));
+      if(Find(MakeKey(f,e,sub_c), ret)) break;
+    }
+  }
+  return ret;
+}
+
+void
+LexicalReorderingTableImage::
+DbgDump(std::ostream* out) const
+{
+  for(size_t i = 0; i < m_NumEntries; ++i) {
+    *out << " key: '" << GetKey(i) << "' score: ";
+    *out << "(num scores: " << m_NumScores << ")";
+    for(size_t j = 0; j < m_NumScores; ++j)
+      *out << m_Scores[i * m_NumScores + j] << " ";
+    *out << "\n";
+  }
+}
+
 LexicalReorderingTableTree::
 LexicalReorderingTableTree(const std::string& filePath,
                            const std::vector<FactorType>& f_factors,
@@ -18,6 +18,7 @@
 #include "moses/ConfusionNet.h"
 #include "moses/Sentence.h"
 #include "moses/PrefixTreeMap.h"
+#include "util/mmap.hh"
 
 namespace Moses
 {
@@ -84,6 +85,12 @@ protected:
   FactorList m_FactorsF;
   FactorList m_FactorsE;
   FactorList m_FactorsC;
+
+  std::string
+  MakeKey(const Phrase& f, const Phrase& e, const Phrase& c) const;
+
+  std::string
+  MakeKey(const std::string& f, const std::string& e, const std::string& c) const;
 };
 
 //! @todo what is this?
@@ -114,14 +121,49 @@ public:
 
 private:
 
-  std::string
-  MakeKey(const Phrase& f, const Phrase& e, const Phrase& c) const;
+  void
+  LoadFromFile(const std::string& filePath);
+};
 
-  std::string
-  MakeKey(const std::string& f, const std::string& e, const std::string& c) const;
+//! read-only snapshot of a LexicalReorderingTableMemory, mmap'ed from disk
+class LexicalReorderingTableImage
+  : public LexicalReorderingTable
+{
+  // implements LexicalReorderingTable on a single relocatable file holding
+  // the sorted keys and the (already transformed) scores of a text table.
+  // The file is mapped shared and read-only, so nothing is parsed at startup
+  // and all decoder processes on a host share the same pages.
+  util::scoped_memory m_Image;
+  const uint64_t* m_KeyOffsets;
+  const char* m_Keys;
+  uint64_t m_KeyBytes;
+  const float* m_Scores;
+  size_t m_NumEntries;
+  size_t m_NumScores;
+
+public:
+  static
+  bool
+  Create(std::istream& inFile, const std::string& outFileName);
+
+  LexicalReorderingTableImage(const std::string& filePath,
+                              const std::vector<FactorType>& f_factors,
+                              const std::vector<FactorType>& e_factors,
+                              const std::vector<FactorType>& c_factors);
+
+  virtual
+  std::vector<float>
+  GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
   void
-  LoadFromFile(const std::string& filePath);
+  DbgDump(std::ostream* out) const;
+
+private:
+  StringPiece
+  GetKey(size_t i) const;
+
+  bool
+  Find(const std::string& key, Scores& scores) const;
 };
 
 class LexicalReorderingTableTree
@@ -0,0 +1,175 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "util/exception.hh"
+
+#include "LexicalReorderingTable.h"
+#include "moses/Phrase.h"
+#include "moses/TempDir.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+const char *kTable[] = {
+  "das ||| the ||| 0.5 0.25 0.125 0.125 0.3 0.7",
+  "das Haus ||| the house ||| 0.1 0.2 0.3 0.4 0.5 0.6",
+  "Haus ||| house ||| 1 0 0 0 0.0001 0.9999",
+  "klein ||| small ||| 0.7 0.1 0.1 0.1 0.6 0.4",
+  "ist ||| is ||| 0.2 0.2 0.2 0.4 0.25 0.75",
+  "\xc3\xa4hnlich ||| similar ||| 0.4 0.3 0.2 0.1 0.5 0.5",
+};
+
+string ReadFile(const string &path)
+{
+  ifstream in(path.c_str(), ios::binary);
+  return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string &path, const string &data)
+{
+  ofstream out(path.c_str(), ios::binary | ios::trunc);
+  out << data;
+}
+
+Phrase MakePhrase(FactorDirection direction, const string &str)
+{
+  Phrase phrase;
+  phrase.CreateFromString(direction, vector<FactorType>(1, 0), str, NULL);
+  return phrase;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(lexical_reordering_table)
+
+BOOST_AUTO_TEST_CASE(image_round_trip)
+{
+  TempDir dir("lexical-reordering");
+  const string prefix = dir.File("reordering-table");
+  {
+    ofstream text(prefix.c_str());
+    for (size_t i = 0; i < sizeof(kTable) / sizeof(kTable[0]); ++i) {
+      text << kTable[i] << "\n";
+    }
+  }
+  {
+    ifstream text(prefix.c_str());
+    BOOST_REQUIRE(LexicalReorderingTableImage::Create(text, prefix));
+  }
+
+  const vector<FactorType> factors(1, 0), noFactors;
+  LexicalReorderingTableMemory memory(prefix, factors, factors, noFactors);
+  LexicalReorderingTableImage image(prefix, factors, factors, noFactors);
+
+  // Both hold their entries sorted by key.
+  ostringstream memoryDump, imageDump;
+  memory.DbgDump(&memoryDump);
+  image.DbgDump(&imageDump);
+  BOOST_CHECK_EQUAL(memoryDump.str(), imageDump.str());
+
+  const char *lookups[][2] = {
+    {"das", "the"}, {"das Haus", "the house"}, {"Haus", "house"},
+    {"klein", "small"}, {"ist", "is"}, {"\xc3\xa4hnlich", "similar"},
+    {"das", "house"}, {"Haus", "the house"}, {"gross", "big"},
+  };
+  const Phrase context;
+  for (size_t i = 0; i < sizeof(lookups) / sizeof(lookups[0]); ++i) {
+    Phrase f(MakePhrase(Input, lookups[i][0])), e(MakePhrase(Output, lookups[i][1]));
+    vector<float> expected = memory.GetScore(f, e, context);
+    vector<float> got = image.GetScore(f, e, context);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), got.begin(), got.end());
+    BOOST_CHECK_EQUAL(expected.empty(), i >= 6);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(image_rejects_inconsistent_scores)
+{
+  TempDir dir("lexical-reordering");
+  const string prefix = dir.File("reordering-table");
+  istringstream text("das ||| the ||| 0.5 0.5\nHaus ||| house ||| 0.5\n");
+  BOOST_CHECK(!LexicalReorderingTableImage::Create(text, prefix));
+}
+
+BOOST_AUTO_TEST_CASE(image_without_scores)
+{
+  TempDir dir("lexical-reordering");
+  const string prefix = dir.File("reordering-table");
+  istringstream text("das ||| the ||| \nHaus ||| house ||| \n");
+  BOOST_REQUIRE(LexicalReorderingTableImage::Create(text, prefix));
+
+  const vector<FactorType> factors(1, 0), noFactors;
+  LexicalReorderingTableImage image(prefix, factors, factors, noFactors);
+  const Phrase context;
+  BOOST_CHECK(image.GetScore(MakePhrase(Input, "Haus"), MakePhrase(Output, "house"),
+                             context).empty());
+}
+
+BOOST_AUTO_TEST_CASE(image_rejects_damaged_file)
+{
+  TempDir dir("lexical-reordering");
+  const string prefix = dir.File("reordering-table");
+  const string imagePath = prefix + ".lrimage";
+  istringstream text("das ||| the ||| 0.5 0.5\nHaus ||| house ||| 0.25 0.75\n");
+  BOOST_REQUIRE(LexicalReorderingTableImage::Create(text, prefix));
+  const string good = ReadFile(imagePath);
+  const vector<FactorType> factors(1, 0), noFactors;
+
+  // header fields sit after the 8 byte magic: numEntries, numScores, keyBytes
+  const size_t kNumEntries = 8, kKeyBytes = 24, kFirstOffset = 32;
+  const uint64_t huge = ~static_cast<uint64_t>(0) / 2;
+  string bad;
+
+  WriteFile(imagePath, good.substr(0, good.size() - sizeof(float)));
+  BOOST_CHECK_THROW(LexicalReorderingTableImage(prefix, factors, factors, noFactors),
+                    util::Exception);
+
+  bad = good;
+  bad.replace(kNumEntries, sizeof(uint64_t), reinterpret_cast<const char*>(&huge),
+              sizeof(uint64_t));
+  WriteFile(imagePath, bad);
+  BOOST_CHECK_THROW(LexicalReorderingTableImage(prefix, factors, factors, noFactors),
+                    util::Exception);
+
+  bad = good;
+  bad.replace(kKeyBytes, sizeof(uint64_t), reinterpret_cast<const char*>(&huge),
+              sizeof(uint64_t));
+  WriteFile(imagePath, bad);
+  BOOST_CHECK_THROW(LexicalReorderingTableImage(prefix, factors, factors, noFactors),
+                    util::Exception);
+
+  bad = good;
+  bad.replace(kFirstOffset, sizeof(uint64_t), reinterpret_cast<const char*>(&huge),
+              sizeof(uint64_t));
+  WriteFile(imagePath, bad);
+  BOOST_CHECK_THROW(LexicalReorderingTableImage(prefix, factors, factors, noFactors),
+                    util::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -49,6 +49,7 @@ VW::VW(const std::string &line)
   m_tlsComputedStateExtensions = new TLSStateExtensions(this);
   m_tlsTranslationOptionFeatures = new TLSFeatureVectorMap(this);
   m_tlsTargetContextFeatures = new TLSFeatureVectorMap(this);
+  m_tlsSourceFeatures = new TLSSourceFeatureCache(this);
 
   if (! m_normalizer) {
     VERBOSE(1, "VW :: No loss function specified, assuming logistic loss.\n");
@@ -316,9 +317,27 @@ void VW::EvaluateTranslationOptionListWithSourceContext(const InputType &input
 
     Discriminative::FeatureVector outFeaturesSourceNamespace;
 
-    // extract source side features
-    for(size_t i = 0; i < sourceFeatures.size(); ++i)
-      (*sourceFeatures[i])(input, sourceRange, classifier, outFeaturesSourceNamespace);
+    // extract source side features; those that do not depend on the span
+    // are extracted for the first span of the sentence and reused afterwards
+    VWSourceFeatureCache &sentenceFeatures = *m_tlsSourceFeatures->GetStored();
+    for(size_t i = 0; i < sourceFeatures.size(); ++i) {
+      if (! sourceFeatures[i]->IsSpanIndependent()) {
+        (*sourceFeatures[i])(input, sourceRange, classifier, outFeaturesSourceNamespace);
+        continue;
+      }
+
+      const Discriminative::FeatureVector *features = sentenceFeatures.Find(i);
+      if (features) {
+        if (! features->empty())
+          classifier.AddLabelIndependentFeatureVector(*features);
+      } else {
+        Discriminative::FeatureVector extracted;
+        (*sourceFeatures[i])(input, sourceRange, classifier, extracted);
+        features = &sentenceFeatures.Insert(i, extracted);
+      }
+      outFeaturesSourceNamespace.insert(outFeaturesSourceNamespace.end(),
+                                        features->begin(), features->end());
+    }
 
     for (size_t toptIdx = 0; toptIdx < translationOptionList.size(); toptIdx++) {
       const TranslationOption *topt = translationOptionList.Get(toptIdx);
@@ -425,6 +444,9 @@ void VW::InitializeForInput(ttasksptr const& ttask)
   m_tlsTargetContextFeatures->GetStored()->clear();
   m_tlsTranslationOptionFeatures->GetStored()->clear();
 
+  // span-independent source features belong to the previous sentence
+  m_tlsSourceFeatures->GetStored()->Clear();
+
   InputType const& source = *(ttask->GetSource().get());
   // tabbed sentence is assumed only in training
   if (! m_train)
@@ -27,6 +27,7 @@
 #include "ThreadLocalByFeatureStorage.h"
 #include "TrainingLoss.h"
 #include "VWTargetSentence.h"
+#include "VWSourceFeatureCache.h"
 
 /*
  * VW classifier feature. See vw/README.md for further information.
@@ -61,6 +62,9 @@ typedef ThreadLocalByFeatureStorage<FloatHashMap> TLSFloatHashMap;
 // thread-specific hash tablei for caching full classifier outputs
 typedef ThreadLocalByFeatureStorage<boost::unordered_map<size_t, FloatHashMap> > TLSStateExtensions;
 
+// thread-specific cache of the span-independent source features of the current sentence
+typedef ThreadLocalByFeatureStorage<VWSourceFeatureCache> TLSSourceFeatureCache;
+
 /*
  * VW feature function. A discriminative classifier with source and target context features.
  */
@@ -189,6 +193,7 @@ private:
   TLSFloatHashMap *m_tlsFutureScores;
   TLSStateExtensions *m_tlsComputedStateExtensions;
   TLSFeatureVectorMap *m_tlsTranslationOptionFeatures, *m_tlsTargetContextFeatures;
+  TLSSourceFeatureCache *m_tlsSourceFeatures;
 };
 
 }
@@ -101,6 +101,12 @@ public:
                           , Discriminative::Classifier &classifier
                           , Discriminative::FeatureVector &outFeatures) const = 0;
 
+  // True for source features that depend on the sentence but not on the word
+  // range (e.g. bag of words). VW extracts them once per sentence.
+  virtual bool IsSpanIndependent() const {
+    return false;
+  }
+
   // Overload to process target-dependent features, create features once for
   // every target phrase. One source word range will have at least one target
   // phrase, but may have more.
@@ -22,6 +22,10 @@ public:
     VWFeatureBase::UpdateRegister();
   }
 
+  bool IsSpanIndependent() const {
+    return true;
+  }
+
   void operator()(const InputType &input
                   , const Range &sourceRange
                   , Discriminative::Classifier &classifier
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+#include <boost/unordered_map.hpp>
+
+#include "vw/Classifier.h"
+
+namespace Moses
+{
+
+/*
+ * Features of the source extractors that read the whole sentence but not
+ * the source span (see VWFeatureBase::IsSpanIndependent()). They are the
+ * same for every span of a sentence, so they are extracted for its first
+ * span and reused for the others. Entries are keyed by the position of the
+ * extractor in the source feature list. Each thread has its own cache,
+ * emptied when the thread starts a new sentence.
+ */
+class VWSourceFeatureCache
+{
+public:
+  // Features of the given extractor for the current sentence, NULL if they
+  // have not been extracted yet.
+  const Discriminative::FeatureVector *Find(size_t extractor) const {
+    Map::const_iterator it = m_features.find(extractor);
+    return it == m_features.end() ? NULL : &it->second;
+  }
+
+  const Discriminative::FeatureVector &Insert(size_t extractor, const Discriminative::FeatureVector &features) {
+    return m_features[extractor] = features;
+  }
+
+  void Clear() {
+    m_features.clear();
+  }
+
+  size_t GetSize() const {
+    return m_features.size();
+  }
+
+private:
+  typedef boost::unordered_map<size_t, Discriminative::FeatureVector> Map;
+
+  Map m_features;
+};
+
+}
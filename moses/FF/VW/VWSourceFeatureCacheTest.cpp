@@ -0,0 +1,72 @@
+#include <boost/test/unit_test.hpp>
+
+#include "VWSourceFeatureCache.h"
+
+using namespace Moses;
+using namespace Discriminative;
+
+BOOST_AUTO_TEST_SUITE(vw_source_feature_cache)
+
+namespace
+{
+FeatureVector MakeFeatures(uint32_t first, size_t count)
+{
+  FeatureVector features;
+  for (size_t i = 0; i < count; i++)
+    features.push_back(std::make_pair(first + uint32_t(i), 1.0f + i));
+  return features;
+}
+}
+
+BOOST_AUTO_TEST_CASE(find_inserted)
+{
+  VWSourceFeatureCache cache;
+  BOOST_CHECK(cache.Find(0) == NULL);
+
+  FeatureVector bagOfWords = MakeFeatures(100, 3);
+  const FeatureVector &stored = cache.Insert(0, bagOfWords);
+  BOOST_CHECK(stored == bagOfWords);
+
+  const FeatureVector *found = cache.Find(0);
+  BOOST_REQUIRE(found != NULL);
+  BOOST_CHECK(*found == bagOfWords);
+  BOOST_CHECK(found == &stored);
+  BOOST_CHECK(cache.Find(1) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(extractors_are_separate)
+{
+  VWSourceFeatureCache cache;
+  cache.Insert(0, MakeFeatures(100, 3));
+  cache.Insert(2, MakeFeatures(200, 2));
+  cache.Insert(3, FeatureVector());
+  BOOST_CHECK_EQUAL(cache.GetSize(), 3);
+
+  BOOST_REQUIRE(cache.Find(0) != NULL);
+  BOOST_CHECK(*cache.Find(0) == MakeFeatures(100, 3));
+  BOOST_REQUIRE(cache.Find(2) != NULL);
+  BOOST_CHECK(*cache.Find(2) == MakeFeatures(200, 2));
+  BOOST_CHECK(cache.Find(1) == NULL);
+
+  // an extractor without features is still cached, so it is not run again
+  BOOST_REQUIRE(cache.Find(3) != NULL);
+  BOOST_CHECK(cache.Find(3)->empty());
+}
+
+BOOST_AUTO_TEST_CASE(clear_for_next_sentence)
+{
+  VWSourceFeatureCache cache;
+  cache.Insert(0, MakeFeatures(100, 3));
+  cache.Insert(1, MakeFeatures(200, 1));
+
+  cache.Clear();
+  BOOST_CHECK_EQUAL(cache.GetSize(), 0);
+  BOOST_CHECK(cache.Find(0) == NULL);
+  BOOST_CHECK(cache.Find(1) == NULL);
+
+  cache.Insert(0, MakeFeatures(300, 2));
+  BOOST_REQUIRE(cache.Find(0) != NULL);
+  BOOST_CHECK(*cache.Find(0) == MakeFeatures(300, 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -19,6 +19,8 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include "GenerationDictionary.h"
@@ -28,6 +30,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "util/exception.hh"
+#include "util/file.hh"
+#include "util/mmap.hh"
 #include "util/string_stream.hh"
 
 using namespace std;
@@ -44,9 +48,50 @@ GenerationDictionary::GenerationDictionary(const std::string &line)
   ReadParameters();
 }
 
+namespace
+{
+const char kImageMagic[8] = {'m','o','s','e','s','g','d','1'};
+
+// file layout: header, (numStrings+1) string offsets, string bytes padded
+// to a multiple of 8, numEntries*(numInputFactors+numOutputFactors) string
+// ids padded to a multiple of 8 bytes, numEntries*numScores floats.
+struct ImageHeader {
+  char magic[8];
+  uint64_t numStrings;
+  uint64_t stringBytes;
+  uint64_t numEntries;
+  uint64_t numInputFactors;
+  uint64_t numOutputFactors;
+  uint64_t numScores;
+};
+
+uint64_t PadTo8(uint64_t size)
+{
+  return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+// takes count items of the given size off the bytes left in an image
+bool Take(uint64_t &remaining, uint64_t count, uint64_t size)
+{
+  if (size && count > remaining / size) return false;
+  remaining -= count * size;
+  return true;
+}
+}
+
 void GenerationDictionary::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
+  const string imageFileName = m_filePath + ".gimage";
+  if (FileExists(imageFileName)) {
+    LoadImage(imageFileName);
+  } else {
+    LoadText();
+  }
+}
+
+void GenerationDictionary::LoadText()
+{
   FactorCollection &factorCollection = FactorCollection::Instance();
 
   const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
@@ -95,19 +140,197 @@ void GenerationDictionary::Load(AllOptions::ptr const& opts)
     for (size_t i = 0; i < numFeatureValuesInConfig; i++)
       scores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
 
-    Collection::iterator iterWord = m_collection.find(inputWord);
-    if (iterWord == m_collection.end()) {
-      m_collection[inputWord][outputWord].Assign(this, scores);
-    } else {
-      // source word already in there. delete input word to avoid mem leak
-      (iterWord->second)[outputWord].Assign(this, scores);
-      delete inputWord;
-    }
+    Add(inputWord, outputWord, scores);
   }
 
   inFile.Close();
 }
 
+void GenerationDictionary::LoadImage(const std::string &fileName)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(fileName.c_str()));
+  const uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(ImageHeader),
+                 "Generation image " << fileName << " is truncated");
+  util::scoped_memory image;
+  util::MapRead(util::POPULATE_OR_READ, fd.get(), 0, size, image);
+
+  const char *base = static_cast<const char*>(image.get());
+  const ImageHeader *header = reinterpret_cast<const ImageHeader*>(base);
+  UTIL_THROW_IF2(std::memcmp(header->magic, kImageMagic, sizeof(kImageMagic)),
+                 "File " << fileName << " is not a generation table image");
+
+  const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
+  // an empty table has no factor or score counts
+  const bool empty = header->numEntries == 0;
+  UTIL_THROW_IF2(header->numInputFactors > MAX_NUM_FACTORS
+                 || header->numOutputFactors > MAX_NUM_FACTORS
+                 || (!empty && header->numInputFactors < GetInput().size())
+                 || (!empty && header->numOutputFactors < GetOutput().size()),
+                 "Generation image " << fileName << " has " << header->numInputFactors
+                 << " input and " << header->numOutputFactors << " output factors, expected "
+                 << GetInput().size() << " and " << GetOutput().size());
+  UTIL_THROW_IF2(!empty && header->numScores < numFeatureValuesInConfig,
+                 "Generation image " << fileName << ": expected " << numFeatureValuesInConfig
+                 << " feature values, but found " << header->numScores);
+
+  // check the sections against the file size before computing any pointer,
+  // without overflowing on a damaged header
+  const uint64_t idsPerEntry = header->numInputFactors + header->numOutputFactors;
+  uint64_t remaining = size - sizeof(ImageHeader);
+  bool fits = header->numStrings < remaining / sizeof(uint64_t)
+              && Take(remaining, header->numStrings + 1, sizeof(uint64_t))
+              && Take(remaining, header->stringBytes, 1)
+              && Take(remaining, PadTo8(header->stringBytes) - header->stringBytes, 1)
+              && Take(remaining, header->numEntries, idsPerEntry * sizeof(uint32_t))
+              && Take(remaining, header->numEntries * idsPerEntry % 2, sizeof(uint32_t))
+              && Take(remaining, header->numEntries, header->numScores * sizeof(float))
+              && remaining == 0;
+  UTIL_THROW_IF2(!fits, "Generation image " << fileName << " has the wrong size");
+
+  const char *ptr = base + sizeof(ImageHeader);
+  const uint64_t *offsets = reinterpret_cast<const uint64_t*>(ptr);
+  ptr += (header->numStrings + 1) * sizeof(uint64_t);
+  const char *strings = ptr;
+  ptr += PadTo8(header->stringBytes);
+  const uint32_t *ids = reinterpret_cast<const uint32_t*>(ptr);
+  ptr += PadTo8(header->numEntries * idsPerEntry * sizeof(uint32_t));
+  const float *imageScores = reinterpret_cast<const float*>(ptr);
+
+  UTIL_THROW_IF2(offsets[0] != 0 || offsets[header->numStrings] != header->stringBytes,
+                 "Generation image " << fileName << " has corrupt string offsets");
+
+  // intern each distinct factor string once
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  std::vector<const Factor*> factors(header->numStrings);
+  for (size_t i = 0; i < factors.size(); ++i) {
+    const uint64_t begin = offsets[i], end = offsets[i+1];
+    UTIL_THROW_IF2(begin > end || end > header->stringBytes,
+                   "Generation image " << fileName << " has corrupt string offsets at string " << i);
+    factors[i] = factorCollection.AddFactor(StringPiece(strings + begin, end - begin));
+  }
+
+  std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
+  for (uint64_t entry = 0; entry < header->numEntries; ++entry) {
+    const uint32_t *entryIds = ids + entry * idsPerEntry;
+    for (size_t i = 0; i < idsPerEntry; ++i) {
+      UTIL_THROW_IF2(entryIds[i] >= factors.size(),
+                     "Generation image " << fileName << " has a corrupt string id in entry " << entry);
+    }
+
+    Word *inputWord = new Word();  // deleted in destructor
+    Word outputWord;
+    for (size_t i = 0 ; i < GetInput().size() ; i++) {
+      inputWord->SetFactor(GetInput()[i], factors[entryIds[i]]);
+    }
+    for (size_t i = 0 ; i < GetOutput().size() ; i++) {
+      outputWord.SetFactor(GetOutput()[i], factors[entryIds[header->numInputFactors + i]]);
+    }
+
+    const float *entryScores = imageScores + entry * header->numScores;
+    std::copy(entryScores, entryScores + numFeatureValuesInConfig, scores.begin());
+    Add(inputWord, outputWord, scores);
+  }
+}
+
+void GenerationDictionary::Add(Word *inputWord, const Word &outputWord, const std::vector<float> &scores)
+{
+  Collection::iterator iterWord = m_collection.find(inputWord);
+  if (iterWord == m_collection.end()) {
+    m_collection[inputWord][outputWord].Assign(this, scores);
+  } else {
+    // source word already in there. delete input word to avoid mem leak
+    (iterWord->second)[outputWord].Assign(this, scores);
+    delete inputWord;
+  }
+}
+
+bool GenerationDictionary::CreateImage(std::istream &inFile, const std::string &outFileName)
+{
+  ImageHeader header;
+  std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.numStrings = 0;
+  header.stringBytes = 0;
+  header.numEntries = 0;
+  header.numInputFactors = 0;
+  header.numOutputFactors = 0;
+  header.numScores = 0;
+
+  boost::unordered_map<string, uint32_t> stringIds;
+  vector<string> strings;
+  vector<uint32_t> ids;
+  vector<float> scores;
+
+  string line;
+  size_t lineNum = 0;
+  while(getline(inFile, line)) {
+    ++lineNum;
+    vector<string> token = Tokenize( line );
+    if (token.size() < 2) {
+      TRACE_ERR("ERROR: malformed line " << lineNum << ": '" << line << "'\n");
+      return false;
+    }
+    vector<string> inputFactors = Tokenize( token[0], "|" );
+    vector<string> outputFactors = Tokenize( token[1], "|" );
+    const size_t numScores = token.size() - 2;
+    if (header.numEntries == 0) {
+      header.numInputFactors = inputFactors.size();
+      header.numOutputFactors = outputFactors.size();
+      header.numScores = numScores;
+    } else if (inputFactors.size() != header.numInputFactors
+               || outputFactors.size() != header.numOutputFactors
+               || numScores != header.numScores) {
+      TRACE_ERR("ERROR: line " << lineNum << " has " << inputFactors.size() << " input factors, "
+                << outputFactors.size() << " output factors and " << numScores
+                << " scores, expected " << header.numInputFactors << ", "
+                << header.numOutputFactors << " and " << header.numScores << "\n");
+      return false;
+    }
+
+    inputFactors.insert(inputFactors.end(), outputFactors.begin(), outputFactors.end());
+    for (size_t i = 0; i < inputFactors.size(); ++i) {
+      std::pair<boost::unordered_map<string, uint32_t>::iterator, bool> inserted
+        = stringIds.insert(std::make_pair(inputFactors[i], static_cast<uint32_t>(strings.size())));
+      if (inserted.second) {
+        strings.push_back(inputFactors[i]);
+        header.stringBytes += inputFactors[i].size();
+      }
+      ids.push_back(inserted.first->second);
+    }
+    for (size_t i = 0; i < numScores; ++i) {
+      scores.push_back(FloorScore(TransformScore(Scan<float>(token[2+i]))));
+    }
+    ++header.numEntries;
+  }
+  header.numStrings = strings.size();
+
+  vector<uint64_t> offsets;
+  offsets.reserve(strings.size() + 1);
+  uint64_t offset = 0;
+  for (size_t i = 0; i < strings.size(); ++i) {
+    offsets.push_back(offset);
+    offset += strings[i].size();
+  }
+  offsets.push_back(offset);
+
+  const char padding[8] = {0};
+  util::scoped_fd out(util::CreateOrThrow((outFileName + ".gimage").c_str()));
+  util::WriteOrThrow(out.get(), &header, sizeof(header));
+  util::WriteOrThrow(out.get(), &offsets[0], offsets.size() * sizeof(uint64_t));
+  for (size_t i = 0; i < strings.size(); ++i) {
+    util::WriteOrThrow(out.get(), strings[i].data(), strings[i].size());
+  }
+  util::WriteOrThrow(out.get(), padding, PadTo8(header.stringBytes) - header.stringBytes);
+  if (!ids.empty()) {
+    util::WriteOrThrow(out.get(), &ids[0], ids.size() * sizeof(uint32_t));
+  }
+  util::WriteOrThrow(out.get(), padding, ids.size() % 2 * sizeof(uint32_t));
+  if (!scores.empty()) {
+    util::WriteOrThrow(out.get(), &scores[0], scores.size() * sizeof(float));
+  }
+  return true;
+}
+
 GenerationDictionary::~GenerationDictionary()
 {
   Collection::const_iterator iter;
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_GenerationDictionary_h
 #define moses_GenerationDictionary_h
 
+#include <iostream>
 #include <list>
 #include <stdexcept>
 #include <vector>
@@ -53,6 +54,10 @@ protected:
   // 2nd = target
   std::string						m_filePath;
 
+  void LoadText();
+  void LoadImage(const std::string &fileName);
+  void Add(Word *inputWord, const Word &outputWord, const std::vector<float> &scores);
+
 public:
   static const std::vector<GenerationDictionary*>& GetColl() {
     return s_staticColl;
@@ -61,9 +66,15 @@ public:
   GenerationDictionary(const std::string &line);
   virtual ~GenerationDictionary();
 
-  //! load data file
+  //! load data file, or its image (path.gimage) if there is one
   void Load(AllOptions::ptr const& opts);
 
+  /** writes the text table read from inFile as an image, outFileName.gimage.
+  *  The image holds each factor string once and the transformed scores, so
+  *  loading it skips tokenizing and parsing the text.
+  */
+  static bool CreateImage(std::istream &inFile, const std::string &outFileName);
+
   /** number of unique input entries in the generation table.
   * NOT the number of lines in the generation table
   */
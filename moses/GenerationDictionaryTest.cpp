@@ -0,0 +1,143 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "GenerationDictionary.h"
+#include "TempDir.h"
+#include "Util.h"
+#include "Word.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+const char kTable[] =
+  "haus|NN haus|n 0.5 0.25\n"
+  "haus|NN haeuser|n 0.1 0.0001\n"
+  "klein|ADJ klein|adj 1 0.7\n"
+  "klein|ADJ kleine|adj 0.3 0.2\n"
+  "\xc3\xa4hnlich|ADJ \xc3\xa4hnlich|adj 0.4 0.6\n"
+  "haus|NN haus|n 0.6 0.35\n";
+
+// Feature names must be unique.
+string GenerationLine(const string &path)
+{
+  static size_t count = 0;
+  return "Generation name=GenerationDictionaryTest" + boost::lexical_cast<string>(count++)
+         + " num-features=2 input-factor=0 output-factor=1 path=" + path;
+}
+
+Word MakeWord(const string &surface)
+{
+  Word word;
+  word.CreateFromString(Input, vector<FactorType>(1, 0), surface, false);
+  return word;
+}
+
+// output factor and scores of every entry for the given input word
+string Describe(const GenerationDictionary &dictionary, const string &surface)
+{
+  const OutputWordCollection *words = dictionary.FindWord(MakeWord(surface));
+  if (!words) return "(none)";
+  vector<string> entries;
+  for (OutputWordCollection::const_iterator i = words->begin(); i != words->end(); ++i) {
+    ostringstream entry;
+    entry << i->first.GetString(1).as_string();
+    vector<float> scores = i->second.GetScoresForProducer(&dictionary);
+    for (size_t j = 0; j < scores.size(); ++j) entry << " " << scores[j];
+    entries.push_back(entry.str());
+  }
+  sort(entries.begin(), entries.end());
+  string ret;
+  for (size_t i = 0; i < entries.size(); ++i) ret += entries[i] + "; ";
+  return ret;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(generation_dictionary)
+
+BOOST_AUTO_TEST_CASE(image_matches_text)
+{
+  TempDir dir("generation-dictionary");
+  const string path = dir.Write("generation", kTable);
+  AllOptions::ptr opts(new AllOptions);
+
+  GenerationDictionary text(GenerationLine(path));
+  text.Load(opts);
+
+  istringstream in(kTable);
+  BOOST_REQUIRE(GenerationDictionary::CreateImage(in, path));
+  BOOST_REQUIRE(boost::filesystem::exists(path + ".gimage"));
+  // without the text only the image can supply the entries
+  boost::filesystem::remove(path);
+  GenerationDictionary image(GenerationLine(path));
+  image.Load(opts);
+
+  BOOST_CHECK_EQUAL(image.GetSize(), text.GetSize());
+  BOOST_CHECK_EQUAL(text.GetSize(), static_cast<size_t>(3));
+  const char *words[] = {"haus", "klein", "\xc3\xa4hnlich", "gross"};
+  for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+    BOOST_CHECK_EQUAL(Describe(image, words[i]), Describe(text, words[i]));
+  }
+  BOOST_CHECK_EQUAL(Describe(text, "gross"), "(none)");
+
+  // the later of two duplicate entries wins
+  ostringstream expected;
+  expected << "haeuser " << FloorScore(TransformScore(0.1f)) << " " << FloorScore(TransformScore(0.0001f))
+           << "; haus " << FloorScore(TransformScore(0.6f)) << " " << FloorScore(TransformScore(0.35f)) << "; ";
+  BOOST_CHECK_EQUAL(Describe(image, "haus"), expected.str());
+}
+
+BOOST_AUTO_TEST_CASE(inconsistent_table)
+{
+  TempDir dir("generation-dictionary");
+  istringstream in("haus|NN haus|n 0.5 0.25\nklein|ADJ klein|adj 1\n");
+  BOOST_CHECK(!GenerationDictionary::CreateImage(in, dir.File("generation")));
+}
+
+BOOST_AUTO_TEST_CASE(damaged_image)
+{
+  TempDir dir("generation-dictionary");
+  const string path = dir.File("generation");
+  AllOptions::ptr opts(new AllOptions);
+  istringstream in(kTable);
+  BOOST_REQUIRE(GenerationDictionary::CreateImage(in, path));
+
+  const string image = path + ".gimage";
+  boost::filesystem::resize_file(image, boost::filesystem::file_size(image) - 4);
+  GenerationDictionary truncated(GenerationLine(path));
+  BOOST_CHECK_THROW(truncated.Load(opts), util::Exception);
+
+  dir.Write("generation.gimage", "not an image at all, but long enough for a header");
+  GenerationDictionary garbage(GenerationLine(path));
+  BOOST_CHECK_THROW(garbage.Load(opts), util::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
+#include "moses/Profiler.h"
 
 #include <boost/foreach.hpp>
 
@@ -165,6 +166,7 @@ EvaluateWhenApplied(float estimatedScore)
   for (unsigned i = 0; i < sfs.size(); ++i) {
     const StatelessFeatureFunction &ff = *sfs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
+      ProfileScope profile(ff.GetProfileId());
       ff.EvaluateWhenApplied(*this, &m_currScoreBreakdown);
     }
   }
@@ -175,6 +177,7 @@ EvaluateWhenApplied(float estimatedScore)
     const StatefulFeatureFunction &ff = *ffs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
       FFState const* s = m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL;
+      ProfileScope profile(ff.GetProfileId());
       m_ffStates[i] = ff.EvaluateWhenApplied(*this, s, &m_currScoreBreakdown);
     }
   }
@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Util.h"
 #include "StaticData.h"
 #include "Manager.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -156,6 +157,9 @@ void HypothesisStackCubePruning::PruneToSize(size_t newSize)
 {
   if ( newSize == 0) return; // no limit
 
+  static const size_t profileId = Profiler::Register("Search", "PruneToSize");
+  ProfileScope profile(profileId);
+
   if (m_hypos.size() > newSize) { // ok, if not over the limit
     priority_queue<float> bestScores;
 
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TypeDef.h"
 #include "Util.h"
 #include "Manager.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -159,6 +160,9 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   if ( newSize == 0) return; // no limit
   if ( size() <= newSize ) return; // ok, if not over the limit
 
+  static const size_t profileId = Profiler::Register("Search", "PruneToSize");
+  ProfileScope profile(profileId);
+
   // we need to store a temporary list of hypotheses
   vector< Hypothesis* > hypos = GetSortedListNOTCONST();
   bool* included = (bool*) malloc(sizeof(bool) * hypos.size());
@@ -44,6 +44,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "moses/StaticData.h"
 #include "moses/InputFileStream.h"
 #include "moses/FF/StatefulFeatureFunction.h"
+#include "moses/FF/DynamicCacheBasedLanguageModel.h"
+#include "moses/TranslationModel/PhraseDictionaryDynamicCacheBased.h"
 #include "moses/TreeInput.h"
 #include "moses/ForestInput.h"
 #include "moses/ConfusionNet.h"
@@ -63,6 +65,25 @@ using namespace std;
 namespace Moses
 {
 
+namespace
+{
+
+// whether a cache-based model that DLT markup in the input can update is
+// loaded
+bool HasCacheBasedModels()
+{
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    if (dynamic_cast<PhraseDictionaryDynamicCacheBased*>(ffs[i])
+        || dynamic_cast<DynamicCacheBasedLanguageModel*>(ffs[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
 IOWrapper::IOWrapper(AllOptions const& opts)
   : m_options(new AllOptions(opts))
   , m_nBestStream(NULL)
@@ -92,7 +113,15 @@ IOWrapper::IOWrapper(AllOptions const& opts)
   string nBestFilePath = m_options->nbest.output_file_path;
 
   staticData.GetParameter().SetParameter<string>(m_inputFilePath, "input-file", "");
-  if (m_inputFilePath.empty()) {
+  bool prefetching = false;
+#ifdef WITH_THREADS
+  // DLT markup updates the cache-based models while a line is parsed; that
+  // has to happen on this thread, in input order
+  m_prefetch = m_options->input.prefetch_threads && m_inputType == SentenceInput
+               && !m_look_ahead && !m_look_back && !HasCacheBasedModels();
+  prefetching = m_prefetch;
+#endif
+  if (m_inputFilePath.empty() || prefetching) {
     m_inputFile = NULL;
     m_inputStream = &cin;
   } else {
@@ -141,6 +170,21 @@ IOWrapper::IOWrapper(AllOptions const& opts)
     m_singleBestOutputCollector.reset(new Moses::OutputCollector(&std::cout));
   }
 
+  OutputCollector* collectors[] = {
+    m_singleBestOutputCollector.get(), m_nBestOutputCollector.get(),
+    m_unknownsCollector.get(), m_alignmentInfoCollector.get(),
+    m_searchGraphOutputCollector.get(), m_detailedTranslationCollector.get(),
+    m_wordGraphCollector.get(), m_latticeSamplesCollector.get(),
+    m_detailTreeFragmentsOutputCollector.get()
+  };
+  for (size_t i = 0; i < sizeof(collectors) / sizeof(collectors[0]); ++i) {
+    if (collectors[i]) {
+      collectors[i]->SetStartId(m_options->output.start_translation_id);
+      collectors[i]->SetFlushPolicy(m_options->output.flush_every,
+                                    m_options->output.flush_interval);
+    }
+  }
+
   // setup file pattern for hypergraph output
   char const* key = "output-search-graph-hypergraph";
   PARAM_VEC const* p = staticData.GetParameter().GetParam(key);
@@ -202,6 +246,21 @@ GetBufferedInput()
 {
   switch(m_inputType) {
   case SentenceInput:
+#ifdef WITH_THREADS
+    if (m_prefetch) {
+      // started on first use, once the input source is final
+      if (!m_prefetcher) {
+        VERBOSE(2,"Prefetching input on " << m_options->input.prefetch_threads
+                << " threads" << endl);
+        util::FilePiece *in = m_inputFilePath.empty()
+                              ? new util::FilePiece(util::DupOrThrow(0), "stdin")
+                              : new util::FilePiece(m_inputFilePath.c_str());
+        m_prefetcher.reset(new SentencePrefetcher(in, m_options,
+                           m_options->input.prefetch_threads));
+      }
+      return m_prefetcher->Next();
+    }
+#endif
     return BufferInput<Sentence>();
   case ConfusionNetworkInput:
     return BufferInput<ConfusionNet>();
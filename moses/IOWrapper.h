@@ -62,9 +62,11 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "moses/ChartKBestExtractor.h"
 #include "moses/Syntax/KBestExtractor.h"
 #include "moses/parameters/AllOptions.h"
+#include "moses/SentencePrefetcher.h"
 
 #include <boost/format.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace Moses
 {
@@ -111,6 +113,9 @@ protected:
 
 #ifdef WITH_THREADS
   boost::mutex m_lock;
+  // reads and parses text input ahead of the decoder, if enabled
+  bool m_prefetch;
+  boost::scoped_ptr<SentencePrefetcher> m_prefetcher;
 #endif
   size_t m_currentLine; /* line counter, initialized from static data at construction
 			 * incremented with every call to ReadInput */
@@ -142,8 +147,10 @@ public:
   void SetOutputStream2SingleBestOutputCollector(std::ostream* outStream) {
     if (m_singleBestOutputCollector.get())
       m_singleBestOutputCollector->SetOutputStream(outStream);
-    else
+    else {
       m_singleBestOutputCollector.reset(new Moses::OutputCollector(outStream));
+      m_singleBestOutputCollector->SetStartId(m_options->output.start_translation_id);
+    }
   }
 
   Moses::OutputCollector *GetNBestOutputCollector() {
@@ -180,6 +187,10 @@ public:
 
   void SetInputStreamFromString(std::istringstream &input) {
     m_inputStream = &input;
+#ifdef WITH_THREADS
+    m_prefetch = false;
+    m_prefetcher.reset();
+#endif
   }
 
   std::string GetHypergraphOutputFileName(size_t const id) const;
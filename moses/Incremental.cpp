@@ -10,16 +10,31 @@
 #include "moses/Util.h"
 #include "moses/LM/Base.h"
 #include "moses/OutputCollector.h"
+#include "moses/ThreadPool.h"
 
 #include "lm/model.hh"
 #include "search/applied.hh"
 #include "search/config.hh"
 #include "search/context.hh"
 #include "search/edge_generator.hh"
+#include "search/edge_part.hh"
 #include "search/rule.hh"
 #include "search/vertex_generator.hh"
+#include "util/pool.hh"
 
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#else
+#include <boost/scoped_ptr.hpp>
+#endif
 
 namespace Moses
 {
@@ -28,6 +43,145 @@ namespace Incremental
 namespace
 {
 
+// Edge pools are reset and reused by the following spans and sentences of the
+// decoding thread that used them, so search stops calling malloc once the
+// pools have grown to the size of a span.
+struct EdgePoolCache {
+  ~EdgePoolCache() {
+    for (std::vector<util::Pool*>::iterator i = free.begin(); i != free.end(); ++i) {
+      delete *i;
+    }
+  }
+  std::vector<util::Pool*> free;
+};
+
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<EdgePoolCache> edge_pool_cache;
+#else
+boost::scoped_ptr<EdgePoolCache> edge_pool_cache;
+#endif
+
+util::Pool &GetEdgePool()
+{
+  if (!edge_pool_cache.get()) {
+    edge_pool_cache.reset(new EdgePoolCache());
+  }
+  std::vector<util::Pool*> &free = edge_pool_cache->free;
+  if (free.empty()) {
+    return *new util::Pool();
+  }
+  util::Pool *ret = free.back();
+  free.pop_back();
+  return *ret;
+}
+
+// Call on the thread that got the pool.
+void PutEdgePool(util::Pool &pool)
+{
+  pool.Reset();
+  edge_pool_cache->free.push_back(&pool);
+}
+
+#ifdef WITH_THREADS
+// Jobs 0 ... count - 1, claimed in order by the calling thread and helpers.
+class JobState
+{
+public:
+  JobState(std::size_t count, const boost::function<void (std::size_t)> &job)
+    : job_(job), count_(count), next_(0), running_(0) {}
+
+  void Work() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    ++running_;
+    while (next_ < count_) {
+      std::size_t index = next_++;
+      lock.unlock();
+      std::string error;
+      try {
+        job_(index);
+      } catch (const std::exception &e) {
+        error = e.what();
+      } catch (...) {
+        error = "unknown exception";
+      }
+      lock.lock();
+      if (!error.empty() && error_.empty()) {
+        error_ = error;
+      }
+    }
+    if (--running_ == 0) {
+      done_.notify_all();
+    }
+  }
+
+  // Wait until every job finished.  Returns the first error, if any.
+  std::string Wait() {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    while (next_ < count_ || running_) {
+      done_.wait(lock);
+    }
+    return error_;
+  }
+
+private:
+  boost::function<void (std::size_t)> job_;
+  std::size_t count_, next_, running_;
+  std::string error_;
+
+  boost::mutex mutex_;
+  boost::condition_variable done_;
+};
+
+class JobHelper : public Task
+{
+public:
+  explicit JobHelper(const boost::shared_ptr<JobState> &state) : state_(state) {}
+
+  void Run() {
+    state_->Work();
+  }
+
+private:
+  boost::shared_ptr<JobState> state_;
+};
+
+// Helpers shared by all decoding threads.  Created on first use and never
+// destroyed, since a helper may still hold a finished JobState at exit.
+boost::mutex helper_pool_mutex;
+ThreadPool *helper_pool = NULL;
+
+ThreadPool &HelperPool(std::size_t threads)
+{
+  boost::lock_guard<boost::mutex> lock(helper_pool_mutex);
+  if (!helper_pool) {
+    helper_pool = new ThreadPool(threads);
+  }
+  return *helper_pool;
+}
+#endif // WITH_THREADS
+
+// Run job(0) ... job(count - 1) on up to threads threads, including the
+// calling thread, which also runs whatever the helpers have not claimed yet.
+void RunJobs(std::size_t count, const boost::function<void (std::size_t)> &job, std::size_t threads)
+{
+#ifdef WITH_THREADS
+  if (threads > 1 && count > 1) {
+    boost::shared_ptr<JobState> state(new JobState(count, job));
+    ThreadPool &pool = HelperPool(threads - 1);
+    for (std::size_t i = 1; i < std::min(threads, count); ++i) {
+      pool.Submit(boost::shared_ptr<Task>(new JobHelper(state)));
+    }
+    state->Work();
+    std::string error(state->Wait());
+    UTIL_THROW_IF2(!error.empty(), "Error in incremental search: " << error);
+    return;
+  }
+#endif
+  for (std::size_t i = 0; i < count; ++i) {
+    job(i);
+  }
+}
+
 // This is called by EdgeGenerator.  Route hypotheses to separate vertices for
 // each left hand side label, populating ChartCellLabelSet out.
 template <class Best> class HypothesisCallback
@@ -78,8 +232,17 @@ private:
 template <class Model> class Fill : public ChartParserCallback
 {
 public:
-  Fill(search::Context<Model> &context, const std::vector<lm::WordIndex> &vocab_mapping, search::Score oov_weight)
-    : context_(context), vocab_mapping_(vocab_mapping), oov_weight_(oov_weight) {}
+  Fill(search::Context<Model> &context, const std::vector<lm::WordIndex> &vocab_mapping, search::Score oov_weight, std::size_t threads)
+    : context_(context), vocab_mapping_(vocab_mapping), threads_(threads), pool_(GetEdgePool()), edges_(pool_), oov_weight_(oov_weight) {}
+
+  ~Fill() {
+    for (typename std::vector<Part*>::iterator i = parts_.begin(); i != parts_.end(); ++i) {
+      util::Pool &pool = (*i)->pool;
+      delete *i;
+      PutEdgePool(pool);
+    }
+    PutEdgePool(pool_);
+  }
 
   void Add(const TargetPhraseCollection &targets, const StackVec &nts, const Range &ignored);
 
@@ -88,19 +251,19 @@ public:
   float GetBestScore(const ChartCellLabel *chartCell) const;
 
   bool Empty() const {
-    return edges_.Empty();
+    return edges_.Empty() && parts_.empty();
   }
 
   template <class Best> void Search(Best &best, ChartCellLabelSet &out, boost::object_pool<search::Vertex> &vertex_pool) {
     HypothesisCallback<Best> callback(context_, best, out, vertex_pool);
-    edges_.Search(context_, callback);
+    Run(callback);
   }
 
   // Root: everything into one vertex.
   template <class Best> search::History RootSearch(Best &best) {
     search::Vertex vertex;
     search::RootVertexGenerator<Best> gen(vertex, best);
-    edges_.Search(context_, gen);
+    Run(gen);
     return vertex.BestChild();
   }
 
@@ -108,17 +271,96 @@ public:
     // TODO for input lattice
   }
 private:
+  // With several threads, the edges are divided by left hand side into parts
+  // (several left hand sides per part if there are many), which are popped
+  // in parallel and merged by search::MergeParts.
+  struct Part {
+    explicit Part(util::Pool &pool_in) : pool(pool_in), edges(pool_in), count(0), share(0) {}
+
+    util::Pool &pool;
+    search::EdgePart edges;
+    // Edges added.
+    std::size_t count;
+    // Complete hypotheses to pop ahead.
+    std::size_t share;
+  };
+
+  static const std::size_t kPartsPerThread = 4;
+
   lm::WordIndex Convert(const Word &word) const;
 
+  search::EdgeGenerator &EdgesFor(const TargetPhrase &phrase);
+
+  template <class Output> void Run(Output &output);
+
+  void PopPart(std::size_t index) {
+    parts_[index]->edges.PopAhead(context_, parts_[index]->share);
+  }
+
   search::Context<Model> &context_;
 
   const std::vector<lm::WordIndex> &vocab_mapping_;
 
+  const std::size_t threads_;
+
+  util::Pool &pool_;
+
+  // Used with one thread.
   search::EdgeGenerator edges_;
 
+  std::vector<Part*> parts_;
+  boost::unordered_map<const Factor*, Part*> lhs_parts_;
+
   const search::Score oov_weight_;
 };
 
+template <class Model> search::EdgeGenerator &Fill<Model>::EdgesFor(const TargetPhrase &phrase)
+{
+  if (threads_ <= 1) {
+    return edges_;
+  }
+  Part *&part = lhs_parts_[phrase.GetTargetLHS()[0]];
+  if (!part) {
+    if (parts_.size() < threads_ * kPartsPerThread) {
+      parts_.push_back(new Part(GetEdgePool()));
+      part = parts_.back();
+    } else {
+      part = parts_[(lhs_parts_.size() - 1) % parts_.size()];
+    }
+  }
+  ++part->count;
+  return part->edges.Edges();
+}
+
+template <class Model> template <class Output> void Fill<Model>::Run(Output &output)
+{
+  if (parts_.size() <= 1) {
+    (parts_.empty() ? edges_ : parts_.front()->edges.Edges()).Search(context_, output);
+    return;
+  }
+  // Each part pops ahead its share of the pop limit.
+  std::size_t total = 0;
+  for (typename std::vector<Part*>::const_iterator i = parts_.begin(); i != parts_.end(); ++i) {
+    total += (*i)->count;
+  }
+  const std::size_t limit = context_.PopLimit();
+  std::vector<search::EdgePart*> parts;
+  parts.reserve(parts_.size());
+  for (typename std::vector<Part*>::iterator i = parts_.begin(); i != parts_.end(); ++i) {
+    (*i)->share = std::max<std::size_t>(1, (limit * (*i)->count + total - 1) / total);
+    parts.push_back(&(*i)->edges);
+  }
+  context_.SetConcurrent(true);
+  try {
+    RunJobs(parts_.size(), boost::bind(&Fill<Model>::PopPart, this, _1), threads_);
+  } catch (...) {
+    context_.SetConcurrent(false);
+    throw;
+  }
+  context_.SetConcurrent(false);
+  search::MergeParts(context_, parts, output);
+}
+
 template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targets, const StackVec &nts, const Range &range)
 {
   std::vector<search::PartialVertex> vertices;
@@ -134,7 +376,8 @@ template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targe
     words.clear();
     const TargetPhrase &phrase = **p;
     const AlignmentInfo::NonTermIndexMap &align = phrase.GetAlignNonTerm().GetNonTermIndexMap();
-    search::PartialEdge edge(edges_.AllocateEdge(nts.size()));
+    search::EdgeGenerator &edges = EdgesFor(phrase);
+    search::PartialEdge edge(edges.AllocateEdge(nts.size()));
 
     search::PartialVertex *nt = edge.NT();
     for (size_t i = 0; i < phrase.GetSize(); ++i) {
@@ -156,7 +399,7 @@ template <class Model> void Fill<Model>::Add(const TargetPhraseCollection &targe
     edge.SetNote(note);
     edge.SetRange(range);
 
-    edges_.AddEdge(edge);
+    edges.AddEdge(edge);
   }
 }
 
@@ -168,7 +411,8 @@ template <class Model> void Fill<Model>::AddPhraseOOV(TargetPhrase &phrase, std:
   if (phrase.GetSize())
     words.push_back(Convert(phrase.GetWord(0)));
 
-  search::PartialEdge edge(edges_.AllocateEdge(0));
+  search::EdgeGenerator &edges = EdgesFor(phrase);
+  search::PartialEdge edge(edges.AllocateEdge(0));
   // Appears to be a bug that FutureScore does not already include language model.
   search::ScoreRuleRet scored(search::ScoreRule(context_.LanguageModel(), words, edge.Between()));
   edge.SetScore(phrase.GetFutureScore() + scored.prob * context_.LMWeight() + static_cast<search::Score>(scored.oov) * oov_weight_);
@@ -178,7 +422,7 @@ template <class Model> void Fill<Model>::AddPhraseOOV(TargetPhrase &phrase, std:
   edge.SetNote(note);
   edge.SetRange(range);
 
-  edges_.AddEdge(edge);
+  edges.AddEdge(edge);
 }
 
 // for pruning
@@ -234,6 +478,7 @@ PopulateBest(const Model &model, const std::vector<lm::WordIndex> &words, Best &
   const float oov_weight = abstract.OOVFeatureEnabled() ? data.GetWeights(&abstract)[1] : 0.0;
   size_t cpl = data.options()->cube.pop_limit;
   size_t nbs = data.options()->nbest.nbest_size;
+  size_t threads = data.options()->cube.threads;
   search::Config config(lm_weight * log_10, cpl, search::NBestConfig(nbs));
   search::Context<Model> context(config, model);
 
@@ -247,14 +492,14 @@ PopulateBest(const Model &model, const std::vector<lm::WordIndex> &words, Best &
         break;
       }
       Range range(startPos, startPos + width - 1);
-      Fill<Model> filler(context, words, oov_weight);
+      Fill<Model> filler(context, words, oov_weight, threads);
       parser_.Create(range, filler);
       filler.Search(out, cells_.MutableBase(range).MutableTargetLabelSet(), vertex_pool);
     }
   }
 
   Range range(0, size - 1);
-  Fill<Model> filler(context, words, oov_weight);
+  Fill<Model> filler(context, words, oov_weight, threads);
   parser_.Create(range, filler);
   return filler.RootSearch(out);
 }
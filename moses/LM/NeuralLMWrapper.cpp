@@ -11,6 +11,8 @@ namespace Moses
 {
 NeuralLMWrapper::NeuralLMWrapper(const std::string &line)
   :LanguageModelSingleFactor(line)
+  ,m_cacheSize(1000000)
+  ,m_sharedCacheSize(0)
 {
   ReadParameters();
 }
@@ -35,14 +37,27 @@ void NeuralLMWrapper::Load(AllOptions::ptr const& opts)
   m_neuralLM_shared = new nplm::neuralLM();
   m_neuralLM_shared->read(m_filePath);
   m_neuralLM_shared->premultiply();
-  //TODO: config option?
-  m_neuralLM_shared->set_cache(1000000);
+  m_neuralLM_shared->set_cache(m_cacheSize);
 
   m_unk = m_neuralLM_shared->lookup_word("<unk>");
 
   UTIL_THROW_IF2(m_nGramOrder != m_neuralLM_shared->get_order(),
                  "Wrong order of neuralLM: LM has " << m_neuralLM_shared->get_order() << ", but Moses expects " << m_nGramOrder);
 
+  if (m_sharedCacheSize > 0) {
+    m_sharedCache.reset(new NeuralScoreCache(m_sharedCacheSize, m_nGramOrder));
+  }
+}
+
+void NeuralLMWrapper::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "cache_size") {
+    m_cacheSize = Scan<int>(value);
+  } else if (key == "shared_cache_size") {
+    m_sharedCacheSize = Scan<int>(value);
+  } else {
+    LanguageModelSingleFactor::SetParameter(key, value);
+  }
 }
 
 
@@ -51,8 +66,7 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
 
   if (!m_neuralLM.get()) {
     m_neuralLM.reset(new nplm::neuralLM(*m_neuralLM_shared));
-    //TODO: config option?
-    m_neuralLM->set_cache(1000000);
+    m_neuralLM->set_cache(m_cacheSize);
   }
 
   vector<int> words(contextFactor.size());
@@ -71,7 +85,13 @@ LMResult NeuralLMWrapper::GetValue(const vector<const Word*> &contextFactor, Sta
     boost::hash_combine(hashCode, words[i]);
   }
 
-  double value = m_neuralLM->lookup_ngram(words);
+  float value;
+  if (!m_sharedCache || !m_sharedCache->Find(words, value)) {
+    value = m_neuralLM->lookup_ngram(words);
+    if (m_sharedCache) {
+      m_sharedCache->Insert(words, value);
+    }
+  }
 
   // Create a new struct to hold the result
   LMResult ret;
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "SingleFactor.h"
+#include "NeuralScoreCache.h"
 
 #include <boost/thread/tss.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace nplm
 {
@@ -19,7 +21,11 @@ protected:
   nplm::neuralLM *m_neuralLM_shared;
   // thread-specific nplm for thread-safety
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
+  // n-gram scores shared among threads and sentences; NULL if disabled
+  boost::scoped_ptr<NeuralScoreCache> m_sharedCache;
   int m_unk;
+  int m_cacheSize;
+  int m_sharedCacheSize;
 
 public:
   NeuralLMWrapper(const std::string &line);
@@ -29,6 +35,8 @@ public:
 
   virtual void Load(AllOptions::ptr const& opts);
 
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
 };
 
 
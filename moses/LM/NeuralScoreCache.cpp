@@ -0,0 +1,77 @@
+#include "NeuralScoreCache.h"
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
+
+namespace Moses
+{
+
+NeuralScoreCache::NeuralScoreCache(size_t capacity, size_t order)
+  :m_order(order)
+{
+  UTIL_THROW_IF2(order == 0, "Neural score cache needs a positive n-gram order");
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_mask = size - 1;
+  m_hashes.resize(size, 0);
+  m_keys.resize(size * m_order, -1);
+  m_scores.resize(size, 0);
+}
+
+uint64_t NeuralScoreCache::Hash(const std::vector<int> &ngram) const
+{
+  uint64_t ret = util::MurmurHashNative(&ngram[0], ngram.size() * sizeof(int), ngram.size());
+  // 0 is reserved for empty slots
+  return ret ? ret : 1;
+}
+
+bool NeuralScoreCache::Matches(size_t slot, const std::vector<int> &ngram) const
+{
+  const int *key = &m_keys[slot * m_order];
+  for (size_t i = 0; i < m_order; ++i) {
+    int id = (i < ngram.size()) ? ngram[i] : -1;
+    if (key[i] != id) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NeuralScoreCache::Find(const std::vector<int> &ngram, float &score) const
+{
+  if (ngram.empty() || ngram.size() > m_order) {
+    return false;
+  }
+  uint64_t hash = Hash(ngram);
+  size_t slot = hash & m_mask;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_locks[slot % NUM_LOCKS]);
+#endif
+  if (m_hashes[slot] != hash || !Matches(slot, ngram)) {
+    return false;
+  }
+  score = m_scores[slot];
+  return true;
+}
+
+void NeuralScoreCache::Insert(const std::vector<int> &ngram, float score)
+{
+  if (ngram.empty() || ngram.size() > m_order) {
+    return;
+  }
+  uint64_t hash = Hash(ngram);
+  size_t slot = hash & m_mask;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_locks[slot % NUM_LOCKS]);
+#endif
+  int *key = &m_keys[slot * m_order];
+  for (size_t i = 0; i < m_order; ++i) {
+    key[i] = (i < ngram.size()) ? ngram[i] : -1;
+  }
+  m_hashes[slot] = hash;
+  m_scores[slot] = score;
+}
+
+}
+
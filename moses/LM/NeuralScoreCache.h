@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Fixed-capacity n-gram -> score cache shared by all decoder threads.
+ *  NPLM only offers a cache per model instance, and every thread owns its
+ *  own instance, so identical contexts get propagated once per thread.
+ *  This cache sits in front of those instances and is shared across
+ *  threads and sentences.
+ *
+ *  Keys are sequences of at most 'order' non-negative word IDs.  The table is
+ *  direct-mapped: a colliding insert simply evicts the previous entry, which
+ *  keeps memory bounded and avoids any eviction bookkeeping.  Slots are
+ *  protected by a small array of striped locks.
+ */
+class NeuralScoreCache
+{
+public:
+  // capacity is rounded up to the next power of two
+  NeuralScoreCache(size_t capacity, size_t order);
+
+  bool Find(const std::vector<int> &ngram, float &score) const;
+  void Insert(const std::vector<int> &ngram, float score);
+
+  size_t GetOrder() const {
+    return m_order;
+  }
+
+  size_t GetCapacity() const {
+    return m_scores.size();
+  }
+
+protected:
+  static const size_t NUM_LOCKS = 64;
+
+  uint64_t Hash(const std::vector<int> &ngram) const;
+  bool Matches(size_t slot, const std::vector<int> &ngram) const;
+
+  size_t m_order;
+  size_t m_mask;
+  std::vector<uint64_t> m_hashes; // 0 marks an empty slot
+  std::vector<int> m_keys; // m_order IDs per slot, padded with -1
+  std::vector<float> m_scores;
+
+#ifdef WITH_THREADS
+  mutable boost::mutex m_locks[NUM_LOCKS];
+#endif
+};
+
+}
+
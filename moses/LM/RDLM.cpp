@@ -107,6 +107,11 @@ void RDLM::Load(AllOptions::ptr const& opts)
   static_root_head = lm_head_base_instance_->lookup_input_word("<root_head>");
   static_root_label = lm_head_base_instance_->lookup_input_word("<root_label>");
 
+  if (m_sharedCacheSize > 0) {
+    m_sharedCacheHead.reset(new NeuralScoreCache(m_sharedCacheSize, size_head));
+    m_sharedCacheLabel.reset(new NeuralScoreCache(m_sharedCacheSize, size_label));
+  }
+
   // just score provided file, then exit.
   if (!m_debugPath.empty()) {
     ScoreFile(m_debugPath);
@@ -297,10 +302,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
         it = std::copy(ancestor_labels.end()-context_up_nonempty, ancestor_labels.end(), it);
       }
       if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[0] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[1] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       }
     }
     return;
@@ -366,19 +371,19 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
       it += m_context_right;
       it = std::copy(ancestor_heads.end()-context_up_nonempty, ancestor_heads.end(), it);
       it = std::copy(ancestor_labels.end()-context_up_nonempty, ancestor_labels.end(), it);
-      score[2] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      score[2] += LookupNgram(ngram, thread_objects.lm_label, m_sharedCacheLabel.get());
     } else {
       boost::hash_combine(boundary_hash, ngram.back());
-      score[3] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      score[3] += LookupNgram(ngram, thread_objects.lm_label, m_sharedCacheLabel.get());
     }
     if (head_idx != static_dummy_head && head_idx != static_head_head) {
       ngram.push_back(head_ids.second);
       *(ngram.end()-2) = label_idx;
       if (ancestor_heads.size() == m_context_up && ancestor_heads.back() == static_root_head && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[0] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[1] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       }
     }
   }
@@ -493,10 +498,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
     ngram.back() = labels_output[i];
 
     if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-      score[2] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      score[2] += LookupNgram(ngram, thread_objects.lm_label, m_sharedCacheLabel.get());
     } else {
       boost::hash_combine(boundary_hash, ngram.back());
-      score[3] += FloorScore(thread_objects.lm_label->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+      score[3] += LookupNgram(ngram, thread_objects.lm_label, m_sharedCacheLabel.get());
     }
 
     // construct context of head model and predict head
@@ -506,10 +511,10 @@ void RDLM::Score(InternalTree* root, const TreePointerMap & back_pointers, boost
       ngram.push_back(heads_output[i]);
 
       if (ancestor_labels.size() >= m_context_up && !num_virtual) {
-        score[0] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[0] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       } else {
         boost::hash_combine(boundary_hash, ngram.back());
-        score[1] += FloorScore(thread_objects.lm_head->lookup_ngram(EigenMap(ngram.data(), ngram.size())));
+        score[1] += LookupNgram(ngram, thread_objects.lm_head, m_sharedCacheHead.get());
       }
       ngram.pop_back();
     }
@@ -715,6 +720,21 @@ int RDLM::Factor2ID(const Factor * const factor, int model_type) const
   return ret;
 }
 
+// score n-gram with thread-specific NPLM instance, going through the
+// cross-thread score cache if one is configured
+float RDLM::LookupNgram(const std::vector<int> &ngram, nplm::neuralTM *lm, NeuralScoreCache *cache) const
+{
+  float score;
+  if (cache && cache->Find(ngram, score)) {
+    return score;
+  }
+  score = FloorScore(lm->lookup_ngram(EigenMap(const_cast<int*>(ngram.data()), ngram.size())));
+  if (cache) {
+    cache->Insert(ngram, score);
+  }
+  return score;
+}
+
 void RDLM::PrintInfo(std::vector<int> &ngram, nplm::neuralTM* lm) const
 {
   for (size_t i = 0; i < ngram.size()-1; i++) {
@@ -822,6 +842,8 @@ void RDLM::SetParameter(const std::string& key, const std::string& value)
     m_factorType = Scan<FactorType>(value);
   } else if (key == "cache_size") {
     m_cacheSize = Scan<int>(value);
+  } else if (key == "shared_cache_size") {
+    m_sharedCacheSize = Scan<int>(value);
   } else {
     UTIL_THROW(util::Exception, "Unknown argument " << key << "=" << value);
   }
@@ -4,9 +4,11 @@
 #include "moses/FF/FFState.h"
 #include "moses/FF/InternalTree.h"
 #include "moses/Word.h"
+#include "moses/LM/NeuralScoreCache.h"
 
 #include <boost/thread/tss.hpp>
 #include <boost/array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
@@ -91,6 +93,10 @@ class RDLM : public StatefulFeatureFunction
 
   mutable boost::thread_specific_ptr<rdlm::ThreadLocal> thread_objects_backend_;
 
+  // n-gram scores shared among threads and sentences; NULL if disabled
+  boost::scoped_ptr<NeuralScoreCache> m_sharedCacheHead;
+  boost::scoped_ptr<NeuralScoreCache> m_sharedCacheLabel;
+
   std::string m_glueSymbolString;
   Word dummy_head;
   Word m_glueSymbol;
@@ -111,6 +117,7 @@ class RDLM : public StatefulFeatureFunction
   std::string m_debugPath; // score all trees in the provided file, then exit
   int m_binarized;
   int m_cacheSize;
+  int m_sharedCacheSize;
 
   size_t offset_up_head;
   size_t offset_up_label;
@@ -164,6 +171,7 @@ public:
     , m_sharedVocab(false)
     , m_binarized(0)
     , m_cacheSize(1000000)
+    , m_sharedCacheSize(0)
     , m_factorType(0) {
     ReadParameters();
     std::vector<FactorType> factors;
@@ -187,6 +195,7 @@ public:
   void GetIDs(const Word & head, const Word & preterminal, std::pair<int,int> & IDs) const;
   int Factor2ID(const Factor * const factor, int model_type) const;
   void ScoreFile(std::string &path); //for debugging
+  float LookupNgram(const std::vector<int> &ngram, nplm::neuralTM *lm, NeuralScoreCache *cache) const;
   void PrintInfo(std::vector<int> &ngram, nplm::neuralTM* lm) const; //for debugging
 
   TreePointerMap AssociateLeafNTs(InternalTree* root, const std::vector<TreePointer> &previous) const;
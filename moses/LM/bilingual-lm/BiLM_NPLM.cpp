@@ -9,7 +9,8 @@ BilingualLM_NPLM::BilingualLM_NPLM(const std::string &line)
   : BilingualLM(line),
     premultiply(true),
     factored(false),
-    neuralLM_cache(1000000)
+    neuralLM_cache(1000000),
+    shared_cache_size(0)
 {
 
   NULL_string = "<null>"; //Default null value for nplm
@@ -22,7 +23,15 @@ float BilingualLM_NPLM::Score(std::vector<int>& source_words, std::vector<int>&
 {
   source_words.reserve(source_ngrams+target_ngrams+1);
   source_words.insert( source_words.end(), target_words.begin(), target_words.end() );
-  return FloorScore(m_neuralLM->lookup_ngram(source_words));
+  float score;
+  if (m_sharedCache && m_sharedCache->Find(source_words, score)) {
+    return score;
+  }
+  score = FloorScore(m_neuralLM->lookup_ngram(source_words));
+  if (m_sharedCache) {
+    m_sharedCache->Insert(source_words, score);
+  }
+  return score;
 }
 
 const Word& BilingualLM_NPLM::getNullWord() const
@@ -90,6 +99,8 @@ void BilingualLM_NPLM::SetParameter(const std::string& key, const std::string& v
     target_vocab_path = value;
   } else if (key == "cache_size") {
     neuralLM_cache = atoi(value.c_str());
+  } else if (key == "shared_cache_size") {
+    shared_cache_size = Scan<int>(value);
   } else if (key == "premultiply") {
     premultiply = Scan<bool>(value);
     //TODO: doesn't currently do anything (constructor doesn't know about parameters)
@@ -116,6 +127,9 @@ void BilingualLM_NPLM::loadModel()
     ", but Moses expects " << ngram_order);
 
   m_neuralLM_shared->set_cache(neuralLM_cache); //Default 1000000
+  if (shared_cache_size > 0) {
+    m_sharedCache.reset(new NeuralScoreCache(shared_cache_size, ngram_order));
+  }
 
   //Setup factor -> NeuralLMId cache. First target words
   FactorCollection& factorFactory = FactorCollection::Instance(); //To do the conversion from string to vocabID
@@ -1,4 +1,6 @@
 #include "moses/LM/BilingualLM.h"
+#include "moses/LM/NeuralScoreCache.h"
+#include <boost/scoped_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include <utility> //make_pair
 #include <fstream> //Read vocabulary files
@@ -31,6 +33,8 @@ private:
 
   nplm::neuralLM *m_neuralLM_shared;
   mutable boost::thread_specific_ptr<nplm::neuralLM> m_neuralLM;
+  // n-gram scores shared among threads and sentences; NULL if disabled
+  boost::scoped_ptr<NeuralScoreCache> m_sharedCache;
 
   mutable boost::unordered_map<const Factor*, int> target_neuralLMids;
   mutable boost::unordered_map<const Factor*, int> source_neuralLMids;
@@ -45,6 +49,7 @@ private:
   bool premultiply;
   bool factored;
   int neuralLM_cache;
+  int shared_cache_size;
   int source_unknown_word_id;
   int target_unknown_word_id;
 };
@@ -30,15 +30,25 @@
 #endif
 
 #include <iostream>
-#include <map>
 #include <ostream>
+#include <map>
 #include <string>
+#include <vector>
 #include "Util.h"
 #include "util/exception.hh"
+#include "util/usage.hh"
 namespace Moses
 {
 /**
-* Makes sure output goes in the correct order when multi-threading
+* Makes sure output goes in the correct order when multi-threading.
+*
+* Out-of-order results wait in a small ring buffer indexed by sentence ID;
+* the few that are too far ahead for the ring wait in an ordered map.  Only
+* one thread writes to the streams at a time: whoever completes the next
+* run of consecutive sentences writes the whole run in one go, outside the
+* lock, while other threads just deposit their output and return.
+* How often the streams are flushed is configurable (SetFlushPolicy);
+* by default they are flushed after every write, as before.
 **/
 class OutputCollector
 {
@@ -49,10 +59,13 @@ public:
     , m_outStream(outStream)
     , m_debugStream(debugStream)
     , m_isHoldingOutputStream(false)
-    , m_isHoldingDebugStream(false) {}
+    , m_isHoldingDebugStream(false) {
+    Init();
+  }
 
   OutputCollector(std::string xout, std::string xerr = "")
     : m_nextOutput(0) {
+    Init();
     // TO DO open magic streams instead of regular ofstreams! [UG]
 
     if (xout == "/dev/stderr") {
@@ -83,6 +96,7 @@ public:
   }
 
   ~OutputCollector() {
+    Flush();
     if (m_isHoldingOutputStream)
       delete m_outStream;
     if (m_isHoldingDebugStream)
@@ -101,6 +115,29 @@ public:
     return (m_outStream == &std::cout);
   }
 
+  /**
+    * ID of the first sentence to be written, if not 0 (the
+    * start-translation-id option).  Call before the first Write().
+    **/
+  void SetStartId(int sourceId) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_nextOutput = sourceId;
+  }
+
+  /**
+    * Flush the streams after every sentences written, or when at least
+    * seconds have passed since the last flush (0 disables that check).
+    **/
+  void SetFlushPolicy(size_t sentences, double seconds = 0) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_flushEvery = sentences;
+    m_flushInterval = seconds;
+  }
+
   /**
     * Write or cache the output, as appropriate.
     **/
@@ -108,39 +145,132 @@ public:
 #ifdef WITH_THREADS
     boost::mutex::scoped_lock lock(m_mutex);
 #endif
-    if (sourceId == m_nextOutput) {
-      //This is the one we were expecting
-      *m_outStream << output << std::flush;
-      *m_debugStream << debug << std::flush;
-      ++m_nextOutput;
-      //see if there's any more
-      std::map<int,std::string>::iterator iter;
-      while ((iter = m_outputs.find(m_nextOutput)) != m_outputs.end()) {
-        *m_outStream << iter->second << std::flush;
-        ++m_nextOutput;
-        std::map<int,std::string>::iterator debugIter = m_debugs.find(iter->first);
-        m_outputs.erase(iter);
-        if (debugIter != m_debugs.end()) {
-          *m_debugStream << debugIter->second << std::flush;
-          m_debugs.erase(debugIter);
-        }
+    if (sourceId < m_nextOutput) {
+      // already written, nothing will ever pick this up
+      return;
+    }
+    Slot &slot = GetSlot(sourceId);
+    slot.output = output;
+    slot.debug = debug;
+    slot.ready = true;
+
+    if (m_isWriting) {
+      // the thread that is writing will get to this sentence
+      return;
+    }
+    m_isWriting = true;
+    std::string outBatch, debugBatch;
+    size_t count;
+    while ((count = TakeReady(outBatch, debugBatch)) > 0) {
+#ifdef WITH_THREADS
+      lock.unlock();
+#endif
+      m_outStream->write(outBatch.data(), outBatch.size());
+      if (debugBatch.size()) {
+        m_debugStream->write(debugBatch.data(), debugBatch.size());
       }
-    } else {
-      //save for later
-      m_outputs[sourceId] = output;
-      m_debugs[sourceId] = debug;
+      m_unflushed += count;
+      if (m_unflushed >= m_flushEvery
+          || (m_flushInterval > 0 && util::WallTime() - m_lastFlush >= m_flushInterval)) {
+        FlushStreams();
+      }
+#ifdef WITH_THREADS
+      lock.lock();
+#endif
     }
+    m_isWriting = false;
+  }
+
+  void Flush() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (!m_isWriting) FlushStreams();
   }
 
 
 private:
-  std::map<int,std::string> m_outputs;
-  std::map<int,std::string> m_debugs;
+  struct Slot {
+    bool ready;
+    std::string output;
+    std::string debug;
+    Slot() : ready(false) {}
+  };
+
+  void Init() {
+    m_ring.resize(64);
+    m_isWriting = false;
+    m_flushEvery = 1;
+    m_flushInterval = 0;
+    m_unflushed = 0;
+    m_lastFlush = util::WallTime();
+  }
+
+  // slot of sentence sourceId, in the ring unless it is too far ahead
+  Slot &GetSlot(int sourceId) {
+    if (size_t(sourceId - m_nextOutput) >= m_ring.size()) {
+      return m_overflow[sourceId];
+    }
+    return m_ring[sourceId % m_ring.size()];
+  }
+
+  // move the sentences that the ring has caught up with out of the overflow
+  void MoveFromOverflow() {
+    while (!m_overflow.empty()
+           && size_t(m_overflow.begin()->first - m_nextOutput) < m_ring.size()) {
+      Slot &from = m_overflow.begin()->second;
+      Slot &to = m_ring[m_overflow.begin()->first % m_ring.size()];
+      to.ready = from.ready;
+      to.output.swap(from.output);
+      to.debug.swap(from.debug);
+      m_overflow.erase(m_overflow.begin());
+    }
+  }
+
+  // move the run of consecutive finished sentences into the batches
+  size_t TakeReady(std::string &outBatch, std::string &debugBatch) {
+    outBatch.clear();
+    debugBatch.clear();
+    size_t count = 0;
+    for (;;) {
+      Slot &slot = m_ring[m_nextOutput % m_ring.size()];
+      if (!slot.ready) break;
+      if (count == 0) {
+        outBatch.swap(slot.output);
+        debugBatch.swap(slot.debug);
+      } else {
+        outBatch += slot.output;
+        debugBatch += slot.debug;
+      }
+      slot.ready = false;
+      slot.output.clear();
+      slot.debug.clear();
+      ++m_nextOutput;
+      ++count;
+      MoveFromOverflow();
+    }
+    return count;
+  }
+
+  void FlushStreams() {
+    *m_outStream << std::flush;
+    *m_debugStream << std::flush;
+    m_unflushed = 0;
+    m_lastFlush = util::WallTime();
+  }
+
+  std::vector<Slot> m_ring;
+  std::map<int, Slot> m_overflow;
   int m_nextOutput;
   std::ostream* m_outStream;
   std::ostream* m_debugStream;
   bool m_isHoldingOutputStream;
   bool m_isHoldingDebugStream;
+  bool m_isWriting;
+  size_t m_flushEvery;
+  double m_flushInterval;
+  size_t m_unflushed;
+  double m_lastFlush;
 #ifdef WITH_THREADS
   boost::mutex m_mutex;
 #endif
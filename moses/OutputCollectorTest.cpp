@@ -0,0 +1,225 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "OutputCollector.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+// A string stream that counts how often it is flushed.
+class CountingBuf : public stringbuf
+{
+public:
+  CountingBuf() : flushes(0) {}
+  size_t flushes;
+protected:
+  int sync() {
+    ++flushes;
+    return stringbuf::sync();
+  }
+};
+
+struct Streams {
+  CountingBuf outBuf, debugBuf;
+  ostream out, debug;
+  Streams() : out(&outBuf), debug(&debugBuf) {}
+};
+
+string Line(int id)
+{
+  ostringstream line;
+  line << id << "\n";
+  return line.str();
+}
+
+string Lines(int from, int to)
+{
+  string ret;
+  for (int id = from; id < to; ++id) ret += Line(id);
+  return ret;
+}
+
+#ifdef WITH_THREADS
+// Writes sentences first, first + step, ... below end.
+void WriteEvery(OutputCollector *collector, int first, int step, int end)
+{
+  for (int id = first; id < end; id += step) {
+    collector->Write(id, Line(id), "debug " + Line(id));
+    if (id % 7 == 0) boost::this_thread::yield();
+  }
+}
+#endif
+
+}
+
+BOOST_AUTO_TEST_SUITE(output_collector)
+
+BOOST_AUTO_TEST_CASE(out_of_order)
+{
+  Streams streams;
+  {
+    OutputCollector collector(&streams.out, &streams.debug);
+    collector.Write(2, Line(2), "d2\n");
+    collector.Write(1, Line(1));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), "");
+
+    collector.Write(0, Line(0), "d0\n");
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 3));
+    BOOST_CHECK_EQUAL(streams.debugBuf.str(), "d0\nd2\n");
+
+    collector.Write(4, Line(4));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 3));
+    collector.Write(3, Line(3));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 5));
+
+    // already written
+    collector.Write(1, "again\n");
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 5));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(far_ahead)
+{
+  // sentences far beyond the ring wait until the ring catches up with them
+  const int count = 1000;
+  Streams streams;
+  {
+    OutputCollector collector(&streams.out, &streams.debug);
+    for (int id = count - 1; id > 0; --id) {
+      collector.Write(id, Line(id));
+    }
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), "");
+    collector.Write(0, Line(0));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, count));
+
+    // and again, now interleaved with sentences inside the ring
+    collector.Write(count + 500, Line(count + 500));
+    collector.Write(count + 70, Line(count + 70));
+    for (int id = count + 1; id < count + 500; ++id) {
+      if (id != count + 70) collector.Write(id, Line(id));
+    }
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, count));
+    collector.Write(count, Line(count));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, count + 501));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(start_id)
+{
+  Streams streams;
+  {
+    OutputCollector collector(&streams.out, &streams.debug);
+    collector.SetStartId(100);
+    collector.Write(101, Line(101));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), "");
+    collector.Write(100, Line(100));
+    BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(100, 102));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(flush_every_sentence_by_default)
+{
+  Streams streams;
+  OutputCollector collector(&streams.out, &streams.debug);
+  collector.Write(0, Line(0));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 1);
+  collector.Write(1, Line(1));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 2);
+}
+
+BOOST_AUTO_TEST_CASE(flush_every_n_sentences)
+{
+  Streams streams;
+  OutputCollector collector(&streams.out, &streams.debug);
+  collector.SetFlushPolicy(3);
+
+  collector.Write(0, Line(0));
+  collector.Write(1, Line(1));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 0);
+  collector.Write(2, Line(2));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 1);
+  BOOST_CHECK_EQUAL(streams.debugBuf.flushes, 1);
+
+  // a run of sentences written in one go counts all of them
+  collector.Write(5, Line(5));
+  collector.Write(4, Line(4));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 1);
+  collector.Write(3, Line(3));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 2);
+
+  collector.Write(6, Line(6));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 2);
+  collector.Flush();
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 3);
+  BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 7));
+}
+
+BOOST_AUTO_TEST_CASE(flush_interval)
+{
+  Streams streams;
+  OutputCollector collector(&streams.out, &streams.debug);
+  collector.SetFlushPolicy(1000, 0.05);
+
+  collector.Write(0, Line(0));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 0);
+
+  double start = util::WallTime();
+  while (util::WallTime() - start < 0.1) {
+#ifdef WITH_THREADS
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+#endif
+  }
+  collector.Write(1, Line(1));
+  BOOST_CHECK_EQUAL(streams.outBuf.flushes, 1);
+  BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, 2));
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(concurrent_writers)
+{
+  const int threads = 4, count = 2000;
+  Streams streams;
+  {
+    OutputCollector collector(&streams.out, &streams.debug);
+    collector.SetFlushPolicy(16);
+    boost::thread_group group;
+    for (int t = 0; t < threads; ++t) {
+      group.create_thread(boost::bind(&WriteEvery, &collector, t, threads, count));
+    }
+    group.join_all();
+  }
+  BOOST_CHECK_EQUAL(streams.outBuf.str(), Lines(0, count));
+  string debug;
+  for (int id = 0; id < count; ++id) debug += "debug " + Line(id);
+  BOOST_CHECK_EQUAL(streams.debugBuf.str(), debug);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,11 @@
 #include <iostream>
 #include <boost/iostreams/filtering_stream.hpp>
 
+namespace util
+{
+class BlockGZipSink;
+}
+
 namespace Moses
 {
 
@@ -35,6 +40,9 @@ namespace Moses
  * Transparently compresses output when writing to a file whose name ends in
  * ".gz".  Or, writes to stdout instead of a file when given a filename
  * consisting of just a dash ("-").
+ *
+ * Compressed output is block gzip (see util/block_gzip.hh): standard gzip
+ * that util::ReadCompressed can inflate on several threads.
  */
 class OutputFileStream : public boost::iostreams::filtering_ostream
 {
@@ -45,6 +53,9 @@ private:
    */
   std::ofstream *m_outFile;
 
+  /// Compressor for ".gz" files, or NULL.
+  util::BlockGZipSink *m_blockGZip;
+
   /// Is this stream open?
   bool m_open;
 
@@ -75,6 +86,9 @@ public:
 
   /// Flush and close stream.  After this, the stream can be opened again.
   void Close();
+
+  /// Number of threads compressing each ".gz" file opened after this call.
+  static void SetCompressionThreads(size_t threads);
 };
 
 }
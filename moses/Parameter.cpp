@@ -123,6 +123,7 @@ Parameter::Parameter()
   AddParam(cube_opts,"cube-pruning-diversity", "cbd", "How many hypotheses should be created for each coverage. (default = 0)");
   AddParam(cube_opts,"cube-pruning-lazy-scoring", "cbls", "Don't fully score a hypothesis until it is popped");
   AddParam(cube_opts,"cube-pruning-deterministic-search", "cbds", "Break ties deterministically during search");
+  AddParam(cube_opts,"cube-pruning-threads", "Threads that generate the vertices of one span in the incremental search (default = 1)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // minimum bayes risk decoding
@@ -163,6 +164,7 @@ Parameter::Parameter()
   AddParam(input_opts,"xml-brackets", "xb", "specify strings to be used as xml tags opening and closing, e.g. \"{{ }}\" (default \"< >\"). Avoid square brackets because of configuration file format. Valid only with text input mode" );
   AddParam(input_opts,"start-translation-id", "Id of 1st input. Default = 0");
   AddParam(input_opts,"alternate-weight-setting", "aws", "alternate set of weights to used per xml specification");
+  AddParam(input_opts,"input-prefetch-threads", "ipt", "read and parse text input ahead of the decoder on this many background threads (default 0 = off)");
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // output options
@@ -176,6 +178,8 @@ Parameter::Parameter()
   AddParam(output_opts,"print-all-derivations", "to print all derivations in search graph");
   AddParam(output_opts,"translation-details", "T", "for each best hypothesis, report translation details to the given file");
 
+  AddParam(output_opts,"output-flush-every", "flush output streams after this many sentences (default 1)");
+  AddParam(output_opts,"output-flush-interval", "also flush output streams when this many seconds have passed since the last flush (default 0 = never)");
   AddParam(output_opts,"output-hypo-score", "Output the hypo score to stdout with the output string. For search error analysis. Default is false");
   AddParam(output_opts,"output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
   AddParam(output_opts,"tree-translation-details", "Ttree", "for each hypothesis, report translation details with tree fragment info to given file");
@@ -272,6 +276,8 @@ Parameter::Parameter()
   AddParam(misc_opts,"context-weights", "A key-value map for context-sensitive translation.");
   AddParam(misc_opts,"context-window",
            "Context window (in words) for context-sensitive translation: {+|-|+-}<number>.");
+  AddParam(misc_opts,"profile-output",
+           "Time feature function evaluation, phrase lookups, pruning and output, and write the totals as JSON to this file");
 
   // Compact phrase table and reordering table.
   po::options_description cpt_opts("Options when using compact phrase and reordering tables.");
@@ -0,0 +1,167 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width: 2 -*-
+#include "Profiler.h"
+
+#include <map>
+#include <utility>
+
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MOSES_PROFILER_TSC
+#else
+#include <time.h>
+#endif
+
+#include "util/usage.hh"
+
+namespace Moses
+{
+
+namespace
+{
+struct Counters {
+  std::vector<uint64_t> ticks;
+  std::vector<uint64_t> calls;
+};
+
+// every thread's table, so that Dump() can see tables of finished threads
+std::vector<boost::shared_ptr<Counters> > s_allCounters;
+std::vector<std::pair<std::string, std::string> > s_names;
+std::map<std::pair<std::string, std::string>, size_t> s_ids;
+uint64_t s_startTicks = 0;
+double s_startWall = 0;
+
+#ifdef WITH_THREADS
+boost::mutex s_mutex;
+void NoCleanup(Counters*) {}
+boost::thread_specific_ptr<Counters> s_threadCounters(&NoCleanup);
+#else
+Counters *s_threadCounters = NULL;
+#endif
+
+Counters &GetThreadCounters()
+{
+#ifdef WITH_THREADS
+  Counters *counters = s_threadCounters.get();
+#else
+  Counters *counters = s_threadCounters;
+#endif
+  if (counters) return *counters;
+
+  boost::shared_ptr<Counters> created(new Counters);
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(s_mutex);
+#endif
+    s_allCounters.push_back(created);
+  }
+#ifdef WITH_THREADS
+  s_threadCounters.reset(created.get());
+#else
+  s_threadCounters = created.get();
+#endif
+  return *created;
+}
+
+void WriteJSONString(std::ostream &out, const std::string &str)
+{
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    char c = str[i];
+    if (c == '"' || c == '\\') out << '\\' << c;
+    else if (c == '\n') out << "\\n";
+    else if (c == '\t') out << "\\t";
+    else out << c;
+  }
+  out << '"';
+}
+}
+
+bool Profiler::s_enabled = false;
+
+size_t Profiler::Register(const std::string &category, const std::string &name)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_mutex);
+#endif
+  std::pair<std::string, std::string> key(category, name);
+  std::map<std::pair<std::string, std::string>, size_t>::const_iterator iter = s_ids.find(key);
+  if (iter != s_ids.end()) {
+    return iter->second;
+  }
+  size_t id = s_names.size();
+  s_names.push_back(key);
+  s_ids[key] = id;
+  return id;
+}
+
+void Profiler::Enable()
+{
+  s_startTicks = Now();
+  s_startWall = util::WallTime();
+  s_enabled = true;
+}
+
+uint64_t Profiler::Now()
+{
+#ifdef MOSES_PROFILER_TSC
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+void Profiler::Add(size_t id, uint64_t ticks)
+{
+  Counters &counters = GetThreadCounters();
+  if (id >= counters.ticks.size()) {
+    counters.ticks.resize(id + 1, 0);
+    counters.calls.resize(id + 1, 0);
+  }
+  counters.ticks[id] += ticks;
+  ++counters.calls[id];
+}
+
+void Profiler::Dump(std::ostream &out)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(s_mutex);
+#endif
+  // convert ticks to seconds using the wall time that passed since Enable()
+  double elapsed = util::WallTime() - s_startWall;
+  uint64_t elapsedTicks = Now() - s_startTicks;
+  double secondsPerTick = elapsedTicks ? elapsed / elapsedTicks : 0;
+
+  std::vector<uint64_t> ticks(s_names.size(), 0), calls(s_names.size(), 0);
+  for (size_t t = 0; t < s_allCounters.size(); ++t) {
+    const Counters &counters = *s_allCounters[t];
+    for (size_t i = 0; i < counters.ticks.size() && i < ticks.size(); ++i) {
+      ticks[i] += counters.ticks[i];
+      calls[i] += counters.calls[i];
+    }
+  }
+
+  out << "{\n  \"wall_seconds\": " << elapsed
+      << ",\n  \"threads\": " << s_allCounters.size()
+      << ",\n  \"counters\": [";
+  for (size_t i = 0; i < s_names.size(); ++i) {
+    out << (i ? ",\n" : "\n") << "    {\"category\": ";
+    WriteJSONString(out, s_names[i].first);
+    out << ", \"name\": ";
+    WriteJSONString(out, s_names[i].second);
+    out << ", \"calls\": " << calls[i]
+        << ", \"seconds\": " << ticks[i] * secondsPerTick << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+}
+
@@ -0,0 +1,66 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width: 2 -*-
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace Moses
+{
+
+/** Low-overhead instrumentation of the decoder's hot paths.
+ *
+ * Code sections register a named counter once (Register) and time
+ * themselves with a ProfileScope.  Each thread accumulates elapsed
+ * ticks (the CPU time stamp counter where available) and call counts in
+ * its own table, so timing a section costs two counter reads and no
+ * locking.  The tables are summed and written as JSON by Dump() once
+ * decoding is done.  Unless Enable() has been called, a ProfileScope
+ * only tests a flag.
+ */
+class Profiler
+{
+public:
+  //! returns the ID of the counter category/name, creating it if necessary
+  static size_t Register(const std::string &category, const std::string &name);
+
+  static void Enable();
+
+  static bool IsEnabled() {
+    return s_enabled;
+  }
+
+  static uint64_t Now();
+
+  static void Add(size_t id, uint64_t ticks);
+
+  //! write the totals over all threads as a JSON object
+  static void Dump(std::ostream &out);
+
+private:
+  static bool s_enabled;
+};
+
+/** Adds the time between construction and destruction to a counter */
+class ProfileScope
+{
+public:
+  explicit ProfileScope(size_t id)
+    : m_id(id)
+    , m_start(Profiler::IsEnabled() ? Profiler::Now() : 0) {
+  }
+
+  ~ProfileScope() {
+    if (m_start) {
+      Profiler::Add(m_id, Profiler::Now() - m_start);
+    }
+  }
+
+private:
+  size_t m_id;
+  uint64_t m_start;
+};
+
+}
+
@@ -0,0 +1,118 @@
+#include "RecyclingAllocator.h"
+
+#include <new>
+
+#include <boost/thread/tss.hpp>
+
+namespace Moses
+{
+
+namespace
+{
+
+const std::size_t kGranularity = 16;
+const std::size_t kClasses = RecyclingAllocator::kMaxSize / kGranularity;
+
+struct FreeLists {
+  FreeLists() : bytes(0) {
+    for (std::size_t i = 0; i < kClasses; ++i) {
+      heads[i] = NULL;
+    }
+  }
+
+  ~FreeLists() {
+    Clear();
+  }
+
+  void Clear() {
+    for (std::size_t i = 0; i < kClasses; ++i) {
+      while (heads[i]) {
+        void *next = *static_cast<void**>(heads[i]);
+        ::operator delete(heads[i]);
+        heads[i] = next;
+      }
+    }
+    bytes = 0;
+  }
+
+  // Each free block stores the pointer to the next one.
+  void *heads[kClasses];
+  // Total size of the blocks on the lists.
+  std::size_t bytes;
+};
+
+FreeLists &ThreadFreeLists()
+{
+  // Never destroyed, so objects freed during static destruction are safe.
+  static boost::thread_specific_ptr<FreeLists> *lists =
+    new boost::thread_specific_ptr<FreeLists>();
+  FreeLists *ret = lists->get();
+  if (!ret) {
+    ret = new FreeLists();
+    lists->reset(ret);
+  }
+  return *ret;
+}
+
+std::size_t SizeClass(std::size_t size)
+{
+  return size ? (size - 1) / kGranularity : 0;
+}
+
+std::size_t ClassBytes(std::size_t sizeClass)
+{
+  return (sizeClass + 1) * kGranularity;
+}
+
+}  // namespace
+
+const std::size_t RecyclingAllocator::kMaxSize;
+const std::size_t RecyclingAllocator::kMaxFreeBytes;
+
+void *RecyclingAllocator::Allocate(std::size_t size)
+{
+  if (size > kMaxSize) {
+    return ::operator new(size);
+  }
+  std::size_t sizeClass = SizeClass(size);
+  FreeLists &lists = ThreadFreeLists();
+  void *ret = lists.heads[sizeClass];
+  if (!ret) {
+    return ::operator new(ClassBytes(sizeClass));
+  }
+  lists.heads[sizeClass] = *static_cast<void**>(ret);
+  lists.bytes -= ClassBytes(sizeClass);
+  return ret;
+}
+
+void RecyclingAllocator::Free(void *ptr, std::size_t size)
+{
+  if (!ptr) {
+    return;
+  }
+  if (size > kMaxSize) {
+    ::operator delete(ptr);
+    return;
+  }
+  std::size_t sizeClass = SizeClass(size);
+  FreeLists &lists = ThreadFreeLists();
+  if (lists.bytes + ClassBytes(sizeClass) > kMaxFreeBytes) {
+    ::operator delete(ptr);
+    return;
+  }
+  *static_cast<void**>(ptr) = lists.heads[sizeClass];
+  lists.heads[sizeClass] = ptr;
+  lists.bytes += ClassBytes(sizeClass);
+}
+
+void RecyclingAllocator::Release()
+{
+  ThreadFreeLists().Clear();
+}
+
+std::size_t RecyclingAllocator::FreeBytes()
+{
+  return ThreadFreeLists().bytes;
+}
+
+}  // namespace Moses
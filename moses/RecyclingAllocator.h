@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Moses
+{
+
+/** Per-thread free lists of small memory blocks, one list per size class.
+ *
+ * Objects that the decoder creates and destroys at a high rate (syntax search
+ * vertices and hyperedges, feature function states) get their memory from
+ * here through class-specific operator new and operator delete.  A freed block
+ * goes on the freeing thread's list for its size class and the next allocation
+ * of that class on the thread reuses it, so once the lists are warm decoding a
+ * sentence does not go to the system allocator for these objects.  Blocks
+ * larger than kMaxSize are passed through to ::operator new.
+ *
+ * A thread keeps at most kMaxFreeBytes on its lists.  TranslationTask
+ * releases the lists of its thread after each sentence, so memory recycled
+ * while decoding one sentence is not held on to by idle threads.
+ */
+class RecyclingAllocator
+{
+public:
+  static const std::size_t kMaxSize = 512;
+  static const std::size_t kMaxFreeBytes = 16 << 20;
+
+  static void *Allocate(std::size_t size);
+
+  // size must be the size passed to Allocate.
+  static void Free(void *ptr, std::size_t size);
+
+  // Return the blocks on the calling thread's lists to the system.
+  static void Release();
+
+  // Bytes on the calling thread's lists.
+  static std::size_t FreeBytes();
+
+  // Calls Release when it goes out of scope.
+  class ReleaseOnExit
+  {
+  public:
+    ~ReleaseOnExit() {
+      Release();
+    }
+  };
+};
+
+}  // namespace Moses
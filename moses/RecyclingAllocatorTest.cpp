@@ -0,0 +1,105 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <cstring>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "RecyclingAllocator.h"
+
+using namespace Moses;
+
+namespace
+{
+
+void FreeBytesOnThread(std::size_t &out)
+{
+  out = RecyclingAllocator::FreeBytes();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(recycling_allocator)
+
+BOOST_AUTO_TEST_CASE(reuses_freed_block)
+{
+  RecyclingAllocator::Release();
+  void *first = RecyclingAllocator::Allocate(40);
+  std::memset(first, 1, 40);
+  RecyclingAllocator::Free(first, 40);
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), static_cast<std::size_t>(48));
+
+  // same size class
+  void *second = RecyclingAllocator::Allocate(33);
+  BOOST_CHECK_EQUAL(first, second);
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), static_cast<std::size_t>(0));
+
+  // another size class does not get the block
+  RecyclingAllocator::Free(second, 33);
+  void *third = RecyclingAllocator::Allocate(64);
+  BOOST_CHECK(third != second);
+  RecyclingAllocator::Free(third, 64);
+  RecyclingAllocator::Release();
+}
+
+BOOST_AUTO_TEST_CASE(large_blocks_pass_through)
+{
+  RecyclingAllocator::Release();
+  const std::size_t size = RecyclingAllocator::kMaxSize + 1;
+  void *block = RecyclingAllocator::Allocate(size);
+  std::memset(block, 1, size);
+  RecyclingAllocator::Free(block, size);
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), static_cast<std::size_t>(0));
+  RecyclingAllocator::Free(NULL, 16);
+}
+
+BOOST_AUTO_TEST_CASE(free_lists_are_capped)
+{
+  RecyclingAllocator::Release();
+  const std::size_t size = RecyclingAllocator::kMaxSize;
+  std::vector<void*> blocks(RecyclingAllocator::kMaxFreeBytes / size + 10);
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    blocks[i] = RecyclingAllocator::Allocate(size);
+  }
+  for (std::size_t i = 0; i < blocks.size(); ++i) {
+    RecyclingAllocator::Free(blocks[i], size);
+  }
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), RecyclingAllocator::kMaxFreeBytes);
+
+  {
+    RecyclingAllocator::ReleaseOnExit release;
+  }
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), static_cast<std::size_t>(0));
+}
+
+BOOST_AUTO_TEST_CASE(lists_are_per_thread)
+{
+  RecyclingAllocator::Release();
+  RecyclingAllocator::Free(RecyclingAllocator::Allocate(100), 100);
+  std::size_t other = 1;
+  boost::thread thread(boost::bind(&FreeBytesOnThread, boost::ref(other)));
+  thread.join();
+  BOOST_CHECK_EQUAL(other, static_cast<std::size_t>(0));
+  BOOST_CHECK_EQUAL(RecyclingAllocator::FreeBytes(), static_cast<std::size_t>(112));
+  RecyclingAllocator::Release();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include "StaticData.h"
 #include "InputType.h"
 #include "TranslationOptionCollection.h"
+#include "Profiler.h"
 #include <boost/foreach.hpp>
 using namespace std;
 
@@ -90,6 +91,8 @@ void SearchCubePruning::Decode()
   const size_t PopLimit = m_manager.options()->cube.pop_limit;
   VERBOSE(2,"Cube Pruning pop limit is " << PopLimit << std::endl);
 
+  static const size_t profileId = Profiler::Register("Search", "CubePruning");
+
   const size_t Diversity = m_manager.options()->cube.diversity;
   VERBOSE(2,"Cube Pruning diversity is " << Diversity << std::endl);
   VERBOSE(2,"Max Phrase length is "
@@ -129,28 +132,31 @@ void SearchCubePruning::Decode()
     }
 
     // main search loop, pop k best hyps
-    for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
-      // get currently best hypothesis in queue
-      m_manager.GetSentenceStats().StartTimeManageCubes();
-      BitmapContainer *bc = BCQueue.top();
-      BCQueue.pop();
-      m_manager.GetSentenceStats().StopTimeManageCubes();
-      IFVERBOSE(2) {
-        m_manager.GetSentenceStats().AddPopped();
-      }
-      // push on stack and create successors
-      IFVERBOSE(2) {
-        m_manager.GetSentenceStats().StartTimeOtherScore();
-      }
-      bc->ProcessBestHypothesis();
-      IFVERBOSE(2) {
-        m_manager.GetSentenceStats().StopTimeOtherScore();
+    {
+      ProfileScope profile(profileId);
+      for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
+        // get currently best hypothesis in queue
+        m_manager.GetSentenceStats().StartTimeManageCubes();
+        BitmapContainer *bc = BCQueue.top();
+        BCQueue.pop();
+        m_manager.GetSentenceStats().StopTimeManageCubes();
+        IFVERBOSE(2) {
+          m_manager.GetSentenceStats().AddPopped();
+        }
+        // push on stack and create successors
+        IFVERBOSE(2) {
+          m_manager.GetSentenceStats().StartTimeOtherScore();
+        }
+        bc->ProcessBestHypothesis();
+        IFVERBOSE(2) {
+          m_manager.GetSentenceStats().StopTimeOtherScore();
+        }
+        // if there are any hypothesis left in this specific container, add back to queue
+        m_manager.GetSentenceStats().StartTimeManageCubes();
+        if (!bc->Empty())
+          BCQueue.push(bc);
+        m_manager.GetSentenceStats().StopTimeManageCubes();
       }
-      // if there are any hypothesis left in this specific container, add back to queue
-      m_manager.GetSentenceStats().StartTimeManageCubes();
-      if (!bc->Empty())
-        BCQueue.push(bc);
-      m_manager.GetSentenceStats().StopTimeManageCubes();
     }
 
     // ensure diversity, a minimum number of inserted hyps for each bitmap container;
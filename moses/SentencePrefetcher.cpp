@@ -0,0 +1,157 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width: 2 -*-
+#ifdef WITH_THREADS
+
+#include "SentencePrefetcher.h"
+
+#include <exception>
+
+#include <boost/bind.hpp>
+
+#include "moses/Sentence.h"
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+SentencePrefetcher::
+SentencePrefetcher(util::FilePiece *in,
+                   AllOptions::ptr const& opts,
+                   size_t numThreads)
+  : m_in(in)
+  , m_options(opts)
+  , m_numThreads(numThreads ? numThreads : 1)
+  , m_ordered(4 * m_numThreads)
+    // room for every batch in flight plus one end marker per parser
+  , m_work(5 * m_numThreads + 1)
+  , m_currentPos(0)
+  , m_finished(false)
+  , m_stop(false)
+{
+  for (size_t i = 0; i < m_numThreads; ++i) {
+    m_threads.create_thread(boost::bind(&SentencePrefetcher::Parse, this));
+  }
+  m_threads.create_thread(boost::bind(&SentencePrefetcher::Read, this));
+}
+
+SentencePrefetcher::
+~SentencePrefetcher()
+{
+  // the reader stops after the batch it is working on and the parsers
+  // skip what is left, so this only takes the batches already in flight
+  // off the queue, to unblock a reader waiting for room
+  Stop();
+  while (!m_finished) {
+    m_ordered.Consume(m_current);
+    if (!m_current) m_finished = true;
+  }
+  m_threads.join_all();
+}
+
+void
+SentencePrefetcher::
+Read()
+{
+  StringPiece line;
+  bool eof = false;
+  while (!eof && !Stopped()) {
+    BatchPtr batch(new Batch);
+    batch->lines.reserve(BATCH_SIZE);
+    try {
+      while (batch->lines.size() < BATCH_SIZE) {
+        if (!m_in->ReadLineOrEOF(line)) {
+          eof = true;
+          break;
+        }
+        batch->lines.push_back(line.as_string());
+      }
+    } catch (const std::exception &e) {
+      batch->error = e.what();
+      eof = true;
+    }
+    if (batch->lines.empty() && batch->error.empty()) break;
+    m_ordered.Produce(batch);
+    m_work.Produce(batch);
+  }
+  m_ordered.Produce(BatchPtr());
+  for (size_t i = 0; i < m_numThreads; ++i) {
+    m_work.Produce(BatchPtr());
+  }
+}
+
+void
+SentencePrefetcher::
+Parse()
+{
+  BatchPtr batch;
+  while (m_work.Consume(batch)) {
+    std::vector<boost::shared_ptr<Sentence> > sentences;
+    std::string error;
+    // once stopped, batches are only marked done, which lets the reader
+    // reach its end markers
+    if (!Stopped()) {
+      try {
+        sentences.reserve(batch->lines.size());
+        for (size_t i = 0; i < batch->lines.size(); ++i) {
+          boost::shared_ptr<Sentence> sentence(new Sentence(m_options));
+          sentence->init(batch->lines[i]);
+          sentences.push_back(sentence);
+        }
+      } catch (const std::exception &e) {
+        error = e.what();
+      }
+    }
+
+    boost::mutex::scoped_lock lock(batch->mutex);
+    batch->sentences.swap(sentences);
+    if (batch->error.empty()) batch->error = error;
+    batch->done = true;
+    batch->cond.notify_all();
+  }
+}
+
+void
+SentencePrefetcher::
+Stop()
+{
+  boost::mutex::scoped_lock lock(m_stopMutex);
+  m_stop = true;
+}
+
+bool
+SentencePrefetcher::
+Stopped() const
+{
+  boost::mutex::scoped_lock lock(m_stopMutex);
+  return m_stop;
+}
+
+boost::shared_ptr<InputType>
+SentencePrefetcher::
+Next()
+{
+  while (!m_finished) {
+    if (m_current && m_currentPos < m_current->sentences.size()) {
+      return m_current->sentences[m_currentPos++];
+    }
+    if (m_current && !m_current->error.empty()) {
+      Stop();
+      UTIL_THROW2("Error reading input: " << m_current->error);
+    }
+
+    m_ordered.Consume(m_current);
+    m_currentPos = 0;
+    if (!m_current) {
+      m_finished = true;
+      break;
+    }
+    boost::mutex::scoped_lock lock(m_current->mutex);
+    while (!m_current->done) {
+      m_current->cond.wait(lock);
+    }
+  }
+  return boost::shared_ptr<InputType>();
+}
+
+}
+
+#endif // WITH_THREADS
@@ -0,0 +1,90 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width: 2 -*-
+#pragma once
+
+#ifdef WITH_THREADS
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "util/file_piece.hh"
+#include "util/pcqueue.hh"
+#include "moses/parameters/AllOptions.h"
+
+namespace Moses
+{
+class InputType;
+class Sentence;
+
+/** Pipelined reader for plain sentence input.
+ *
+ * A reader thread splits the input into lines with util::FilePiece and
+ * groups them into batches; a small pool of worker threads turns each
+ * batch into Sentence objects (tokenization, factor and XML parsing).
+ * Next() hands out the parsed sentences in input order.  At most a fixed
+ * number of batches is in flight, so memory stays bounded however far the
+ * reader gets ahead of the decoder.
+ *
+ * Sentence::init() also runs the DLT instructions of a line, which update
+ * the cache-based models out of input order; the caller must not prefetch
+ * when such a model is loaded.
+ */
+class SentencePrefetcher
+{
+public:
+  // takes ownership of in
+  SentencePrefetcher(util::FilePiece *in,
+                     AllOptions::ptr const& opts,
+                     size_t numThreads);
+  ~SentencePrefetcher();
+
+  //! next sentence in input order, or a null pointer at the end of input
+  boost::shared_ptr<InputType> Next();
+
+private:
+  struct Batch {
+    std::vector<std::string> lines;
+    std::vector<boost::shared_ptr<Sentence> > sentences;
+    std::string error;
+    bool done;
+    boost::mutex mutex;
+    boost::condition_variable cond;
+
+    Batch() : done(false) {}
+  };
+  typedef boost::shared_ptr<Batch> BatchPtr;
+
+  static const size_t BATCH_SIZE = 64;
+
+  void Read();
+  void Parse();
+
+  // tells the reader and the parsers to skip the rest of the input
+  void Stop();
+  bool Stopped() const;
+
+  boost::scoped_ptr<util::FilePiece> m_in;
+  AllOptions::ptr m_options;
+  size_t m_numThreads;
+
+  // batches in input order, for Next(); a null batch marks the end
+  util::PCQueue<BatchPtr> m_ordered;
+  // the same batches, for the parser threads
+  util::PCQueue<BatchPtr> m_work;
+
+  BatchPtr m_current;
+  size_t m_currentPos;
+  bool m_finished;
+
+  bool m_stop;
+  mutable boost::mutex m_stopMutex;
+
+  boost::thread_group m_threads;
+};
+
+}
+
+#endif // WITH_THREADS
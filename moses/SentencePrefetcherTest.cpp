@@ -0,0 +1,148 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#ifdef WITH_THREADS
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "SentencePrefetcher.h"
+#include "Sentence.h"
+#include "TempDir.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+// Lines with and without segment IDs; line errorLine, if any, has a DLT tag
+// without a type, which Sentence::init() rejects.
+string MakeInput(size_t numLines, size_t errorLine = 0)
+{
+  ostringstream out;
+  for (size_t i = 1; i <= numLines; ++i) {
+    if (i == errorLine) {
+      out << "w" << i << " <dlt id=\"x\"/> z\n";
+    } else if (i % 3 == 0) {
+      out << "<seg id=\"" << 1000 + i << "\"> w" << i << " x" << i % 7 << " </seg>\n";
+    } else {
+      out << "w" << i << " y" << i % 5 << "\n";
+    }
+  }
+  return out.str();
+}
+
+string Describe(const InputType &input)
+{
+  ostringstream out;
+  out << input.GetTranslationId() << " ";
+  input.Print(out);
+  return out.str();
+}
+
+// Reads like IOWrapper without prefetching; returns whether it got to the
+// end without an error.
+bool ReadSequential(const string &path, AllOptions::ptr const& opts, vector<string> &out)
+{
+  ifstream in(path.c_str());
+  try {
+    while (true) {
+      Sentence sentence(opts);
+      if (!sentence.Read(in)) return true;
+      out.push_back(Describe(sentence));
+    }
+  } catch (const util::Exception &) {
+    return false;
+  }
+}
+
+bool ReadPrefetched(const string &path, AllOptions::ptr const& opts, size_t threads, vector<string> &out)
+{
+  SentencePrefetcher prefetcher(new util::FilePiece(path.c_str()), opts, threads);
+  try {
+    while (boost::shared_ptr<InputType> sentence = prefetcher.Next()) {
+      out.push_back(Describe(*sentence));
+    }
+  } catch (const util::Exception &) {
+    return false;
+  }
+  return true;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(sentence_prefetcher)
+
+BOOST_AUTO_TEST_CASE(same_as_sequential)
+{
+  TempDir dir("sentence-prefetcher");
+  const string path = dir.Write("input", MakeInput(1000));
+  AllOptions::ptr opts(new AllOptions);
+
+  vector<string> expected;
+  BOOST_REQUIRE(ReadSequential(path, opts, expected));
+  BOOST_REQUIRE_EQUAL(expected.size(), 1000);
+  BOOST_CHECK_EQUAL(expected[2], "1003 w3 x3 ");
+
+  for (size_t threads = 1; threads <= 4; threads += 3) {
+    vector<string> prefetched;
+    BOOST_CHECK(ReadPrefetched(path, opts, threads, prefetched));
+    BOOST_CHECK(prefetched == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(parse_error)
+{
+  TempDir dir("sentence-prefetcher");
+  // the error is in the middle of a batch, well before the end of the input
+  const string path = dir.Write("input", MakeInput(100000, 200));
+  AllOptions::ptr opts(new AllOptions);
+
+  vector<string> expected;
+  BOOST_REQUIRE(!ReadSequential(path, opts, expected));
+  BOOST_REQUIRE_EQUAL(expected.size(), 199);
+
+  // the sentences before the bad line come out, then the error; the rest
+  // of the input is not read
+  for (size_t threads = 1; threads <= 4; threads += 3) {
+    vector<string> prefetched;
+    BOOST_CHECK(!ReadPrefetched(path, opts, threads, prefetched));
+    BOOST_CHECK(prefetched == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stop_early)
+{
+  TempDir dir("sentence-prefetcher");
+  const string path = dir.Write("input", MakeInput(100000));
+  AllOptions::ptr opts(new AllOptions);
+  SentencePrefetcher prefetcher(new util::FilePiece(path.c_str()), opts, 2);
+  boost::shared_ptr<InputType> first = prefetcher.Next();
+  BOOST_REQUIRE(first);
+  BOOST_CHECK_EQUAL(Describe(*first), "0 w1 y1 ");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // WITH_THREADS
@@ -15,23 +15,22 @@ namespace Syntax
 
 Cube::Cube(const SHyperedgeBundle &bundle)
   : m_bundle(bundle)
+  , m_dimensions(bundle.stacks.size()+1)
+  , m_visited(0, CoordinateHasher(*this), CoordinateEqualityPred(*this))
 {
-  // Create the SHyperedge for the 'corner' of the cube.
-  std::vector<int> coordinates(bundle.stacks.size()+1, 0);
-  SHyperedge *hyperedge = CreateHyperedge(coordinates);
-  // Add its coordinates to the set of visited coordinates.
-  std::pair<CoordinateSet::iterator, bool> p = m_visited.insert(coordinates);
-  const std::vector<int> &storedCoordinates = *p.first;
+  // Create the SHyperedge for the 'corner' of the cube and add its
+  // coordinates to the set of visited coordinates.
+  m_coordinates.resize(m_dimensions, 0);
+  m_visited.insert(0);
+  SHyperedge *hyperedge = CreateHyperedge(&m_coordinates[0]);
   // Add the SHyperedge to the queue along with its coordinates (which will be
   // needed for creating its neighbours).
-  m_queue.push(QueueItem(hyperedge, &storedCoordinates));
+  m_queue.push(QueueItem(hyperedge, 0));
 }
 
 Cube::~Cube()
 {
-  // Delete the SHyperedges belonging to any unpopped items.  Note that the
-  // coordinate vectors are not deleted here since they are owned by m_visited
-  // (and so will be deleted by its destructor).
+  // Delete the SHyperedges belonging to any unpopped items.
   while (!m_queue.empty()) {
     QueueItem item = m_queue.top();
     m_queue.pop();
@@ -44,19 +43,21 @@ SHyperedge *Cube::Pop()
 {
   QueueItem item = m_queue.top();
   m_queue.pop();
-  CreateNeighbours(*item.second);
+  CreateNeighbours(item.second);
   return item.first;
 }
 
-void Cube::CreateNeighbours(const std::vector<int> &coordinates)
+void Cube::CreateNeighbours(std::size_t offset)
 {
-  // Create a copy of the origin coordinates that will be adjusted for
-  // each neighbour.
-  std::vector<int> tmpCoordinates(coordinates);
+  // Copy the origin coordinates, which will be adjusted for each neighbour.
+  // (A copy because m_coordinates grows as neighbours are added.)
+  std::vector<int> &tmpCoordinates = m_neighbour;
+  tmpCoordinates.assign(m_coordinates.begin()+offset,
+                        m_coordinates.begin()+offset+m_dimensions);
 
   // Create each neighbour along the vertex stack dimensions.
-  for (std::size_t i = 0; i < coordinates.size()-1; ++i) {
-    const std::size_t x = coordinates[i];
+  for (std::size_t i = 0; i < m_dimensions-1; ++i) {
+    const std::size_t x = tmpCoordinates[i];
     if (m_bundle.stacks[i]->size() > x+1) {
       ++tmpCoordinates[i];
       CreateNeighbour(tmpCoordinates);
@@ -64,7 +65,7 @@ void Cube::CreateNeighbours(const std::vector<int> &coordinates)
     }
   }
   // Create the neighbour along the translation dimension.
-  const std::size_t x = coordinates.back();
+  const std::size_t x = tmpCoordinates.back();
   if (m_bundle.translations->GetSize() > x+1) {
     ++tmpCoordinates.back();
     CreateNeighbour(tmpCoordinates);
@@ -75,18 +76,21 @@ void Cube::CreateNeighbours(const std::vector<int> &coordinates)
 void Cube::CreateNeighbour(const std::vector<int> &coordinates)
 {
   // Add the coordinates to the set of visited coordinates if not already
-  // present.
-  std::pair<CoordinateSet::iterator, bool> p = m_visited.insert(coordinates);
-  if (!p.second) {
+  // present.  They are appended first so that the set can look them up by
+  // offset, and removed again if they were there already.
+  const std::size_t offset = m_coordinates.size();
+  m_coordinates.insert(m_coordinates.end(), coordinates.begin(),
+                       coordinates.end());
+  if (!m_visited.insert(offset).second) {
     // We have visited this neighbour before, so there is nothing to do.
+    m_coordinates.resize(offset);
     return;
   }
-  SHyperedge *hyperedge = CreateHyperedge(coordinates);
-  const std::vector<int> &storedCoordinates = *p.first;
-  m_queue.push(QueueItem(hyperedge, &storedCoordinates));
+  SHyperedge *hyperedge = CreateHyperedge(&m_coordinates[offset]);
+  m_queue.push(QueueItem(hyperedge, offset));
 }
 
-SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
+SHyperedge *Cube::CreateHyperedge(const int *coordinates)
 {
   SHyperedge *hyperedge = new SHyperedge();
 
@@ -97,8 +101,8 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
     StatefulFeatureFunction::GetStatefulFeatureFunctions().size());
   hyperedge->head = head;
 
-  hyperedge->tail.resize(coordinates.size()-1);
-  for (std::size_t i = 0; i < coordinates.size()-1; ++i) {
+  hyperedge->tail.resize(m_dimensions-1);
+  for (std::size_t i = 0; i < m_dimensions-1; ++i) {
     boost::shared_ptr<SVertex> pred = (*m_bundle.stacks[i])[coordinates[i]];
     hyperedge->tail[i] = pred.get();
   }
@@ -106,7 +110,7 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
   hyperedge->label.inputWeight = m_bundle.inputWeight;
 
   hyperedge->label.translation =
-    *(m_bundle.translations->begin()+coordinates.back());
+    *(m_bundle.translations->begin()+coordinates[m_dimensions-1]);
 
   // Calculate feature deltas.
 
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <queue>
 #include <vector>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
 #include <boost/unordered_set.hpp>
 
 #include "SHyperedge.h"
@@ -34,9 +36,37 @@ public:
   }
 
 private:
-  typedef boost::unordered_set<std::vector<int> > CoordinateSet;
+  // The coordinates of every visited grid point are stored back to back in
+  // m_coordinates, m_dimensions ints each, and points are referred to by
+  // their offset into it.  This avoids a vector allocation per point.
+  class CoordinateHasher
+  {
+  public:
+    CoordinateHasher(const Cube &cube) : m_cube(cube) {}
+    std::size_t operator()(std::size_t offset) const {
+      const int *p = &m_cube.m_coordinates[offset];
+      return boost::hash_range(p, p + m_cube.m_dimensions);
+    }
+  private:
+    const Cube &m_cube;
+  };
+
+  class CoordinateEqualityPred
+  {
+  public:
+    CoordinateEqualityPred(const Cube &cube) : m_cube(cube) {}
+    bool operator()(std::size_t x, std::size_t y) const {
+      const int *p = &m_cube.m_coordinates[x];
+      return std::equal(p, p + m_cube.m_dimensions, &m_cube.m_coordinates[y]);
+    }
+  private:
+    const Cube &m_cube;
+  };
+
+  typedef boost::unordered_set<std::size_t, CoordinateHasher,
+          CoordinateEqualityPred> CoordinateSet;
 
-  typedef std::pair<SHyperedge *, const std::vector<int> *> QueueItem;
+  typedef std::pair<SHyperedge *, std::size_t> QueueItem;
 
   class QueueItemOrderer
   {
@@ -49,11 +79,14 @@ private:
   typedef std::priority_queue<QueueItem, std::vector<QueueItem>,
           QueueItemOrderer> Queue;
 
-  SHyperedge *CreateHyperedge(const std::vector<int> &);
+  SHyperedge *CreateHyperedge(const int *);
   void CreateNeighbour(const std::vector<int> &);
-  void CreateNeighbours(const std::vector<int> &);
+  void CreateNeighbours(std::size_t);
 
   const SHyperedgeBundle &m_bundle;
+  const std::size_t m_dimensions;
+  std::vector<int> m_coordinates;
+  std::vector<int> m_neighbour;
   CoordinateSet m_visited;
   Queue m_queue;
 };
@@ -12,6 +12,7 @@ namespace F2S
 void HyperPathLoader::Load(const StringPiece &s, HyperPath &path)
 {
   path.nodeSeqs.clear();
+  m_factors.clear();
   // Tokenize the string and store the tokens in m_tokenSeq.
   m_tokenSeq.clear();
   for (TreeFragmentTokenizer p(s); p != TreeFragmentTokenizer(); ++p) {
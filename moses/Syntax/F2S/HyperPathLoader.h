@@ -32,6 +32,11 @@ class HyperPathLoader
 public:
   void Load(const StringPiece &, HyperPath &);
 
+  // The factors added by the last call to Load(), in the order they were met.
+  const std::vector<const Factor *> &GetFactors() const {
+    return m_factors;
+  }
+
 private:
   struct NodeTuple {
     int index;          // Preorder index of the node.
@@ -49,16 +54,19 @@ private:
   void GenerateNodeTupleSeq(int height);
 
   const Factor *AddTerminalFactor(const StringPiece &s) {
-    return FactorCollection::Instance().AddFactor(s, false);
+    m_factors.push_back(FactorCollection::Instance().AddFactor(s, false));
+    return m_factors.back();
   }
 
   const Factor *AddNonTerminalFactor(const StringPiece &s) {
-    return FactorCollection::Instance().AddFactor(s, true);
+    m_factors.push_back(FactorCollection::Instance().AddFactor(s, true));
+    return m_factors.back();
   }
 
   std::vector<TreeFragmentToken> m_tokenSeq;
   std::vector<NodeTuple> m_nodeTupleSeq;
   std::stack<int> m_parentStack;
+  std::vector<const Factor *> m_factors;
 };
 
 }  // namespace F2S
@@ -74,6 +74,52 @@ public:
     return m_root;
   }
 
+  // The interface used by RuleMatcherHyperTree, which MappedHyperTree also
+  // provides.
+  typedef const Node *NodeRef;
+
+  NodeRef GetRootChild(const HyperPath::NodeSeq &nodeSeq) const {
+    return m_root.GetChild(nodeSeq);
+  }
+
+  bool HasRules(NodeRef node) const {
+    return node->HasRules();
+  }
+
+  TargetPhraseCollection::shared_ptr GetTargetPhraseCollection(
+    NodeRef node) const {
+    return node->GetTargetPhraseCollection();
+  }
+
+  class ChildIterator
+  {
+  public:
+    ChildIterator(const HyperTree &, NodeRef node)
+      : m_p(node->GetMap().begin())
+      , m_end(node->GetMap().end()) {}
+
+    bool AtEnd() const {
+      return m_p == m_end;
+    }
+
+    ChildIterator &operator++() {
+      ++m_p;
+      return *this;
+    }
+
+    const HyperPath::NodeSeq &GetLabel() const {
+      return m_p->first;
+    }
+
+    NodeRef GetNode() const {
+      return &m_p->second;
+    }
+
+  private:
+    Node::Map::const_iterator m_p;
+    Node::Map::const_iterator m_end;
+  };
+
 private:
   friend class HyperTreeCreator;
 
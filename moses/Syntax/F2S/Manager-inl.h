@@ -23,7 +23,9 @@
 #include "DerivationWriter.h"
 #include "GlueRuleSynthesizer.h"
 #include "HyperTree.h"
+#include "MappedHyperTree.h"
 #include "RuleMatcherCallback.h"
+#include "RuleMatcherHyperTree.h"
 #include "TopologicalSorter.h"
 
 namespace Moses
@@ -99,7 +101,7 @@ void Manager<RuleMatcher>::Decode()
     // callback prunes the SHyperedgeBundles and keeps the best ones (up
     // to ruleLimit).
     callback.ClearContainer();
-    for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
+    for (typename std::vector<boost::shared_ptr<MainRuleMatcher> >::iterator
          q = m_mainRuleMatchers.begin(); q != m_mainRuleMatchers.end(); ++q) {
       (*q)->EnumerateHyperedges(vertex, callback);
     }
@@ -158,10 +160,18 @@ void Manager<RuleMatcher>::InitializeRuleMatchers()
     // by this point.
     const RuleTable *table = ff->GetTable();
     assert(table);
+    const MappedHyperTree *mapped = dynamic_cast<const MappedHyperTree*>(table);
+    if (mapped) {
+      typedef RuleMatcherHyperTree<RuleMatcherCallback, MappedHyperTree>
+      MappedRuleMatcher;
+      boost::shared_ptr<MainRuleMatcher> p(new MappedRuleMatcher(*mapped));
+      m_mainRuleMatchers.push_back(p);
+      continue;
+    }
     RuleTable *nonConstTable = const_cast<RuleTable*>(table);
     HyperTree *trie = dynamic_cast<HyperTree*>(nonConstTable);
     assert(trie);
-    boost::shared_ptr<RuleMatcher> p(new RuleMatcher(*trie));
+    boost::shared_ptr<MainRuleMatcher> p(new RuleMatcher(*trie));
     m_mainRuleMatchers.push_back(p);
   }
 
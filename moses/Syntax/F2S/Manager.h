@@ -15,6 +15,8 @@
 #include "Forest.h"
 #include "HyperTree.h"
 #include "PVertexToStackMap.h"
+#include "RuleMatcher.h"
+#include "RuleMatcherCallback.h"
 
 namespace Moses
 {
@@ -44,6 +46,10 @@ public:
   void OutputDetailedTranslationReport(OutputCollector *collector) const;
 
 private:
+  // The matchers of the rule tables, which need not all be of type
+  // RuleMatcher (a MappedHyperTree gets its own matcher).
+  typedef F2S::RuleMatcher<RuleMatcherCallback> MainRuleMatcher;
+
   const Forest::Vertex &FindRootNode(const Forest &);
 
   void InitializeRuleMatchers();
@@ -59,7 +65,7 @@ private:
   std::size_t m_sentenceLength;  // Includes <s> and </s>
   PVertexToStackMap m_stackMap;
   boost::shared_ptr<HyperTree> m_glueRuleTrie;
-  std::vector<boost::shared_ptr<RuleMatcher> > m_mainRuleMatchers;
+  std::vector<boost::shared_ptr<MainRuleMatcher> > m_mainRuleMatchers;
   boost::shared_ptr<RuleMatcher> m_glueRuleMatcher;
 };
 
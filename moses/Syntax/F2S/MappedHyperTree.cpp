@@ -0,0 +1,537 @@
+#include "MappedHyperTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "moses/FactorCollection.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+#include "moses/Syntax/RuleTableFF.h"
+#include "util/double-conversion/double-conversion.h"
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+
+#include "HyperPathLoader.h"
+
+namespace Moses
+{
+namespace Syntax
+{
+namespace F2S
+{
+
+namespace
+{
+const char kMagic[8] = {'m','o','s','e','s','h','t','1'};
+
+// file layout: header, symbols, symbol strings, nodes (breadth-first),
+// labels, rules.  Each section starts at a multiple of 8.
+struct Header {
+  char magic[8];
+  uint64_t numScores;
+  uint64_t numSymbols;
+  uint64_t stringBytes;
+  uint64_t numNodes;
+  uint64_t numLabels;
+  uint64_t ruleBytes;
+};
+
+struct SymbolRecord {
+  uint64_t offset;
+  uint32_t length;
+  uint32_t isNonTerminal;
+};
+
+// The first two symbols stand for HyperPath::kEpsilon and HyperPath::kComma.
+const uint32_t kEpsilonSymbol = 0;
+const uint32_t kCommaSymbol = 1;
+
+// A rule is stored as its scores, the lengths of the kRuleStrings strings
+// (target, alignment, sparse scores, properties), and the strings, padded to
+// a multiple of 4.
+const std::size_t kRuleStrings = 4;
+
+uint64_t PadTo8(uint64_t size)
+{
+  return (size + 7) & ~static_cast<uint64_t>(7);
+}
+
+uint64_t PadTo4(uint64_t size)
+{
+  return (size + 3) & ~static_cast<uint64_t>(3);
+}
+
+// Takes a section of count items of unit bytes, padded to a multiple of 8,
+// off the remaining bytes of the file.  Returns false if it does not fit.
+bool TakeSection(uint64_t &remaining, uint64_t count, uint64_t unit)
+{
+  if (count > remaining / unit) {
+    return false;
+  }
+  const uint64_t bytes = PadTo8(count * unit);
+  if (bytes > remaining) {
+    return false;
+  }
+  remaining -= bytes;
+  return true;
+}
+
+// A node of the tree while it is built.  The rules are spilled to a
+// temporary file, the node only keeps their offsets and sizes.
+struct BuildNode {
+  typedef std::map<std::vector<uint32_t>, BuildNode> Map;
+
+  Map children;
+  std::vector<std::pair<uint64_t, uint32_t> > rules;
+};
+
+// Orders node records by edge label, as the builder's std::map does.
+struct LabelLess {
+  const uint32_t *labels;
+
+  bool operator()(const MappedHyperTree::NodeRecord &node,
+                  const std::vector<uint32_t> &label) const {
+    const uint32_t *begin = labels + node.label;
+    return std::lexicographical_compare(begin, begin + node.labelLength,
+                                        label.begin(), label.end());
+  }
+};
+}
+
+bool MappedHyperTree::Create(const std::string &inFile,
+                             const std::string &outFile)
+{
+  util::FilePiece in(inFile.c_str(), &std::cerr);
+  util::scoped_fd spill(util::MakeTemp(outFile));
+
+  double_conversion::StringToDoubleConverter converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan");
+
+  HyperPathLoader hyperPathLoader;
+  HyperPath sourceFragment;
+  BuildNode root;
+
+  // factor ID -> symbol
+  boost::unordered_map<std::size_t, uint32_t> symbols;
+  std::vector<SymbolRecord> symbolRecords(2);
+  std::memset(&symbolRecords[0], 0, 2 * sizeof(SymbolRecord));
+  std::string strings;
+
+  // reused variables
+  std::vector<uint32_t> label;
+  std::vector<float> scoreVector;
+  std::string record;
+  StringPiece line;
+
+  std::size_t numScores = 0;
+  std::size_t count = 0;
+  uint64_t spillSize = 0;
+
+  while (true) {
+    try {
+      line = in.ReadLine();
+    } catch (const util::EndOfFileException &e) {
+      break;
+    }
+    ++count;
+
+    util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+    StringPiece sourceString(*pipes);
+    StringPiece fields[kRuleStrings];
+    fields[0] = *++pipes;
+    StringPiece scoreString(*++pipes);
+    if (++pipes) {
+      fields[1] = *pipes;
+    }
+    ++pipes;  // counts
+    if (++pipes) {
+      fields[2] = *pipes;
+    }
+    if (++pipes) {
+      fields[3] = *pipes;
+    }
+
+    scoreVector.clear();
+    for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
+      int processed;
+      float score = converter.StringToFloat(s->data(), s->length(), &processed);
+      if (std::isnan(score)) {
+        std::cerr << "ERROR: bad score " << *s << " on line " << count << std::endl;
+        return false;
+      }
+      scoreVector.push_back(FloorScore(TransformScore(score)));
+    }
+    if (count == 1) {
+      numScores = scoreVector.size();
+    } else if (scoreVector.size() != numScores) {
+      std::cerr << "ERROR: found " << scoreVector.size() << " scores on line "
+                << count << ", expected " << numScores << std::endl;
+      return false;
+    }
+
+    // Source-side: give the new factors a symbol and find the node.
+    hyperPathLoader.Load(sourceString, sourceFragment);
+    const std::vector<const Factor *> &factors = hyperPathLoader.GetFactors();
+    for (std::size_t i = 0; i < factors.size(); ++i) {
+      const std::size_t id = factors[i]->GetId();
+      if (symbols.find(id) != symbols.end()) {
+        continue;
+      }
+      symbols[id] = symbolRecords.size();
+      SymbolRecord symbol;
+      symbol.offset = strings.size();
+      symbol.length = factors[i]->GetString().size();
+      symbol.isNonTerminal = (id < moses_MaxNumNonterminals);
+      symbolRecords.push_back(symbol);
+      strings.append(factors[i]->GetString().data(), symbol.length);
+    }
+    BuildNode *node = &root;
+    for (std::size_t i = 0; i < sourceFragment.nodeSeqs.size(); ++i) {
+      const HyperPath::NodeSeq &nodeSeq = sourceFragment.nodeSeqs[i];
+      label.clear();
+      for (std::size_t j = 0; j < nodeSeq.size(); ++j) {
+        if (nodeSeq[j] == HyperPath::kEpsilon) {
+          label.push_back(kEpsilonSymbol);
+        } else if (nodeSeq[j] == HyperPath::kComma) {
+          label.push_back(kCommaSymbol);
+        } else {
+          label.push_back(symbols[nodeSeq[j]]);
+        }
+      }
+      node = &node->children[label];
+    }
+
+    // Target-side: spill the rule.
+    record.clear();
+    if (numScores) {
+      record.append(reinterpret_cast<const char *>(&scoreVector[0]),
+                    numScores * sizeof(float));
+    }
+    for (std::size_t i = 0; i < kRuleStrings; ++i) {
+      const uint32_t length = fields[i].size();
+      record.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    }
+    for (std::size_t i = 0; i < kRuleStrings; ++i) {
+      record.append(fields[i].data(), fields[i].size());
+    }
+    record.resize(PadTo4(record.size()), 0);
+    util::WriteOrThrow(spill.get(), record.data(), record.size());
+    node->rules.push_back(std::make_pair(spillSize, record.size()));
+    spillSize += record.size();
+  }
+
+  // Number the nodes breadth-first, so that the children of a node are
+  // consecutive.
+  const std::vector<uint32_t> rootLabel;
+  std::vector<std::pair<const BuildNode *, const std::vector<uint32_t> *> >
+  order(1, std::make_pair(&root, &rootLabel));
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const BuildNode::Map &children = order[i].first->children;
+    for (BuildNode::Map::const_iterator p = children.begin();
+         p != children.end(); ++p) {
+      order.push_back(std::make_pair(&p->second, &p->first));
+    }
+  }
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.numScores = numScores;
+  header.numSymbols = symbolRecords.size();
+  header.stringBytes = strings.size();
+  header.numNodes = order.size();
+  header.numLabels = 0;
+  header.ruleBytes = 0;
+
+  std::vector<NodeRecord> nodes(order.size());
+  uint64_t nextChild = 1;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const BuildNode &node = *order[i].first;
+    NodeRecord &rec = nodes[i];
+    rec.rules = header.ruleBytes;
+    rec.label = header.numLabels;
+    rec.firstChild = nextChild;
+    rec.numRules = node.rules.size();
+    rec.labelLength = order[i].second->size();
+    rec.numChildren = node.children.size();
+    rec.padding = 0;
+    for (std::size_t j = 0; j < node.rules.size(); ++j) {
+      header.ruleBytes += node.rules[j].second;
+    }
+    header.numLabels += rec.labelLength;
+    nextChild += rec.numChildren;
+  }
+
+  const char padding[8] = {0};
+  util::scoped_fd out(util::CreateOrThrow(outFile.c_str()));
+  util::WriteOrThrow(out.get(), &header, sizeof(header));
+  util::WriteOrThrow(out.get(), &symbolRecords[0],
+                     symbolRecords.size() * sizeof(SymbolRecord));
+  util::WriteOrThrow(out.get(), strings.data(), strings.size());
+  util::WriteOrThrow(out.get(), padding,
+                     PadTo8(header.stringBytes) - header.stringBytes);
+  util::WriteOrThrow(out.get(), &nodes[0], nodes.size() * sizeof(NodeRecord));
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const std::vector<uint32_t> &nodeLabel = *order[i].second;
+    if (!nodeLabel.empty()) {
+      util::WriteOrThrow(out.get(), &nodeLabel[0],
+                         nodeLabel.size() * sizeof(uint32_t));
+    }
+  }
+  const uint64_t labelBytes = header.numLabels * sizeof(uint32_t);
+  util::WriteOrThrow(out.get(), padding, PadTo8(labelBytes) - labelBytes);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const BuildNode &node = *order[i].first;
+    for (std::size_t j = 0; j < node.rules.size(); ++j) {
+      record.resize(node.rules[j].second);
+      util::ErsatzPRead(spill.get(), &record[0], record.size(),
+                        node.rules[j].first);
+      util::WriteOrThrow(out.get(), record.data(), record.size());
+    }
+  }
+
+  std::cerr << "Wrote " << count << " rules, " << header.numNodes
+            << " nodes and " << header.numSymbols - 2 << " source symbols to "
+            << outFile << std::endl;
+  return true;
+}
+
+bool MappedHyperTree::IsMappedHyperTree(const std::string &path)
+{
+  std::ifstream in(path.c_str(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) &&
+         !std::memcmp(magic, kMagic, sizeof(kMagic));
+}
+
+MappedHyperTree::MappedHyperTree(
+  const std::vector<FactorType> &input,
+  const std::vector<FactorType> &output,
+  const std::string &path,
+  const RuleTableFF *ff,
+  boost::unordered_set<std::size_t> &sourceTermSet)
+  : RuleTable(ff)
+  , m_output(output)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeOrThrow(fd.get());
+  UTIL_THROW_IF2(size < sizeof(Header),
+                 "Mapped HyperTree " << path << " is truncated");
+  util::MapRead(util::LAZY, fd.get(), 0, size, m_image);
+
+  const char *base = static_cast<const char *>(m_image.get());
+  const Header *header = reinterpret_cast<const Header *>(base);
+  UTIL_THROW_IF2(std::memcmp(header->magic, kMagic, sizeof(kMagic)),
+                 "File " << path << " is not a mapped HyperTree");
+  UTIL_THROW_IF2(header->numScores != ff->GetNumScoreComponents(),
+                 "Mapped HyperTree " << path << " has " << header->numScores
+                 << " scores per rule, expected "
+                 << ff->GetNumScoreComponents());
+  m_numScores = header->numScores;
+
+  // Check the section sizes against the file before computing any pointer.
+  uint64_t remaining = size - sizeof(Header);
+  UTIL_THROW_IF2(header->numSymbols < 2 || header->numNodes < 1 ||
+                 !TakeSection(remaining, header->numSymbols, sizeof(SymbolRecord)) ||
+                 !TakeSection(remaining, header->stringBytes, 1) ||
+                 !TakeSection(remaining, header->numNodes, sizeof(NodeRecord)) ||
+                 !TakeSection(remaining, header->numLabels, sizeof(uint32_t)) ||
+                 remaining != header->ruleBytes,
+                 "Mapped HyperTree " << path << " has the wrong size");
+
+  const char *ptr = base + sizeof(Header);
+  const SymbolRecord *symbols = reinterpret_cast<const SymbolRecord *>(ptr);
+  ptr += header->numSymbols * sizeof(SymbolRecord);
+  const char *strings = ptr;
+  ptr += PadTo8(header->stringBytes);
+  m_nodes = reinterpret_cast<const NodeRecord *>(ptr);
+  ptr += header->numNodes * sizeof(NodeRecord);
+  m_labels = reinterpret_cast<const uint32_t *>(ptr);
+  ptr += PadTo8(header->numLabels * sizeof(uint32_t));
+  m_rules = ptr;
+
+  for (uint64_t i = 2; i < header->numSymbols; ++i) {
+    UTIL_THROW_IF2(symbols[i].offset > header->stringBytes ||
+                   symbols[i].length > header->stringBytes - symbols[i].offset,
+                   "Mapped HyperTree " << path << " is corrupt: symbol " << i
+                   << " lies outside the symbol strings");
+  }
+
+  // Check the nodes and their labels once, so that matching never reads
+  // outside the mapping.  Rules are checked as DecodeRules reads them.
+  for (uint64_t i = 0; i < header->numNodes; ++i) {
+    const NodeRecord &node = m_nodes[i];
+    bool valid = node.firstChild <= header->numNodes &&
+                 node.numChildren <= header->numNodes - node.firstChild &&
+                 node.label <= header->numLabels &&
+                 node.labelLength <= header->numLabels - node.label &&
+                 node.rules <= header->ruleBytes;
+    for (uint32_t j = 0; valid && j < node.labelLength; ++j) {
+      valid = m_labels[node.label + j] < header->numSymbols;
+    }
+    UTIL_THROW_IF2(!valid, "Mapped HyperTree " << path << " is corrupt: node "
+                   << i << " refers outside the file");
+  }
+  m_ruleBytes = header->ruleBytes;
+
+  // Add the source symbols to the FactorCollection.
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  sourceTermSet.clear();
+  m_factorIds.resize(header->numSymbols);
+  m_factorIds[kEpsilonSymbol] = HyperPath::kEpsilon;
+  m_factorIds[kCommaSymbol] = HyperPath::kComma;
+  for (uint64_t i = 2; i < header->numSymbols; ++i) {
+    StringPiece s(strings + symbols[i].offset, symbols[i].length);
+    const Factor *factor = factorCollection.AddFactor(s, symbols[i].isNonTerminal);
+    m_factorIds[i] = factor->GetId();
+    m_symbols[factor->GetId()] = i;
+    if (!symbols[i].isNonTerminal) {
+      sourceTermSet.insert(factor->GetId());
+    }
+  }
+
+  Word *lhs = NULL;
+  m_dummySourcePhrase.CreateFromString(Input, input, "hello", &lhs);
+  delete lhs;
+}
+
+MappedHyperTree::NodeRef MappedHyperTree::GetRootChild(
+  const HyperPath::NodeSeq &nodeSeq) const
+{
+  std::vector<uint32_t> label(nodeSeq.size());
+  for (std::size_t i = 0; i < nodeSeq.size(); ++i) {
+    if (nodeSeq[i] == HyperPath::kEpsilon) {
+      label[i] = kEpsilonSymbol;
+    } else if (nodeSeq[i] == HyperPath::kComma) {
+      label[i] = kCommaSymbol;
+    } else {
+      boost::unordered_map<std::size_t, uint32_t>::const_iterator p =
+        m_symbols.find(nodeSeq[i]);
+      if (p == m_symbols.end()) {
+        return NULL;
+      }
+      label[i] = p->second;
+    }
+  }
+
+  // The root's children are sorted by label.
+  const NodeRecord *begin = m_nodes + m_nodes[0].firstChild;
+  const NodeRecord *end = begin + m_nodes[0].numChildren;
+  LabelLess less;
+  less.labels = m_labels;
+  const NodeRecord *p = std::lower_bound(begin, end, label, less);
+  if (p == end || p->labelLength != label.size() ||
+      !std::equal(label.begin(), label.end(), m_labels + p->label)) {
+    return NULL;
+  }
+  return p;
+}
+
+bool MappedHyperTree::HasRules(NodeRef node) const
+{
+  return node->numRules > 0;
+}
+
+TargetPhraseCollection::shared_ptr MappedHyperTree::GetTargetPhraseCollection(
+  NodeRef node) const
+{
+  if (!m_ff->GetMaxCacheSize()) {
+    return DecodeRules(node);
+  }
+  CacheColl &cache = m_ff->GetRuleCache();
+  const std::size_t key = node - m_nodes;
+  CacheColl::iterator p = cache.find(key);
+  if (p != cache.end()) {
+    p->second.second = clock();
+    return p->second.first;
+  }
+  TargetPhraseCollection::shared_ptr coll = DecodeRules(node);
+  cache[key] = CacheCollEntry(coll, clock());
+  return coll;
+}
+
+TargetPhraseCollection::shared_ptr MappedHyperTree::DecodeRules(
+  NodeRef node) const
+{
+  TargetPhraseCollection::shared_ptr coll(new TargetPhraseCollection);
+  std::vector<float> scoreVector(m_numScores);
+  uint64_t offset = node->rules;
+  const uint64_t fixedBytes = m_numScores * sizeof(float) +
+                              kRuleStrings * sizeof(uint32_t);
+  for (uint32_t i = 0; i < node->numRules; ++i) {
+    UTIL_THROW_IF2(offset > m_ruleBytes || m_ruleBytes - offset < fixedBytes,
+                   "Mapped HyperTree is corrupt: rule " << i << " of node "
+                   << node - m_nodes << " lies outside the rules");
+    uint64_t remaining = m_ruleBytes - offset - fixedBytes;
+    const char *ptr = m_rules + offset;
+    if (m_numScores) {
+      std::memcpy(&scoreVector[0], ptr, m_numScores * sizeof(float));
+    }
+    ptr += m_numScores * sizeof(float);
+    uint32_t lengths[kRuleStrings];
+    std::memcpy(lengths, ptr, sizeof(lengths));
+    ptr += sizeof(lengths);
+    StringPiece fields[kRuleStrings];
+    for (std::size_t j = 0; j < kRuleStrings; ++j) {
+      UTIL_THROW_IF2(lengths[j] > remaining,
+                     "Mapped HyperTree is corrupt: rule " << i << " of node "
+                     << node - m_nodes << " lies outside the rules");
+      remaining -= lengths[j];
+      fields[j] = StringPiece(ptr, lengths[j]);
+      ptr += lengths[j];
+    }
+    offset = PadTo4(ptr - m_rules);
+
+    TargetPhrase *targetPhrase = new TargetPhrase(m_ff);
+    Word *targetLHS = NULL;
+    targetPhrase->CreateFromString(Output, m_output, fields[0], &targetLHS);
+    targetPhrase->SetTargetLHS(targetLHS);
+    targetPhrase->SetAlignmentInfo(fields[1]);
+    if (!fields[2].empty()) {
+      targetPhrase->SetSparseScore(m_ff, fields[2]);
+    }
+    if (!fields[3].empty()) {
+      targetPhrase->SetProperties(fields[3]);
+    }
+    targetPhrase->GetScoreBreakdown().Assign(m_ff, scoreVector);
+    targetPhrase->EvaluateInIsolation(m_dummySourcePhrase,
+                                      m_ff->GetFeaturesToApply());
+    coll->Add(targetPhrase);
+  }
+  if (m_ff->GetTableLimit()) {
+    coll->Sort(true, m_ff->GetTableLimit());
+  }
+  return coll;
+}
+
+MappedHyperTree::ChildIterator::ChildIterator(const MappedHyperTree &trie,
+    NodeRef node)
+  : m_trie(trie)
+  , m_p(trie.m_nodes + node->firstChild)
+  , m_end(m_p + node->numChildren)
+{
+  Decode();
+}
+
+void MappedHyperTree::ChildIterator::Decode()
+{
+  if (AtEnd()) {
+    return;
+  }
+  const uint32_t *label = m_trie.m_labels + m_p->label;
+  m_label.resize(m_p->labelLength);
+  for (uint32_t i = 0; i < m_p->labelLength; ++i) {
+    m_label[i] = m_trie.m_factorIds[label[i]];
+  }
+}
+
+}  // namespace F2S
+}  // namespace Syntax
+}  // namespace Moses
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <stdint.h>
+
+#include "moses/Phrase.h"
+#include "moses/Syntax/RuleTable.h"
+#include "moses/TargetPhraseCollection.h"
+#include "moses/TypeDef.h"
+#include "util/mmap.hh"
+
+#include "HyperPath.h"
+
+namespace Moses
+{
+namespace Syntax
+{
+namespace F2S
+{
+
+// A HyperTree that is stored in a binary file and memory-mapped instead of
+// being loaded.  The file is written by Create() (see
+// misc/CreateMappedHyperTree) from a text rule table.
+//
+// The nodes are stored breadth-first, so the children of a node are
+// consecutive and sorted by edge label, followed by the rules of each node.
+// The target sides are kept as text and only turned into TargetPhrase
+// objects when the matcher asks for a node's rules; the resulting
+// collections go into the per-thread cache of the RuleTableFF (see its
+// cache-size parameter).
+//
+// Factor IDs depend on the process, so the file stores the source symbols as
+// strings and they are added to the FactorCollection when the file is
+// opened.
+class MappedHyperTree : public RuleTable
+{
+public:
+  // The node records of the file.  Offsets are relative to the start of the
+  // label and rule sections, so the file can be mapped anywhere.
+  struct NodeRecord {
+    uint64_t rules;       // offset of the first rule
+    uint64_t label;       // offset of the edge label
+    uint64_t firstChild;  // index of the first child
+    uint32_t numRules;
+    uint32_t labelLength;
+    uint32_t numChildren;
+    uint32_t padding;
+  };
+
+  // Write the binary form of the text rule table inFile to outFile.
+  static bool Create(const std::string &inFile, const std::string &outFile);
+
+  // Does path start with the magic of a mapped HyperTree?
+  static bool IsMappedHyperTree(const std::string &path);
+
+  MappedHyperTree(const std::vector<FactorType> &input,
+                  const std::vector<FactorType> &output,
+                  const std::string &path,
+                  const RuleTableFF *ff,
+                  boost::unordered_set<std::size_t> &sourceTermSet);
+
+  // The interface used by RuleMatcherHyperTree (see HyperTree).
+  typedef const NodeRecord *NodeRef;
+
+  NodeRef GetRootChild(const HyperPath::NodeSeq &) const;
+
+  bool HasRules(NodeRef) const;
+
+  TargetPhraseCollection::shared_ptr GetTargetPhraseCollection(NodeRef) const;
+
+  class ChildIterator
+  {
+  public:
+    ChildIterator(const MappedHyperTree &, NodeRef);
+
+    bool AtEnd() const {
+      return m_p == m_end;
+    }
+
+    ChildIterator &operator++() {
+      ++m_p;
+      Decode();
+      return *this;
+    }
+
+    const HyperPath::NodeSeq &GetLabel() const {
+      return m_label;
+    }
+
+    NodeRef GetNode() const {
+      return m_p;
+    }
+
+  private:
+    void Decode();
+
+    const MappedHyperTree &m_trie;
+    NodeRef m_p;
+    NodeRef m_end;
+    HyperPath::NodeSeq m_label;
+  };
+
+private:
+  TargetPhraseCollection::shared_ptr DecodeRules(NodeRef) const;
+
+  std::vector<FactorType> m_output;
+  Phrase m_dummySourcePhrase;
+
+  util::scoped_memory m_image;
+  const NodeRecord *m_nodes;
+  const uint32_t *m_labels;
+  const char *m_rules;
+  uint64_t m_ruleBytes;
+  std::size_t m_numScores;
+
+  // file symbol -> factor ID (or HyperPath::kEpsilon / kComma)
+  std::vector<std::size_t> m_factorIds;
+  // factor ID -> file symbol
+  boost::unordered_map<std::size_t, uint32_t> m_symbols;
+};
+
+}  // namespace F2S
+}  // namespace Syntax
+}  // namespace Moses
@@ -0,0 +1,303 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "moses/Syntax/F2S/Forest.h"
+#include "moses/Syntax/F2S/HyperTree.h"
+#include "moses/Syntax/F2S/HyperTreeLoader.h"
+#include "moses/Syntax/F2S/MappedHyperTree.h"
+#include "moses/Syntax/F2S/RuleMatcherHyperTree.h"
+#include "moses/Syntax/PHyperedge.h"
+#include "moses/Syntax/RuleTableFF.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TempDir.h"
+#include "moses/Word.h"
+#include "moses/parameters/AllOptions.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace Moses::Syntax;
+using namespace Moses::Syntax::F2S;
+
+namespace
+{
+
+const char *kRules[] = {
+  "[NP [DT the] [NN house]] ||| das Haus [NP] ||| 0.5 0.25 ||| ||| 1 1 1",
+  "[NP [DT the] [NN house]] ||| das Gebaeude [NP] ||| 0.3 0.25 ||| ||| 1 1 1 ||| sparse_a 1",
+  "[NP [DT the] [NN]] ||| das [NN][NN] [NP] ||| 0.4 0.2 ||| 1-1",
+  "[NP [DT] [NN]] ||| [DT][DT] [NN][NN] [NP] ||| 0.1 0.1 ||| 0-0 1-1",
+  "[S [NP] [VP [V sees] [NP]]] ||| [NP][NP] sieht [NP][NP] [S] ||| 0.2 0.9 ||| 0-0 2-2",
+  "[S [NP] [VP]] ||| [NP][NP] [VP][VP] [S] ||| 0.5 0.5 ||| 0-0 1-1",
+  "[VP [V sees] [NP [DT the] [NN]]] ||| sieht das [NN][NN] [VP] ||| 0.3 0.3 ||| 2-2",
+  "[NN house] ||| Haus [NN] ||| 0.9 0.8 ||| ||| 1 1 1 ||| ||| {{Tree [NN Haus]}}",
+  "[NN cat] ||| Katze [NN] ||| 0.9 0.8",
+};
+
+// Feature names must be unique.
+std::string TableLine(const std::string &path)
+{
+  static std::size_t count = 0;
+  return "RuleTable name=MappedHyperTreeTest" + boost::lexical_cast<std::string>(count++)
+         + " num-features=2 input-factor=0 output-factor=0 path=" + path;
+}
+
+// The forest of "the house sees the house".
+class TestForest
+{
+public:
+  TestForest() {
+    Forest::Vertex *the1 = Add("the", false, 0, 0);
+    Forest::Vertex *house1 = Add("house", false, 1, 1);
+    Forest::Vertex *sees = Add("sees", false, 2, 2);
+    Forest::Vertex *the2 = Add("the", false, 3, 3);
+    Forest::Vertex *house2 = Add("house", false, 4, 4);
+    Forest::Vertex *dt1 = Add("DT", true, 0, 0, the1);
+    Forest::Vertex *nn1 = Add("NN", true, 1, 1, house1);
+    Forest::Vertex *v = Add("V", true, 2, 2, sees);
+    Forest::Vertex *dt2 = Add("DT", true, 3, 3, the2);
+    Forest::Vertex *nn2 = Add("NN", true, 4, 4, house2);
+    Forest::Vertex *np1 = Add("NP", true, 0, 1, dt1, nn1);
+    Forest::Vertex *np2 = Add("NP", true, 3, 4, dt2, nn2);
+    Forest::Vertex *vp = Add("VP", true, 2, 4, v, np2);
+    Add("S", true, 0, 4, np1, vp);
+  }
+
+  const std::vector<Forest::Vertex *> &GetVertices() const {
+    return m_forest.vertices;
+  }
+
+private:
+  Forest::Vertex *Add(const std::string &symbol, bool isNonTerminal,
+                      std::size_t start, std::size_t end,
+                      Forest::Vertex *first = NULL,
+                      Forest::Vertex *second = NULL) {
+    Word word(isNonTerminal);
+    word.CreateFromString(Input, std::vector<FactorType>(1, 0), symbol, isNonTerminal);
+    Forest::Vertex *vertex = new Forest::Vertex(PVertex(Range(start, end), word));
+    m_forest.vertices.push_back(vertex);
+    if (first) {
+      Forest::Hyperedge *edge = new Forest::Hyperedge;
+      edge->head = vertex;
+      edge->tail.push_back(first);
+      if (second) {
+        edge->tail.push_back(second);
+      }
+      edge->weight = -0.125f * m_forest.vertices.size();
+      vertex->incoming.push_back(edge);
+    }
+    return vertex;
+  }
+
+  Forest m_forest;
+};
+
+std::string DescribeVertex(const PVertex &vertex)
+{
+  std::ostringstream out;
+  out << vertex.symbol << vertex.span;
+  return out.str();
+}
+
+// Records every hyperedge the matcher finds, with its rules.
+class Recorder
+{
+public:
+  Recorder(const RuleTableFF &ff) : m_ff(ff) {}
+
+  void operator()(const PHyperedge &hyperedge) {
+    std::ostringstream out;
+    out << DescribeVertex(*hyperedge.head) << " ->";
+    for (std::size_t i = 0; i < hyperedge.tail.size(); ++i) {
+      out << " " << DescribeVertex(*hyperedge.tail[i]);
+    }
+    out << " | " << hyperedge.label.inputWeight;
+    const TargetPhraseCollection &coll = *hyperedge.label.translations;
+    for (TargetPhraseCollection::const_iterator p = coll.begin(); p != coll.end(); ++p) {
+      const TargetPhrase &target = **p;
+      out << " | " << target.GetTargetLHS() << " " << static_cast<const Phrase&>(target)
+          << " " << target.GetAlignTerm() << " " << target.GetAlignNonTerm();
+      std::vector<float> scores = target.GetScoreBreakdown().GetScoresForProducer(&m_ff);
+      for (std::size_t i = 0; i < scores.size(); ++i) {
+        out << " " << scores[i];
+      }
+      out << " " << target.GetScoreBreakdown().GetScoreForProducer(&m_ff, "sparse_a")
+          << (target.GetProperty("Tree") ? " Tree" : "");
+    }
+    matches.push_back(out.str());
+  }
+
+  std::vector<std::string> matches;
+
+private:
+  const RuleTableFF &m_ff;
+};
+
+template<typename Trie>
+std::vector<std::string> Match(const Trie &trie, const RuleTableFF &ff,
+                               const TestForest &forest)
+{
+  RuleMatcherHyperTree<Recorder, Trie> matcher(trie);
+  Recorder recorder(ff);
+  const std::vector<Forest::Vertex *> &vertices = forest.GetVertices();
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    matcher.EnumerateHyperedges(*vertices[i], recorder);
+  }
+  // the tries list children in different orders
+  std::sort(recorder.matches.begin(), recorder.matches.end());
+  return recorder.matches;
+}
+
+std::string WriteRules(const TempDir &dir)
+{
+  std::string text;
+  for (std::size_t i = 0; i < sizeof(kRules) / sizeof(kRules[0]); ++i) {
+    text += std::string(kRules[i]) + "\n";
+  }
+  return dir.Write("rule-table", text);
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(mapped_hyper_tree)
+
+BOOST_AUTO_TEST_CASE(matches_in_memory_tree)
+{
+  TempDir dir("mapped-hyper-tree");
+  const std::string text = WriteRules(dir), binary = dir.File("rule-table.bin");
+  BOOST_REQUIRE(MappedHyperTree::Create(text, binary));
+  BOOST_CHECK(MappedHyperTree::IsMappedHyperTree(binary));
+  BOOST_CHECK(!MappedHyperTree::IsMappedHyperTree(text));
+
+  AllOptions opts;
+  std::vector<FactorType> factors(1, 0);
+  RuleTableFF ff(TableLine(text));
+  TestForest forest;
+
+  HyperTree trie(&ff);
+  boost::unordered_set<std::size_t> terms;
+  HyperTreeLoader loader;
+  BOOST_REQUIRE(loader.Load(opts, factors, factors, text, ff, trie, terms));
+  std::vector<std::string> expected = Match(trie, ff, forest);
+  // NN twice, NP [DT NN] twice, NP [the NN] twice, NP [the house] twice,
+  // VP [sees [the NN]], S [NP VP], S [NP [sees NP]]
+  BOOST_REQUIRE_EQUAL(expected.size(), static_cast<std::size_t>(11));
+
+  boost::unordered_set<std::size_t> mappedTerms;
+  MappedHyperTree mapped(factors, factors, binary, &ff, mappedTerms);
+  BOOST_CHECK(mappedTerms == terms);
+  std::vector<std::string> got = Match(mapped, ff, forest);
+  BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_file)
+{
+  TempDir dir("mapped-hyper-tree");
+  const std::string text = WriteRules(dir), binary = dir.File("rule-table.bin");
+  BOOST_REQUIRE(MappedHyperTree::Create(text, binary));
+  std::vector<FactorType> factors(1, 0);
+  RuleTableFF ff(TableLine(text));
+  boost::unordered_set<std::size_t> terms;
+
+  std::string image;
+  {
+    std::ifstream in(binary.c_str(), std::ios::binary);
+    image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+
+  // truncated
+  dir.Write("truncated.bin", image.substr(0, image.size() - 3));
+  BOOST_CHECK_THROW(MappedHyperTree(factors, factors, dir.File("truncated.bin"), &ff, terms),
+                    util::Exception);
+
+  // a symbol string beyond the end of the strings: the header is 7 words,
+  // followed by 16-byte symbol records with the string offset first
+  std::string badSymbol = image;
+  const uint64_t offset = 1 << 30;
+  badSymbol.replace(7 * 8 + 2 * 16, sizeof(offset), reinterpret_cast<const char *>(&offset), sizeof(offset));
+  dir.Write("bad-symbol.bin", badSymbol);
+  BOOST_CHECK_THROW(MappedHyperTree(factors, factors, dir.File("bad-symbol.bin"), &ff, terms),
+                    util::Exception);
+
+  // the sections after the symbols, from the header fields
+  uint64_t fields[7];
+  std::memcpy(fields, image.data(), sizeof(fields));
+  const uint64_t numScores = fields[1], numSymbols = fields[2], stringBytes = fields[3],
+                 numNodes = fields[4], numLabels = fields[5];
+  const std::size_t nodesAt = 7 * 8 + numSymbols * 16 + ((stringBytes + 7) & ~7ULL);
+  const std::size_t labelsAt = nodesAt + numNodes * sizeof(MappedHyperTree::NodeRecord);
+  const std::size_t rulesAt = labelsAt + ((numLabels * 4 + 7) & ~7ULL);
+  std::vector<MappedHyperTree::NodeRecord> records(numNodes);
+  std::memcpy(&records[0], image.data() + nodesAt, numNodes * sizeof(MappedHyperTree::NodeRecord));
+
+  // children beyond the last node
+  std::string badChildren = image;
+  MappedHyperTree::NodeRecord root = records[0];
+  root.numChildren = numNodes;
+  badChildren.replace(nodesAt, sizeof(root), reinterpret_cast<const char *>(&root), sizeof(root));
+  dir.Write("bad-children.bin", badChildren);
+  BOOST_CHECK_THROW(MappedHyperTree(factors, factors, dir.File("bad-children.bin"), &ff, terms),
+                    util::Exception);
+
+  // a label symbol that does not exist
+  std::string badLabel = image;
+  const uint32_t symbol = numSymbols;
+  BOOST_REQUIRE(records[1].labelLength > 0);
+  badLabel.replace(labelsAt + records[1].label * 4, sizeof(symbol), reinterpret_cast<const char *>(&symbol), sizeof(symbol));
+  dir.Write("bad-label.bin", badLabel);
+  BOOST_CHECK_THROW(MappedHyperTree(factors, factors, dir.File("bad-label.bin"), &ff, terms),
+                    util::Exception);
+
+  // target strings longer than the rules: the table opens, but matching
+  // throws when it decodes the rules
+  std::string badRule = image;
+  const uint32_t length = 1 << 30;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (records[i].numRules) {
+      badRule.replace(rulesAt + records[i].rules + numScores * sizeof(float), sizeof(length),
+                      reinterpret_cast<const char *>(&length), sizeof(length));
+    }
+  }
+  dir.Write("bad-rule.bin", badRule);
+  {
+    MappedHyperTree mapped(factors, factors, dir.File("bad-rule.bin"), &ff, terms);
+    TestForest forest;
+    BOOST_CHECK_THROW(Match(mapped, ff, forest), util::Exception);
+  }
+
+  // a section size that overflows
+  std::string badSize = image;
+  const uint64_t nodes = ~static_cast<uint64_t>(0) / 8;
+  badSize.replace(4 * 8, sizeof(nodes), reinterpret_cast<const char *>(&nodes), sizeof(nodes));
+  dir.Write("bad-size.bin", badSize);
+  BOOST_CHECK_THROW(MappedHyperTree(factors, factors, dir.File("bad-size.bin"), &ff, terms),
+                    util::Exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
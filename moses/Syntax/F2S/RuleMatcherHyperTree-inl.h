@@ -7,19 +7,19 @@ namespace Syntax
 namespace F2S
 {
 
-template<typename Callback>
-RuleMatcherHyperTree<Callback>::RuleMatcherHyperTree(const HyperTree &ruleTrie)
+template<typename Callback, typename Trie>
+RuleMatcherHyperTree<Callback, Trie>::RuleMatcherHyperTree(
+  const Trie &ruleTrie)
   : m_ruleTrie(ruleTrie)
 {
 }
 
-template<typename Callback>
-void RuleMatcherHyperTree<Callback>::EnumerateHyperedges(
+template<typename Callback, typename Trie>
+void RuleMatcherHyperTree<Callback, Trie>::EnumerateHyperedges(
   const Forest::Vertex &v, Callback &callback)
 {
-  const HyperTree::Node &root = m_ruleTrie.GetRootNode();
   HyperPath::NodeSeq nodeSeq(1, v.pvertex.symbol[0]->GetId());
-  const HyperTree::Node *child = root.GetChild(nodeSeq);
+  typename Trie::NodeRef child = m_ruleTrie.GetRootChild(nodeSeq);
   if (!child) {
     return;
   }
@@ -35,7 +35,7 @@ void RuleMatcherHyperTree<Callback>::EnumerateHyperedges(
   while (!m_queue.empty()) {
     MatchItem item = m_queue.front();
     m_queue.pop();
-    if (item.trieNode->HasRules()) {
+    if (m_ruleTrie.HasRules(item.trieNode)) {
       const FNS &fns = item.annotatedFNS.fns;
       // Set the output hyperedge's tail.
       m_hyperedge.tail.clear();
@@ -52,7 +52,7 @@ void RuleMatcherHyperTree<Callback>::EnumerateHyperedges(
       }
       // Set the output hyperedge label's translation set pointer.
       m_hyperedge.label.translations
-      = item.trieNode->GetTargetPhraseCollection();
+      = m_ruleTrie.GetTargetPhraseCollection(item.trieNode);
       // Pass the output hyperedge to the callback.
       callback(m_hyperedge);
     }
@@ -60,20 +60,17 @@ void RuleMatcherHyperTree<Callback>::EnumerateHyperedges(
   }
 }
 
-template<typename Callback>
-void RuleMatcherHyperTree<Callback>::PropagateNextLexel(const MatchItem &item)
+template<typename Callback, typename Trie>
+void RuleMatcherHyperTree<Callback, Trie>::PropagateNextLexel(const MatchItem &item)
 {
   std::vector<AnnotatedFNS> tfns;
   std::vector<AnnotatedFNS> rfns;
   std::vector<AnnotatedFNS> rfns2;
 
-  const HyperTree::Node &trieNode = *(item.trieNode);
-  const HyperTree::Node::Map &map = trieNode.GetMap();
-
-  for (HyperTree::Node::Map::const_iterator p = map.begin();
-       p != map.end(); ++p) {
-    const HyperPath::NodeSeq &edgeLabel = p->first;
-    const HyperTree::Node &child = p->second;
+  for (typename Trie::ChildIterator p(m_ruleTrie, item.trieNode); !p.AtEnd();
+       ++p) {
+    const HyperPath::NodeSeq &edgeLabel = p.GetLabel();
+    typename Trie::NodeRef child = p.GetNode();
 
     const int numSubSeqs = CountCommas(edgeLabel) + 1;
 
@@ -119,14 +116,14 @@ void RuleMatcherHyperTree<Callback>::PropagateNextLexel(const MatchItem &item)
       newItem.annotatedFNS.fragment.insert(newItem.annotatedFNS.fragment.end(),
                                            q->fragment.begin(),
                                            q->fragment.end());
-      newItem.trieNode = &child;
+      newItem.trieNode = child;
       m_queue.push(newItem);
     }
   }
 }
 
-template<typename Callback>
-void RuleMatcherHyperTree<Callback>::CartesianProduct(
+template<typename Callback, typename Trie>
+void RuleMatcherHyperTree<Callback, Trie>::CartesianProduct(
   const std::vector<AnnotatedFNS> &x,
   const std::vector<AnnotatedFNS> &y,
   std::vector<AnnotatedFNS> &z)
@@ -154,8 +151,8 @@ void RuleMatcherHyperTree<Callback>::CartesianProduct(
   }
 }
 
-template<typename Callback>
-bool RuleMatcherHyperTree<Callback>::MatchChildren(
+template<typename Callback, typename Trie>
+bool RuleMatcherHyperTree<Callback, Trie>::MatchChildren(
   const std::vector<Forest::Vertex *> &children,
   const HyperPath::NodeSeq &edgeLabel,
   std::size_t pos,
@@ -172,8 +169,8 @@ bool RuleMatcherHyperTree<Callback>::MatchChildren(
   return true;
 }
 
-template<typename Callback>
-int RuleMatcherHyperTree<Callback>::CountCommas(const HyperPath::NodeSeq &seq)
+template<typename Callback, typename Trie>
+int RuleMatcherHyperTree<Callback, Trie>::CountCommas(const HyperPath::NodeSeq &seq)
 {
   int count = 0;
   for (std::vector<std::size_t>::const_iterator p = seq.begin();
@@ -185,8 +182,8 @@ int RuleMatcherHyperTree<Callback>::CountCommas(const HyperPath::NodeSeq &seq)
   return count;
 }
 
-template<typename Callback>
-int RuleMatcherHyperTree<Callback>::SubSeqLength(const HyperPath::NodeSeq &seq,
+template<typename Callback, typename Trie>
+int RuleMatcherHyperTree<Callback, Trie>::SubSeqLength(const HyperPath::NodeSeq &seq,
     int pos)
 {
   int length = 0;
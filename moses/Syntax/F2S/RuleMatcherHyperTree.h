@@ -1,5 +1,8 @@
 #pragma once
 
+#include <queue>
+#include <vector>
+
 #include "moses/Syntax/PHyperedge.h"
 
 #include "Forest.h"
@@ -20,11 +23,13 @@ namespace F2S
 //   Translation"
 //  In proceedings of EMNLP 2009
 //
-template<typename Callback>
+// Trie is HyperTree or MappedHyperTree.
+//
+template<typename Callback, typename Trie = HyperTree>
 class RuleMatcherHyperTree : public RuleMatcher<Callback>
 {
 public:
-  RuleMatcherHyperTree(const HyperTree &);
+  RuleMatcherHyperTree(const Trie &);
 
   ~RuleMatcherHyperTree() {}
 
@@ -46,7 +51,7 @@ private:
   // fragment.
   struct MatchItem {
     AnnotatedFNS annotatedFNS;
-    const HyperTree::Node *trieNode;
+    typename Trie::NodeRef trieNode;
   };
 
   // Implements the Cartsian product operation from line 16 of Algorithm 4
@@ -65,7 +70,7 @@ private:
 
   int SubSeqLength(const HyperPath::NodeSeq &, int);
 
-  const HyperTree &m_ruleTrie;
+  const Trie &m_ruleTrie;
   PHyperedge m_hyperedge;
   std::queue<MatchItem> m_queue;  // Called "SFP" in Zhang et al. (2009)
 };
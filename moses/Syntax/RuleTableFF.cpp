@@ -2,6 +2,7 @@
 #include "moses/parameters/AllOptions.h"
 #include "moses/Syntax/F2S/HyperTree.h"
 #include "moses/Syntax/F2S/HyperTreeLoader.h"
+#include "moses/Syntax/F2S/MappedHyperTree.h"
 #include "moses/Syntax/S2T/RuleTrieCYKPlus.h"
 #include "moses/Syntax/S2T/RuleTrieLoader.h"
 #include "moses/Syntax/S2T/RuleTrieScope3.h"
@@ -16,10 +17,9 @@ std::vector<RuleTableFF*> RuleTableFF::s_instances;
 
 RuleTableFF::RuleTableFF(const std::string &line)
   : PhraseDictionary(line, true)
+  , m_loadThreads(0)
 {
   ReadParameters();
-  // caching for memory pt is pointless
-  m_maxCacheSize = 0;
 
   s_instances.push_back(this);
 }
@@ -29,6 +29,16 @@ void RuleTableFF::Load(Moses::AllOptions::ptr const& opts)
   m_options = opts;
   SetFeaturesToApply();
 
+  if ((opts->search.algo == SyntaxF2S || opts->search.algo == SyntaxT2S) &&
+      F2S::MappedHyperTree::IsMappedHyperTree(m_filePath)) {
+    m_table = new F2S::MappedHyperTree(m_input, m_output, m_filePath, this,
+                                       m_sourceTerminalSet);
+    return;
+  }
+
+  // caching for memory pt is pointless
+  m_maxCacheSize = 0;
+
   if (opts->search.algo == SyntaxF2S || opts->search.algo == SyntaxT2S) {
     F2S::HyperTree *trie = new F2S::HyperTree(this);
     F2S::HyperTreeLoader loader;
@@ -60,5 +70,23 @@ void RuleTableFF::Load(Moses::AllOptions::ptr const& opts)
   }
 }
 
+void RuleTableFF::InitializeForInput(ttasksptr const& ttask)
+{
+  if (m_maxCacheSize) {
+    ReduceCache();
+  }
+}
+
+void RuleTableFF::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "load-threads") {
+    m_loadThreads = Scan<std::size_t>(value);
+  } else if (key == "binary-dump") {
+    m_binaryDump = value;
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 }  // Syntax
 }  // Moses
@@ -29,6 +29,10 @@ public:
 
   void Load(AllOptions::ptr const& opts);
 
+  void InitializeForInput(ttasksptr const& ttask);
+
+  void SetParameter(const std::string& key, const std::string& value);
+
   const RuleTable *GetTable() const {
     return m_table;
   }
@@ -49,9 +53,33 @@ public:
     return m_sourceTerminalSet;
   }
 
+  // Number of threads parsing the rule table while it is loaded, 0 to parse
+  // in the loading thread.
+  std::size_t GetLoadThreads() const {
+    return m_loadThreads;
+  }
+
+  // File for the binary dump of the parsed rule table, or empty.
+  const std::string &GetBinaryDump() const {
+    return m_binaryDump;
+  }
+
+  // For tables that build their TargetPhraseCollections on demand: the
+  // per-thread cache and its capacity (0 if caching is off).
+  std::size_t GetMaxCacheSize() const {
+    return m_maxCacheSize;
+  }
+
+  CacheColl &GetRuleCache() const {
+    return GetCache();
+  }
+
 private:
   static std::vector<RuleTableFF*> s_instances;
 
+  std::size_t m_loadThreads;
+  std::string m_binaryDump;
+
   const RuleTable *m_table;
   boost::unordered_set<std::size_t> m_sourceTerminalSet;
 };
@@ -0,0 +1,673 @@
+#include "RuleTableReader.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sstream>
+
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#endif
+
+#include "moses/AlignmentInfo.h"
+#include "moses/Factor.h"
+#include "moses/FactorCollection.h"
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+#include "moses/TranslationModel/PhraseDictionary.h"
+#include "moses/parameters/AllOptions.h"
+#include "util/double-conversion/double-conversion.h"
+#include "util/exception.hh"
+#include "util/string_piece.hh"
+#include "util/tokenize_piece.hh"
+
+namespace Moses
+{
+namespace Syntax
+{
+
+namespace
+{
+
+const char DUMP_MAGIC[8] = {'m', 'o', 's', 'e', 's', 'R', 'T', 'D'};
+const uint32_t DUMP_VERSION = 1;
+
+}  // namespace
+
+// Encodes rules for the binary dump.  Factors are written as indices into a
+// vocabulary that is local to the chunk, so chunks can be encoded
+// independently and a reader interns each distinct string once per chunk.
+class RuleTableReader::Encoder
+{
+public:
+  Encoder() : m_numRules(0) {}
+
+  template<typename T>
+  void Put(const T &value) {
+    m_body.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void PutString(const StringPiece &str) {
+    Put<uint32_t>(str.size());
+    m_body.append(str.data(), str.size());
+  }
+
+  // Writes a flag for presence, so a missing LHS can be encoded too.
+  void PutWord(const Word *word) {
+    uint8_t flags = word ? 1 : 0;
+    if (word && word->IsNonTerminal()) flags |= 2;
+    Put(flags);
+    if (!word) return;
+    uint32_t mask = 0;
+    for (std::size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+      if ((*word)[i]) mask |= 1 << i;
+    }
+    Put(mask);
+    for (std::size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+      if ((*word)[i]) Put(Index((*word)[i], word->IsNonTerminal()));
+    }
+  }
+
+  void PutPhrase(const Phrase &phrase) {
+    Put<uint32_t>(phrase.GetSize());
+    for (std::size_t i = 0; i < phrase.GetSize(); ++i) {
+      PutWord(&phrase.GetWord(i));
+    }
+  }
+
+  void PutAlignment(const AlignmentInfo &alignment) {
+    Put<uint32_t>(alignment.GetSize());
+    for (AlignmentInfo::const_iterator p = alignment.begin();
+         p != alignment.end(); ++p) {
+      Put<uint32_t>(p->first);
+      Put<uint32_t>(p->second);
+    }
+  }
+
+  void AddRule() {
+    ++m_numRules;
+  }
+
+  // Writes the chunk: vocabulary, number of rules, then the rules.
+  void Finish(std::string &out) const {
+    out.clear();
+    uint32_t size = m_vocab.size();
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    for (std::size_t i = 0; i < m_vocab.size(); ++i) {
+      uint8_t isNonTerminal = m_vocab[i].second;
+      StringPiece str = m_vocab[i].first->GetString();
+      uint32_t length = str.size();
+      out.append(reinterpret_cast<const char*>(&isNonTerminal), sizeof(isNonTerminal));
+      out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+      out.append(str.data(), str.size());
+    }
+    out.append(reinterpret_cast<const char*>(&m_numRules), sizeof(m_numRules));
+    out += m_body;
+  }
+
+private:
+  uint32_t Index(const Factor *factor, bool isNonTerminal) {
+    boost::unordered_map<const Factor*, uint32_t>::const_iterator p
+    = m_ids.find(factor);
+    if (p != m_ids.end()) return p->second;
+    uint32_t id = m_vocab.size();
+    m_ids[factor] = id;
+    m_vocab.push_back(std::make_pair(factor, isNonTerminal));
+    return id;
+  }
+
+  std::string m_body;
+  uint32_t m_numRules;
+  boost::unordered_map<const Factor*, uint32_t> m_ids;
+  std::vector<std::pair<const Factor*, bool> > m_vocab;
+};
+
+class RuleTableReader::Decoder
+{
+public:
+  explicit Decoder(const std::string &chunk)
+    : m_cur(chunk.data())
+    , m_end(chunk.data() + chunk.size()) {
+    FactorCollection &factorCollection = FactorCollection::Instance();
+    uint32_t size = Get<uint32_t>();
+    m_vocab.reserve(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      bool isNonTerminal = Get<uint8_t>();
+      StringPiece str = GetString();
+      m_vocab.push_back(factorCollection.AddFactor(str, isNonTerminal));
+    }
+    m_numRules = Get<uint32_t>();
+  }
+
+  uint32_t NumRules() const {
+    return m_numRules;
+  }
+
+  bool AtEnd() const {
+    return m_cur == m_end;
+  }
+
+  template<typename T>
+  T Get() {
+    UTIL_THROW_IF2(static_cast<std::size_t>(m_end - m_cur) < sizeof(T),
+                   "Truncated rule table dump");
+    T ret;
+    std::memcpy(&ret, m_cur, sizeof(T));
+    m_cur += sizeof(T);
+    return ret;
+  }
+
+  StringPiece GetString() {
+    uint32_t length = Get<uint32_t>();
+    UTIL_THROW_IF2(static_cast<std::size_t>(m_end - m_cur) < length,
+                   "Truncated rule table dump");
+    StringPiece ret(m_cur, length);
+    m_cur += length;
+    return ret;
+  }
+
+  // Returns false if the encoded word was missing.
+  bool GetWord(Word &word) {
+    uint8_t flags = Get<uint8_t>();
+    if (!(flags & 1)) return false;
+    word.SetIsNonTerminal(flags & 2);
+    uint32_t mask = Get<uint32_t>();
+    for (std::size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+      if (!(mask & (1 << i))) continue;
+      uint32_t id = Get<uint32_t>();
+      UTIL_THROW_IF2(id >= m_vocab.size(), "Bad factor in rule table dump");
+      word.SetFactor(i, m_vocab[id]);
+    }
+    return true;
+  }
+
+  void GetPhrase(Phrase &phrase) {
+    uint32_t size = Get<uint32_t>();
+    for (uint32_t i = 0; i < size; ++i) {
+      UTIL_THROW_IF2(!GetWord(phrase.AddWord()), "Bad word in rule table dump");
+    }
+  }
+
+  void GetAlignment(AlignmentInfo::CollType &alignment) {
+    uint32_t size = Get<uint32_t>();
+    for (uint32_t i = 0; i < size; ++i) {
+      uint32_t source = Get<uint32_t>();
+      uint32_t target = Get<uint32_t>();
+      alignment.insert(std::pair<size_t,size_t>(source, target));
+    }
+  }
+
+private:
+  const char *m_cur, *m_end;
+  std::vector<const Factor*> m_vocab;
+  uint32_t m_numRules;
+};
+
+RuleTableReader::Batch::~Batch()
+{
+  for (std::size_t i = 0; i < rules.size(); ++i) {
+    delete rules[i].sourceLHS;
+    delete rules[i].target;
+  }
+}
+
+RuleTableReader::RuleTableReader(const AllOptions &opts,
+                                 const std::vector<FactorType> &input,
+                                 const std::vector<FactorType> &output,
+                                 const std::string &path,
+                                 const PhraseDictionary &ff,
+                                 std::size_t numThreads,
+                                 const std::string &binaryDump)
+  : m_options(opts)
+  , m_input(input)
+  , m_output(output)
+  , m_ff(ff)
+  , m_numThreads(numThreads)
+  , m_textSize(0)
+  , m_textTime(-1)
+  , m_nextLine(1)
+  , m_currentPos(0)
+  , m_finished(false)
+  , m_numRules(0)
+#ifdef WITH_THREADS
+  , m_stop(false)
+#endif
+{
+  m_timer.start();
+
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    m_textSize = st.st_size;
+    m_textTime = st.st_mtime;
+  }
+
+  if (binaryDump.empty() || !OpenDump(binaryDump)) {
+    std::ostream *progress = NULL;
+    IFVERBOSE(1) progress = &std::cerr;
+    m_text.reset(new util::FilePiece(path.c_str(), progress));
+    if (!binaryDump.empty()) StartDump(binaryDump);
+  }
+
+#ifdef WITH_THREADS
+  if (m_numThreads) {
+    m_ordered.reset(new util::PCQueue<BatchPtr>(4 * m_numThreads));
+    // room for every batch in flight plus one end marker per parser
+    m_work.reset(new util::PCQueue<BatchPtr>(5 * m_numThreads + 1));
+    for (std::size_t i = 0; i < m_numThreads; ++i) {
+      m_threads.create_thread(boost::bind(&RuleTableReader::Parse, this));
+    }
+    m_threads.create_thread(boost::bind(&RuleTableReader::Read, this));
+  }
+#endif
+}
+
+RuleTableReader::~RuleTableReader()
+{
+#ifdef WITH_THREADS
+  if (m_numThreads) {
+    // drain the pipeline so the reader is not left blocked on a full queue;
+    // if the table was not read to the end, the threads skip the rest
+    Stop();
+    while (!m_finished) {
+      m_ordered->Consume(m_current);
+      if (!m_current) m_finished = true;
+    }
+    m_threads.join_all();
+  }
+#endif
+  // an unfinished dump is useless
+  if (m_dumpOut.get() != -1) {
+    m_dumpOut.reset();
+    unlink((m_dumpPath + ".tmp").c_str());
+  }
+}
+
+bool RuleTableReader::Next(ParsedRule &rule)
+{
+  while (!m_finished) {
+    if (m_current && m_currentPos < m_current->rules.size()) {
+      ParsedRule &next = m_current->rules[m_currentPos++];
+      rule = next;
+      next.sourceLHS = NULL;
+      next.target = NULL;
+      ++m_numRules;
+      return true;
+    }
+
+#ifdef WITH_THREADS
+    if (m_numThreads) {
+      m_ordered->Consume(m_current);
+      if (m_current) {
+        boost::mutex::scoped_lock lock(m_current->mutex);
+        while (!m_current->done) {
+          m_current->cond.wait(lock);
+        }
+      }
+    } else
+#endif
+    {
+      m_current = ReadBatch();
+      if (m_current) ParseBatch(*m_current);
+    }
+    m_currentPos = 0;
+
+    if (!m_current) {
+      m_finished = true;
+      FinishDump();
+      Report();
+      break;
+    }
+    if (!m_current->error.empty()) {
+#ifdef WITH_THREADS
+      if (m_numThreads) Stop();
+#endif
+      UTIL_THROW2(m_ff.GetFilePath() << ": " << m_current->error);
+    }
+
+    if (m_dumpOut.get() != -1) {
+      uint64_t size = m_current->encoded.size();
+      util::WriteOrThrow(m_dumpOut.get(), &size, sizeof(size));
+      util::WriteOrThrow(m_dumpOut.get(), m_current->encoded.data(), size);
+    }
+  }
+  return false;
+}
+
+std::string RuleTableReader::DumpConfig() const
+{
+  std::ostringstream config;
+  config << "max-factors=" << MAX_NUM_FACTORS
+         << " input=" << Join(",", m_input)
+         << " output=" << Join(",", m_output)
+         << " scores=" << m_ff.GetNumScoreComponents()
+         << " word-deletion=" << m_options.unk.word_deletion_enabled;
+  return config.str();
+}
+
+// Opens the dump if it matches the text table and the configuration.
+bool RuleTableReader::OpenDump(const std::string &path)
+{
+  util::scoped_fd file(open(path.c_str(), O_RDONLY));
+  if (file.get() == -1) return false;
+
+  const std::string expected = DumpConfig();
+  char magic[sizeof(DUMP_MAGIC)];
+  uint32_t version, configLength;
+  std::string config;
+  uint64_t textSize;
+  int64_t textTime;
+  if (util::ReadOrEOF(file.get(), magic, sizeof(magic)) != sizeof(magic)
+      || std::memcmp(magic, DUMP_MAGIC, sizeof(magic))) {
+    VERBOSE(1, path << " is not a rule table dump, ignoring it" << std::endl);
+    return false;
+  }
+  util::ReadOrThrow(file.get(), &version, sizeof(version));
+  util::ReadOrThrow(file.get(), &configLength, sizeof(configLength));
+  if (version != DUMP_VERSION || configLength != expected.size()) {
+    VERBOSE(1, "Rule table dump " << path << " was written for another version or configuration, ignoring it" << std::endl);
+    return false;
+  }
+  config.resize(configLength);
+  util::ReadOrThrow(file.get(), &config[0], configLength);
+  util::ReadOrThrow(file.get(), &textSize, sizeof(textSize));
+  util::ReadOrThrow(file.get(), &textTime, sizeof(textTime));
+  if (config != expected) {
+    VERBOSE(1, "Rule table dump " << path << " was written for another configuration, ignoring it" << std::endl);
+    return false;
+  }
+  // without the text table, the dump is all there is
+  if (m_textTime != -1 && (textSize != m_textSize || textTime != m_textTime)) {
+    VERBOSE(1, "Rule table dump " << path << " is out of date, ignoring it" << std::endl);
+    return false;
+  }
+
+  VERBOSE(1, "Reading rules from dump " << path << std::endl);
+  std::ostream *progress = NULL;
+  IFVERBOSE(1) progress = &std::cerr;
+  m_dumpProgress.reset(new util::ErsatzProgress(util::SizeFile(file.get()), progress));
+  m_dumpIn.reset(file.release());
+  return true;
+}
+
+void RuleTableReader::StartDump(const std::string &path)
+{
+  m_dumpPath = path;
+  m_dumpOut.reset(util::CreateOrThrow((path + ".tmp").c_str()));
+
+  const std::string config = DumpConfig();
+  uint32_t configLength = config.size();
+  int fd = m_dumpOut.get();
+  util::WriteOrThrow(fd, DUMP_MAGIC, sizeof(DUMP_MAGIC));
+  util::WriteOrThrow(fd, &DUMP_VERSION, sizeof(DUMP_VERSION));
+  util::WriteOrThrow(fd, &configLength, sizeof(configLength));
+  util::WriteOrThrow(fd, config.data(), config.size());
+  util::WriteOrThrow(fd, &m_textSize, sizeof(m_textSize));
+  util::WriteOrThrow(fd, &m_textTime, sizeof(m_textTime));
+}
+
+void RuleTableReader::FinishDump()
+{
+  if (m_dumpOut.get() == -1) return;
+  // a chunk of size 0 marks the end
+  uint64_t end = 0;
+  util::WriteOrThrow(m_dumpOut.get(), &end, sizeof(end));
+  m_dumpOut.reset();
+  std::string tmp = m_dumpPath + ".tmp";
+  UTIL_THROW_IF2(std::rename(tmp.c_str(), m_dumpPath.c_str()),
+                 "Failed to rename " << tmp << " to " << m_dumpPath);
+  VERBOSE(1, "Wrote rule table dump " << m_dumpPath << std::endl);
+}
+
+void RuleTableReader::Report()
+{
+  IFVERBOSE(1) {
+    double seconds = m_timer.get_elapsed_time();
+    std::cerr << "Read " << m_numRules << " rules in " << seconds << " seconds";
+    if (seconds > 0) {
+      std::cerr << " (" << static_cast<uint64_t>(m_numRules / seconds) << " rules/s)";
+    }
+    std::cerr << std::endl;
+  }
+}
+
+// Reads the next block of lines or the next chunk of the dump.  Returns a
+// null pointer at the end.
+RuleTableReader::BatchPtr RuleTableReader::ReadBatch()
+{
+  BatchPtr batch(new Batch);
+  if (m_dumpIn.get() != -1) {
+    uint64_t size;
+    util::ReadOrThrow(m_dumpIn.get(), &size, sizeof(size));
+    if (!size) {
+      m_dumpProgress->Finished();
+      return BatchPtr();
+    }
+    batch->chunk.resize(size);
+    util::ReadOrThrow(m_dumpIn.get(), &batch->chunk[0], size);
+    *m_dumpProgress += sizeof(size) + size;
+    return batch;
+  }
+
+  batch->firstLine = m_nextLine;
+  batch->lines.reserve(BATCH_SIZE);
+  StringPiece line;
+  while (batch->lines.size() < BATCH_SIZE && m_text->ReadLineOrEOF(line)) {
+    batch->lines.push_back(line.as_string());
+  }
+  m_nextLine += batch->lines.size();
+  if (batch->lines.empty()) return BatchPtr();
+  return batch;
+}
+
+void RuleTableReader::ParseBatch(Batch &batch) const
+{
+  if (m_dumpIn.get() != -1) {
+    DecodeChunk(batch);
+    return;
+  }
+
+  double_conversion::StringToDoubleConverter converter(
+    double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf",
+    "nan");
+  boost::scoped_ptr<Encoder> encoder;
+  if (m_dumpOut.get() != -1) encoder.reset(new Encoder);
+
+  batch.rules.reserve(batch.lines.size());
+  for (std::size_t i = 0; i < batch.lines.size(); ++i) {
+    ParseLine(batch.lines[i], batch.firstLine + i, converter, encoder.get(),
+              batch);
+  }
+  if (encoder) encoder->Finish(batch.encoded);
+}
+
+void RuleTableReader::ParseLine(
+  const std::string &line, std::size_t lineNum,
+  const double_conversion::StringToDoubleConverter &converter,
+  Encoder *encoder, Batch &batch) const
+{
+  util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+  StringPiece sourcePhraseString(*pipes);
+  StringPiece targetPhraseString(*++pipes);
+  StringPiece scoreString(*++pipes);
+
+  StringPiece alignString;
+  if (++pipes) {
+    StringPiece temp(*pipes);
+    alignString = temp;
+  }
+
+  bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == std::string::npos);
+  if (isLHSEmpty && !m_options.unk.word_deletion_enabled) {
+    TRACE_ERR( m_ff.GetFilePath() << ":" << lineNum << ": pt entry contains empty target, skipping\n");
+    return;
+  }
+
+  std::vector<float> scoreVector;
+  for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
+    int processed;
+    float score = converter.StringToFloat(s->data(), s->length(), &processed);
+    UTIL_THROW_IF2(std::isnan(score), "Bad score " << *s << " on line " << lineNum);
+    scoreVector.push_back(FloorScore(TransformScore(score)));
+  }
+  const std::size_t numScoreComponents = m_ff.GetNumScoreComponents();
+  if (scoreVector.size() != numScoreComponents) {
+    UTIL_THROW2("Size of scoreVector != number (" << scoreVector.size() << "!="
+                << numScoreComponents << ") of score components on line " << lineNum);
+  }
+
+  // the batch owns the rule from here on, also if parsing fails
+  batch.rules.push_back(ParsedRule());
+  ParsedRule &rule = batch.rules.back();
+  rule.target = new TargetPhrase(&m_ff);
+  TargetPhrase &targetPhrase = *rule.target;
+
+  Word *targetLHS;
+  targetPhrase.CreateFromString(Output, m_output, targetPhraseString, &targetLHS);
+  rule.source.CreateFromString(Input, m_input, sourcePhraseString, &rule.sourceLHS);
+
+  targetPhrase.SetAlignmentInfo(alignString);
+  targetPhrase.SetTargetLHS(targetLHS);
+
+  ++pipes;  // skip over counts field.
+
+  StringPiece sparseString, propertiesString;
+  if (++pipes) {
+    sparseString = *pipes;
+    targetPhrase.SetSparseScore(&m_ff, sparseString);
+  }
+
+  if (++pipes) {
+    propertiesString = *pipes;
+    targetPhrase.SetProperties(propertiesString);
+  }
+
+  targetPhrase.GetScoreBreakdown().Assign(&m_ff, scoreVector);
+  targetPhrase.EvaluateInIsolation(rule.source, m_ff.GetFeaturesToApply());
+
+  if (encoder) {
+    encoder->PutWord(rule.sourceLHS);
+    encoder->PutPhrase(rule.source);
+    encoder->PutWord(&targetPhrase.GetTargetLHS());
+    encoder->PutPhrase(targetPhrase);
+    encoder->PutAlignment(targetPhrase.GetAlignTerm());
+    encoder->PutAlignment(targetPhrase.GetAlignNonTerm());
+    for (std::size_t i = 0; i < scoreVector.size(); ++i) {
+      encoder->Put(scoreVector[i]);
+    }
+    encoder->PutString(sparseString);
+    encoder->PutString(propertiesString);
+    encoder->AddRule();
+  }
+}
+
+// Builds the rules of a dump chunk.  This is the inverse of the encoding in
+// ParseLine; only the feature evaluation is repeated.
+void RuleTableReader::DecodeChunk(Batch &batch) const
+{
+  Decoder decoder(batch.chunk);
+  const std::size_t numScoreComponents = m_ff.GetNumScoreComponents();
+  std::vector<float> scoreVector(numScoreComponents);
+
+  batch.rules.reserve(decoder.NumRules());
+  for (uint32_t i = 0; i < decoder.NumRules(); ++i) {
+    batch.rules.push_back(ParsedRule());
+    ParsedRule &rule = batch.rules.back();
+    rule.target = new TargetPhrase(&m_ff);
+    TargetPhrase &targetPhrase = *rule.target;
+
+    Word sourceLHS;
+    if (decoder.GetWord(sourceLHS)) rule.sourceLHS = new Word(sourceLHS);
+    decoder.GetPhrase(rule.source);
+    Word targetLHS;
+    if (decoder.GetWord(targetLHS)) targetPhrase.SetTargetLHS(new Word(targetLHS));
+    decoder.GetPhrase(targetPhrase);
+
+    AlignmentInfo::CollType alignTerm, alignNonTerm;
+    decoder.GetAlignment(alignTerm);
+    decoder.GetAlignment(alignNonTerm);
+    targetPhrase.SetAlignTerm(alignTerm);
+    targetPhrase.SetAlignNonTerm(alignNonTerm);
+
+    for (std::size_t j = 0; j < numScoreComponents; ++j) {
+      scoreVector[j] = decoder.Get<float>();
+    }
+    StringPiece sparseString = decoder.GetString();
+    if (!sparseString.empty()) targetPhrase.SetSparseScore(&m_ff, sparseString);
+    StringPiece propertiesString = decoder.GetString();
+    targetPhrase.SetProperties(propertiesString);
+
+    targetPhrase.GetScoreBreakdown().Assign(&m_ff, scoreVector);
+    targetPhrase.EvaluateInIsolation(rule.source, m_ff.GetFeaturesToApply());
+  }
+  UTIL_THROW_IF2(!decoder.AtEnd(), "Trailing data in rule table dump chunk");
+}
+
+#ifdef WITH_THREADS
+void RuleTableReader::Stop()
+{
+  boost::mutex::scoped_lock lock(m_stopMutex);
+  m_stop = true;
+}
+
+bool RuleTableReader::Stopped() const
+{
+  boost::mutex::scoped_lock lock(m_stopMutex);
+  return m_stop;
+}
+
+void RuleTableReader::Read()
+{
+  while (!Stopped()) {
+    BatchPtr batch;
+    try {
+      batch = ReadBatch();
+    } catch (const std::exception &e) {
+      batch.reset(new Batch);
+      batch->error = e.what();
+    }
+    if (!batch) break;
+    m_ordered->Produce(batch);
+    m_work->Produce(batch);
+    if (!batch->error.empty()) break;
+  }
+  m_ordered->Produce(BatchPtr());
+  for (std::size_t i = 0; i < m_numThreads; ++i) {
+    m_work->Produce(BatchPtr());
+  }
+}
+
+void RuleTableReader::Parse()
+{
+  BatchPtr batch;
+  while (m_work->Consume(batch)) {
+    std::string error;
+    // after an error the batch is only marked done, which lets the reader
+    // and Next() reach the end markers
+    if (batch->error.empty() && !Stopped()) {
+      try {
+        ParseBatch(*batch);
+      } catch (const std::exception &e) {
+        error = e.what();
+        Stop();
+      }
+    }
+
+    boost::mutex::scoped_lock lock(batch->mutex);
+    if (batch->error.empty()) batch->error = error;
+    batch->done = true;
+    batch->cond.notify_all();
+  }
+}
+#endif
+
+}  // namespace Syntax
+}  // namespace Moses
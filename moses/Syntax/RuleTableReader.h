@@ -0,0 +1,166 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#include "util/pcqueue.hh"
+#endif
+
+#include "moses/Phrase.h"
+#include "moses/Timer.h"
+#include "moses/TypeDef.h"
+#include "util/ersatz_progress.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+
+namespace double_conversion
+{
+class StringToDoubleConverter;
+}
+
+namespace Moses
+{
+class AllOptions;
+class PhraseDictionary;
+class TargetPhrase;
+class Word;
+
+namespace Syntax
+{
+
+// A rule as read from a rule table, ready to be inserted into a trie.
+struct ParsedRule {
+  ParsedRule() : sourceLHS(NULL), target(NULL) {}
+
+  Phrase source;
+  Word *sourceLHS;
+  TargetPhrase *target;
+};
+
+/** Reads the rules of a Moses-format rule table (S2T and T2S rule tables,
+ * PhraseDictionaryMemory), in table order.
+ *
+ * With numThreads=N (the load-threads parameter of the table), a reader
+ * thread splits the table into blocks of lines and N parser threads build the
+ * rules (tokenizing, interning factors, scoring); the loading thread only
+ * inserts them.
+ *
+ * With binaryDump=FILE (binary-dump), the parsed rules are also written to FILE, and
+ * later loads read FILE instead of parsing the text table, provided it was
+ * written from the same table (same size and modification time) with the
+ * same factors and number of scores.  The dump holds the rules before
+ * pruning and before feature evaluation, so table-limit and the weights may
+ * change between runs.
+ */
+class RuleTableReader
+{
+public:
+  RuleTableReader(const AllOptions &opts,
+                  const std::vector<FactorType> &input,
+                  const std::vector<FactorType> &output,
+                  const std::string &path,
+                  const PhraseDictionary &ff,
+                  std::size_t numThreads,
+                  const std::string &binaryDump);
+
+  ~RuleTableReader();
+
+  // Next rule, or false at the end of the table.  The caller takes ownership
+  // of rule.sourceLHS and rule.target.
+  bool Next(ParsedRule &rule);
+
+private:
+  struct Batch {
+    Batch() : firstLine(0), done(false) {}
+    ~Batch();
+
+    // text lines or one chunk of the binary dump
+    std::vector<std::string> lines;
+    std::string chunk;
+    std::size_t firstLine;
+
+    std::vector<ParsedRule> rules;
+    // rules encoded for the binary dump
+    std::string encoded;
+
+    std::string error;
+    bool done;
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+    boost::condition_variable cond;
+#endif
+  };
+  typedef boost::shared_ptr<Batch> BatchPtr;
+
+  class Encoder;
+  class Decoder;
+
+  static const std::size_t BATCH_SIZE = 10000;
+
+  bool OpenDump(const std::string &path);
+  void StartDump(const std::string &path);
+  void FinishDump();
+  std::string DumpConfig() const;
+
+  BatchPtr ReadBatch();
+  void ParseBatch(Batch &batch) const;
+  void ParseLine(const std::string &line, std::size_t lineNum,
+                 const double_conversion::StringToDoubleConverter &converter,
+                 Encoder *encoder, Batch &batch) const;
+  void DecodeChunk(Batch &batch) const;
+
+  void Report();
+
+  const AllOptions &m_options;
+  const std::vector<FactorType> &m_input;
+  const std::vector<FactorType> &m_output;
+  const PhraseDictionary &m_ff;
+  std::size_t m_numThreads;
+
+  // stat of the text table; the time is -1 if it does not exist
+  uint64_t m_textSize;
+  int64_t m_textTime;
+
+  // input: the text table or a binary dump
+  boost::scoped_ptr<util::FilePiece> m_text;
+  util::scoped_fd m_dumpIn;
+  boost::scoped_ptr<util::ErsatzProgress> m_dumpProgress;
+  std::size_t m_nextLine;
+
+  // output: the binary dump being written, renamed into place at the end
+  util::scoped_fd m_dumpOut;
+  std::string m_dumpPath;
+
+  BatchPtr m_current;
+  std::size_t m_currentPos;
+  bool m_finished;
+
+  std::size_t m_numRules;
+  Timer m_timer;
+
+#ifdef WITH_THREADS
+  void Read();
+  void Parse();
+
+  // Tells the reader and parser threads to skip the rest of the table, e.g.
+  // after an error, so the destructor does not wait for the whole table.
+  void Stop();
+  bool Stopped() const;
+  bool m_stop;
+  mutable boost::mutex m_stopMutex;
+
+  // batches in table order, for Next(); a null batch marks the end
+  boost::scoped_ptr<util::PCQueue<BatchPtr> > m_ordered;
+  // the same batches, for the parser threads
+  boost::scoped_ptr<util::PCQueue<BatchPtr> > m_work;
+  boost::thread_group m_threads;
+#endif
+};
+
+}  // namespace Syntax
+}  // namespace Moses
@@ -0,0 +1,157 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "moses/Syntax/RuleTableFF.h"
+#include "moses/Syntax/RuleTableReader.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TempDir.h"
+#include "moses/Word.h"
+#include "moses/parameters/AllOptions.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace Moses::Syntax;
+
+namespace
+{
+
+void WriteTable(const std::string &path, std::size_t numRules, bool withError = false)
+{
+  std::ofstream out(path.c_str());
+  for (std::size_t i = 0; i < numRules; ++i) {
+    if (withError && i == 5) {
+      out << "der [NN][NP] [NP] ||| the [NN][NP] [NP] ||| 0.5" << std::endl;
+      continue;
+    }
+    out << "der w" << i << " [NN][NN] [NP] ||| the [NN][NN] v" << i
+        << " [NP] ||| 0.5 0." << (i % 9 + 1) << " ||| 0-0 2-1 ||| 1 1 1"
+        << " ||| sparse_" << (i % 3) << " 1 ||| {{Tree [NP the]}}" << std::endl;
+    out << "w" << i << " ||| v" << i << " [NN] ||| 0.25 1 ||| 0-0" << std::endl;
+  }
+}
+
+std::string Describe(const ParsedRule &rule, const RuleTableFF &ff)
+{
+  std::ostringstream out;
+  if (rule.sourceLHS) out << *rule.sourceLHS;
+  out << " | " << rule.source << " | ";
+  const TargetPhrase &target = *rule.target;
+  out << target.GetTargetLHS() << " | " << static_cast<const Phrase&>(target)
+      << " | " << target.GetAlignTerm() << " | " << target.GetAlignNonTerm()
+      << " |";
+  std::vector<float> scores = target.GetScoreBreakdown().GetScoresForProducer(&ff);
+  for (std::size_t i = 0; i < scores.size(); ++i) out << " " << scores[i];
+  out << " | ";
+  const PhraseProperty *property = target.GetProperty("Tree");
+  if (property) out << "Tree";
+  return out.str();
+}
+
+std::vector<std::string> ReadAll(const AllOptions &opts, const std::string &path, const RuleTableFF &ff)
+{
+  std::vector<FactorType> factors(1, 0);
+  RuleTableReader reader(opts, factors, factors, path, ff,
+                         ff.GetLoadThreads(), ff.GetBinaryDump());
+  std::vector<std::string> rules;
+  ParsedRule rule;
+  while (reader.Next(rule)) {
+    rules.push_back(Describe(rule, ff));
+    delete rule.sourceLHS;
+    delete rule.target;
+  }
+  return rules;
+}
+
+// Feature names must be unique.
+std::string TableLine(const std::string &path, std::size_t threads, const std::string &dump)
+{
+  static std::size_t count = 0;
+  std::string line = "RuleTable name=RuleTableReaderTest" + boost::lexical_cast<std::string>(count++)
+                     + " num-features=2 input-factor=0 output-factor=0 path=" + path
+                     + " load-threads=" + boost::lexical_cast<std::string>(threads);
+  if (!dump.empty()) line += " binary-dump=" + dump;
+  return line;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(rule_table_reader)
+
+BOOST_AUTO_TEST_CASE(dump_round_trip)
+{
+  TempDir dir("rule-table-reader");
+  const std::string text = dir.File("rule-table"), dump = dir.File("rule-table.dump");
+  WriteTable(text, 25000);
+  AllOptions opts;
+
+  RuleTableFF plain(TableLine(text, 0, ""));
+  std::vector<std::string> expected = ReadAll(opts, text, plain);
+  BOOST_REQUIRE_EQUAL(expected.size(), static_cast<std::size_t>(50000));
+
+  RuleTableFF dumping(TableLine(text, 2, dump));
+  std::vector<std::string> parsed = ReadAll(opts, text, dumping);
+  BOOST_CHECK(parsed == expected);
+  BOOST_REQUIRE(boost::filesystem::exists(dump));
+
+  // Without the text table, only the dump can supply the rules.
+  boost::filesystem::remove(text);
+  for (std::size_t threads = 0; threads <= 2; threads += 2) {
+    RuleTableFF loading(TableLine(text, threads, dump));
+    std::vector<std::string> loaded = ReadAll(opts, text, loading);
+    BOOST_CHECK(loaded == expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stale_dump_ignored)
+{
+  TempDir dir("rule-table-reader");
+  const std::string text = dir.File("rule-table"), dump = dir.File("rule-table.dump");
+  WriteTable(text, 10);
+  AllOptions opts;
+  RuleTableFF first(TableLine(text, 0, dump));
+  ReadAll(opts, text, first);
+
+  WriteTable(text, 20);
+  RuleTableFF second(TableLine(text, 0, dump));
+  BOOST_CHECK_EQUAL(ReadAll(opts, text, second).size(), static_cast<std::size_t>(40));
+}
+
+BOOST_AUTO_TEST_CASE(parse_error)
+{
+  TempDir dir("rule-table-reader");
+  const std::string text = dir.File("rule-table"), dump = dir.File("rule-table.dump");
+  WriteTable(text, 100000, true);
+  AllOptions opts;
+  for (std::size_t threads = 0; threads <= 4; threads += 4) {
+    RuleTableFF ff(TableLine(text, threads, dump));
+    BOOST_CHECK_THROW(ReadAll(opts, text, ff), util::Exception);
+    // an unfinished dump is not kept
+    BOOST_CHECK(!boost::filesystem::exists(dump));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "moses/Phrase.h"
+#include "moses/RecyclingAllocator.h"
 
 #include "SLabel.h"
 
@@ -14,6 +15,13 @@ namespace Syntax
 struct SVertex;
 
 struct SHyperedge {
+  static void *operator new(std::size_t size) {
+    return RecyclingAllocator::Allocate(size);
+  }
+  static void operator delete(void *ptr, std::size_t size) {
+    RecyclingAllocator::Free(ptr, size);
+  }
+
   SVertex *head;
   std::vector<SVertex*> tail;
   SLabel label;
@@ -2,6 +2,8 @@
 
 #include <vector>
 
+#include "moses/RecyclingAllocator.h"
+
 namespace Moses
 {
 
@@ -20,6 +22,13 @@ struct SHyperedge;
 struct SVertex {
   ~SVertex();
 
+  static void *operator new(std::size_t size) {
+    return RecyclingAllocator::Allocate(size);
+  }
+  static void operator delete(void *ptr, std::size_t size) {
+    RecyclingAllocator::Free(ptr, size);
+  }
+
   SHyperedge *best;
   std::vector<SHyperedge*> recombined;
   const PVertex *pvertex;
@@ -116,6 +116,11 @@ public:
     m_collection.clear();
   }
 
+  //! exchange entries with another collection without copying them
+  void Swap(TargetPhraseCollection &other) {
+    m_collection.swap(other.m_collection);
+  }
+
 };
 
 
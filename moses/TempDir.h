@@ -0,0 +1,67 @@
+// -*- c++ -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TempDir_h
+#define moses_TempDir_h
+
+#include <fstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+namespace Moses
+{
+
+/** A temporary directory for unit tests, removed with everything in it.
+ *  The name is prefix followed by a random suffix.
+ */
+class TempDir
+{
+public:
+  explicit TempDir(const std::string &prefix)
+    : m_path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(prefix + "-%%%%-%%%%")) {
+    boost::filesystem::create_directories(m_path);
+  }
+
+  ~TempDir() {
+    boost::system::error_code ignored;
+    boost::filesystem::remove_all(m_path, ignored);
+  }
+
+  //! path of a file in the directory
+  std::string File(const std::string &name) const {
+    return (m_path / name).string();
+  }
+
+  //! writes text to a file in the directory and returns its path
+  std::string Write(const std::string &name, const std::string &text) const {
+    const std::string path = File(name);
+    std::ofstream out(path.c_str());
+    out << text;
+    return path;
+  }
+
+private:
+  boost::filesystem::path m_path;
+};
+
+}
+
+#endif
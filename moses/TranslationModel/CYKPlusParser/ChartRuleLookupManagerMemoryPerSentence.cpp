@@ -176,10 +176,10 @@ void ChartRuleLookupManagerMemoryPerSentence::AddAndExtend(
 
   // get all further extensions of rule (until reaching end of sentence or max-chart-span)
   if (endPos < m_lastPos) {
-    if (!node->GetTerminalMap().empty()) {
+    if (node->GetNumTerminalChildren()) {
       GetTerminalExtension(node, endPos+1);
     }
-    if (!node->GetNonTerminalMap().empty()) {
+    if (node->GetNumNonTerminalChildren()) {
       GetNonTerminalExtension(node, endPos+1);
     }
   }
@@ -194,25 +194,11 @@ void ChartRuleLookupManagerMemoryPerSentence::GetTerminalExtension(
 {
 
   const Word &sourceWord = GetSourceAt(pos).GetLabel();
-  const PhraseDictionaryNodeMemory::TerminalMap & terminals = node->GetTerminalMap();
-
-  // if node has small number of terminal edges, test word equality for each.
-  if (terminals.size() < 5) {
-    for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator iter = terminals.begin(); iter != terminals.end(); ++iter) {
-      const Word & word = iter->first;
-      if (TerminalEqualityPred()(word, sourceWord)) {
-        const PhraseDictionaryNodeMemory *child = & iter->second;
-        AddAndExtend(child, pos);
-        break;
-      }
-    }
-  }
-  // else, do hash lookup
-  else {
-    const PhraseDictionaryNodeMemory *child = node->GetChild(sourceWord);
-    if (child != NULL) {
-      AddAndExtend(child, pos);
-    }
+
+  // binary search in the node's sorted terminal edges
+  const PhraseDictionaryNodeMemory *child = node->GetChild(sourceWord);
+  if (child != NULL) {
+    AddAndExtend(child, pos);
   }
 }
 
@@ -225,27 +211,20 @@ void ChartRuleLookupManagerMemoryPerSentence::GetNonTerminalExtension(
 
   const CompressedMatrix &compressedMatrix = m_compressedMatrixVec[startPos];
 
-  // non-terminal labels in phrase dictionary node
-  const PhraseDictionaryNodeMemory::NonTerminalMap & nonTermMap = node->GetNonTerminalMap();
-
   // make room for back pointer
   m_stackVec.push_back(NULL);
   m_stackScores.push_back(0);
 
   // loop over possible expansions of the rule
-  PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator p;
-  PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator end = nonTermMap.end();
-  for (p = nonTermMap.begin(); p != end; ++p) {
+  // (the non-terminal edges of the phrase dictionary node)
+  size_t numNonTerms = node->GetNumNonTerminalChildren();
+  for (size_t i = 0; i < numNonTerms; ++i) {
     // does it match possible source and target non-terminals?
-#if defined(UNLABELLED_SOURCE)
-    const Word &targetNonTerm = p->first;
-#else
-    const Word &targetNonTerm = p->first.second;
-#endif
-    const PhraseDictionaryNodeMemory *child = &p->second;
+    size_t targetNonTermId = node->GetTargetNonTerminalId(i);
+    const PhraseDictionaryNodeMemory *child = &node->GetNonTerminalChild(i);
     //soft matching of NTs
-    if (m_isSoftMatching && !m_softMatchingMap[targetNonTerm[0]->GetId()].empty()) {
-      const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTerm[0]->GetId()];
+    if (m_isSoftMatching && !m_softMatchingMap[targetNonTermId].empty()) {
+      const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTermId];
       for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
         const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
         for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
@@ -256,7 +235,7 @@ void ChartRuleLookupManagerMemoryPerSentence::GetNonTerminalExtension(
       }
     } // end of soft matches lookup
 
-    const CompressedColumn &matches = compressedMatrix[targetNonTerm[0]->GetId()];
+    const CompressedColumn &matches = compressedMatrix[targetNonTermId];
     for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
       m_stackVec.back() = match->cellLabel;
       m_stackScores.back() = match->score;
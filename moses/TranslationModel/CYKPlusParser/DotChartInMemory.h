@@ -100,7 +100,7 @@ public:
     UTIL_THROW_IF2(dottedRule == NULL, "Dotted rule is null");
     m_coll[pos].push_back(dottedRule);
     if (!dottedRule->GetLastNode().IsLeaf()) {
-      if (dottedRule->GetLastNode().GetNonTerminalMap().empty() && !dottedRule->IsRoot()) {
+      if (dottedRule->GetLastNode().GetNumNonTerminalChildren() == 0 && !dottedRule->IsRoot()) {
         size_t startPos = dottedRule->GetWordsRange().GetEndPos() + 1;
         m_expandableDottedRuleListTerminalsOnly[startPos].push_back(dottedRule);
       } else {
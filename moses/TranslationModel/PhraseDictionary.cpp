@@ -27,6 +27,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/DecodeStep.h"
 #include "moses/DecodeGraph.h"
 #include "moses/InputPath.h"
+#include "moses/Profiler.h"
 #include "util/exception.hh"
 
 using namespace std;
@@ -42,6 +43,7 @@ PhraseDictionary::PhraseDictionary(const std::string &line, bool registerNow)
 {
   m_id = s_staticColl.size();
   s_staticColl.push_back(this);
+  m_profileLookupId = Profiler::Register("Lookup", GetScoreProducerDescription());
 }
 
 bool
@@ -124,6 +124,10 @@ public:
     GetTargetPhraseCollectionBatch(inputPathQueue);
   }
 
+  size_t GetProfileLookupId() const {
+    return m_profileLookupId;
+  }
+
   //! Create entry for translation of source to targetPhrase
   virtual void InitializeForInput(ttasksptr const& ttask) {
   }
@@ -170,6 +174,7 @@ protected:
 
   // cache
   size_t m_maxCacheSize; // 0 = no caching
+  size_t m_profileLookupId; // Profiler counter for phrase lookup
 
 #ifdef WITH_THREADS
   //reader-writer lock
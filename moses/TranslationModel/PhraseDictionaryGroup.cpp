@@ -22,6 +22,8 @@
 #include <boost/foreach.hpp>
 #include <boost/unordered_map.hpp>
 
+#include "moses/TranslationTask.h"
+
 #include "util/exception.hh"
 
 using namespace std;
@@ -87,6 +89,7 @@ void PhraseDictionaryGroup::Load(AllOptions::ptr const& opts)
       if (pd->GetScoreProducerDescription() == pdName) {
         pdFound = true;
         m_memberPDs.push_back(pd);
+        m_memberPDFeatures.push_back(vector<FeatureFunction*>(1, pd));
         size_t nScores = pd->GetNumScoreComponents();
         numScoreComponents += nScores;
         if (m_scoresPerModel == 0) {
@@ -110,6 +113,8 @@ void PhraseDictionaryGroup::Load(AllOptions::ptr const& opts)
     numScoreComponents += m_numModels;
   }
   if (m_modelBitmapCounts) {
+    UTIL_THROW_IF2(m_numModels > 8 * sizeof(unsigned long),
+                   m_description << ": too many member models for model-bitmap-counts");
     numScoreComponents += (pow(2, m_numModels) - 1);
   }
   UTIL_THROW_IF2(numScoreComponents != m_numScoreComponents,
@@ -153,10 +158,11 @@ void PhraseDictionaryGroup::GetTargetPhraseCollectionBatch(
     }
   }
   // Look up each input in each model
+  SPTR<TaskCache> cache = ttask->GetScope()->get<TaskCache>(this, true);
   BOOST_FOREACH(InputPath* inputPath, inputPathQueue) {
     const Phrase &phrase = inputPath->GetPhrase();
     TargetPhraseCollection::shared_ptr  targetPhrases =
-      this->GetTargetPhraseCollectionLEGACY(ttask, phrase);
+      GetTargetPhraseCollection(ttask, cache.get(), phrase);
     inputPath->SetTargetPhrases(*this, targetPhrases, NULL);
   }
 }
@@ -171,10 +177,21 @@ TargetPhraseCollection::shared_ptr
 PhraseDictionaryGroup::
 GetTargetPhraseCollectionLEGACY(const ttasksptr& ttask, const Phrase& src) const
 {
-  TargetPhraseCollection::shared_ptr ret
-  = CreateTargetPhraseCollection(ttask, src);
+  SPTR<TaskCache> cache = ttask->GetScope()->get<TaskCache>(this, true);
+  return GetTargetPhraseCollection(ttask, cache.get(), src);
+}
+
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryGroup::
+GetTargetPhraseCollection(const ttasksptr& ttask, TaskCache* cache,
+                          const Phrase& src) const
+{
+  TargetPhraseCollection::shared_ptr ret = cache->Find(src);
+  if (ret) return ret;
+
+  ret = CreateTargetPhraseCollection(ttask, src);
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryGroup*>(this)->CacheForCleanup(ret);
+  cache->Insert(src, ret);
   return ret;
 }
 
@@ -182,10 +199,28 @@ TargetPhraseCollection::shared_ptr
 PhraseDictionaryGroup::
 CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
 {
-  // Aggregation of phrases and corresponding statistics (scores, models seen by)
+  // Look up all models first so that the statistics are allocated once
+  vector<TargetPhraseCollection::shared_ptr> collections(m_numModels);
+  size_t total = 0;
+  for (size_t i = 0; i < m_numModels; ++i) {
+    collections[i] = m_memberPDs[i]->GetTargetPhraseCollectionLEGACY(ttask, src);
+    if (collections[i] != NULL) {
+      total += collections[i]->GetSize();
+    }
+  }
+
+  // Aggregation of phrases and corresponding statistics.  Phrase k has
+  // scores [k * m_numScoreComponents, (k + 1) * m_numScoreComponents) and
+  // was seen by model i if bit k * m_numModels + i of seen is set.
   vector<TargetPhrase*> phraseList;
-  typedef unordered_map<const TargetPhrase*, PDGroupPhrase, UnorderedComparer<Phrase>, UnorderedComparer<Phrase> > PhraseMap;
+  phraseList.reserve(total);
+  vector<float> scores;
+  scores.reserve(total * m_numScoreComponents);
+  dynamic_bitset<> seen;
+  seen.reserve(total * m_numModels);
+  typedef unordered_map<const TargetPhrase*, size_t, UnorderedComparer<Phrase>, UnorderedComparer<Phrase> > PhraseMap;
   PhraseMap phraseMap;
+  phraseMap.rehash(total);
 
   // For each model
   size_t offset = 0;
@@ -193,14 +228,12 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
 
     // Collect phrases from this table
     const PhraseDictionary& pd = *m_memberPDs[i];
-    TargetPhraseCollection::shared_ptr
-    ret_raw = pd.GetTargetPhraseCollectionLEGACY(ttask, src);
+    const size_t scoreIndex = pd.GetIndex();
 
-    if (ret_raw != NULL) {
+    if (collections[i] != NULL) {
       // Process each phrase from table
-      BOOST_FOREACH(const TargetPhrase* targetPhrase, *ret_raw) {
-        vector<float> raw_scores =
-          targetPhrase->GetScoreBreakdown().GetScoresForProducer(&pd);
+      BOOST_FOREACH(const TargetPhrase* targetPhrase, *collections[i]) {
+        size_t k;
 
         // Phrase not in collection -> add if unrestricted or first model
         PhraseMap::iterator iter = phraseMap.find(targetPhrase);
@@ -213,32 +246,33 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
           TargetPhrase* phrase = new TargetPhrase(*targetPhrase);
           // Correct future cost estimates and total score
           phrase->GetScoreBreakdown().InvertDenseFeatures(&pd);
-          vector<FeatureFunction*> pd_feature;
-          pd_feature.push_back(m_memberPDs[i]);
-          const vector<FeatureFunction*> pd_feature_const(pd_feature);
-          phrase->EvaluateInIsolation(src, pd_feature_const);
+          phrase->EvaluateInIsolation(src, m_memberPDFeatures[i]);
           // Zero out scores from original phrase table
           phrase->GetScoreBreakdown().ZeroDenseFeatures(&pd);
           // Add phrase entry
+          k = phraseList.size();
           phraseList.push_back(phrase);
-          phraseMap[targetPhrase] = PDGroupPhrase(phrase, m_defaultScores, m_numModels);
+          phraseMap[phrase] = k;
+          scores.insert(scores.end(), m_defaultScores.begin(), m_defaultScores.end());
+          seen.resize(seen.size() + m_numModels);
         } else {
           // For existing phrases: merge extra scores (such as lr-func scores for mmsapt)
-          TargetPhrase* phrase = iter->second.m_targetPhrase;
+          k = iter->second;
+          TargetPhrase* phrase = phraseList[k];
           BOOST_FOREACH(const TargetPhrase::ScoreCache_t::value_type pair, targetPhrase->GetExtraScores()) {
             phrase->SetExtraScores(pair.first, pair.second);
           }
         }
-        // Don't repeat lookup if phrase already found
-        PDGroupPhrase& pdgPhrase = (iter == phraseMap.end()) ? phraseMap.find(targetPhrase)->second : iter->second;
 
         // Copy scores from this model
+        const FVector& raw_scores = targetPhrase->GetScoreBreakdown().GetScoresVector();
+        float* phraseScores = &scores[k * m_numScoreComponents];
         for (size_t j = 0; j < pd.GetNumScoreComponents(); ++j) {
-          pdgPhrase.m_scores[offset + j] = raw_scores[j];
+          phraseScores[offset + j] = raw_scores[scoreIndex + j];
         }
 
         // Phrase seen by this model
-        pdgPhrase.m_seenBy[i] = true;
+        seen[k * m_numModels + i] = true;
       }
     }
     offset += pd.GetNumScoreComponents();
@@ -246,9 +280,11 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
 
   // Compute additional scores as phrases are added to return collection
   TargetPhraseCollection::shared_ptr ret(new TargetPhraseCollection);
-  const vector<FeatureFunction*> pd_feature_const(m_pdFeature);
-  BOOST_FOREACH(TargetPhrase* phrase, phraseList) {
-    PDGroupPhrase& pdgPhrase = phraseMap.find(phrase)->second;
+  vector<float> phraseScoreVector;
+  for (size_t k = 0; k < phraseList.size(); ++k) {
+    TargetPhrase* phrase = phraseList[k];
+    float* phraseScores = &scores[k * m_numScoreComponents];
+    const size_t seenOffset = k * m_numModels;
 
     // Score order (example with 2 models)
     // member1_scores member2_scores [m1_pc m2_pc] [m1_wc m2_wc]
@@ -258,18 +294,18 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
     // Phrase count (per member model)
     if (m_phraseCounts) {
       for (size_t i = 0; i < m_numModels; ++i) {
-        if (pdgPhrase.m_seenBy[i]) {
-          pdgPhrase.m_scores[offset + i] = 1;
+        if (seen[seenOffset + i]) {
+          phraseScores[offset + i] = 1;
         }
       }
       offset += m_numModels;
     }
     // Word count (per member model)
     if (m_wordCounts) {
-      size_t wc = pdgPhrase.m_targetPhrase->GetSize();
+      size_t wc = phrase->GetSize();
       for (size_t i = 0; i < m_numModels; ++i) {
-        if (pdgPhrase.m_seenBy[i]) {
-          pdgPhrase.m_scores[offset + i] = wc;
+        if (seen[seenOffset + i]) {
+          phraseScores[offset + i] = wc;
         }
       }
       offset += m_numModels;
@@ -278,8 +314,14 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
     // Model bitmap features (one feature per possible bitmap)
     // e.g. seen by models 1 and 3 but not 2 -> "101" fires
     if (m_modelBitmapCounts) {
-      // Throws exception if someone tries to combine more than 64 models
-      pdgPhrase.m_scores[offset + (pdgPhrase.m_seenBy.to_ulong() - 1)] = 1;
+      // Load() refuses more models than the bits of an unsigned long
+      unsigned long bitmap = 0;
+      for (size_t i = 0; i < m_numModels; ++i) {
+        if (seen[seenOffset + i]) {
+          bitmap |= 1UL << i;
+        }
+      }
+      phraseScores[offset + (bitmap - 1)] = 1;
       offset += m_seenByAll.to_ulong();
     }
 
@@ -287,15 +329,19 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
     // this phrase
     if (m_defaultAverageOthers) {
       // Average seen scores
-      if (pdgPhrase.m_seenBy != m_seenByAll) {
+      size_t seenByCount = 0;
+      for (size_t i = 0; i < m_numModels; ++i) {
+        seenByCount += seen[seenOffset + i];
+      }
+      if (seenByCount != m_numModels) {
         vector<float> avgScores(m_scoresPerModel, 0);
         size_t seenBy = 0;
         offset = 0;
         // sum
         for (size_t i = 0; i < m_numModels; ++i) {
-          if (pdgPhrase.m_seenBy[i]) {
+          if (seen[seenOffset + i]) {
             for (size_t j = 0; j < m_scoresPerModel; ++j) {
-              avgScores[j] += pdgPhrase.m_scores[offset + j];
+              avgScores[j] += phraseScores[offset + j];
             }
             seenBy += 1;
           }
@@ -308,9 +354,9 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
         // copy
         offset = 0;
         for (size_t i = 0; i < m_numModels; ++i) {
-          if (!pdgPhrase.m_seenBy[i]) {
+          if (!seen[seenOffset + i]) {
             for (size_t j = 0; j < m_scoresPerModel; ++j) {
-              pdgPhrase.m_scores[offset + j] = avgScores[j];
+              phraseScores[offset + j] = avgScores[j];
             }
           }
           offset += m_scoresPerModel;
@@ -325,8 +371,8 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
           for (size_t i = 0; i < m_numModels; ++i) {
             const LexicalReordering* lrFunc = *m_mmsaptLrFuncs[i];
             // Add if phrase seen and model has lr-func
-            if (pdgPhrase.m_seenBy[i] && lrFunc != NULL) {
-              const Scores* scores = pdgPhrase.m_targetPhrase->GetExtraScores(lrFunc);
+            if (seen[seenOffset + i] && lrFunc != NULL) {
+              const Scores* scores = phrase->GetExtraScores(lrFunc);
               if (!avgLRScores) {
                 avgLRScores.reset(new Scores(*scores));
               } else {
@@ -346,8 +392,8 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
             // set
             for (size_t i = 0; i < m_numModels; ++i) {
               const LexicalReordering* lrFunc = *m_mmsaptLrFuncs[i];
-              if (!pdgPhrase.m_seenBy[i] && lrFunc != NULL) {
-                pdgPhrase.m_targetPhrase->SetExtraScores(lrFunc, avgLRScores);
+              if (!seen[seenOffset + i] && lrFunc != NULL) {
+                phrase->SetExtraScores(lrFunc, avgLRScores);
               }
             }
           }
@@ -357,9 +403,10 @@ CreateTargetPhraseCollection(const ttasksptr& ttask, const Phrase& src) const
     }
 
     // Assign scores
-    phrase->GetScoreBreakdown().Assign(this, pdgPhrase.m_scores);
+    phraseScoreVector.assign(phraseScores, phraseScores + m_numScoreComponents);
+    phrase->GetScoreBreakdown().Assign(this, phraseScoreVector);
     // Correct future cost estimates and total score
-    phrase->EvaluateInIsolation(src, pd_feature_const);
+    phrase->EvaluateInIsolation(src, m_pdFeature);
     ret->Add(phrase);
   }
 
@@ -374,21 +421,36 @@ CreateRuleLookupManager(const ChartParser &,
   UTIL_THROW(util::Exception, "Phrase table used in chart decoder");
 }
 
-//copied from PhraseDictionaryCompact; free memory allocated to TargetPhraseCollection (and each TargetPhrase) at end of sentence
-void PhraseDictionaryGroup::CacheForCleanup(TargetPhraseCollection::shared_ptr  tpc)
-{
-  PhraseCache &ref = GetPhraseCache();
-  ref.push_back(tpc);
-}
-
 void
 PhraseDictionaryGroup::
 CleanUpAfterSentenceProcessing(const InputType &source)
 {
-  GetPhraseCache().clear();
   CleanUpComponentModels(source);
 }
 
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryGroup::TaskCache::
+Find(const Phrase& src) const
+{
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  boost::unordered_map<Phrase, TargetPhraseCollection::shared_ptr>::const_iterator
+  iter = m_collections.find(src);
+  if (iter == m_collections.end()) return TargetPhraseCollection::shared_ptr();
+  return iter->second;
+}
+
+void
+PhraseDictionaryGroup::TaskCache::
+Insert(const Phrase& src, const TargetPhraseCollection::shared_ptr& tpc)
+{
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  m_collections[src] = tpc;
+}
+
 void PhraseDictionaryGroup::CleanUpComponentModels(const InputType &source)
 {
   for (size_t i = 0; i < m_numModels; ++i) {
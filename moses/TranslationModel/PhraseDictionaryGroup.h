@@ -39,19 +39,6 @@
 namespace Moses
 {
 
-struct PDGroupPhrase {
-  TargetPhrase* m_targetPhrase;
-  std::vector<float> m_scores;
-  boost::dynamic_bitset<> m_seenBy;
-
-  PDGroupPhrase() : m_targetPhrase(NULL) { }
-
-  PDGroupPhrase(TargetPhrase* targetPhrase, const std::vector<float>& scores, const size_t nModels)
-    : m_targetPhrase(targetPhrase),
-      m_scores(scores),
-      m_seenBy(nModels) { }
-};
-
 /** Combines multiple phrase tables into a single interface.  Each member phrase
  * table scores each phrase and a single set of translations/scores is returned.
  * If a phrase is not in one of the tables, its scores are zero-filled unless
@@ -69,7 +56,6 @@ public:
                                const Phrase& src) const;
   std::vector<std::vector<float> > getWeights(size_t numWeights,
       bool normalize) const;
-  void CacheForCleanup(TargetPhraseCollection::shared_ptr  tpc);
   void CleanUpAfterSentenceProcessing(const InputType& source);
   void CleanUpComponentModels(const InputType& source);
   // functions below override the base class
@@ -88,6 +74,8 @@ protected:
   std::vector<std::string> m_memberPDStrs;
   std::vector<PhraseDictionary*> m_memberPDs;
   std::vector<FeatureFunction*> m_pdFeature;
+  // features to re-evaluate when phrases of member i are copied
+  std::vector<std::vector<FeatureFunction*> > m_memberPDFeatures;
   size_t m_numModels;
   size_t m_totalModelScores;
   boost::dynamic_bitset<> m_seenByAll;
@@ -110,31 +98,21 @@ protected:
   // pointers to pointers since member mmsapts may not load these until later
   std::vector<LexicalReordering**> m_mmsaptLrFuncs;
 
-  typedef std::vector<TargetPhraseCollection::shared_ptr > PhraseCache;
+  // Combined collections by source phrase, kept in the task's ContextScope
+  // under this table's address.  Tasks may share a scope, hence the lock.
+  class TaskCache
+  {
+    boost::unordered_map<Phrase, TargetPhraseCollection::shared_ptr> m_collections;
 #ifdef WITH_THREADS
-  boost::shared_mutex m_lock_cache;
-  typedef std::map<boost::thread::id, PhraseCache> SentenceCache;
-#else
-  typedef PhraseCache SentenceCache;
+    mutable boost::shared_mutex m_lock;
 #endif
-  SentenceCache m_sentenceCache;
+  public:
+    TargetPhraseCollection::shared_ptr Find(const Phrase& src) const;
+    void Insert(const Phrase& src, const TargetPhraseCollection::shared_ptr& tpc);
+  };
 
-  PhraseCache& GetPhraseCache() {
-#ifdef WITH_THREADS
-    {
-      // first try read-only lock
-      boost::shared_lock<boost::shared_mutex> read_lock(m_lock_cache);
-      SentenceCache::iterator i = m_sentenceCache.find(
-        boost::this_thread::get_id());
-      if (i != m_sentenceCache.end())
-        return i->second;
-    }
-    boost::unique_lock<boost::shared_mutex> lock(m_lock_cache);
-    return m_sentenceCache[boost::this_thread::get_id()];
-#else
-    return m_sentenceCache;
-#endif
-  }
+  TargetPhraseCollection::shared_ptr GetTargetPhraseCollection(
+    const ttasksptr& ttask, TaskCache* cache, const Phrase& src) const;
 };
 
 } // end namespace
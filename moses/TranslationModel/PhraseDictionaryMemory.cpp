@@ -137,6 +137,7 @@ void PhraseDictionaryMemory::SortAndPrune()
   if (GetTableLimit()) {
     m_collection.Sort(GetTableLimit());
   }
+  m_collection.Freeze();
 }
 
 void
@@ -183,22 +184,20 @@ TO_STRING_BODY(PhraseDictionaryMemory);
 // friend
 ostream& operator<<(ostream& out, const PhraseDictionaryMemory& phraseDict)
 {
-  typedef PhraseDictionaryNodeMemory::TerminalMap TermMap;
-  typedef PhraseDictionaryNodeMemory::NonTerminalMap NonTermMap;
-
+  // the frozen trie only keeps the factor IDs of the first level
   const PhraseDictionaryNodeMemory &coll = phraseDict.m_collection;
-  for (NonTermMap::const_iterator p = coll.m_nonTermMap.begin(); p != coll.m_nonTermMap.end(); ++p) {
+  if (!coll.IsFrozen()) {
+    return out;
+  }
+  for (size_t i = 0; i < coll.GetNumNonTerminalChildren(); ++i) {
 #if defined(UNLABELLED_SOURCE)
-    const Word &targetNonTerm = p->first;
-    out << targetNonTerm;
+    out << coll.GetTargetNonTerminalId(i) << " ";
 #else
-    const Word &sourceNonTerm = p->first.first;
-    out << sourceNonTerm;
+    out << coll.GetSourceNonTerminalId(i) << " ";
 #endif
   }
-  for (TermMap::const_iterator p = coll.m_sourceTermMap.begin(); p != coll.m_sourceTermMap.end(); ++p) {
-    const Word &sourceTerm = p->first;
-    out << sourceTerm;
+  for (size_t i = 0; i < coll.GetNumTerminalChildren(); ++i) {
+    out << coll.GetTerminalId(i, phraseDict.GetInput()[0]) << " ";
   }
   return out;
 }
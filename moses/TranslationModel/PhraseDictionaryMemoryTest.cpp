@@ -0,0 +1,126 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "PhraseDictionaryMemory.h"
+#include "RuleTable/LoaderStandard.h"
+#include "moses/FactorCollection.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TempDir.h"
+#include "moses/parameters/AllOptions.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+void WriteTable(const string &path, size_t numRules)
+{
+  ofstream out(path.c_str());
+  for (size_t i = 0; i < numRules; ++i) {
+    out << "der w" << i << " [X][X] [X] ||| the [X][X] v" << i
+        << " [X] ||| 0.5 0." << (i % 9 + 1) << " ||| 0-0 2-1 ||| 1 1 1" << endl;
+    out << "w" << i << " [X] ||| v" << i << " [X] ||| 0.25 1 ||| 0-0" << endl;
+    out << "w" << (i % 7) << " [X] ||| u" << i << " [X] ||| 0." << (i % 9 + 1) << " 1 ||| 0-0" << endl;
+  }
+}
+
+// Feature names must be unique.
+string TableLine(const string &path, size_t threads, const string &dump)
+{
+  static size_t count = 0;
+  string line = "PhraseDictionaryMemory name=PhraseDictionaryMemoryTest" + boost::lexical_cast<string>(count++)
+                + " num-features=2 input-factor=0 output-factor=0 table-limit=3 path=" + path
+                + " load-threads=" + boost::lexical_cast<string>(threads);
+  if (!dump.empty()) line += " binary-dump=" + dump;
+  return line;
+}
+
+// every rule of the trie below node, with its source path (as factor IDs)
+// and scores
+void Describe(const PhraseDictionaryMemory &table, const PhraseDictionaryNodeMemory &node,
+              const string &path, ostringstream &out)
+{
+  const TargetPhraseCollection &collection = *node.GetTargetPhraseCollection();
+  for (TargetPhraseCollection::const_iterator p = collection.begin(); p != collection.end(); ++p) {
+    out << path << " ->" << static_cast<const Phrase&>(**p) << "|";
+    vector<float> scores = (*p)->GetScoreBreakdown().GetScoresForProducer(&table);
+    for (size_t i = 0; i < scores.size(); ++i) out << " " << scores[i];
+    out << "\n";
+  }
+  for (size_t i = 0; i < node.GetNumTerminalChildren(); ++i) {
+    Describe(table, node.GetTerminalChild(i), path + " " + boost::lexical_cast<string>(node.GetTerminalId(i, 0)), out);
+  }
+  for (size_t i = 0; i < node.GetNumNonTerminalChildren(); ++i) {
+    Describe(table, node.GetNonTerminalChild(i), path + " " + boost::lexical_cast<string>(node.GetTargetNonTerminalId(i)), out);
+  }
+}
+
+// Loads the table without PhraseDictionary::Load(), which would look at the
+// features of the other tests.
+string Load(const string &line)
+{
+  PhraseDictionaryMemory table(line);
+  AllOptions opts;
+  RuleTableLoaderStandard loader;
+  BOOST_REQUIRE(loader.Load(opts, table.GetInput(), table.GetOutput(), table.GetFilePath(),
+                            table.GetTableLimit(), table));
+  ostringstream out;
+  Describe(table, table.GetRootNode(), "", out);
+  return out.str();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(phrase_dictionary_memory)
+
+BOOST_AUTO_TEST_CASE(binary_dump_round_trip)
+{
+  TempDir dir("phrase-dictionary-memory");
+  const string text = dir.File("rule-table"), dump = dir.File("rule-table.dump");
+  WriteTable(text, 5000);
+
+  const string expected = Load(TableLine(text, 0, ""));
+  const string w3 = boost::lexical_cast<string>(FactorCollection::Instance().GetFactor("w3")->GetId());
+  BOOST_CHECK(expected.find("\n " + w3 + " ->v3 | -1.38629 0\n") != string::npos);
+
+  BOOST_CHECK_EQUAL(Load(TableLine(text, 2, dump)), expected);
+  BOOST_REQUIRE(boost::filesystem::exists(dump));
+
+  // loaded from the dump
+  BOOST_CHECK_EQUAL(Load(TableLine(text, 0, dump)), expected);
+  BOOST_CHECK_EQUAL(Load(TableLine(text, 2, dump)), expected);
+
+  // a dump of another table is ignored and rewritten
+  WriteTable(text, 10);
+  const string changed = Load(TableLine(text, 0, ""));
+  BOOST_CHECK(changed != expected);
+  BOOST_CHECK_EQUAL(Load(TableLine(text, 0, dump)), changed);
+  BOOST_CHECK_EQUAL(Load(TableLine(text, 2, dump)), changed);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
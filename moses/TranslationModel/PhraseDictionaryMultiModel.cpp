@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/string_stream.hh"
 
 #include "moses/TranslationModel/PhraseDictionaryMultiModel.h"
+#include "moses/TranslationTask.h"
+
+#include <boost/foreach.hpp>
 
 using namespace std;
 
@@ -27,6 +30,82 @@ namespace Moses
 
 {
 
+MultiModelStatistics::
+MultiModelStatistics(const std::vector<FactorType> &output,
+                     size_t numScoreComponents, size_t numModels)
+  : m_output(output)
+  , m_numModels(numModels)
+  , m_stride(numScoreComponents * numModels)
+{ }
+
+MultiModelStatistics::
+~MultiModelStatistics()
+{
+  RemoveAllInColl(m_phrases);
+}
+
+void
+MultiModelStatistics::
+Reserve(size_t phrases)
+{
+  m_phrases.reserve(phrases);
+  m_probabilities.reserve(phrases * m_stride);
+  m_index.rehash(phrases);
+}
+
+size_t
+MultiModelStatistics::
+Hash(const Phrase &phrase) const
+{
+  size_t seed = phrase.GetSize();
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    const Word &word = phrase.GetWord(pos);
+    for (size_t f = 0; f < m_output.size(); ++f) {
+      const Factor *factor = word.GetFactor(m_output[f]);
+      boost::hash_combine(seed, factor ? factor->GetId() + 1 : 0);
+    }
+  }
+  return seed;
+}
+
+bool
+MultiModelStatistics::
+SameOutput(const Phrase &a, const Phrase &b) const
+{
+  if (a.GetSize() != b.GetSize()) return false;
+  for (size_t pos = 0; pos < a.GetSize(); ++pos) {
+    for (size_t f = 0; f < m_output.size(); ++f) {
+      // factors are unique per string, so pointers compare their IDs
+      if (a.GetWord(pos).GetFactor(m_output[f]) != b.GetWord(pos).GetFactor(m_output[f]))
+        return false;
+    }
+  }
+  return true;
+}
+
+size_t
+MultiModelStatistics::
+Find(const Phrase &phrase, size_t hash) const
+{
+  typedef boost::unordered_multimap<size_t, size_t>::const_iterator Iter;
+  std::pair<Iter, Iter> range = m_index.equal_range(hash);
+  for (Iter i = range.first; i != range.second; ++i) {
+    if (SameOutput(*m_phrases[i->second], phrase)) return i->second;
+  }
+  return m_phrases.size();
+}
+
+size_t
+MultiModelStatistics::
+Add(TargetPhrase *phrase, size_t hash)
+{
+  size_t index = m_phrases.size();
+  m_phrases.push_back(phrase);
+  m_probabilities.resize(m_probabilities.size() + m_stride, 0.0);
+  m_index.insert(std::make_pair(hash, index));
+  return index;
+}
+
 PhraseDictionaryMultiModel::
 PhraseDictionaryMultiModel(const std::string &line)
   : PhraseDictionary(line, true)
@@ -91,7 +170,9 @@ void PhraseDictionaryMultiModel::Load(AllOptions::ptr const& opts)
     UTIL_THROW_IF2(pt == NULL,
                    "Could not find component phrase table " << ptName);
     m_pd.push_back(pt);
+    m_pdFeatures.push_back(std::vector<FeatureFunction*>(1, pt));
   }
+  m_pdFeature.push_back(this);
 }
 
 TargetPhraseCollection::shared_ptr
@@ -103,71 +184,100 @@ GetTargetPhraseCollectionLEGACY(const Phrase& src) const
   multimodelweights = getWeights(m_numScoreComponents, true);
   TargetPhraseCollection::shared_ptr ret;
 
-  std::map<std::string, multiModelStats*>* allStats;
-  allStats = new(std::map<std::string,multiModelStats*>);
+  MultiModelStatistics allStats(m_output, m_numScoreComponents, m_numModels);
   CollectSufficientStatistics(src, allStats);
   ret = CreateTargetPhraseCollectionLinearInterpolation(src, allStats, multimodelweights);
-  RemoveAllInMap(*allStats);
-  delete allStats; // ??? Why the detour through malloc? UG
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
-  const_cast<PhraseDictionaryMultiModel*>(this)->CacheForCleanup(ret);
-
   return ret;
 }
 
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMultiModel::
+GetTargetPhraseCollectionLEGACY(ttasksptr const& ttask, const Phrase& src) const
+{
+  SPTR<TaskCache> cache = ttask->GetScope()->get<TaskCache>(this, true);
+  return GetTargetPhraseCollection(cache.get(), src);
+}
+
 void
 PhraseDictionaryMultiModel::
-CollectSufficientStatistics
-(const Phrase& src, std::map<std::string, multiModelStats*>* allStats) const
+GetTargetPhraseCollectionBatch(ttasksptr const& ttask,
+                               InputPathList const& inputPathQueue) const
 {
-  for(size_t i = 0; i < m_numModels; ++i) {
-    const PhraseDictionary &pd = *m_pd[i];
+  SPTR<TaskCache> cache = ttask->GetScope()->get<TaskCache>(this, true);
+  BOOST_FOREACH(InputPath* inputPath, inputPathQueue) {
+    const Phrase &phrase = inputPath->GetPhrase();
+    TargetPhraseCollection::shared_ptr targetPhrases
+    = GetTargetPhraseCollection(cache.get(), phrase);
+    inputPath->SetTargetPhrases(*this, targetPhrases, NULL);
+  }
+}
 
-    TargetPhraseCollection::shared_ptr ret_raw;
-    ret_raw = pd.GetTargetPhraseCollectionLEGACY(src);
-    if (ret_raw != NULL) {
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMultiModel::
+GetTargetPhraseCollection(TaskCache *cache, const Phrase& src) const
+{
+  // weights sent with a request hold for that request only; the scope,
+  // and with it the cache, may be shared by other requests
+  const std::vector<float> *weights = GetTemporaryMultiModelWeightsVector();
+  if (weights && weights->size()) return GetTargetPhraseCollectionLEGACY(src);
 
-      TargetPhraseCollection::const_iterator iterTargetPhrase, iterLast;
-      if (m_tableLimit != 0 && ret_raw->GetSize() > m_tableLimit) {
-        iterLast = ret_raw->begin() + m_tableLimit;
-      } else {
-        iterLast = ret_raw->end();
-      }
+  TargetPhraseCollection::shared_ptr ret = cache->Find(src);
+  if (ret) return ret;
 
-      for (iterTargetPhrase = ret_raw->begin(); iterTargetPhrase != iterLast;  ++iterTargetPhrase) {
-        const TargetPhrase * targetPhrase = *iterTargetPhrase;
-        std::vector<float> raw_scores = targetPhrase->GetScoreBreakdown().GetScoresForProducer(&pd);
+  ret = GetTargetPhraseCollectionLEGACY(src);
+  cache->Insert(src, ret);
+  return ret;
+}
 
-        std::string targetString = targetPhrase->GetStringRep(m_output);
-        if (allStats->find(targetString) == allStats->end()) {
+void
+PhraseDictionaryMultiModel::
+CollectSufficientStatistics
+(const Phrase& src, MultiModelStatistics &allStats) const
+{
+  // look up all models first so that the statistics are allocated once
+  std::vector<TargetPhraseCollection::shared_ptr> collections(m_numModels);
+  std::vector<size_t> sizes(m_numModels, 0);
+  size_t total = 0;
+  for(size_t i = 0; i < m_numModels; ++i) {
+    collections[i] = m_pd[i]->GetTargetPhraseCollectionLEGACY(src);
+    if (collections[i] != NULL) {
+      sizes[i] = collections[i]->GetSize();
+      if (m_tableLimit != 0 && sizes[i] > m_tableLimit) {
+        sizes[i] = m_tableLimit;
+      }
+      total += sizes[i];
+    }
+  }
+  allStats.Reserve(total);
 
-          multiModelStats * statistics = new multiModelStats;
-          statistics->targetPhrase = new TargetPhrase(*targetPhrase); //make a copy so that we don't overwrite the original phrase table info
-          statistics->p.resize(m_numScoreComponents);
-          for(size_t j = 0; j < m_numScoreComponents; ++j) {
-            statistics->p[j].resize(m_numModels);
-          }
+  for(size_t i = 0; i < m_numModels; ++i) {
+    const PhraseDictionary &pd = *m_pd[i];
+    const size_t scoreIndex = pd.GetIndex();
 
-          //correct future cost estimates and total score
-          statistics->targetPhrase->GetScoreBreakdown().InvertDenseFeatures(&pd);
-          vector<FeatureFunction*> pd_feature;
-          pd_feature.push_back(m_pd[i]);
-          const vector<FeatureFunction*> pd_feature_const(pd_feature);
-          statistics->targetPhrase->EvaluateInIsolation(src, pd_feature_const);
-          // zero out scores from original phrase table
-          statistics->targetPhrase->GetScoreBreakdown().ZeroDenseFeatures(&pd);
+    for (size_t k = 0; k < sizes[i]; ++k) {
+      const TargetPhrase *targetPhrase = collections[i]->GetTargetPhrase(k);
 
-          (*allStats)[targetString] = statistics;
+      size_t hash = allStats.Hash(*targetPhrase);
+      size_t index = allStats.Find(*targetPhrase, hash);
+      if (index == allStats.Size()) {
+        //make a copy so that we don't overwrite the original phrase table info
+        TargetPhrase *phrase = new TargetPhrase(*targetPhrase);
 
-        }
-        multiModelStats * statistics = (*allStats)[targetString];
+        //correct future cost estimates and total score
+        phrase->GetScoreBreakdown().InvertDenseFeatures(&pd);
+        phrase->EvaluateInIsolation(src, m_pdFeatures[i]);
+        // zero out scores from original phrase table
+        phrase->GetScoreBreakdown().ZeroDenseFeatures(&pd);
 
-        for(size_t j = 0; j < m_numScoreComponents; ++j) {
-          statistics->p[j][i] = UntransformScore(raw_scores[j]);
-        }
+        index = allStats.Add(phrase, hash);
+      }
 
-        (*allStats)[targetString] = statistics;
+      const FVector &raw_scores = targetPhrase->GetScoreBreakdown().GetScoresVector();
+      float *p = allStats.GetProbabilities(index) + i;
+      for(size_t j = 0; j < m_numScoreComponents; ++j) {
+        p[j * m_numModels] = UntransformScore(raw_scores[scoreIndex + j]);
       }
     }
   }
@@ -177,29 +287,26 @@ TargetPhraseCollection::shared_ptr
 PhraseDictionaryMultiModel::
 CreateTargetPhraseCollectionLinearInterpolation
 ( const Phrase& src,
-  std::map<std::string,multiModelStats*>* allStats,
+  MultiModelStatistics &allStats,
   std::vector<std::vector<float> > &multimodelweights) const
 {
   TargetPhraseCollection::shared_ptr ret(new TargetPhraseCollection);
-  for ( std::map< std::string, multiModelStats*>::const_iterator iter = allStats->begin(); iter != allStats->end(); ++iter ) {
+  Scores scoreVector(m_numScoreComponents);
 
-    multiModelStats * statistics = iter->second;
+  for (size_t k = 0; k < allStats.Size(); ++k) {
+    const float *p = allStats.GetProbabilities(k);
 
-    Scores scoreVector(m_numScoreComponents);
-
-    for(size_t i = 0; i < m_numScoreComponents; ++i) {
-      scoreVector[i] = TransformScore(std::inner_product(statistics->p[i].begin(), statistics->p[i].end(), multimodelweights[i].begin(), 0.0));
+    for(size_t i = 0; i < m_numScoreComponents; ++i, p += m_numModels) {
+      scoreVector[i] = TransformScore(std::inner_product(p, p + m_numModels, multimodelweights[i].begin(), 0.0));
     }
 
-    statistics->targetPhrase->GetScoreBreakdown().Assign(this, scoreVector);
+    TargetPhrase *phrase = allStats.Release(k);
+    phrase->GetScoreBreakdown().Assign(this, scoreVector);
 
     //correct future cost estimates and total score
-    vector<FeatureFunction*> pd_feature;
-    pd_feature.push_back(const_cast<PhraseDictionaryMultiModel*>(this));
-    const vector<FeatureFunction*> pd_feature_const(pd_feature);
-    statistics->targetPhrase->EvaluateInIsolation(src, pd_feature_const);
+    phrase->EvaluateInIsolation(src, m_pdFeature);
 
-    ret->Add(new TargetPhrase(*statistics->targetPhrase));
+    ret->Add(phrase);
   }
   return ret;
 }
@@ -278,28 +385,10 @@ CreateRuleLookupManager(const ChartParser &, const ChartCellCollectionBase&,
 }
 
 
-//copied from PhraseDictionaryCompact; free memory allocated to TargetPhraseCollection (and each TargetPhrase) at end of sentence
-void
-PhraseDictionaryMultiModel::
-CacheForCleanup(TargetPhraseCollection::shared_ptr tpc)
-{
-  GetPhraseCache().push_back(tpc);
-}
-
-
 void
 PhraseDictionaryMultiModel::
 CleanUpAfterSentenceProcessing(const InputType &source)
 {
-  // PhraseCache &ref = GetPhraseCache();
-  // for(PhraseCache::iterator it = ref.begin(); it != ref.end(); it++) {
-  //   it->reset();
-  // }
-
-  // PhraseCache temp;
-  // temp.swap(ref);
-  GetPhraseCache().clear();
-
   CleanUpComponentModels(source);
 
   std::vector<float> empty_vector;
@@ -307,6 +396,30 @@ CleanUpAfterSentenceProcessing(const InputType &source)
 }
 
 
+TargetPhraseCollection::shared_ptr
+PhraseDictionaryMultiModel::TaskCache::
+Find(const Phrase &src) const
+{
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  boost::unordered_map<Phrase, TargetPhraseCollection::shared_ptr>::const_iterator
+  iter = m_collections.find(src);
+  if (iter == m_collections.end()) return TargetPhraseCollection::shared_ptr();
+  return iter->second;
+}
+
+void
+PhraseDictionaryMultiModel::TaskCache::
+Insert(const Phrase &src, TargetPhraseCollection::shared_ptr const& tpc)
+{
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+#endif
+  m_collections[src] = tpc;
+}
+
+
 void
 PhraseDictionaryMultiModel::
 CleanUpComponentModels(const InputType &source)
@@ -364,29 +477,30 @@ MinimizePerplexity(vector<pair<string, string> > &phrase_pair_vector)
     string source_string = phrase_pair.first;
     string target_string = phrase_pair.second;
 
-    vector<float> fs(m_numModels);
-    map<string,multiModelStats*>* allStats = new(map<string,multiModelStats*>);
+    MultiModelStatistics allStats(m_output, m_numScoreComponents, m_numModels);
 
     Phrase sourcePhrase(0);
     sourcePhrase.CreateFromString(Input, m_input, source_string, NULL);
+    Phrase targetPhrase(0);
+    targetPhrase.CreateFromString(Output, m_output, target_string, NULL);
 
     CollectSufficientStatistics(sourcePhrase, allStats); //optimization potential: only call this once per source phrase
 
     //phrase pair not found; leave cache empty
-    if (allStats->find(target_string) == allStats->end()) {
-      RemoveAllInMap(*allStats);
-      delete allStats;
+    size_t index = allStats.Find(targetPhrase, allStats.Hash(targetPhrase));
+    if (index == allStats.Size()) {
       continue;
     }
 
     multiModelStatsOptimization* targetStatistics = new multiModelStatsOptimization();
-    targetStatistics->targetPhrase = new TargetPhrase(*(*allStats)[target_string]->targetPhrase);
-    targetStatistics->p = (*allStats)[target_string]->p;
+    targetStatistics->targetPhrase = allStats.Release(index);
+    const float *p = allStats.GetProbabilities(index);
+    targetStatistics->p.resize(m_numScoreComponents);
+    for (size_t i = 0; i < m_numScoreComponents; ++i, p += m_numModels) {
+      targetStatistics->p[i].assign(p, p + m_numModels);
+    }
     targetStatistics->f = iter->second;
     optimizerStats.push_back(targetStatistics);
-
-    RemoveAllInMap(*allStats);
-    delete allStats;
   }
 
   Sentence sentence;
@@ -58,6 +58,63 @@ struct multiModelPhrase {
   };
 };
 
+/** Target phrases collected from all component models for one source phrase.
+ * Phrases are found by a hash of the IDs of their output factors, so no
+ * string is built per phrase.  The probabilities of all phrases share one
+ * buffer that is reserved up front: phrase i has one row of numModels
+ * probabilities per score component, starting at GetProbabilities(i).
+ */
+class MultiModelStatistics
+{
+public:
+  MultiModelStatistics(const std::vector<FactorType> &output,
+                       size_t numScoreComponents, size_t numModels);
+  ~MultiModelStatistics();
+
+  //! make room for this many phrases
+  void Reserve(size_t phrases);
+
+  size_t Hash(const Phrase &phrase) const;
+
+  //! index of the phrase with the same output factors, or Size() if none
+  size_t Find(const Phrase &phrase, size_t hash) const;
+
+  //! take ownership of phrase and give it zero probabilities
+  size_t Add(TargetPhrase *phrase, size_t hash);
+
+  size_t Size() const {
+    return m_phrases.size();
+  }
+
+  TargetPhrase &GetTargetPhrase(size_t i) {
+    return *m_phrases[i];
+  }
+
+  //! hand phrase i over to the caller
+  TargetPhrase *Release(size_t i) {
+    TargetPhrase *ret = m_phrases[i];
+    m_phrases[i] = NULL;
+    return ret;
+  }
+
+  float *GetProbabilities(size_t i) {
+    return &m_probabilities[i * m_stride];
+  }
+
+private:
+  bool SameOutput(const Phrase &a, const Phrase &b) const;
+
+  const std::vector<FactorType> &m_output;
+  size_t m_numModels;
+  size_t m_stride;
+  std::vector<TargetPhrase*> m_phrases;
+  std::vector<float> m_probabilities;
+  boost::unordered_multimap<size_t, size_t> m_index;
+
+  MultiModelStatistics(const MultiModelStatistics &);
+  void operator=(const MultiModelStatistics &);
+};
+
 /** Implementation of a virtual phrase table constructed from multiple component phrase tables.
  */
 class PhraseDictionaryMultiModel: public PhraseDictionary
@@ -74,12 +131,11 @@ public:
 
   virtual void
   CollectSufficientStatistics
-  (const Phrase& src, std::map<std::string,multiModelStats*>* allStats)
-  const;
+  (const Phrase& src, MultiModelStatistics &allStats) const;
 
   virtual TargetPhraseCollection::shared_ptr
   CreateTargetPhraseCollectionLinearInterpolation
-  (const Phrase& src, std::map<std::string,multiModelStats*>* allStats,
+  (const Phrase& src, MultiModelStatistics &allStats,
    std::vector<std::vector<float> > &multimodelweights) const;
 
   std::vector<std::vector<float> >
@@ -88,9 +144,6 @@ public:
   std::vector<float>
   normalizeWeights(std::vector<float> &weights) const;
 
-  void
-  CacheForCleanup(TargetPhraseCollection::shared_ptr tpc);
-
   void
   CleanUpAfterSentenceProcessing(const InputType &source);
 
@@ -106,6 +159,14 @@ public:
   virtual TargetPhraseCollection::shared_ptr
   GetTargetPhraseCollectionLEGACY(const Phrase& src) const;
 
+  virtual TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollectionLEGACY(ttasksptr const& ttask,
+                                  const Phrase& src) const;
+
+  virtual void
+  GetTargetPhraseCollectionBatch(ttasksptr const& ttask,
+                                 InputPathList const& inputPathQueue) const;
+
   virtual void
   InitializeForInput(ttasksptr const& ttask) {
     // Don't do anything source specific here as this object is shared
@@ -132,29 +193,27 @@ protected:
   size_t m_numModels;
   std::vector<float> m_multimodelweights;
 
-  typedef std::vector<TargetPhraseCollection::shared_ptr> PhraseCache;
+  // features to re-evaluate when phrases of model i are copied
+  std::vector<std::vector<FeatureFunction*> > m_pdFeatures;
+  // this table, to re-evaluate combined phrases
+  std::vector<FeatureFunction*> m_pdFeature;
+
+  // Combined collections by source phrase, kept in the task's ContextScope
+  // under this table's address.  Tasks may share a scope (all of batch mode
+  // does), so the map has its own lock.
+  class TaskCache
+  {
+    boost::unordered_map<Phrase, TargetPhraseCollection::shared_ptr> m_collections;
 #ifdef WITH_THREADS
-  boost::shared_mutex m_lock_cache;
-  typedef std::map<boost::thread::id, PhraseCache> SentenceCache;
-#else
-  typedef PhraseCache SentenceCache;
+    mutable boost::shared_mutex m_lock;
 #endif
-  SentenceCache m_sentenceCache;
+  public:
+    TargetPhraseCollection::shared_ptr Find(const Phrase &src) const;
+    void Insert(const Phrase &src, TargetPhraseCollection::shared_ptr const& tpc);
+  };
 
-  PhraseCache& GetPhraseCache() {
-#ifdef WITH_THREADS
-    {
-      // first try read-only lock
-      boost::shared_lock<boost::shared_mutex> read_lock(m_lock_cache);
-      SentenceCache::iterator i = m_sentenceCache.find(boost::this_thread::get_id());
-      if (i != m_sentenceCache.end()) return i->second;
-    }
-    boost::unique_lock<boost::shared_mutex> lock(m_lock_cache);
-    return m_sentenceCache[boost::this_thread::get_id()];
-#else
-    return m_sentenceCache;
-#endif
-  }
+  TargetPhraseCollection::shared_ptr
+  GetTargetPhraseCollection(TaskCache *cache, const Phrase& src) const;
 
 #ifdef WITH_THREADS
   //reader-writer lock
@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include "PhraseDictionaryNodeMemory.h"
 #include "moses/TargetPhrase.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
@@ -28,38 +29,261 @@ using namespace std;
 namespace Moses
 {
 
+PhraseDictionaryNodeMemory::Storage::Storage(const Storage &copy)
+  : m_children(copy.m_children ? new Children(*copy.m_children) : NULL)
+  , m_targetPhraseCollection(copy.m_targetPhraseCollection)
+  , m_frozenOwner(copy.m_frozenOwner)
+{
+}
+
+PhraseDictionaryNodeMemory::PhraseDictionaryNodeMemory(const PhraseDictionaryNodeMemory &copy)
+  : m_storage(copy.m_storage ? new Storage(*copy.m_storage) : NULL)
+  , m_frozen(copy.m_frozen)
+  , m_firstTerminal(copy.m_firstTerminal)
+  , m_numTerminals(copy.m_numTerminals)
+  , m_firstNonTerminal(copy.m_firstNonTerminal)
+  , m_numNonTerminals(copy.m_numNonTerminals)
+  , m_collection(copy.m_collection)
+{
+}
+
+PhraseDictionaryNodeMemory &PhraseDictionaryNodeMemory::operator=(const PhraseDictionaryNodeMemory &copy)
+{
+  if (this != &copy) {
+    Storage *storage = copy.m_storage ? new Storage(*copy.m_storage) : NULL;
+    delete m_storage;
+    m_storage = storage;
+    m_frozen = copy.m_frozen;
+    m_firstTerminal = copy.m_firstTerminal;
+    m_numTerminals = copy.m_numTerminals;
+    m_firstNonTerminal = copy.m_firstNonTerminal;
+    m_numNonTerminals = copy.m_numNonTerminals;
+    m_collection = copy.m_collection;
+  }
+  return *this;
+}
+
+PhraseDictionaryNodeMemory::~PhraseDictionaryNodeMemory()
+{
+  delete m_storage;
+}
+
 void PhraseDictionaryNodeMemory::Prune(size_t tableLimit)
 {
-  // recusively prune
-  for (TerminalMap::iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
-    p->second.Prune(tableLimit);
+  if (m_frozen) {
+    std::vector<TargetPhraseCollection> &colls = *m_frozen->m_collections;
+    for (size_t i = 0; i < colls.size(); ++i) {
+      colls[i].Prune(true, tableLimit);
+    }
+    return;
   }
-  for (NonTerminalMap::iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
-    p->second.Prune(tableLimit);
+
+  // recusively prune
+  Children *children = m_storage->m_children;
+  if (children) {
+    for (TerminalMap::iterator p = children->m_sourceTermMap.begin(); p != children->m_sourceTermMap.end(); ++p) {
+      p->second.Prune(tableLimit);
+    }
+    for (NonTerminalMap::iterator p = children->m_nonTermMap.begin(); p != children->m_nonTermMap.end(); ++p) {
+      p->second.Prune(tableLimit);
+    }
   }
 
   // prune TargetPhraseCollection in this node
-  m_targetPhraseCollection->Prune(true, tableLimit);
+  m_storage->m_targetPhraseCollection->Prune(true, tableLimit);
 }
 
 void PhraseDictionaryNodeMemory::Sort(size_t tableLimit)
 {
-  // recusively sort
-  for (TerminalMap::iterator p = m_sourceTermMap.begin(); p != m_sourceTermMap.end(); ++p) {
-    p->second.Sort(tableLimit);
+  if (m_frozen) {
+    std::vector<TargetPhraseCollection> &colls = *m_frozen->m_collections;
+    for (size_t i = 0; i < colls.size(); ++i) {
+      colls[i].Sort(true, tableLimit);
+    }
+    return;
   }
-  for (NonTerminalMap::iterator p = m_nonTermMap.begin(); p != m_nonTermMap.end(); ++p) {
-    p->second.Sort(tableLimit);
+
+  // recusively sort
+  Children *children = m_storage->m_children;
+  if (children) {
+    for (TerminalMap::iterator p = children->m_sourceTermMap.begin(); p != children->m_sourceTermMap.end(); ++p) {
+      p->second.Sort(tableLimit);
+    }
+    for (NonTerminalMap::iterator p = children->m_nonTermMap.begin(); p != children->m_nonTermMap.end(); ++p) {
+      p->second.Sort(tableLimit);
+    }
   }
 
   // prune TargetPhraseCollection in this node
-  m_targetPhraseCollection->Sort(true, tableLimit);
+  m_storage->m_targetPhraseCollection->Sort(true, tableLimit);
+}
+
+bool PhraseDictionaryNodeMemory::TerminalIds(const Word &sourceTerm, const std::vector<FactorType> &factors, uint32_t *ids)
+{
+  for (size_t i = 0; i < factors.size(); ++i) {
+    const Factor *f = sourceTerm[factors[i]];
+    if (!f) {
+      return false;
+    }
+    ids[i] = f->GetId();
+  }
+  return true;
+}
+
+uint64_t PhraseDictionaryNodeMemory::NonTerminalKeyId(const Word &sourceNonTerm, const Word &targetNonTerm)
+{
+  // only the first factor of a non-terminal is relevant
+  return (static_cast<uint64_t>(sourceNonTerm[0]->GetId()) << 32) | targetNonTerm[0]->GetId();
+}
+
+namespace
+{
+struct FrozenTerminal {
+  uint32_t ids[MAX_NUM_FACTORS];
+  PhraseDictionaryNodeMemory *node;
+
+  // unused ids are 0 in all terminals of a table
+  bool operator<(const FrozenTerminal &other) const {
+    return std::lexicographical_compare(ids, ids + MAX_NUM_FACTORS, other.ids, other.ids + MAX_NUM_FACTORS);
+  }
+};
+
+struct FrozenNonTerminal {
+  uint64_t id;
+  PhraseDictionaryNodeMemory *node;
+
+  bool operator<(const FrozenNonTerminal &other) const {
+    return id < other.id;
+  }
+};
+}
+
+void PhraseDictionaryNodeMemory::CountDescendants(size_t &numTerminals, size_t &numNonTerminals,
+    size_t &numCollections, const Word *&terminal) const
+{
+  if (!m_storage->m_targetPhraseCollection->IsEmpty()) {
+    ++numCollections;
+  }
+  const Children *children = m_storage->m_children;
+  if (children) {
+    for (TerminalMap::const_iterator p = children->m_sourceTermMap.begin(); p != children->m_sourceTermMap.end(); ++p) {
+      ++numTerminals;
+      terminal = &p->first;
+      p->second.CountDescendants(numTerminals, numNonTerminals, numCollections, terminal);
+    }
+    for (NonTerminalMap::const_iterator p = children->m_nonTermMap.begin(); p != children->m_nonTermMap.end(); ++p) {
+      ++numNonTerminals;
+      p->second.CountDescendants(numTerminals, numNonTerminals, numCollections, terminal);
+    }
+  }
+}
+
+void PhraseDictionaryNodeMemory::FreezeInto(PhraseDictionaryNodeMemory &dest, FrozenTrie &trie,
+    size_t &nextTerminal, size_t &nextNonTerminal, size_t &nextCollection)
+{
+  std::vector<TargetPhraseCollection> &colls = *trie.m_collections;
+  if (m_storage->m_targetPhraseCollection->IsEmpty()) {
+    dest.m_collection = 0;
+  } else {
+    dest.m_collection = nextCollection++;
+    colls[dest.m_collection].Swap(*m_storage->m_targetPhraseCollection);
+  }
+  m_storage->m_targetPhraseCollection.reset();
+
+  std::vector<FrozenTerminal> terms;
+  std::vector<FrozenNonTerminal> nonTerms;
+  const std::vector<FactorType> &factors = trie.m_factors;
+  if (Children *children = m_storage->m_children) {
+    terms.reserve(children->m_sourceTermMap.size());
+    for (TerminalMap::iterator p = children->m_sourceTermMap.begin(); p != children->m_sourceTermMap.end(); ++p) {
+      FrozenTerminal child = FrozenTerminal();
+      size_t numFactors = 0;
+      for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+        const Factor *f = p->first[i];
+        if (f) {
+          ++numFactors;
+          UTIL_THROW_IF2(f->GetId() >> 32, "Too many factors to freeze phrase table");
+        }
+      }
+      UTIL_THROW_IF2(numFactors != factors.size() || !TerminalIds(p->first, factors, child.ids),
+                     "Terminals of a phrase table must share their factors: " << p->first);
+      child.node = &p->second;
+      terms.push_back(child);
+    }
+    nonTerms.reserve(children->m_nonTermMap.size());
+    for (NonTerminalMap::iterator p = children->m_nonTermMap.begin(); p != children->m_nonTermMap.end(); ++p) {
+      FrozenNonTerminal child;
+#if defined(UNLABELLED_SOURCE)
+      child.id = p->first[0]->GetId();
+#else
+      UTIL_THROW_IF2(p->first.first[0]->GetId() >> 32 || p->first.second[0]->GetId() >> 32,
+                     "Too many factors to freeze phrase table");
+      child.id = NonTerminalKeyId(p->first.first, p->first.second);
+#endif
+      child.node = &p->second;
+      nonTerms.push_back(child);
+    }
+  }
+  std::sort(terms.begin(), terms.end());
+  std::sort(nonTerms.begin(), nonTerms.end());
+
+  dest.m_frozen = &trie;
+  dest.m_firstTerminal = nextTerminal;
+  dest.m_numTerminals = terms.size();
+  dest.m_firstNonTerminal = nextNonTerminal;
+  dest.m_numNonTerminals = nonTerms.size();
+  nextTerminal += terms.size();
+  nextNonTerminal += nonTerms.size();
+
+  for (size_t i = 0; i < terms.size(); ++i) {
+    size_t pos = dest.m_firstTerminal + i;
+    std::copy(terms[i].ids, terms[i].ids + factors.size(), trie.m_terminalIds.begin() + pos * factors.size());
+    terms[i].node->FreezeInto(trie.m_terminals[pos], trie, nextTerminal, nextNonTerminal, nextCollection);
+  }
+  for (size_t i = 0; i < nonTerms.size(); ++i) {
+    size_t pos = dest.m_firstNonTerminal + i;
+    trie.m_nonTerminalIds[pos] = nonTerms[i].id;
+    nonTerms[i].node->FreezeInto(trie.m_nonTerminals[pos], trie, nextTerminal, nextNonTerminal, nextCollection);
+  }
+
+  // the subtree has been moved, release the hash maps
+  delete m_storage->m_children;
+  m_storage->m_children = NULL;
+}
+
+void PhraseDictionaryNodeMemory::Freeze()
+{
+  if (m_frozen) return;
+
+  size_t numTerminals = 0, numNonTerminals = 0, numCollections = 0;
+  const Word *terminal = NULL;
+  CountDescendants(numTerminals, numNonTerminals, numCollections, terminal);
+  UTIL_THROW_IF2(numTerminals >> 32 || numNonTerminals >> 32, "Too many nodes to freeze phrase table");
+
+  boost::shared_ptr<FrozenTrie> trie(new FrozenTrie);
+  if (terminal) {
+    for (size_t i = 0; i < MAX_NUM_FACTORS; ++i) {
+      if ((*terminal)[i]) trie->m_factors.push_back(i);
+    }
+    UTIL_THROW_IF2(trie->m_factors.empty(), "Terminal without factors in phrase table");
+  }
+  trie->m_terminals.resize(numTerminals, PhraseDictionaryNodeMemory(trie.get()));
+  trie->m_terminalIds.resize(numTerminals * trie->m_factors.size());
+  trie->m_nonTerminals.resize(numNonTerminals, PhraseDictionaryNodeMemory(trie.get()));
+  trie->m_nonTerminalIds.resize(numNonTerminals);
+  trie->m_collections.reset(new std::vector<TargetPhraseCollection>(numCollections + 1));
+
+  size_t nextTerminal = 0, nextNonTerminal = 0, nextCollection = 1;
+  FreezeInto(*this, *trie, nextTerminal, nextNonTerminal, nextCollection);
+  m_storage->m_frozenOwner = trie;
 }
 
 PhraseDictionaryNodeMemory*
 PhraseDictionaryNodeMemory::GetOrCreateChild(const Word &sourceTerm)
 {
-  return &m_sourceTermMap[sourceTerm];
+  UTIL_THROW_IF2(m_frozen, "Cannot add rules to a frozen phrase table");
+  if (!m_storage->m_children) m_storage->m_children = new Children;
+  return &m_storage->m_children->m_sourceTermMap[sourceTerm];
 }
 
 #if defined(UNLABELLED_SOURCE)
@@ -67,8 +291,10 @@ PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetOrCreateNonTerminalCh
 {
   UTIL_THROW_IF2(!targetNonTerm.IsNonTerminal(),
                  "Not a non-terminal: " << targetNonTerm);
+  UTIL_THROW_IF2(m_frozen, "Cannot add rules to a frozen phrase table");
 
-  return &m_nonTermMap[targetNonTerm];
+  if (!m_storage->m_children) m_storage->m_children = new Children;
+  return &m_storage->m_children->m_nonTermMap[targetNonTerm];
 }
 #else
 PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetOrCreateChild(const Word &sourceNonTerm, const Word &targetNonTerm)
@@ -77,19 +303,67 @@ PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetOrCreateChild(const W
                  "Not a non-terminal: " << sourceNonTerm);
   UTIL_THROW_IF2(!targetNonTerm.IsNonTerminal(),
                  "Not a non-terminal: " << targetNonTerm);
+  UTIL_THROW_IF2(m_frozen, "Cannot add rules to a frozen phrase table");
 
-  NonTerminalMapKey key(sourceNonTerm, targetNonTerm);
-  return &m_nonTermMap[NonTerminalMapKey(sourceNonTerm, targetNonTerm)];
+  if (!m_storage->m_children) m_storage->m_children = new Children;
+  return &m_storage->m_children->m_nonTermMap[NonTerminalMapKey(sourceNonTerm, targetNonTerm)];
 }
 #endif
 
+size_t PhraseDictionaryNodeMemory::GetTerminalId(size_t i, FactorType factorType) const
+{
+  assert(m_frozen && i < m_numTerminals);
+  const std::vector<FactorType> &factors = m_frozen->m_factors;
+  size_t factor = std::find(factors.begin(), factors.end(), factorType) - factors.begin();
+  assert(factor < factors.size());
+  return m_frozen->m_terminalIds[(m_firstTerminal + i) * factors.size() + factor];
+}
+
+const PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::FindFrozenChild(uint64_t id) const
+{
+  const std::vector<uint64_t> &ids = m_frozen->m_nonTerminalIds;
+  std::vector<uint64_t>::const_iterator begin = ids.begin() + m_firstNonTerminal;
+  std::vector<uint64_t>::const_iterator end = begin + m_numNonTerminals;
+  std::vector<uint64_t>::const_iterator p = std::lower_bound(begin, end, id);
+  if (p == end || *p != id) {
+    return NULL;
+  }
+  return &m_frozen->m_nonTerminals[p - ids.begin()];
+}
+
 const PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetChild(const Word &sourceTerm) const
 {
   UTIL_THROW_IF2(sourceTerm.IsNonTerminal(),
                  "Not a terminal: " << sourceTerm);
 
-  TerminalMap::const_iterator p = m_sourceTermMap.find(sourceTerm);
-  return (p == m_sourceTermMap.end()) ? NULL : &p->second;
+  if (m_frozen) {
+    // only the factors of the table are compared, as TerminalEqualityPred does
+    const std::vector<FactorType> &factors = m_frozen->m_factors;
+    uint32_t ids[MAX_NUM_FACTORS];
+    if (m_numTerminals == 0 || !TerminalIds(sourceTerm, factors, ids)) {
+      return NULL;
+    }
+    size_t n = factors.size();
+    const uint32_t *keys = &m_frozen->m_terminalIds[0];
+    size_t lo = m_firstTerminal, hi = m_firstTerminal + m_numTerminals;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (std::lexicographical_compare(keys + mid * n, keys + (mid + 1) * n, ids, ids + n)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == m_firstTerminal + m_numTerminals || !std::equal(ids, ids + n, keys + lo * n)) {
+      return NULL;
+    }
+    return &m_frozen->m_terminals[lo];
+  }
+
+  const Children *children = m_storage->m_children;
+  if (!children) return NULL;
+  TerminalMap::const_iterator p = children->m_sourceTermMap.find(sourceTerm);
+  return (p == children->m_sourceTermMap.end()) ? NULL : &p->second;
 }
 
 #if defined(UNLABELLED_SOURCE)
@@ -98,8 +372,14 @@ const PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetNonTerminalChil
   UTIL_THROW_IF2(!targetNonTerm.IsNonTerminal(),
                  "Not a non-terminal: " << targetNonTerm);
 
-  NonTerminalMap::const_iterator p = m_nonTermMap.find(targetNonTerm);
-  return (p == m_nonTermMap.end()) ? NULL : &p->second;
+  if (m_frozen) {
+    return FindFrozenChild(targetNonTerm[0]->GetId());
+  }
+
+  const Children *children = m_storage->m_children;
+  if (!children) return NULL;
+  NonTerminalMap::const_iterator p = children->m_nonTermMap.find(targetNonTerm);
+  return (p == children->m_nonTermMap.end()) ? NULL : &p->second;
 }
 #else
 const PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetChild(const Word &sourceNonTerm, const Word &targetNonTerm) const
@@ -109,17 +389,33 @@ const PhraseDictionaryNodeMemory *PhraseDictionaryNodeMemory::GetChild(const Wor
   UTIL_THROW_IF2(!targetNonTerm.IsNonTerminal(),
                  "Not a non-terminal: " << targetNonTerm);
 
+  if (m_frozen) {
+    return FindFrozenChild(NonTerminalKeyId(sourceNonTerm, targetNonTerm));
+  }
+
+  const Children *children = m_storage->m_children;
+  if (!children) return NULL;
   NonTerminalMapKey key(sourceNonTerm, targetNonTerm);
-  NonTerminalMap::const_iterator p = m_nonTermMap.find(key);
-  return (p == m_nonTermMap.end()) ? NULL : &p->second;
+  NonTerminalMap::const_iterator p = children->m_nonTermMap.find(key);
+  return (p == children->m_nonTermMap.end()) ? NULL : &p->second;
 }
 #endif
 
 void PhraseDictionaryNodeMemory::Remove()
 {
-  m_sourceTermMap.clear();
-  m_nonTermMap.clear();
-  m_targetPhraseCollection->Remove();
+  if (m_frozen) {
+    // only drops this node's reference: the arena goes with the last node
+    // owning it (the root or a copy of it), the rules with the last
+    // collection handed out by GetTargetPhraseCollection()
+    delete m_storage;
+    m_storage = new Storage;
+    m_frozen = NULL;
+    m_firstTerminal = m_numTerminals = m_firstNonTerminal = m_numNonTerminals = m_collection = 0;
+  } else {
+    delete m_storage->m_children;
+    m_storage->m_children = NULL;
+    m_storage->m_targetPhraseCollection->Remove();
+  }
 }
 
 std::ostream& operator<<(std::ostream &out, const PhraseDictionaryNodeMemory &node)
@@ -21,17 +21,21 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #pragma once
 
+#include <cassert>
 #include <map>
 #include <vector>
 #include <iterator>
 #include <utility>
 #include <ostream>
+#include <stdint.h>
 #include "moses/Word.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/Terminal.h"
 #include "moses/NonTerminal.h"
+#include "util/exception.hh"
 
 #include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/version.hpp>
 
@@ -90,8 +94,17 @@ public:
   }
 };
 
-/** One node of the PhraseDictionaryMemory structure
-*/
+/** One node of the PhraseDictionaryMemory structure.
+ *
+ * While a table is loaded each node keeps its children in hash maps.
+ * Freeze() then moves the whole trie into one arena: the children of a
+ * node reached by terminals become a contiguous block of one vector, those
+ * reached by non-terminals a block of another, each sorted by the factor
+ * IDs of their keys so that they can be found by binary search.  The keys
+ * are kept as factor IDs only and the target phrase collections are stored
+ * in a single vector.  The child accessors below are only valid once the
+ * trie has been frozen.
+ */
 class PhraseDictionaryNodeMemory
 {
 public:
@@ -124,25 +137,105 @@ public:
 #endif
 
 private:
-  friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryMemory&);
-  friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryScope3&);
-  friend std::ostream& operator<<(std::ostream&, const PhraseDictionaryFuzzyMatch&);
+  // children of a node that is still being built
+  struct Children {
+    TerminalMap m_sourceTermMap;
+    NonTerminalMap m_nonTermMap;
+  };
 
-  TerminalMap m_sourceTermMap;
-  NonTerminalMap m_nonTermMap;
-  TargetPhraseCollection::shared_ptr m_targetPhraseCollection;
+  // arena holding every node of a frozen trie except the root
+  struct FrozenTrie {
+    // nodes reached by a terminal.  For each of them m_terminalIds holds
+    // the IDs of the factors in m_factors, the active factors shared by
+    // all terminals of the table.
+    std::vector<PhraseDictionaryNodeMemory> m_terminals;
+    std::vector<uint32_t> m_terminalIds;
+    std::vector<FactorType> m_factors;
+    // nodes reached by a non-terminal, and the label IDs of their keys
+    std::vector<PhraseDictionaryNodeMemory> m_nonTerminals;
+    std::vector<uint64_t> m_nonTerminalIds;
+    // [0] is the empty collection shared by all nodes without rules
+    boost::shared_ptr<std::vector<TargetPhraseCollection> > m_collections;
+  };
 
+  // what a node owns outside an arena: its children and rules while the
+  // table is built, the arena once the trie below it has been frozen
+  struct Storage {
+    Storage() : m_children(NULL), m_targetPhraseCollection(new TargetPhraseCollection) {}
+    Storage(const Storage &copy);
+    ~Storage() {
+      delete m_children;
+    }
+
+    Children *m_children;
+    TargetPhraseCollection::shared_ptr m_targetPhraseCollection;
+    boost::shared_ptr<FrozenTrie> m_frozenOwner;
+
+  private:
+    Storage &operator=(const Storage &);
+  };
+
+  // NULL for the nodes of an arena
+  Storage *m_storage;
+  // set once frozen
+  const FrozenTrie *m_frozen;
+  uint32_t m_firstTerminal;
+  uint32_t m_numTerminals;
+  uint32_t m_firstNonTerminal;
+  uint32_t m_numNonTerminals;
+  uint32_t m_collection;
+
+  // a node of the given arena
+  explicit PhraseDictionaryNodeMemory(const FrozenTrie *trie)
+    : m_storage(NULL)
+    , m_frozen(trie)
+    , m_firstTerminal(0)
+    , m_numTerminals(0)
+    , m_firstNonTerminal(0)
+    , m_numNonTerminals(0)
+    , m_collection(0) { }
+
+  static bool TerminalIds(const Word &sourceTerm, const std::vector<FactorType> &factors, uint32_t *ids);
+  static uint64_t NonTerminalKeyId(const Word &sourceNonTerm, const Word &targetNonTerm);
+  const PhraseDictionaryNodeMemory *FindFrozenChild(uint64_t id) const;
+
+  void CountDescendants(size_t &numTerminals, size_t &numNonTerminals,
+                        size_t &numCollections, const Word *&terminal) const;
+  void FreezeInto(PhraseDictionaryNodeMemory &dest, FrozenTrie &trie, size_t &nextTerminal,
+                  size_t &nextNonTerminal, size_t &nextCollection);
 
 public:
   PhraseDictionaryNodeMemory()
-    : m_targetPhraseCollection(new TargetPhraseCollection) { }
+    : m_storage(new Storage)
+    , m_frozen(NULL)
+    , m_firstTerminal(0)
+    , m_numTerminals(0)
+    , m_firstNonTerminal(0)
+    , m_numNonTerminals(0)
+    , m_collection(0) { }
+
+  PhraseDictionaryNodeMemory(const PhraseDictionaryNodeMemory &copy);
+  PhraseDictionaryNodeMemory &operator=(const PhraseDictionaryNodeMemory &copy);
+  ~PhraseDictionaryNodeMemory();
 
   bool IsLeaf() const {
-    return m_sourceTermMap.empty() && m_nonTermMap.empty();
+    if (m_frozen) {
+      return m_numTerminals == 0 && m_numNonTerminals == 0;
+    }
+    const Children *children = m_storage->m_children;
+    return children == NULL
+           || (children->m_sourceTermMap.empty() && children->m_nonTermMap.empty());
+  }
+
+  bool IsFrozen() const {
+    return m_frozen != NULL;
   }
 
   void Prune(size_t tableLimit);
   void Sort(size_t tableLimit);
+  //! move the trie below this (root) node into a compact read-only arena
+  void Freeze();
+
   PhraseDictionaryNodeMemory *GetOrCreateChild(const Word &sourceTerm);
   const PhraseDictionaryNodeMemory *GetChild(const Word &sourceTerm) const;
 #if defined(UNLABELLED_SOURCE)
@@ -155,19 +248,47 @@ public:
 
   TargetPhraseCollection::shared_ptr
   GetTargetPhraseCollection() const {
-    return m_targetPhraseCollection;
-  }
-  TargetPhraseCollection::shared_ptr
-  GetTargetPhraseCollection() {
-    return m_targetPhraseCollection;
+    if (m_frozen) {
+      return TargetPhraseCollection::shared_ptr(m_frozen->m_collections,
+             &(*m_frozen->m_collections)[m_collection]);
+    }
+    return m_storage->m_targetPhraseCollection;
   }
 
-  const TerminalMap & GetTerminalMap() const {
-    return m_sourceTermMap;
+  // children of a frozen node, in key order
+  size_t GetNumTerminalChildren() const {
+    UTIL_THROW_IF2(!m_frozen, "Phrase table node has not been frozen");
+    return m_numTerminals;
+  }
+  //! factor ID of the i-th terminal; factorType must be a factor of the table
+  size_t GetTerminalId(size_t i, FactorType factorType) const;
+  const PhraseDictionaryNodeMemory &GetTerminalChild(size_t i) const {
+    assert(m_frozen && i < m_numTerminals);
+    return m_frozen->m_terminals[m_firstTerminal + i];
   }
 
-  const NonTerminalMap & GetNonTerminalMap() const {
-    return m_nonTermMap;
+  size_t GetNumNonTerminalChildren() const {
+    UTIL_THROW_IF2(!m_frozen, "Phrase table node has not been frozen");
+    return m_numNonTerminals;
+  }
+#if defined(UNLABELLED_SOURCE)
+  size_t GetTargetNonTerminalId(size_t i) const {
+    assert(m_frozen && i < m_numNonTerminals);
+    return m_frozen->m_nonTerminalIds[m_firstNonTerminal + i];
+  }
+#else
+  size_t GetSourceNonTerminalId(size_t i) const {
+    assert(m_frozen && i < m_numNonTerminals);
+    return m_frozen->m_nonTerminalIds[m_firstNonTerminal + i] >> 32;
+  }
+  size_t GetTargetNonTerminalId(size_t i) const {
+    assert(m_frozen && i < m_numNonTerminals);
+    return m_frozen->m_nonTerminalIds[m_firstNonTerminal + i] & 0xffffffff;
+  }
+#endif
+  const PhraseDictionaryNodeMemory &GetNonTerminalChild(size_t i) const {
+    assert(m_frozen && i < m_numNonTerminals);
+    return m_frozen->m_nonTerminals[m_firstNonTerminal + i];
   }
 
   void Remove();
@@ -0,0 +1,262 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "PhraseDictionaryNodeMemory.h"
+#include "moses/FactorCollection.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+// "a|x" is a terminal with factors a and x, "a" the same as "a|_", and "X:Y"
+// a non-terminal with source label X and target label Y.  All terminals of a
+// table have the same factors.
+Word MakeWord(const string &str)
+{
+  FactorCollection &factors = FactorCollection::Instance();
+  vector<string> labels = Tokenize(str, ":");
+  Word word(labels.size() == 2);
+  if (word.IsNonTerminal()) {
+    word.SetFactor(0, factors.AddFactor(labels[0], true));
+    return word;
+  }
+  vector<string> parts = Tokenize(str, "|");
+  parts.resize(2, "_");
+  for (size_t i = 0; i < parts.size(); ++i) {
+    word.SetFactor(i, factors.AddFactor(parts[i]));
+  }
+  return word;
+}
+
+Word TargetLabel(const string &str)
+{
+  Word word(true);
+  word.SetFactor(0, FactorCollection::Instance().AddFactor(Tokenize(str, ":")[1], true));
+  return word;
+}
+
+PhraseDictionaryNodeMemory *GetOrCreate(PhraseDictionaryNodeMemory &root, const string &path)
+{
+  vector<string> words = Tokenize(path);
+  PhraseDictionaryNodeMemory *node = &root;
+  for (size_t i = 0; i < words.size(); ++i) {
+    Word word = MakeWord(words[i]);
+    if (!word.IsNonTerminal()) {
+      node = node->GetOrCreateChild(word);
+    } else {
+#if defined(UNLABELLED_SOURCE)
+      node = node->GetOrCreateNonTerminalChild(TargetLabel(words[i]));
+#else
+      node = node->GetOrCreateChild(word, TargetLabel(words[i]));
+#endif
+    }
+  }
+  return node;
+}
+
+const PhraseDictionaryNodeMemory *Find(const PhraseDictionaryNodeMemory &root, const string &path)
+{
+  vector<string> words = Tokenize(path);
+  const PhraseDictionaryNodeMemory *node = &root;
+  for (size_t i = 0; node && i < words.size(); ++i) {
+    Word word = MakeWord(words[i]);
+    if (!word.IsNonTerminal()) {
+      node = node->GetChild(word);
+    } else {
+#if defined(UNLABELLED_SOURCE)
+      node = node->GetNonTerminalChild(TargetLabel(words[i]));
+#else
+      node = node->GetChild(word, TargetLabel(words[i]));
+#endif
+    }
+  }
+  return node;
+}
+
+void AddRule(PhraseDictionaryNodeMemory &root, const string &path, const string &target)
+{
+  Phrase phrase;
+  phrase.CreateFromString(Output, vector<FactorType>(1, 0), target, NULL);
+  GetOrCreate(root, path)->GetTargetPhraseCollection()->Add(new TargetPhrase(phrase, NULL));
+}
+
+string Describe(const TargetPhraseCollection &collection)
+{
+  ostringstream out;
+  for (TargetPhraseCollection::const_iterator p = collection.begin(); p != collection.end(); ++p) {
+    out << "[" << static_cast<const Phrase&>(**p) << "]";
+  }
+  return out.str();
+}
+
+// what a lookup of each path finds
+string LookUp(const PhraseDictionaryNodeMemory &root, const vector<string> &paths)
+{
+  ostringstream out;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const PhraseDictionaryNodeMemory *node = Find(root, paths[i]);
+    out << paths[i] << " -> ";
+    if (node) {
+      out << (node->IsLeaf() ? "leaf " : "node ") << Describe(*node->GetTargetPhraseCollection());
+    } else {
+      out << "none";
+    }
+    out << "\n";
+  }
+  return out.str();
+}
+
+void AddRules(PhraseDictionaryNodeMemory &root)
+{
+  AddRule(root, "a", "A");
+  AddRule(root, "a", "A2");
+  AddRule(root, "a b", "A B");
+  AddRule(root, "a b c", "A B C");
+  AddRule(root, "b c", "B C");
+  AddRule(root, "a|x", "A X");
+  AddRule(root, "a|y d", "A Y D");
+  AddRule(root, "a X:Y", "A");
+  AddRule(root, "a X:Z", "A");
+  AddRule(root, "a X:Y b", "A B");
+  AddRule(root, "Z:X c", "C");
+  // nodes without rules of their own
+  GetOrCreate(root, "e f g");
+}
+
+vector<string> Paths()
+{
+  const char *paths[] = {
+    "", "a", "a b", "a b c", "b", "b c", "c", "a|x", "a|y", "a|y d", "a|z",
+    "a X:Y", "a X:Z", "a Y:X", "a X:Y b", "a X:Z b", "Z:X", "Z:X c", "X:Z c",
+    "e", "e f", "e f g", "e f g h", "a b c d",
+  };
+  return vector<string>(paths, paths + sizeof(paths) / sizeof(paths[0]));
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(phrase_dictionary_node_memory)
+
+BOOST_AUTO_TEST_CASE(freeze_keeps_lookups)
+{
+  PhraseDictionaryNodeMemory root;
+  AddRules(root);
+  const vector<string> paths = Paths();
+  const string before = LookUp(root, paths);
+  BOOST_CHECK(!root.IsFrozen());
+  BOOST_CHECK_THROW(root.GetNumTerminalChildren(), util::Exception);
+  BOOST_CHECK_THROW(root.GetNumNonTerminalChildren(), util::Exception);
+
+  root.Freeze();
+  BOOST_CHECK(root.IsFrozen());
+  BOOST_CHECK_EQUAL(LookUp(root, paths), before);
+  BOOST_CHECK(before.find("a b c -> leaf [A B C ]") != string::npos);
+  BOOST_CHECK(before.find("a|z -> none") != string::npos);
+
+  // freezing again changes nothing
+  root.Freeze();
+  BOOST_CHECK_EQUAL(LookUp(root, paths), before);
+
+  // so do copies of the frozen root
+  PhraseDictionaryNodeMemory copy(root);
+  BOOST_CHECK_EQUAL(LookUp(copy, paths), before);
+
+  BOOST_CHECK_THROW(GetOrCreate(root, "a"), util::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(frozen_children_in_key_order)
+{
+  PhraseDictionaryNodeMemory root;
+  AddRules(root);
+  root.Freeze();
+
+  // a, a|x, a|y, b, e
+  BOOST_REQUIRE_EQUAL(root.GetNumTerminalChildren(), static_cast<size_t>(5));
+  BOOST_REQUIRE_EQUAL(root.GetNumNonTerminalChildren(), static_cast<size_t>(1));
+  for (size_t i = 1; i < root.GetNumTerminalChildren(); ++i) {
+    size_t prev = root.GetTerminalId(i - 1, 0), id = root.GetTerminalId(i, 0);
+    BOOST_CHECK(prev < id || (prev == id && root.GetTerminalId(i - 1, 1) < root.GetTerminalId(i, 1)));
+  }
+  const char *terminals[] = { "a", "a|x", "a|y", "b", "e" };
+  for (size_t t = 0; t < 5; ++t) {
+    Word word = MakeWord(terminals[t]);
+    const PhraseDictionaryNodeMemory *child = root.GetChild(word);
+    BOOST_REQUIRE(child);
+    size_t i = 0;
+    while (i < root.GetNumTerminalChildren() && &root.GetTerminalChild(i) != child) ++i;
+    BOOST_REQUIRE(i < root.GetNumTerminalChildren());
+    BOOST_CHECK_EQUAL(root.GetTerminalId(i, 0), word[0]->GetId());
+    BOOST_CHECK_EQUAL(root.GetTerminalId(i, 1), word[1]->GetId());
+  }
+
+  const PhraseDictionaryNodeMemory *a = Find(root, "a");
+  BOOST_REQUIRE(a);
+  BOOST_CHECK_EQUAL(a->GetNumTerminalChildren(), static_cast<size_t>(1));
+  BOOST_REQUIRE_EQUAL(a->GetNumNonTerminalChildren(), static_cast<size_t>(2));
+  BOOST_CHECK(a->GetTargetNonTerminalId(0) < a->GetTargetNonTerminalId(1));
+  const char *nonTerminals[] = { "X:Y", "X:Z" };
+  for (size_t t = 0; t < 2; ++t) {
+    const PhraseDictionaryNodeMemory *child = Find(*a, nonTerminals[t]);
+    BOOST_REQUIRE(child);
+    size_t i = (child == &a->GetNonTerminalChild(0)) ? 0 : 1;
+    BOOST_CHECK_EQUAL(&a->GetNonTerminalChild(i), child);
+    BOOST_CHECK_EQUAL(a->GetTargetNonTerminalId(i), TargetLabel(nonTerminals[t])[0]->GetId());
+#if !defined(UNLABELLED_SOURCE)
+    BOOST_CHECK_EQUAL(a->GetSourceNonTerminalId(i), MakeWord(nonTerminals[t])[0]->GetId());
+#endif
+  }
+}
+
+BOOST_AUTO_TEST_CASE(freeze_needs_shared_factors)
+{
+  PhraseDictionaryNodeMemory root;
+  AddRules(root);
+  Word word;
+  word.SetFactor(0, FactorCollection::Instance().AddFactor("f"));
+  root.GetOrCreateChild(word);
+  BOOST_CHECK_THROW(root.Freeze(), util::Exception);
+}
+
+BOOST_AUTO_TEST_CASE(rules_outlive_removed_trie)
+{
+  TargetPhraseCollection::shared_ptr collection;
+  {
+    PhraseDictionaryNodeMemory root;
+    AddRules(root);
+    root.Freeze();
+    collection = Find(root, "a b")->GetTargetPhraseCollection();
+    root.Remove();
+    BOOST_CHECK(!root.IsFrozen());
+    BOOST_CHECK(root.IsLeaf());
+    BOOST_CHECK(root.GetTargetPhraseCollection()->IsEmpty());
+  }
+  BOOST_CHECK_EQUAL(Describe(*collection), "[A B ]");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
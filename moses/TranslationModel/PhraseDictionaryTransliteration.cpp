@@ -1,5 +1,11 @@
 // vim:tabstop=2
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "PhraseDictionaryTransliteration.h"
 #include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerSkeleton.h"
@@ -7,25 +13,220 @@
 #include "moses/DecodeStep.h"
 #include "util/tempfile.hh"
 
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 using namespace std;
 
 namespace Moses
 {
+
+namespace
+{
+
+// one word per line, its characters separated by spaces
+void AppendCharacters(const string &word, string &out)
+{
+  for (size_t i = 0; i < word.size(); ++i) {
+    // a new UTF-8 character starts at every byte that is not a continuation
+    if (i > 0 && (word[i] & 0xC0) != 0x80) {
+      out += ' ';
+    }
+    out += word[i];
+  }
+  out += '\n';
+}
+
+// "id ||| t r a n s ||| features ||| score"; false if the line is not one
+bool ParseNBestLine(const string &line, size_t &id, string &target, float &score)
+{
+  vector<string> fields = TokenizeMultiCharSeparator(line, "|||");
+  if (fields.size() < 4) {
+    return false;
+  }
+  id = Scan<size_t>(fields[0]);
+  target.clear();
+  for (size_t i = 0; i < fields[1].size(); ++i) {
+    if (fields[1][i] != ' ') {
+      target += fields[1][i];
+    }
+  }
+  score = Scan<float>(fields[3]);
+  return true;
+}
+
+// Bytes of input per batch, at least one word.  The batch is written before
+// any output is read, so it must stay well below the buffer of the channel
+// to the decoder (64KB for a pipe, more for a socket); otherwise writing
+// blocks while the decoder blocks writing n-best lists nobody reads yet.
+const size_t MAX_DECODER_BATCH_BYTES = 16384;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Write all of data to a socket.  A decoder that exited gives an error
+// instead of SIGPIPE, which would kill this process.
+void SendOrThrow(int fd, const string &data)
+{
+  const char *p = data.data();
+  size_t left = data.size();
+  while (left) {
+    ssize_t sent = send(fd, p, left, MSG_NOSIGNAL);
+    if (sent == -1 && errno == EINTR) {
+      continue;
+    }
+    UTIL_THROW_IF2(sent == -1, "Transliteration decoder exited");
+    p += sent;
+    left -= sent;
+  }
+}
+
+}
+
+/** Runs moses on the transliteration model in a child process, which loads
+ * the model once and then translates words (as character sequences) sent
+ * to its standard input.  Each batch of words is followed by an empty
+ * sentence, whose n-best entry marks the end of the batch's n-best lists.
+ */
+class PhraseDictionaryTransliteration::Decoder
+{
+public:
+  Decoder(const string &command)
+    : m_nextId(0) {
+    // a socket rather than a pipe to the child, so writing to it can be
+    // told not to raise SIGPIPE
+    int toChild[2], fromChild[2];
+    UTIL_THROW_IF2(socketpair(AF_UNIX, SOCK_STREAM, 0, toChild) == -1 ||
+                   pipe(fromChild) == -1,
+                   "Could not create pipes for the transliteration decoder");
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(toChild[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    m_pid = fork();
+    UTIL_THROW_IF2(m_pid == -1, "Could not fork the transliteration decoder");
+    if (m_pid == 0) {
+      dup2(toChild[0], 0);
+      dup2(fromChild[1], 1);
+      close(toChild[0]);
+      close(toChild[1]);
+      close(fromChild[0]);
+      close(fromChild[1]);
+      execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+      _exit(127);
+    }
+    close(toChild[0]);
+    close(fromChild[1]);
+    m_toChild = toChild[1];
+    m_fromChild = fdopen(fromChild[0], "r");
+    UTIL_THROW_IF2(m_fromChild == NULL, "Could not read from the transliteration decoder");
+  }
+
+  ~Decoder() {
+    close(m_toChild);
+    fclose(m_fromChild);
+    waitpid(m_pid, NULL, 0);
+  }
+
+  void Transliterate(const vector<string> &words, vector<Transliterations> &out) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    string input;
+    for (size_t begin = 0, end; begin < words.size(); begin = end) {
+      input.clear();
+      for (end = begin; end < words.size(); ++end) {
+        const size_t size = input.size();
+        AppendCharacters(words[end], input);
+        if (end > begin && input.size() > MAX_DECODER_BATCH_BYTES) {
+          input.resize(size);
+          break;
+        }
+      }
+      input += '\n';
+      SendOrThrow(m_toChild, input);
+
+      const size_t firstId = m_nextId;
+      const size_t endId = firstId + (end - begin);
+      m_nextId = endId + 1;
+      string line, target;
+      size_t id;
+      float score;
+      while (true) {
+        UTIL_THROW_IF2(!ReadLine(line), "Transliteration decoder exited");
+        if (!ParseNBestLine(line, id, target, score) || id < firstId) {
+          // more n-best entries for an earlier batch's end marker
+          continue;
+        }
+        if (id >= endId) {
+          break;
+        }
+        if (!target.empty()) {
+          out[begin + id - firstId].push_back(make_pair(target, score));
+        }
+      }
+    }
+  }
+
+private:
+  bool ReadLine(string &line) {
+    line.clear();
+    int c;
+    while ((c = getc(m_fromChild)) != EOF) {
+      if (c == '\n') {
+        return true;
+      }
+      line += (char) c;
+    }
+    return false;
+  }
+
+  pid_t m_pid;
+  int m_toChild;
+  FILE *m_fromChild;
+  size_t m_nextId;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
 PhraseDictionaryTransliteration::PhraseDictionaryTransliteration(const std::string &line)
   : PhraseDictionary(line, true)
+  , m_nBestSize(50)
+  , m_transliterationCacheSize(100000)
 {
   ReadParameters();
-  UTIL_THROW_IF2(m_mosesDir.empty() ||
-                 m_scriptDir.empty() ||
-                 m_externalDir.empty() ||
-                 m_inputLang.empty() ||
-                 m_outputLang.empty(), "Must specify all arguments");
+  UTIL_THROW_IF2(m_mosesDir.empty(), "Must specify moses-dir");
+  UTIL_THROW_IF2(m_decoderConfig.empty() &&
+                 (m_scriptDir.empty() ||
+                  m_externalDir.empty() ||
+                  m_inputLang.empty() ||
+                  m_outputLang.empty()), "Must specify all arguments");
+}
+
+PhraseDictionaryTransliteration::~PhraseDictionaryTransliteration()
+{
 }
 
 void PhraseDictionaryTransliteration::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
   SetFeaturesToApply();
+
+  if (!m_decoderConfig.empty()) {
+    // Transliterate waits for the n-best list of each batch, so the child
+    // must not hold it back in its output buffer
+    string cmd = m_mosesDir + "/bin/moses" +
+                 " -f " + m_decoderConfig +
+                 " -search-algorithm 1 -cube-pruning-pop-limit 5000 -s 5000" +
+                 " -drop-unknown -distortion-limit 0 -v 0" +
+                 " -n-best-list - " + SPrint(m_nBestSize) +
+                 " -output-flush-every 1 -output-flush-interval 0";
+    m_decoder.reset(new Decoder(cmd));
+  }
 }
 
 void PhraseDictionaryTransliteration::CleanUpAfterSentenceProcessing(const InputType& source)
@@ -35,6 +236,11 @@ void PhraseDictionaryTransliteration::CleanUpAfterSentenceProcessing(const Input
 
 void PhraseDictionaryTransliteration::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
+  CacheColl &cache = GetCache();
+
+  // unknown words of the sentence, transliterated together
+  vector<InputPath*> pending;
+  vector<string> pendingWords;
 
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
@@ -51,89 +257,155 @@ void PhraseDictionaryTransliteration::GetTargetPhraseCollectionBatch(const Input
       continue;
     }
 
-    GetTargetPhraseCollection(inputPath);
+    CacheColl::iterator cached = cache.find(hash_value(sourcePhrase));
+    if (cached != cache.end()) {
+      inputPath.SetTargetPhrases(*this, cached->second.first, NULL);
+    } else {
+      pending.push_back(&inputPath);
+      pendingWords.push_back(GetSourceWord(sourcePhrase));
+    }
+  }
+  if (pending.empty()) {
+    return;
   }
-}
 
-void
-PhraseDictionaryTransliteration::
-GetTargetPhraseCollection(InputPath &inputPath) const
-{
-  const Phrase &sourcePhrase = inputPath.GetPhrase();
-  size_t hash = hash_value(sourcePhrase);
+  // look up the words other sentences have seen, transliterate the rest
+  vector<Transliterations> transliterations(pending.size());
+  vector<string> unseen;
+  {
+#ifdef WITH_THREADS
+    boost::shared_lock<boost::shared_mutex> lock(m_transliterationsMutex);
+#endif
+    for (size_t i = 0; i < pendingWords.size(); ++i) {
+      TransliterationCache::const_iterator seen = m_transliterations.find(pendingWords[i]);
+      if (seen != m_transliterations.end()) {
+        transliterations[i] = seen->second;
+      } else {
+        unseen.push_back(pendingWords[i]);
+      }
+    }
+  }
+  if (!unseen.empty()) {
+    sort(unseen.begin(), unseen.end());
+    unseen.erase(unique(unseen.begin(), unseen.end()), unseen.end());
+    vector<Transliterations> results(unseen.size());
+    Transliterate(unseen, results);
+    {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::shared_mutex> lock(m_transliterationsMutex);
+#endif
+      if (m_transliterations.size() + unseen.size() > m_transliterationCacheSize) {
+        m_transliterations.clear();
+      }
+      for (size_t i = 0; i < unseen.size(); ++i) {
+        m_transliterations[unseen[i]] = results[i];
+      }
+    }
+    for (size_t i = 0; i < pendingWords.size(); ++i) {
+      vector<string>::const_iterator found = lower_bound(unseen.begin(), unseen.end(), pendingWords[i]);
+      if (found != unseen.end() && *found == pendingWords[i]) {
+        transliterations[i] = results[found - unseen.begin()];
+      }
+    }
+  }
 
-  CacheColl &cache = GetCache();
+  for (size_t i = 0; i < pending.size(); ++i) {
+    const Phrase &sourcePhrase = pending[i]->GetPhrase();
+    TargetPhraseCollection::shared_ptr tpColl = CreateTargetPhrases(sourcePhrase, transliterations[i]);
+    cache[hash_value(sourcePhrase)] = CacheCollEntry(tpColl, clock());
+    pending[i]->SetTargetPhrases(*this, tpColl, NULL);
+  }
+}
 
-  CacheColl::iterator iter;
-  iter = cache.find(hash);
+std::string PhraseDictionaryTransliteration::GetSourceWord(const Phrase &sourcePhrase) const
+{
+  return sourcePhrase.GetWord(0).GetString(m_input, false);
+}
 
-  if (iter != cache.end()) {
-    // already in cache
-    TargetPhraseCollection::shared_ptr tpColl = iter->second.first;
-    inputPath.SetTargetPhrases(*this, tpColl, NULL);
+void PhraseDictionaryTransliteration::Transliterate(const vector<string> &words, vector<Transliterations> &out) const
+{
+  if (m_decoder) {
+    m_decoder->Transliterate(words, out);
   } else {
-    // TRANSLITERATE
-    const util::temp_file inFile;
-    const util::temp_dir outDir;
-
-    ofstream inStream(inFile.path().c_str());
-    inStream << sourcePhrase.ToString() << endl;
-    inStream.close();
-
-    string cmd = m_scriptDir + "/Transliteration/prepare-transliteration-phrase-table.pl" +
-                 " --transliteration-model-dir " + m_filePath +
-                 " --moses-src-dir " + m_mosesDir +
-                 " --external-bin-dir " + m_externalDir +
-                 " --input-extension " + m_inputLang +
-                 " --output-extension " + m_outputLang +
-                 " --oov-file " + inFile.path() +
-                 " --out-dir " + outDir.path();
-
-    int ret = system(cmd.c_str());
-    UTIL_THROW_IF2(ret != 0, "Transliteration script error");
-
-    TargetPhraseCollection::shared_ptr tpColl(new TargetPhraseCollection);
-    vector<TargetPhrase*> targetPhrases
-    = CreateTargetPhrases(sourcePhrase, outDir.path());
-    vector<TargetPhrase*>::const_iterator iter;
-    for (iter = targetPhrases.begin(); iter != targetPhrases.end(); ++iter) {
-      TargetPhrase *tp = *iter;
-      tpColl->Add(tp);
-    }
-    cache[hash] = CacheCollEntry(tpColl, clock());
-    inputPath.SetTargetPhrases(*this, tpColl, NULL);
+    RunScript(words, out);
   }
 }
 
-std::vector<TargetPhrase*> PhraseDictionaryTransliteration::CreateTargetPhrases(const Phrase &sourcePhrase, const string &outDir) const
+// words are sorted and unique
+void PhraseDictionaryTransliteration::RunScript(const vector<string> &words, vector<Transliterations> &out) const
 {
-  std::vector<TargetPhrase*> ret;
-
-  string outPath = outDir + "/out.txt";
-  ifstream outStream(outPath.c_str());
+  const util::temp_file inFile;
+  const util::temp_dir outDir;
 
+  ofstream inStream(inFile.path().c_str());
+  for (size_t i = 0; i < words.size(); ++i) {
+    inStream << words[i] << endl;
+  }
+  inStream.close();
+
+  // line i of translitPath holds the characters of sentence i of the n-best
+  // list; the script decodes the words in its own order
+  const string translitPath = outDir.path() + "/words.translit";
+  const string nBestPath = outDir.path() + "/words.nbest";
+
+  string cmd = m_scriptDir + "/Transliteration/prepare-transliteration-phrase-table.pl" +
+               " --transliteration-model-dir " + m_filePath +
+               " --moses-src-dir " + m_mosesDir +
+               " --external-bin-dir " + m_externalDir +
+               " --input-extension " + m_inputLang +
+               " --output-extension " + m_outputLang +
+               " --oov-file " + inFile.path() +
+               " --out-dir " + outDir.path() +
+               " --translit-file " + translitPath +
+               " --nbest-file " + nBestPath;
+
+  int ret = system(cmd.c_str());
+  UTIL_THROW_IF2(ret != 0, "Transliteration script error");
+
+  vector<size_t> wordIndex;
+  ifstream translitStream(translitPath.c_str());
   string line;
-  while (getline(outStream, line)) {
-    vector<string> toks;
-    Tokenize(toks, line, "\t");
-    UTIL_THROW_IF2(toks.size() != 2, "Error in transliteration output file. Expecting word\tscore");
+  while (getline(translitStream, line)) {
+    string word;
+    for (size_t i = 0; i < line.size(); ++i) {
+      if (line[i] != ' ') {
+        word += line[i];
+      }
+    }
+    size_t index = lower_bound(words.begin(), words.end(), word) - words.begin();
+    UTIL_THROW_IF2(index == words.size() || words[index] != word,
+                   "Unexpected word in transliteration input " << word);
+    wordIndex.push_back(index);
+  }
 
+  ifstream nBestStream(nBestPath.c_str());
+  string target;
+  size_t id;
+  float score;
+  while (getline(nBestStream, line)) {
+    UTIL_THROW_IF2(!ParseNBestLine(line, id, target, score) || id >= wordIndex.size(),
+                   "Error in transliteration n-best list: " << line);
+    out[wordIndex[id]].push_back(make_pair(target, score));
+  }
+}
+
+TargetPhraseCollection::shared_ptr PhraseDictionaryTransliteration::CreateTargetPhrases(const Phrase &sourcePhrase, const Transliterations &transliterations) const
+{
+  TargetPhraseCollection::shared_ptr tpColl(new TargetPhraseCollection);
+  Transliterations::const_iterator iter;
+  for (iter = transliterations.begin(); iter != transliterations.end(); ++iter) {
     TargetPhrase *tp = new TargetPhrase(this);
     Word &word = tp->AddWord();
-    word.CreateFromString(Output, m_output, toks[0], false);
+    word.CreateFromString(Output, m_output, iter->first, false);
 
-    float score = Scan<float>(toks[1]);
-    tp->GetScoreBreakdown().PlusEquals(this, score);
+    tp->GetScoreBreakdown().PlusEquals(this, iter->second);
 
     // score of all other ff when this rule is being loaded
     tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
 
-    ret.push_back(tp);
+    tpColl->Add(tp);
   }
-
-  outStream.close();
-
-  return ret;
+  return tpColl;
 }
 
 ChartRuleLookupManager* PhraseDictionaryTransliteration::CreateRuleLookupManager(const ChartParser &parser,
@@ -158,6 +430,12 @@ SetParameter(const std::string& key, const std::string& value)
     m_inputLang = value;
   } else if (key == "output-lang") {
     m_outputLang = value;
+  } else if (key == "decoder-config") {
+    m_decoderConfig = value;
+  } else if (key == "n-best") {
+    m_nBestSize = Scan<size_t>(value);
+  } else if (key == "transliteration-cache-size") {
+    m_transliterationCacheSize = Scan<size_t>(value);
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
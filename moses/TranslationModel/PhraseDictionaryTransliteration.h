@@ -2,7 +2,12 @@
 #pragma once
 
 #include "PhraseDictionary.h"
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/tss.hpp>
+#include <boost/unordered_map.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
 
 namespace Moses
 {
@@ -17,6 +22,7 @@ class PhraseDictionaryTransliteration : public PhraseDictionary
 
 public:
   PhraseDictionaryTransliteration(const std::string &line);
+  ~PhraseDictionaryTransliteration();
 
   void Load(AllOptions::ptr const& opts);
 
@@ -33,11 +39,32 @@ public:
   TO_STRING();
 
 protected:
+  //! (transliteration, score) pairs of a word, best first
+  typedef std::vector<std::pair<std::string, float> > Transliterations;
+  typedef boost::unordered_map<std::string, Transliterations> TransliterationCache;
+
+  //! a moses process that keeps the transliteration model loaded
+  class Decoder;
+
   std::string m_mosesDir, m_scriptDir, m_externalDir, m_inputLang, m_outputLang;
+  std::string m_decoderConfig;
+  size_t m_nBestSize;
+  size_t m_transliterationCacheSize;
+
+  boost::scoped_ptr<Decoder> m_decoder;
+
+  // transliterations of all words seen so far, shared by all threads
+  mutable TransliterationCache m_transliterations;
+#ifdef WITH_THREADS
+  mutable boost::shared_mutex m_transliterationsMutex;
+#endif
+
+  std::string GetSourceWord(const Phrase &sourcePhrase) const;
 
-  std::vector<TargetPhrase*> CreateTargetPhrases(const Phrase &sourcePhrase, const std::string &outDir) const;
+  void Transliterate(const std::vector<std::string> &words, std::vector<Transliterations> &out) const;
+  void RunScript(const std::vector<std::string> &words, std::vector<Transliterations> &out) const;
 
-  void GetTargetPhraseCollection(InputPath &inputPath) const;
+  TargetPhraseCollection::shared_ptr CreateTargetPhrases(const Phrase &sourcePhrase, const Transliterations &transliterations) const;
 
 };
 
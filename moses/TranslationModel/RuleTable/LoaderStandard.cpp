@@ -36,6 +36,7 @@
 #include "moses/Range.h"
 #include "moses/ChartTranslationOptionList.h"
 #include "moses/FactorCollection.h"
+#include "moses/Syntax/RuleTableReader.h"
 #include "util/file_piece.hh"
 #include "util/string_piece.hh"
 #include "util/tokenize_piece.hh"
@@ -149,6 +150,26 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
 {
   PrintUserTime(string("Start loading text phrase table. ") + (format==MosesFormat?"Moses":"Hiero") + " format");
 
+  if (format == MosesFormat) {
+    // parsed by Syntax::RuleTableReader, which can use several threads and
+    // a binary dump of the table
+    Syntax::RuleTableReader reader(opts, input, output, inFile, ruleTable,
+                                   ruleTable.GetLoadThreads(), ruleTable.GetBinaryDump());
+    Syntax::ParsedRule rule;
+    while (reader.Next(rule)) {
+      TargetPhraseCollection::shared_ptr phraseColl
+      = GetOrCreateTargetPhraseCollection(ruleTable, rule.source,
+                                          *rule.target, rule.sourceLHS);
+      phraseColl->Add(rule.target);
+
+      // not implemented correctly in memory pt. just delete it for now
+      delete rule.sourceLHS;
+    }
+
+    SortAndPrune(ruleTable);
+    return true;
+  }
+
   // const StaticData &staticData = StaticData::Instance();
 
   string lineOrig;
@@ -172,11 +193,10 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
       break;
     }
 
-    if (format == HieroFormat) { // inefficiently reformat line
-      hiero_before.assign(line.data(), line.size());
-      ReformatHieroRule(hiero_before, hiero_after);
-      line = hiero_after;
-    }
+    // inefficiently reformat line
+    hiero_before.assign(line.data(), line.size());
+    ReformatHieroRule(hiero_before, hiero_after);
+    line = hiero_after;
 
     util::TokenIter<util::MultiCharacter> pipes(line, "|||");
     StringPiece sourcePhraseString(*pipes);
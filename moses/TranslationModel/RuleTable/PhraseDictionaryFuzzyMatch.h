@@ -20,6 +20,10 @@
 
 #pragma once
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "Trie.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/InputType.h"
@@ -74,8 +78,15 @@ protected:
   void SortAndPrune(PhraseDictionaryNodeMemory &rootNode);
   PhraseDictionaryNodeMemory &GetRootNode(const InputType &source);
 
+  // per-sentence rule tries, by translation ID
   std::map<long, PhraseDictionaryNodeMemory> m_collection;
+#ifdef WITH_THREADS
+  mutable boost::mutex m_accessLock;
+#endif
   std::vector<std::string> m_config;
+  // verify fuzzy-match candidates by bit-parallel edit distance
+  bool m_fastMatch;
+  size_t m_matchThreads;
 
   tmmt::FuzzyMatchWrapper *m_FuzzyMatchWrapper;
 
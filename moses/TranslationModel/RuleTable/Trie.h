@@ -41,14 +41,31 @@ class RuleTableTrie : public PhraseDictionary
 {
 public:
   RuleTableTrie(const std::string &line)
-    : PhraseDictionary(line, true) {
+    : PhraseDictionary(line, true)
+    , m_loadThreads(0) {
   }
 
   virtual ~RuleTableTrie();
 
   void Load(AllOptions::ptr const& opts);
 
+  void SetParameter(const std::string& key, const std::string& value);
+
+  // Number of threads parsing a Moses-format table while it is loaded, 0 to
+  // parse in the loading thread.
+  std::size_t GetLoadThreads() const {
+    return m_loadThreads;
+  }
+
+  // File for the binary dump of the parsed Moses-format table, or empty.
+  const std::string &GetBinaryDump() const {
+    return m_binaryDump;
+  }
+
 private:
+  std::size_t m_loadThreads;
+  std::string m_binaryDump;
+
   friend class RuleTableLoader;
 
   virtual TargetPhraseCollection::shared_ptr
@@ -7,20 +7,25 @@
 //
 
 #include <iostream>
+#ifdef WITH_THREADS
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
 #include "FuzzyMatchWrapper.h"
 #include "SentenceAlignment.h"
 #include "Match.h"
+#include "WordEditDistance.h"
 #include "create_xml.h"
 #include "moses/Util.h"
-#include "moses/StaticData.h"
-#include "util/file.hh"
 
 using namespace std;
 
 namespace tmmt
 {
 
-FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath)
+FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::string &targetPath, const std::string &alignmentPath,
+                                     bool fastMatch, size_t threads)
   :basic_flag(false)
   ,lsed_flag(true)
   ,refined_flag(true)
@@ -30,9 +35,11 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   ,multiple_flag(true)
   ,multiple_slack(0)
   ,multiple_max(100)
+  ,m_fastMatch(fastMatch)
+  ,m_threads(threads ? threads : 1)
 {
   cerr << "creating suffix array" << endl;
-  suffixArray = new tmmt::SuffixArray( sourcePath );
+  suffixArray = new tmmt::SuffixArray( sourcePath, m_threads );
 
   //cerr << "loading source data" << endl;
   //load_corpus(sourcePath, source);
@@ -49,55 +56,68 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   cerr << "loading completed" << endl;
 }
 
-string FuzzyMatchWrapper::Extract(long translationId, const string &dirNameStr)
+void FuzzyMatchWrapper::Extract(long translationId, const string &input, vector<ExtractedRule> &rules)
 {
-  const Moses::StaticData &staticData = Moses::StaticData::Instance();
-
   WordIndex wordIndex;
 
-  string fuzzyMatchFile = ExtractTM(wordIndex, translationId, dirNameStr);
+  vector< WORD_ID > inputIds = GetVocabulary().Tokenize( input.c_str() );
+  ExtractTM(wordIndex, translationId, inputIds, rules);
 
-  // create extrac files
-  create_xml(fuzzyMatchFile);
-
-  // create phrase table with usual Moses scoring and consolidate programs
-  string cmd;
-  cmd = "LC_ALL=C sort " + fuzzyMatchFile + ".extract | gzip -c > "
-        + fuzzyMatchFile + ".extract.sorted.gz";
-  system(cmd.c_str());
-  cmd = "LC_ALL=C sort " + fuzzyMatchFile + ".extract.inv | gzip -c > "
-        + fuzzyMatchFile + ".extract.inv.sorted.gz";
-  system(cmd.c_str());
+  // score like the usual Moses scoring and consolidate programs would
+  Score(rules);
+}
 
-#ifdef IS_XCODE
-  cmd = "/Users/hieuhoang/unison/workspace/github/moses-smt/bin";
-#elif IS_ECLIPSE
-  cmd = "/home/hieu/workspace/github/moses-smt/bin";
-#else
-  cmd = staticData.GetBinDirectory();
-#endif
+namespace
+{
+struct RuleStats {
+  size_t index;
+  std::map<string, float> alignments;
+};
+}
 
-  cmd += string("/../scripts/training/train-model.perl -dont-zip -first-step 6 -last-step 6 -f en -e fr -hierarchical ")
-         + " -extract-file " + fuzzyMatchFile + ".extract -lexical-file - -score-options \"--NoLex\" "
-         + " -phrase-translation-table " + fuzzyMatchFile + ".pt";
-  system(cmd.c_str());
+void FuzzyMatchWrapper::Score(vector<ExtractedRule> &rules)
+{
+  // merge identical rules, keeping the most frequent alignment
+  map< pair<string, string>, RuleStats > merged;
+  map< string, float > sourceCount, targetCount;
+  vector<ExtractedRule> unique;
+
+  for (size_t i = 0; i < rules.size(); ++i) {
+    const ExtractedRule &rule = rules[i];
+    pair<string, string> key(rule.source, rule.target);
+    map< pair<string, string>, RuleStats >::iterator iter = merged.find(key);
+    if (iter == merged.end()) {
+      iter = merged.insert(make_pair(key, RuleStats())).first;
+      iter->second.index = unique.size();
+      unique.push_back(rule);
+    } else {
+      unique[iter->second.index].count += rule.count;
+    }
+    float &alignCount = iter->second.alignments[rule.alignment];
+    alignCount += rule.count;
+    if (alignCount > iter->second.alignments[unique[iter->second.index].alignment]) {
+      unique[iter->second.index].alignment = rule.alignment;
+    }
 
+    sourceCount[rule.source] += rule.count;
+    targetCount[rule.target] += rule.count;
+  }
 
-  return fuzzyMatchFile + ".pt.gz";
+  // inverse then direct phrase translation probability
+  for (size_t i = 0; i < unique.size(); ++i) {
+    ExtractedRule &rule = unique[i];
+    rule.scores.resize(2);
+    rule.scores[0] = rule.count / targetCount[rule.target];
+    rule.scores[1] = rule.count / sourceCount[rule.source];
+  }
+  rules.swap(unique);
 }
 
-string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const string &dirNameStr)
+void FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const vector< WORD_ID > &inputIds, vector<ExtractedRule> &rules)
 {
   const std::vector< std::vector< WORD_ID > > &source = suffixArray->GetCorpus();
 
-  string inputPath = dirNameStr + "/in";
-  string fuzzyMatchFile = dirNameStr + "/fuzzyMatchFile";
-  ofstream fuzzyMatchStream(fuzzyMatchFile.c_str());
-
-  vector< vector< WORD_ID > > input;
-  load_corpus(inputPath, input);
-
-  assert(input.size() == 1);
+  vector< vector< WORD_ID > > input(1, inputIds);
   size_t sentenceInd = 0;
 
   clock_t start_clock = clock();
@@ -247,6 +267,7 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     init_short_matches(wordIndex, translationId, input[sentenceInd] );
   }
   vector< int > best_tm;
+  vector< int > candidates;
   typedef map< int, vector< Match > >::iterator I;
 
   clock_t clock_validation_sum = 0;
@@ -271,6 +292,12 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     }
     tm_count_word_match++;
 
+    // the exact distance is cheap enough to skip pruning and parsing
+    if (m_fastMatch) {
+      candidates.push_back( tmID );
+      continue;
+    }
+
     // prune, check again how many words are matched
     vector< Match > pruned = prune_matches( match, best_cost );
     words_matched = 0;
@@ -307,6 +334,20 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
       best_tm.push_back( tmID );
     }
   }
+
+  if (m_fastMatch) {
+    clock_t clock_validation_start = clock();
+    WordEditDistance distance( input[sentenceInd] );
+    vector< unsigned int > costs;
+    verify_candidates( distance, candidates, costs, best_cost );
+    for(size_t c=0; c<candidates.size(); c++) {
+      if (costs[c] == (unsigned int) best_cost) {
+        best_tm.push_back( candidates[c] );
+      }
+    }
+    tm_count_word_match2 = candidates.size();
+    clock_validation_sum += clock() - clock_validation_start;
+  }
   cerr << "reduced best cost from " << old_best_cost << " to " << best_cost << endl;
   cerr << "tm considered: " << sentence_match.size()
        << " word-matched: " << tm_count_word_match
@@ -329,7 +370,7 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
       sed( input[sentenceInd], source[s], path, true );
       const vector<WORD_ID> &sourceSentence = source[s];
       vector<SentenceAlignment> &targets = targetAndAlignment[s];
-      create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, path, fuzzyMatchStream);
+      create_extract(sourceSentence, targets, inputStr, path, rules);
 
     }
   } // if (multiple_flag)
@@ -384,13 +425,9 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     // creat xml & extracts
     const vector<WORD_ID> &sourceSentence = source[best_match];
     vector<SentenceAlignment> &targets = targetAndAlignment[best_match];
-    create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, best_path, fuzzyMatchStream);
+    create_extract(sourceSentence, targets, inputStr, best_path, rules);
 
   } // else if (multiple_flag)
-
-  fuzzyMatchStream.close();
-
-  return fuzzyMatchFile;
 }
 
 void FuzzyMatchWrapper::load_corpus( const std::string &fileName, vector< vector< WORD_ID > > &corpus )
@@ -511,37 +548,13 @@ void FuzzyMatchWrapper::load_alignment(const std::string &fileName, vector< vect
   }
 }
 
-bool FuzzyMatchWrapper::GetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, unsigned int &value) const
-{
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-#endif
-  map< pair< WORD_ID, WORD_ID >, unsigned int >::const_iterator lookup = m_lsed.find( key );
-  if (lookup != m_lsed.end()) {
-    value = lookup->second;
-    return true;
-  }
-
-  return false;
-}
-
-void FuzzyMatchWrapper::SetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, const unsigned int &value)
-{
-#ifdef WITH_THREADS
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif
-  m_lsed[ key ] = value;
-}
-
 /* Letter string edit distance, e.g. sub 'their' to 'there' costs 2 */
 
 unsigned int FuzzyMatchWrapper::letter_sed( WORD_ID aIdx, WORD_ID bIdx )
 {
   // check if already computed -> lookup in cache
-  pair< WORD_ID, WORD_ID > pIdx = make_pair( aIdx, bIdx );
   unsigned int value;
-  bool ret = GetLSEDCache(pIdx, value);
-  if (ret) {
+  if (m_lsed.Find( aIdx, bIdx, value )) {
     return value;
   }
 
@@ -583,7 +596,7 @@ unsigned int FuzzyMatchWrapper::letter_sed( WORD_ID aIdx, WORD_ID bIdx )
   free( cost );
 
   // cache and return result
-  SetLSEDCache(pIdx, final);
+  m_lsed.Insert( aIdx, bIdx, final );
   return final;
 }
 
@@ -715,7 +728,7 @@ void FuzzyMatchWrapper::basic_fuzzy_match( vector< vector< WORD_ID > > source,
       input_length = input[i].size();
     }
     unsigned int best_cost = input_length * (100-min_match) / 100 + 2;
-    string best_path = "";
+    WordEditDistance distance( input[i] );
     //int best_match = -1;
 
     // go through all corpus sentences
@@ -732,13 +745,17 @@ void FuzzyMatchWrapper::basic_fuzzy_match( vector< vector< WORD_ID > > source,
       }
 
       // compute string edit distance
-      string path;
-      unsigned int cost = sed( input[i], source[s], path, use_letter_sed );
+      unsigned int cost;
+      if (use_letter_sed) {
+        string path;
+        cost = sed( input[i], source[s], path, use_letter_sed );
+      } else {
+        cost = distance.Distance( source[s], best_cost );
+      }
 
       // update if new best
       if (cost < best_cost) {
         best_cost = cost;
-        best_path = path;
         //best_match = s;
       }
     }
@@ -746,6 +763,113 @@ void FuzzyMatchWrapper::basic_fuzzy_match( vector< vector< WORD_ID > > source,
   }
 }
 
+namespace
+{
+/* verifies candidates handed out in small chunks, so that threads
+ stay busy whatever the spread of sentence lengths */
+class CandidateVerifier
+{
+public:
+  CandidateVerifier(const WordEditDistance &distance,
+                    const vector< vector< WORD_ID > > &source,
+                    const vector< int > &candidates,
+                    vector< unsigned int > &costs,
+                    int best_cost)
+    :m_distance(distance)
+    ,m_source(source)
+    ,m_candidates(candidates)
+    ,m_costs(costs)
+    ,m_next(0)
+    ,m_bestCost(best_cost) {
+  }
+
+  void Run() {
+    const size_t chunk = 16;
+    for(;;) {
+#ifdef WITH_THREADS
+      size_t begin = m_next.fetch_add( chunk );
+#else
+      size_t begin = m_next;
+      m_next += chunk;
+#endif
+      if (begin >= m_candidates.size()) {
+        break;
+      }
+      size_t end = min( begin + chunk, m_candidates.size() );
+      for(size_t c=begin; c<end; c++) {
+        // anything worse than the best cost so far is not needed exactly
+        int bound = GetBestCost();
+        unsigned int cost = m_distance.Distance( m_source[ m_candidates[c] ], bound );
+        m_costs[c] = cost;
+        if ((int) cost < bound) {
+          Lower( cost );
+        }
+      }
+    }
+  }
+
+  int GetBestCost() const {
+#ifdef WITH_THREADS
+    return m_bestCost.load();
+#else
+    return m_bestCost;
+#endif
+  }
+
+private:
+  void Lower(int cost) {
+#ifdef WITH_THREADS
+    int current = m_bestCost.load();
+    while (cost < current && !m_bestCost.compare_exchange_weak( current, cost )) {
+    }
+#else
+    if (cost < m_bestCost) {
+      m_bestCost = cost;
+    }
+#endif
+  }
+
+  const WordEditDistance &m_distance;
+  const vector< vector< WORD_ID > > &m_source;
+  const vector< int > &m_candidates;
+  vector< unsigned int > &m_costs;
+#ifdef WITH_THREADS
+  boost::atomic< size_t > m_next;
+  boost::atomic< int > m_bestCost;
+#else
+  size_t m_next;
+  int m_bestCost;
+#endif
+};
+}
+
+/* compute the word edit distance of each candidate sentence to the
+ input, lowering best_cost to the smallest one.  Costs above the final
+ best_cost are only known to be larger, not exact. */
+
+void FuzzyMatchWrapper::verify_candidates( const WordEditDistance &distance, const vector< int > &candidates, vector< unsigned int > &costs, int &best_cost )
+{
+  costs.resize( candidates.size() );
+  CandidateVerifier verifier( distance, suffixArray->GetCorpus(), candidates, costs, best_cost );
+
+  // threads only pay off for a decent number of candidates
+  size_t threads = min( m_threads, candidates.size() / 64 + 1 );
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    boost::thread_group group;
+    for(size_t t=1; t<threads; t++) {
+      group.create_thread( boost::bind( &CandidateVerifier::Run, &verifier ) );
+    }
+    verifier.Run();
+    group.join_all();
+  } else
+#endif
+  {
+    verifier.Run();
+  }
+  best_cost = verifier.GetBestCost();
+}
+
 /* definition of short matches
  very short n-gram matches (1-grams) will not be looked up in
  the suffix array, since there are too many matches
@@ -1000,7 +1124,7 @@ int FuzzyMatchWrapper::parse_matches( vector< Match > &match, int input_length,
 }
 
 
-void FuzzyMatchWrapper::create_extract(int sentenceInd, int cost, const vector< WORD_ID > &sourceSentence, const vector<SentenceAlignment> &targets, const string &inputStr, const string  &path, ofstream &outputFile)
+void FuzzyMatchWrapper::create_extract(const vector< WORD_ID > &sourceSentence, const vector<SentenceAlignment> &targets, const string &inputStr, const string  &path, vector<ExtractedRule> &rules)
 {
   string sourceStr;
   for (size_t pos = 0; pos < sourceSentence.size(); ++pos) {
@@ -1013,16 +1137,14 @@ void FuzzyMatchWrapper::create_extract(int sentenceInd, int cost, const vector<
     string targetStr = sentenceAlignment.getTargetString(GetVocabulary());
     string alignStr = sentenceAlignment.getAlignmentString();
 
-    outputFile
-        << sentenceInd << endl
-        << cost << endl
-        << sourceStr << endl
-        << inputStr << endl
-        << targetStr << endl
-        << alignStr << endl
-        << path << endl
-        << sentenceAlignment.count << endl;
+    CreateXMLRetValues ret = createXML(rules.size() + 1, sourceStr, inputStr, targetStr, alignStr, path + "X");
 
+    ExtractedRule rule;
+    rule.source = ret.ruleS + " [X]";
+    rule.target = ret.ruleT + " [X]";
+    rule.alignment = ret.ruleAlignment;
+    rule.count = sentenceAlignment.count;
+    rules.push_back(rule);
   }
 }
 
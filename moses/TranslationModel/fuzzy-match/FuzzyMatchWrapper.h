@@ -9,28 +9,52 @@
 #ifndef moses_FuzzyMatchWrapper_h
 #define moses_FuzzyMatchWrapper_h
 
-#ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
-#endif
-
 #include <fstream>
 #include <string>
+#include <vector>
 #include "SuffixArray.h"
 #include "Vocabulary.h"
 #include "Match.h"
+#include "LetterEditDistanceCache.h"
 #include "moses/InputType.h"
 
 namespace tmmt
 {
 class Match;
+class WordEditDistance;
 struct SentenceAlignment;
 
+/** A hierarchical rule built from a translation memory match.  The source
+ * and target sides end in the [X] left-hand side, as in an extract file.
+ */
+struct ExtractedRule {
+  std::string source;
+  std::string target;
+  std::string alignment;
+  float count;
+  //! p(s|t) and p(t|s), set by FuzzyMatchWrapper::Score()
+  std::vector<float> scores;
+};
+
 class FuzzyMatchWrapper
 {
 public:
-  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment);
-
-  std::string Extract(long translationId, const std::string &dirNameStr);
+  /** with fastMatch, candidate sentences are verified by bit-parallel
+   * edit distance, spread over the given number of threads, instead of
+   * A* parsing of their n-gram matches.  The source may also be a
+   * suffix array saved by biconcor, which is then mapped, not built. */
+  FuzzyMatchWrapper(const std::string &source, const std::string &target, const std::string &alignment,
+                    bool fastMatch = false, size_t threads = 1);
+
+  /** fuzzy-match an input sentence (space separated words) against the
+   * translation memory and return the scored rules built from the best
+   * matches.  Runs in memory and may be called from several threads.
+   */
+  void Extract(long translationId, const std::string &input, std::vector<ExtractedRule> &rules);
+
+  /** merge identical rules and add relative frequency scores, as
+   * score --NoLex and consolidate do for a rule table */
+  static void Score(std::vector<ExtractedRule> &rules);
 
 protected:
   // tm-mt
@@ -45,15 +69,13 @@ protected:
   int multiple_flag;
   int multiple_slack;
   int multiple_max;
+  bool m_fastMatch;
+  size_t m_threads;
 
   typedef std::map< WORD_ID,std::vector< int > > WordIndex;
 
   // global cache for word pairs
-  std::map< std::pair< WORD_ID, WORD_ID >, unsigned int > m_lsed;
-#ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
-#endif
+  LetterEditDistanceCache m_lsed;
 
   void load_corpus( const std::string &fileName, std::vector< std::vector< tmmt::WORD_ID > > &corpus );
   void load_target( const std::string &fileName, std::vector< std::vector< tmmt::SentenceAlignment > > &corpus);
@@ -73,17 +95,15 @@ protected:
   void add_short_matches(WordIndex &wordIndex, long translationId, std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost );
   std::vector< Match > prune_matches( const std::vector< Match > &match, int best_cost );
   int parse_matches( std::vector< Match > &match, int input_length, int tm_length, int &best_cost );
+  void verify_candidates( const WordEditDistance &distance, const std::vector< int > &candidates, std::vector< unsigned int > &costs, int &best_cost );
 
-  void create_extract(int sentenceInd, int cost, const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string &inputStr, const std::string  &path, std::ofstream &outputFile);
+  void create_extract(const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string &inputStr, const std::string  &path, std::vector<ExtractedRule> &rules);
 
-  std::string ExtractTM(WordIndex &wordIndex, long translationId, const std::string &inputPath);
+  void ExtractTM(WordIndex &wordIndex, long translationId, const std::vector< WORD_ID > &input, std::vector<ExtractedRule> &rules);
   Vocabulary &GetVocabulary() {
     return suffixArray->GetVocabulary();
   }
 
-  bool GetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, unsigned int &value) const;
-  void SetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, const unsigned int &value);
-
 };
 
 }
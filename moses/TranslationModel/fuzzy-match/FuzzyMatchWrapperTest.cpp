@@ -0,0 +1,157 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "FuzzyMatchWrapper.h"
+#include "SentenceAlignment.h"
+#include "moses/TempDir.h"
+
+using namespace tmmt;
+using namespace std;
+
+namespace
+{
+
+// A translation memory in temporary files: source, target with counts, and
+// alignment.
+struct TranslationMemory : public Moses::TempDir {
+  TranslationMemory() : Moses::TempDir("fuzzy-match") {
+    Write("source", "the house is small\nthe house is big\na cat sat on the mat\n");
+    Write("target", "1 das haus ist klein\n1 das haus ist gross\n1 eine katze sass auf der matte\n");
+    Write("alignment", "0-0 1-1 2-2 3-3\n0-0 1-1 2-2 3-3\n0-0 1-1 2-2 3-3 4-4 5-5\n");
+  }
+};
+
+string Describe(const vector<ExtractedRule> &rules)
+{
+  ostringstream out;
+  for (size_t i = 0; i < rules.size(); ++i) {
+    const ExtractedRule &rule = rules[i];
+    out << rule.source << " ||| " << rule.target << " ||| " << rule.alignment
+        << " ||| " << rule.count;
+    for (size_t s = 0; s < rule.scores.size(); ++s) out << " " << rule.scores[s];
+    out << "\n";
+  }
+  return out.str();
+}
+
+ExtractedRule MakeRule(const string &source, const string &target, const string &alignment, float count)
+{
+  ExtractedRule rule;
+  rule.source = source;
+  rule.target = target;
+  rule.alignment = alignment;
+  rule.count = count;
+  return rule;
+}
+
+const char *kInputs[] = {
+  "the house is small",
+  "the house is tiny",
+  "a dog sat on the mat",
+  "nothing here",
+};
+const size_t kNumInputs = sizeof(kInputs) / sizeof(kInputs[0]);
+
+void ExtractAll(FuzzyMatchWrapper &wrapper, size_t repeat, vector<string> &out)
+{
+  out.resize(kNumInputs * repeat);
+  for (size_t i = 0; i < out.size(); ++i) {
+    vector<ExtractedRule> rules;
+    wrapper.Extract(i, kInputs[i % kNumInputs], rules);
+    out[i] = Describe(rules);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(fuzzy_match_wrapper)
+
+BOOST_AUTO_TEST_CASE(score_merges_rules)
+{
+  vector<ExtractedRule> rules;
+  rules.push_back(MakeRule("a [X]", "x [X]", "0-0 ", 1));
+  rules.push_back(MakeRule("a [X]", "y [X]", "0-0 ", 1));
+  rules.push_back(MakeRule("a [X]", "x [X]", "0-1 ", 2));
+  rules.push_back(MakeRule("b [X]", "x [X]", "0-0 ", 1));
+  FuzzyMatchWrapper::Score(rules);
+
+  // first seen order, most frequent alignment, then p(s|t) and p(t|s)
+  BOOST_CHECK_EQUAL(Describe(rules),
+                    "a [X] ||| x [X] ||| 0-1  ||| 3 0.75 0.75\n"
+                    "a [X] ||| y [X] ||| 0-0  ||| 1 1 0.25\n"
+                    "b [X] ||| x [X] ||| 0-0  ||| 1 0.25 1\n");
+}
+
+BOOST_AUTO_TEST_CASE(extract_rules)
+{
+  TranslationMemory tm;
+  const string expected =
+    "the house is small [X] ||| das haus ist klein [X] ||| 0-0 1-1 2-2 3-3 ||| 1 1 1\n"
+    "|"
+    "the house is [X][X] [X] ||| das haus ist [X][X] [X] ||| 0-0 1-1 2-2 3-3 ||| 2 1 1\n"
+    "|"
+    "a [X][X] sat on the mat [X] ||| eine [X][X] sass auf der matte [X] ||| 0-0 2-2 3-3 4-4 5-5 1-1 ||| 1 1 1\n"
+    "|"
+    "|";
+
+  // A* parsing of the n-gram matches and the bit-parallel verification
+  // find the same matches
+  for (int fastMatch = 0; fastMatch < 2; ++fastMatch) {
+    FuzzyMatchWrapper wrapper(tm.File("source"), tm.File("target"), tm.File("alignment"), fastMatch, 2);
+    vector<string> got;
+    ExtractAll(wrapper, 1, got);
+    string joined;
+    for (size_t i = 0; i < got.size(); ++i) joined += got[i] + "|";
+    BOOST_CHECK_EQUAL(joined, expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(extract_from_threads)
+{
+  TranslationMemory tm;
+  FuzzyMatchWrapper serialWrapper(tm.File("source"), tm.File("target"), tm.File("alignment"));
+  vector<string> serial;
+  ExtractAll(serialWrapper, 1, serial);
+
+  // input words are added to the vocabulary while the other threads read it
+  FuzzyMatchWrapper wrapper(tm.File("source"), tm.File("target"), tm.File("alignment"));
+  const size_t numThreads = 4, repeat = 50;
+  vector< vector<string> > results(numThreads);
+  boost::thread_group threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.create_thread(boost::bind(&ExtractAll, boost::ref(wrapper), repeat, boost::ref(results[t])));
+  }
+  threads.join_all();
+
+  for (size_t t = 0; t < numThreads; ++t) {
+    BOOST_REQUIRE_EQUAL(results[t].size(), kNumInputs * repeat);
+    for (size_t i = 0; i < results[t].size(); ++i) {
+      BOOST_CHECK_EQUAL(results[t][i], serial[i % kNumInputs]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+#include "LetterEditDistanceCache.h"
+
+namespace tmmt
+{
+
+LetterEditDistanceCache::LetterEditDistanceCache(size_t capacity)
+{
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_mask = size - 1;
+  m_entries.reset(new Entry[size]);
+  for (size_t i = 0; i < size; ++i) {
+#ifdef WITH_THREADS
+    m_entries[i].store(0, boost::memory_order_relaxed);
+#else
+    m_entries[i] = 0;
+#endif
+  }
+}
+
+bool LetterEditDistanceCache::Key(WORD_ID a, WORD_ID b, uint64_t &key)
+{
+  const uint64_t maxId = ((uint64_t)1 << ID_BITS) - 1;
+  if (a >= maxId || b >= maxId) {
+    return false;
+  }
+  key = (((uint64_t)a + 1) << ID_BITS) | ((uint64_t)b + 1);
+  return true;
+}
+
+bool LetterEditDistanceCache::Find(WORD_ID a, WORD_ID b, unsigned int &value) const
+{
+  uint64_t key;
+  if (!Key(a, b, key)) {
+    return false;
+  }
+  size_t slot = (key * 0x9E3779B97F4A7C15ULL >> 32) & m_mask;
+#ifdef WITH_THREADS
+  uint64_t entry = m_entries[slot].load(boost::memory_order_relaxed);
+#else
+  uint64_t entry = m_entries[slot];
+#endif
+  if (entry >> VALUE_BITS != key) {
+    return false;
+  }
+  value = entry & (((uint64_t)1 << VALUE_BITS) - 1);
+  return true;
+}
+
+void LetterEditDistanceCache::Insert(WORD_ID a, WORD_ID b, unsigned int value)
+{
+  uint64_t key;
+  if (!Key(a, b, key) || value >> VALUE_BITS) {
+    return;
+  }
+  size_t slot = (key * 0x9E3779B97F4A7C15ULL >> 32) & m_mask;
+  uint64_t entry = (key << VALUE_BITS) | value;
+#ifdef WITH_THREADS
+  m_entries[slot].store(entry, boost::memory_order_relaxed);
+#else
+  m_entries[slot] = entry;
+#endif
+}
+
+}
+
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <boost/scoped_array.hpp>
+#ifdef WITH_THREADS
+#include <boost/atomic.hpp>
+#endif
+#include "Vocabulary.h"
+
+namespace tmmt
+{
+
+/** Fixed-size cache of letter edit distances between word pairs.
+ *
+ * The table is direct-mapped and each slot packs both word IDs and the
+ * distance into one 64 bit value, so lookups and inserts are single
+ * atomic loads and stores: threads neither lock nor see half-written
+ * entries.  A newer pair simply replaces whatever shared its slot.
+ * Pairs whose IDs or distance do not fit the packing are not cached.
+ */
+class LetterEditDistanceCache
+{
+public:
+  LetterEditDistanceCache(size_t capacity = 1 << 20);
+
+  bool Find(WORD_ID a, WORD_ID b, unsigned int &value) const;
+  void Insert(WORD_ID a, WORD_ID b, unsigned int value);
+
+private:
+  static const unsigned int ID_BITS = 26;
+  static const unsigned int VALUE_BITS = 12;
+
+  // 0 marks an empty slot, so IDs are stored plus one
+  static bool Key(WORD_ID a, WORD_ID b, uint64_t &key);
+
+#ifdef WITH_THREADS
+  typedef boost::atomic< uint64_t > Entry;
+#else
+  typedef uint64_t Entry;
+#endif
+  boost::scoped_array< Entry > m_entries;
+  size_t m_mask;
+};
+
+}
+
@@ -1,4 +1,6 @@
 #include "SuffixArray.h"
+#include "util/suffix_array.hh"
+#include <map>
 #include <string>
 #include <stdlib.h>
 #include <cstring>
@@ -8,7 +10,16 @@ using namespace std;
 namespace tmmt
 {
 
-SuffixArray::SuffixArray( string fileName )
+SuffixArray::SuffixArray( const string &fileName, size_t threads )
+{
+  if (util::IsSuffixArrayFile( fileName.c_str() )) {
+    Load( fileName );
+  } else {
+    Create( fileName, threads );
+  }
+}
+
+void SuffixArray::Create( const string &fileName, size_t threads )
 {
   m_vcb.StoreIfNew( "<uNk>" );
   m_endOfSentence = m_vcb.StoreIfNew( "<s>" );
@@ -34,7 +45,7 @@ SuffixArray::SuffixArray( string fileName )
   m_array = (WORD_ID*) calloc( sizeof( WORD_ID ), m_size );
   m_index = (INDEX*) calloc( sizeof( INDEX ), m_size );
   m_wordInSentence = (char*) calloc( sizeof( char ), m_size );
-  m_sentence = (size_t*) calloc( sizeof( size_t ), m_size );
+  m_sentence = (INDEX*) calloc( sizeof( INDEX ), m_size );
   m_sentenceLength = (char*) calloc( sizeof( char ), sentenceCount );
 
   // fill the array
@@ -52,12 +63,10 @@ SuffixArray::SuffixArray( string fileName )
 
     vector< WORD_ID >::const_iterator i;
     for( i=words.begin(); i!=words.end(); i++) {
-      m_index[ wordIndex ] = wordIndex;
       m_sentence[ wordIndex ] = sentenceId;
       m_wordInSentence[ wordIndex ] = i-words.begin();
       m_array[ wordIndex++ ] = *i;
     }
-    m_index[ wordIndex ] = wordIndex;
     m_array[ wordIndex++ ] = m_endOfSentence;
     m_sentenceLength[ sentenceId++ ] = words.size();
   }
@@ -65,65 +74,58 @@ SuffixArray::SuffixArray( string fileName )
   cerr << "done reading " << wordIndex << " words, " << sentenceId << " sentences." << endl;
   // List(0,9);
 
-  // sort
-  m_buffer = (INDEX*) calloc( sizeof( INDEX ), m_size );
-  Sort( 0, m_size-1 );
-  free( m_buffer );
+  // sort by words in lexical order, which is the order of the vocabulary's
+  // lookup map; the ranks are computed in place of the suffix array
+  vector< WORD_ID > lexicalRank( m_vcb.lookup.size() );
+  WORD_ID rank = 0;
+  map< WORD, WORD_ID >::const_iterator w;
+  for( w=m_vcb.lookup.begin(); w!=m_vcb.lookup.end(); w++) {
+    lexicalRank[ w->second ] = rank++;
+  }
+  for(INDEX i=0; i<m_size; i++) {
+    m_index[ i ] = lexicalRank[ m_array[ i ] ];
+  }
+  util::BuildSuffixArray( m_index, m_size, m_index, threads );
   cerr << "done sorting" << endl;
 }
 
-// good ol' quick sort
-void SuffixArray::Sort(INDEX start, INDEX end)
+// maps a suffix array saved by biconcor, whose vocabulary is next to it
+void SuffixArray::Load( const string &fileName )
 {
-  if (start == end) return;
-  INDEX mid = (start+end+1)/2;
-  Sort( start, mid-1 );
-  Sort( mid, end );
-
-  // merge
-  size_t i = start;
-  size_t j = mid;
-  size_t k = 0;
-  size_t length = end-start+1;
-  while( k<length ) {
-    if (i == mid ) {
-      m_buffer[ k++ ] = m_index[ j++ ];
-    } else if (j > end ) {
-      m_buffer[ k++ ] = m_index[ i++ ];
+  cerr << "loading suffix array from " << fileName << endl;
+  util::SuffixArrayFile file;
+  util::MapSuffixArrayFile( fileName.c_str(), file, m_mapping );
+  m_vcb.Load( fileName + ".src-vcb" );
+  m_endOfSentence = m_vcb.StoreIfNew( "<s>" );
+
+  // the mapping is read-only, but nothing writes to the arrays
+  m_size = file.header.size;
+  m_array = const_cast< WORD_ID* >( file.text );
+  m_index = const_cast< INDEX* >( file.index );
+  m_wordInSentence = const_cast< char* >( file.word_in_sentence );
+  m_sentence = const_cast< INDEX* >( file.sentence );
+  m_sentenceLength = const_cast< char* >( file.sentence_length );
+
+  corpus.reserve( file.header.sentence_count );
+  vector< WORD_ID > words;
+  for(INDEX i=0; i<m_size; i++) {
+    if (m_array[ i ] == m_endOfSentence) {
+      corpus.push_back( words );
+      words.clear();
     } else {
-      if (CompareIndex( m_index[i], m_index[j] ) < 0) {
-        m_buffer[ k++ ] = m_index[ i++ ];
-      } else {
-        m_buffer[ k++ ] = m_index[ j++ ];
-      }
+      words.push_back( m_array[ i ] );
     }
   }
-
-  memcpy( ((char*)m_index) + sizeof( INDEX ) * start,
-          ((char*)m_buffer), sizeof( INDEX ) * (end-start+1) );
+  cerr << "done loading " << m_size << " words, " << corpus.size() << " sentences." << endl;
 }
 
 SuffixArray::~SuffixArray()
 {
+  if (m_mapping.get() != NULL) return; // arrays point into the loaded file
   free(m_index);
   free(m_array);
 }
 
-int SuffixArray::CompareIndex( INDEX a, INDEX b ) const
-{
-  // skip over identical words
-  INDEX offset = 0;
-  while( a+offset < m_size &&
-         b+offset < m_size &&
-         m_array[ a+offset ] == m_array[ b+offset ] ) {
-    offset++;
-  }
-
-  if( a+offset == m_size ) return -1;
-  if( b+offset == m_size ) return 1;
-  return CompareWord( m_array[ a+offset ], m_array[ b+offset ] );
-}
-
 inline int SuffixArray::CompareWord( WORD_ID a, WORD_ID b ) const
 {
   // cerr << "c(" << m_vcb.GetWord(a) << ":" << m_vcb.GetWord(b) << ")=" << m_vcb.GetWord(a).compare( m_vcb.GetWord(b) ) << endl;
@@ -183,7 +185,9 @@ SuffixArray::INDEX SuffixArray::FindLast( const vector< WORD > &phrase, INDEX st
     INDEX mid = ( start + end + (direction>0 ? 0 : 1) )/2;
 
     int match = Match( phrase, mid );
-    int matchNext = Match( phrase, mid+direction );
+    // there is no next suffix beyond either end of the array
+    INDEX next = mid + direction;
+    int matchNext = (next < m_size) ? Match( phrase, next ) : direction;
     //cerr << "\t" << start << ";" << mid << ";" << end << " -> " << match << "," << matchNext << endl;
 
     if (match == 0 && matchNext != 0) return mid;
@@ -1,4 +1,5 @@
 #include "Vocabulary.h"
+#include "util/mmap.hh"
 
 #pragma once
 
@@ -17,20 +18,23 @@ private:
 
   WORD_ID *m_array;
   INDEX *m_index;
-  INDEX *m_buffer;
   char *m_wordInSentence;
-  size_t *m_sentence;
+  INDEX *m_sentence;
   char *m_sentenceLength;
   WORD_ID m_endOfSentence;
   Vocabulary m_vcb;
   INDEX m_size;
+  // set when the arrays point into a suffix array file
+  util::scoped_memory m_mapping;
+
+  void Create( const std::string &fileName, size_t threads );
+  void Load( const std::string &fileName );
 
 public:
-  SuffixArray( std::string fileName );
+  /** builds the suffix array of a corpus, or maps one saved by biconcor */
+  SuffixArray( const std::string &fileName, size_t threads = 1 );
   ~SuffixArray();
 
-  void Sort(INDEX start, INDEX end);
-  int CompareIndex( INDEX a, INDEX b ) const;
   inline int CompareWord( WORD_ID a, WORD_ID b ) const;
   int Count( const std::vector< WORD > &phrase );
   bool MinCount( const std::vector< WORD > &phrase, INDEX min );
@@ -9,6 +9,19 @@ using namespace std;
 namespace tmmt
 {
 
+Vocabulary::Vocabulary()
+  : m_blocks( ((std::size_t)(WORD_ID)-1 >> kBlockBits) + 1, NULL )
+  , m_size( 0 )
+{
+}
+
+Vocabulary::~Vocabulary()
+{
+  for (size_t i = 0; i < m_blocks.size() && m_blocks[i]; ++i) {
+    delete [] m_blocks[i];
+  }
+}
+
 // as in beamdecoder/tables.cpp
 vector<WORD_ID> Vocabulary::Tokenize( const char input[] )
 {
@@ -49,8 +62,17 @@ WORD_ID Vocabulary::StoreIfNew( const WORD& word )
 #ifdef WITH_THREADS
   boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
 #endif
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  // another thread may have added the word in the meantime
+  map<WORD, WORD_ID>::iterator i = lookup.find( word );
+  if( i != lookup.end() )
+    return i->second;
+  WORD_ID id = m_size;
+  WORD *&block = m_blocks.at( id >> kBlockBits );
+  if (!block) {
+    block = new WORD[ kBlockSize ];
+  }
+  block[ id & (kBlockSize - 1) ] = word;
+  ++m_size;
   lookup[ word ] = id;
   return id;
 }
@@ -67,5 +89,18 @@ WORD_ID Vocabulary::GetWordID( const WORD &word )
   return w;
 }
 
+void Vocabulary::Load( const std::string& fileName )
+{
+  ifstream vcbFile( fileName.c_str() );
+  if (!vcbFile) {
+    cerr << "no such file or directory: " << fileName << endl;
+    exit(1);
+  }
+  string line;
+  while(getline(vcbFile, line)) {
+    StoreIfNew( line );
+  }
+}
+
 }
 
@@ -10,9 +10,11 @@
 #include <queue>
 #include <map>
 #include <cmath>
+#include <vector>
 
 #ifdef WITH_THREADS
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 #endif
 
 namespace tmmt
@@ -23,23 +25,40 @@ typedef unsigned int WORD_ID;
 class Vocabulary
 {
 public:
+  Vocabulary();
+  ~Vocabulary();
+
   std::map<WORD, WORD_ID> lookup;
-  std::vector< WORD > vocab;
   WORD_ID StoreIfNew( const WORD& );
   WORD_ID GetWordID( const WORD& );
   std::vector<WORD_ID> Tokenize( const char[] );
-  inline WORD &GetWord( WORD_ID id ) const {
-    WORD &i = (WORD&) vocab[ id ];
-    return i;
+  // reads one word per line, as biconcor saves its vocabulary
+  void Load( const std::string& fileName );
+
+  // No lock: words of input sentences are added while other threads read,
+  // but stored words never move, and an id is only handed out (under the
+  // lock) after its word is in place.
+  inline const WORD &GetWord( WORD_ID id ) const {
+    return m_blocks[ id >> kBlockBits ][ id & (kBlockSize - 1) ];
   }
 
 protected:
+  // Words are kept in blocks of kBlockSize.  The table of blocks has room
+  // for every WORD_ID from the start, so it is never reallocated either.
+  static const std::size_t kBlockBits = 16;
+  static const std::size_t kBlockSize = 1 << kBlockBits;
+  std::vector<WORD*> m_blocks;
+  std::size_t m_size;
+
 #ifdef WITH_THREADS
-  //reader-writer lock
+  //reader-writer lock for lookup and adding words
   mutable boost::shared_mutex m_accessLock;
 #endif
 
-
+private:
+  // No copying.
+  Vocabulary( const Vocabulary& );
+  void operator=( const Vocabulary& );
 };
 
 }
@@ -0,0 +1,78 @@
+#include "WordEditDistance.h"
+
+#include <cstdlib>
+
+namespace tmmt
+{
+
+WordEditDistance::WordEditDistance(const std::vector< WORD_ID > &pattern)
+  :m_length(pattern.size())
+  ,m_numBlocks((pattern.size() + WORD_SIZE - 1) / WORD_SIZE)
+  ,m_lastBit(pattern.empty() ? 0 : (Word)1 << ((pattern.size() - 1) % WORD_SIZE))
+{
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    std::pair< boost::unordered_map< WORD_ID, size_t >::iterator, bool > ins
+      = m_peqIndex.insert(std::make_pair(pattern[i], m_peq.size()));
+    if (ins.second) {
+      m_peq.resize(m_peq.size() + m_numBlocks, 0);
+    }
+    m_peq[ins.first->second + i / WORD_SIZE] |= (Word)1 << (i % WORD_SIZE);
+  }
+}
+
+unsigned int WordEditDistance::Distance(const std::vector< WORD_ID > &text, unsigned int bound) const
+{
+  const size_t n = text.size();
+  if ((unsigned int) std::abs((int)n - (int)m_length) > bound) {
+    return bound + 1;
+  }
+  if (m_length == 0) {
+    return n;
+  }
+
+  // vertical deltas of each block, all +1 in the first column
+  std::vector< Word > pv(m_numBlocks, ~(Word)0), mv(m_numBlocks, 0);
+  unsigned int score = m_length;
+
+  for (size_t j = 0; j < n; ++j) {
+    boost::unordered_map< WORD_ID, size_t >::const_iterator iter = m_peqIndex.find(text[j]);
+    const Word *peq = (iter == m_peqIndex.end()) ? NULL : &m_peq[iter->second];
+
+    // the first row of the distance matrix grows by one in each column
+    Word hinPos = 1, hinNeg = 0;
+    for (size_t b = 0; b < m_numBlocks; ++b) {
+      Word eq = peq ? peq[b] : 0;
+      Word xv = eq | mv[b];
+      eq |= hinNeg;
+      Word xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+      Word ph = mv[b] | ~(xh | pv[b]);
+      Word mh = pv[b] & xh;
+
+      if (b + 1 == m_numBlocks) {
+        if (ph & m_lastBit) {
+          ++score;
+        } else if (mh & m_lastBit) {
+          --score;
+        }
+      }
+
+      Word houtPos = ph >> (WORD_SIZE - 1);
+      Word houtNeg = mh >> (WORD_SIZE - 1);
+      ph = (ph << 1) | hinPos;
+      mh = (mh << 1) | hinNeg;
+      pv[b] = mh | ~(xv | ph);
+      mv[b] = ph & xv;
+      hinPos = houtPos;
+      hinNeg = houtNeg;
+    }
+
+    // the remaining columns can lower the distance by at most one each
+    if (score > bound + (n - j - 1)) {
+      return bound + 1;
+    }
+  }
+  return score;
+}
+
+}
+
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include "Vocabulary.h"
+
+namespace tmmt
+{
+
+/** Word-level string edit distance (unit cost insertions, deletions and
+ * substitutions) by Myers' bit-vector algorithm, in the blocked form
+ * given by Hyyrö for patterns longer than a machine word.
+ *
+ * The pattern, normally the input sentence, is preprocessed once; each
+ * call of Distance() then costs O(n * ceil(m/64)) word operations for a
+ * text of n words, instead of the O(n * m) cells of the dynamic program
+ * in FuzzyMatchWrapper::sed().
+ */
+class WordEditDistance
+{
+public:
+  WordEditDistance(const std::vector< WORD_ID > &pattern);
+
+  /** edit distance between the pattern and text.  Once the distance
+   * is known to exceed bound, the computation stops and bound+1 is
+   * returned. */
+  unsigned int Distance(const std::vector< WORD_ID > &text, unsigned int bound) const;
+
+  unsigned int Distance(const std::vector< WORD_ID > &text) const {
+    return Distance(text, text.size() + m_length);
+  }
+
+private:
+  typedef uint64_t Word;
+  static const unsigned int WORD_SIZE = 64;
+
+  size_t m_length;
+  size_t m_numBlocks;
+  // bit in the last block that holds the last pattern position
+  Word m_lastBit;
+
+  // match vectors: m_numBlocks entries for each distinct pattern word
+  std::vector< Word > m_peq;
+  boost::unordered_map< WORD_ID, size_t > m_peqIndex;
+};
+
+}
+
@@ -0,0 +1,130 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+#include <algorithm>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "WordEditDistance.h"
+
+using namespace tmmt;
+using namespace std;
+
+namespace
+{
+
+// the plain dynamic program, as in FuzzyMatchWrapper::sed() without letter costs
+unsigned int PlainDistance(const vector<WORD_ID> &a, const vector<WORD_ID> &b)
+{
+  vector<unsigned int> previous(b.size() + 1), current(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) previous[j] = j;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    current[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      unsigned int substitute = previous[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+      current[j] = min(substitute, min(previous[j], current[j - 1]) + 1);
+    }
+    previous.swap(current);
+  }
+  return previous[b.size()];
+}
+
+vector<WORD_ID> RandomSentence(boost::random::mt19937 &gen, size_t length, WORD_ID vocabSize)
+{
+  boost::random::uniform_int_distribution<WORD_ID> word(0, vocabSize - 1);
+  vector<WORD_ID> sentence(length);
+  for (size_t i = 0; i < length; ++i) sentence[i] = word(gen);
+  return sentence;
+}
+
+// the distance both ways round, and with bounds around it
+void CheckDistance(const vector<WORD_ID> &pattern, const vector<WORD_ID> &text)
+{
+  const unsigned int expected = PlainDistance(pattern, text);
+  BOOST_CHECK_EQUAL(WordEditDistance(pattern).Distance(text), expected);
+  BOOST_CHECK_EQUAL(WordEditDistance(text).Distance(pattern), expected);
+
+  WordEditDistance distance(pattern);
+  for (unsigned int bound = (expected < 2 ? 0 : expected - 2); bound <= expected + 2; ++bound) {
+    BOOST_CHECK_EQUAL(distance.Distance(text, bound), min(expected, bound + 1));
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(word_edit_distance)
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+  vector<WORD_ID> empty, three(3, 7);
+  CheckDistance(empty, empty);
+  CheckDistance(empty, three);
+  CheckDistance(three, empty);
+}
+
+BOOST_AUTO_TEST_CASE(block_boundaries)
+{
+  // patterns that fill a machine word and that spill into a second one
+  boost::random::mt19937 gen(42);
+  const size_t lengths[] = {63, 64, 65, 127, 128, 129};
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    vector<WORD_ID> pattern = RandomSentence(gen, lengths[l], 20);
+    CheckDistance(pattern, pattern);
+
+    // edits at the first and last positions
+    vector<WORD_ID> text(pattern);
+    text.front() = 100;
+    text.back() = 100;
+    CheckDistance(pattern, text);
+    text.push_back(101);
+    CheckDistance(pattern, text);
+    text.erase(text.begin());
+    CheckDistance(pattern, text);
+
+    for (size_t other = 0; other < sizeof(lengths) / sizeof(lengths[0]); ++other) {
+      CheckDistance(pattern, RandomSentence(gen, lengths[other], 20));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(repeated_words)
+{
+  vector<WORD_ID> same(65, 1), alternating, shifted(64, 1);
+  for (size_t i = 0; i < 65; ++i) alternating.push_back(i % 2);
+  shifted.insert(shifted.begin(), 2);
+  CheckDistance(same, alternating);
+  CheckDistance(same, shifted);
+  CheckDistance(alternating, shifted);
+  CheckDistance(same, vector<WORD_ID>(1, 1));
+}
+
+BOOST_AUTO_TEST_CASE(random_sentences)
+{
+  boost::random::mt19937 gen(1234);
+  boost::random::uniform_int_distribution<size_t> length(0, 150);
+  for (size_t i = 0; i < 500; ++i) {
+    // small vocabularies give many repeated words
+    const WORD_ID vocabSize = (i % 3 == 0) ? 3 : 50;
+    CheckDistance(RandomSentence(gen, length(gen), vocabSize), RandomSentence(gen, length(gen), vocabSize));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
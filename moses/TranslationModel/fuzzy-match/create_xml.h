@@ -2,4 +2,11 @@
 
 #include <string>
 
-void create_xml(const std::string &inPath);
+class CreateXMLRetValues
+{
+public:
+  std::string frame, ruleS, ruleT, ruleAlignment, ruleAlignmentInv;
+};
+
+//! build the hierarchical rule and XML frame for one translation memory match
+CreateXMLRetValues createXML(int ruleCount, const std::string &source, const std::string &input, const std::string &target, const std::string &align, const std::string &path );
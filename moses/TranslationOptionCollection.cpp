@@ -39,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/LexicalReordering/LexicalReordering.h"
 #include "moses/FF/InputFeature.h"
 #include "TranslationTask.h"
+#include "Profiler.h"
 #include "util/exception.hh"
 
 #include <boost/foreach.hpp>
@@ -658,6 +659,7 @@ GetTargetPhraseCollectionBatch()
       const Tstep* tstep = dynamic_cast<const Tstep *>(*i);
       if (tstep) {
         const PhraseDictionary &pdict = *tstep->GetPhraseDictionaryFeature();
+        ProfileScope profile(pdict.GetProfileLookupId());
         pdict.GetTargetPhraseCollectionBatch(m_ttask.lock(), m_inputPathQueue);
       }
     }
@@ -8,6 +8,8 @@
 #include "moses/Timer.h"
 #include "moses/InputType.h"
 #include "moses/OutputCollector.h"
+#include "moses/Profiler.h"
+#include "moses/RecyclingAllocator.h"
 #include "moses/Incremental.h"
 #include "mbr.h"
 
@@ -165,6 +167,9 @@ void TranslationTask::Run()
 
   const size_t translationId = m_source->GetTranslationId();
 
+  // the hypotheses and states of this sentence are freed with the manager;
+  // then give their recycled memory back
+  RecyclingAllocator::ReleaseOnExit releaseRecycled;
 
   // report wall time spent on translation
   Timer translationTime;
@@ -199,6 +204,9 @@ void TranslationTask::Run()
   // Just sayin' ...
   if (m_ioWrapper == NULL) return;
 
+  static const size_t profileId = Profiler::Register("Output", "TranslationTask");
+  ProfileScope profile(profileId);
+
   // we are done with search, let's look what we got
   OutputCollector* ocoll;
   Timer additionalReportingTime;
@@ -10,6 +10,7 @@ namespace Moses
     , diversity(DEFAULT_CUBE_PRUNING_DIVERSITY)
     , lazy_scoring(false)
     , deterministic_search(false)
+    , threads(1)
   {}
 
   bool
@@ -22,6 +23,7 @@ namespace Moses
 		       DEFAULT_CUBE_PRUNING_DIVERSITY);
     param.SetParameter(lazy_scoring, "cube-pruning-lazy-scoring", false);
     param.SetParameter(deterministic_search, "cube-pruning-deterministic-search", false);
+    param.SetParameter(threads, "cube-pruning-threads", size_t(1));
     return true;
   }
 
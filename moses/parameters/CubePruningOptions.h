@@ -13,6 +13,7 @@ namespace Moses
     size_t  diversity;
     bool lazy_scoring;
     bool deterministic_search;
+    size_t  threads;
 
     bool init(Parameter const& param);
     CubePruningOptions(Parameter const& param);
@@ -13,6 +13,7 @@ namespace Moses {
     , input_type(SentenceInput)
     , xml_policy(XmlPassThrough)
     , placeholder_factor(NOT_FOUND)
+    , prefetch_threads(0)
   { 
     xml_brackets.first  = "<";
     xml_brackets.second = ">";
@@ -78,6 +79,7 @@ namespace Moses {
     param.SetParameter(placeholder_factor, "placeholder-factor", NOT_FOUND);
 
     param.SetParameter<std::string>(factor_delimiter, "factor-delimiter", "|");
+    param.SetParameter<size_t>(prefetch_threads, "input-prefetch-threads", 0);
     param.SetParameter<std::string>(input_file_path,"input-file","");
 
     return true;
@@ -22,6 +22,8 @@ namespace Moses {
     , PrintPassThrough(false)
     , include_lhs_in_search_graph(false)
     , lattice_sample_size(0)
+    , flush_every(1)
+    , flush_interval(0)
   {
     factor_order.assign(1,0);
     factor_delimiter = "|";
@@ -81,6 +83,9 @@ namespace Moses {
     param.SetParameter(detailed_tree_transrep_filepath, 
                        "tree-translation-details", e);
 
+    param.SetParameter<size_t>(flush_every, "output-flush-every", 1);
+    param.SetParameter<float>(flush_interval, "output-flush-interval", 0);
+
     params = param.GetParam("lattice-samples");
     if (params) {
       if (params->size() ==2 ) {
@@ -50,6 +50,11 @@ namespace Moses
     std::string lattice_sample_filepath; 
     size_t lattice_sample_size;
 
+    // flush output streams every flush_every sentences or
+    // flush_interval seconds, whichever comes first
+    size_t flush_every;
+    float flush_interval;
+
     bool init(Parameter const& param);
 
     /// do we need to keep the search graph from decoding?
@@ -21,24 +21,32 @@
 
 #include <iostream>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 #include "OutputFileStream.h"
 #include "gzfilebuf.h"
+#include "util/block_gzip_sink.hh"
+#include "util/exception.hh"
 
 using namespace std;
 using namespace boost::algorithm;
 
 namespace Moses
 {
+namespace
+{
+size_t compressionThreads = 1;
+}
+
 OutputFileStream::OutputFileStream()
   :boost::iostreams::filtering_ostream()
   ,m_outFile(NULL)
+  ,m_blockGZip(NULL)
   ,m_open(false)
 {
 }
 
 OutputFileStream::OutputFileStream(const std::string &filePath)
   :m_outFile(NULL)
+  ,m_blockGZip(NULL)
   ,m_open(false)
 {
   Open(filePath);
@@ -55,15 +63,18 @@ bool OutputFileStream::Open(const std::string &filePath)
   if (filePath == std::string("-")) {
     // Write to standard output.  Leave m_outFile null.
     this->push(std::cout);
+  } else if (ends_with(filePath, ".gz")) {
+    try {
+      m_blockGZip = new util::BlockGZipSink(filePath.c_str(), compressionThreads);
+    } catch (const util::Exception &e) {
+      return false;
+    }
+    this->push(*m_blockGZip);
   } else {
     m_outFile = new ofstream(filePath.c_str(), ios_base::out | ios_base::binary);
     if (m_outFile->fail()) {
       return false;
     }
-
-    if (ends_with(filePath, ".gz")) {
-      this->push(boost::iostreams::gzip_compressor());
-    }
     this->push(*m_outFile);
   }
 
@@ -82,9 +93,21 @@ void OutputFileStream::Close()
     delete m_outFile;
     m_outFile = NULL;
   }
+  if (m_blockGZip) {
+    this->pop(); // compressor
+
+    m_blockGZip->Close();
+    delete m_blockGZip;
+    m_blockGZip = NULL;
+  }
   m_open = false;
 }
 
+void OutputFileStream::SetCompressionThreads(size_t threads)
+{
+  compressionThreads = threads;
+}
+
 
 }
 
@@ -130,7 +130,7 @@ int main(int argc, char* argv[])
 
   if (argc < 6) {
     cerr << "syntax: extract en de align extract max-length [orientation [ --model [wbe|phrase|hier]-[msd|mslr|mono] ] ";
-    cerr << "| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ";
+    cerr << "| --OnlyOutputSpanInfo | --NoTTable | --GZOutput | --CompressionThreads n | --IncludeSentenceId | --SentenceOffset n | --InstanceWeights filename ";
     cerr << "| --TargetConstituentConstrained | --TargetConstituentBoundaries ]" << std::endl;
     exit(1);
   }
@@ -171,6 +171,12 @@ int main(int argc, char* argv[])
       sentenceOffset = atoi(argv[++i]);
     } else if (strcmp(argv[i], "--GZOutput") == 0) {
       options.initGzOutput(true);
+    } else if (strcmp(argv[i], "--CompressionThreads") == 0) {
+      if (i+1 >= argc || argv[i+1][0] < '1' || argv[i+1][0] > '9') {
+        cerr << "extract: syntax error, used switch --CompressionThreads without a number" << endl;
+        exit(1);
+      }
+      Moses::OutputFileStream::SetCompressionThreads(atoi(argv[++i]));
     } else if (strcmp(argv[i], "--InstanceWeights") == 0) {
       if (i+1 >= argc) {
         cerr << "extract: syntax error, used switch --InstanceWeights without file name" << endl;
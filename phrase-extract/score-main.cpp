@@ -154,7 +154,8 @@ int main(int argc, char* argv[])
               "[--TargetSyntacticPreferences] "
               "[--UnpairedExtractFormat] "
               "[--ConditionOnTargetLHS] "
-              "[--CrossedNonTerm]"
+              "[--CrossedNonTerm] "
+              "[--CompressionThreads n]"
               << std::endl;
     std::cerr << featureManager.usage() << std::endl;
     exit(1);
@@ -290,6 +291,13 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--TargetConstituentBoundaries") == 0) {
       targetConstituentBoundariesFlag = true;
       std::cerr << "including target constituent boundaries information" << std::endl;
+    } else if (strcmp(argv[i],"--CompressionThreads") == 0) {
+      if (i+1==argc) {
+        std::cerr << "ERROR: specify number of compression threads!" << std::endl;
+        exit(1);
+      }
+      Moses::OutputFileStream::SetCompressionThreads(std::atoi(argv[++i]));
+      std::cerr << "compressing output with " << argv[i] << " threads" << std::endl;
     } else {
       featureArgs.push_back(argv[i]);
       ++i;
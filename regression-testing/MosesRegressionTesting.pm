@@ -89,5 +89,88 @@ sub get_nbestlist
 }
 
 
-1;
+# Writes a small random moses2 model to $dir and returns the paths of its
+# moses.ini and input: a phrase table over 100 source and 200 target words,
+# with many overlapping phrases so that a stack has many mini-stacks, a
+# bigram language model and 20 input sentences.
+sub write_moses2_toy_model {
+  my ($dir, $seed) = @_;
+  srand($seed);
+  my @source = map { "s$_" } (0 .. 99);
+  my @target = map { "t$_" } (0 .. 199);
+  my $pick = sub { my $words = shift; return join(" ", map { $words->[int(rand(@$words))] } (1 .. shift)); };
+  my $score = sub { return join(" ", map { sprintf("%.4f", 0.01 + rand(0.99)) } (1 .. 4)); };
+
+  open(my $pt, ">", "$dir/phrase-table") or die "Cannot write $dir/phrase-table: $!\n";
+  foreach my $s (@source) {
+    foreach (1 .. 5) {
+      print $pt "$s ||| ".&$pick(\@target, 1 + int(rand(2)))." ||| ".&$score()."\n";
+    }
+  }
+  foreach (1 .. 2000) {
+    my $s = &$pick(\@source, 2 + int(rand(2)));
+    foreach (1 .. 3) {
+      print $pt "$s ||| ".&$pick(\@target, 1 + int(rand(3)))." ||| ".&$score()."\n";
+    }
+  }
+  close($pt);
+
+  my @vocab = ("<unk>", "<s>", "</s>", @target);
+  my %bigrams;
+  my @context = ("<s>", @target);
+  $bigrams{&$pick(\@context, 1)." ".&$pick(\@target, 1)} = 1 foreach (1 .. 5000);
+  open(my $lm, ">", "$dir/lm.arpa") or die "Cannot write $dir/lm.arpa: $!\n";
+  print $lm "\n\\data\\\nngram 1=".scalar(@vocab)."\nngram 2=".scalar(keys %bigrams)."\n\n\\1-grams:\n";
+  foreach my $w (@vocab) {
+    my $prob = $w eq "<s>" ? -99 : -1 - rand(2);
+    printf $lm "%.4f\t%s\t%.4f\n", $prob, $w, -rand(0.5);
+  }
+  print $lm "\n\\2-grams:\n";
+  printf $lm "%.4f\t%s\n", -rand(1), $_ foreach (sort keys %bigrams);
+  print $lm "\n\\end\\\n";
+  close($lm);
+
+  open(my $in, ">", "$dir/input") or die "Cannot write $dir/input: $!\n";
+  foreach (1 .. 20) {
+    my $sentence = &$pick(\@source, 8 + int(rand(13)));
+    # now and then an unknown word
+    $sentence .= " unknown$_" if $_ % 5 == 0;
+    print $in "$sentence\n";
+  }
+  close($in);
+
+  open(my $ini, ">", "$dir/moses.ini") or die "Cannot write $dir/moses.ini: $!\n";
+  print $ini <<"EOF";
+[input-factors]
+0
+
+[mapping]
+0 T 0
+
+[distortion-limit]
+6
+
+[cube-pruning-pop-limit]
+200
+
+[feature]
+UnknownWordPenalty
+WordPenalty
+PhrasePenalty
+PhraseDictionaryMemory name=TranslationModel0 num-features=4 path=$dir/phrase-table input-factor=0 output-factor=0 table-limit=20
+Distortion
+KENLM name=LM0 factor=0 path=$dir/lm.arpa order=2
+
+[weight]
+UnknownWordPenalty0= 1
+WordPenalty0= -1
+PhrasePenalty0= 0.2
+TranslationModel0= 0.2 0.2 0.2 0.2
+Distortion0= 0.3
+LM0= 0.5
+EOF
+  close($ini);
+  return ("$dir/moses.ini", "$dir/input");
+}
 
+1;
@@ -18,6 +18,7 @@ binmode(STDERR, ':utf8');
 my $OUT_DIR = "/tmp/Transliteration-Phrase-Table.$$";
 
 my ($MOSES_SRC_DIR,$TRANSLIT_MODEL,$OOV_FILE,$EXTERNAL_BIN_DIR, $INPUT_EXTENSION, $OUTPUT_EXTENSION);
+my ($TRANSLIT_FILE, $NBEST_FILE);
 die("ERROR: wrong syntax when invoking train-transliteration-PT.pl")
     unless &GetOptions('moses-src-dir=s' => \$MOSES_SRC_DIR,
 			'external-bin-dir=s' => \$EXTERNAL_BIN_DIR,
@@ -25,6 +26,8 @@ die("ERROR: wrong syntax when invoking train-transliteration-PT.pl")
 			'input-extension=s' => \$INPUT_EXTENSION,
 			'output-extension=s' => \$OUTPUT_EXTENSION,
 			'out-dir=s' => \$OUT_DIR,
+			'translit-file=s' => \$TRANSLIT_FILE,
+			'nbest-file=s' => \$NBEST_FILE,
 			'oov-file=s' => \$OOV_FILE);
 
 # check if the files are in place
@@ -44,14 +47,18 @@ die("ERROR: could not find OOV file '$OOV_FILE'")
 `mkdir -p $OUT_DIR/$UNK_FILE_NAME/training`;
 `cp $OOV_FILE $OUT_DIR/$UNK_FILE_NAME/$UNK_FILE_NAME`;
 
-my $translitFile = "$OUT_DIR/" . $UNK_FILE_NAME . "/" . $UNK_FILE_NAME . ".translit";
+# the words split into characters, one per line, in the order they are decoded
+my $translitFile = defined($TRANSLIT_FILE) ? $TRANSLIT_FILE
+    : "$OUT_DIR/" . $UNK_FILE_NAME . "/" . $UNK_FILE_NAME . ".translit";
+# n-best list of the transliterations, sentence i being line i of $translitFile
+my $nBestFile = defined($NBEST_FILE) ? $NBEST_FILE : "$translitFile.op.nBest";
 
 print STDERR "Preparing for Transliteration\n";
 prepare_for_transliteration ($OOV_FILE , $translitFile);
 print STDERR "Run Transliteration\n";
-run_transliteration ($MOSES_SRC_DIR , $EXTERNAL_BIN_DIR , $TRANSLIT_MODEL , $translitFile);
+run_transliteration ($MOSES_SRC_DIR , $EXTERNAL_BIN_DIR , $TRANSLIT_MODEL , $translitFile , $nBestFile);
 print STDERR "Form Transliteration Corpus\n";
-form_corpus ($translitFile , $translitFile.".op.nBest" , $OUT_DIR);
+form_corpus ($translitFile , $nBestFile , $OUT_DIR);
 
 
 ################### Read the UNK word file and prepare for Transliteration ###############################
@@ -98,6 +105,7 @@ sub run_transliteration
 	my $EXTERNAL_BIN_DIR = $list[1];
 	my $TRANSLIT_MODEL = $list[2];
 	my $eval_file = $list[3];
+	my $nbest_file = $list[4];
 
 	`touch $eval_file.moses.table.ini`;
 
@@ -128,7 +136,7 @@ sub run_transliteration
 	`$MOSES_SRC/bin/moses \\
             -search-algorithm 1 -cube-pruning-pop-limit 5000 -s 5000 \\
             -threads 16 -drop-unknown -distortion-limit 0 \\
-            -n-best-list $eval_file.op.nBest 50 \\
+            -n-best-list $nbest_file 50 \\
             -f $eval_file.filtered.ini \\
             < $eval_file \\
             > $eval_file.op`;
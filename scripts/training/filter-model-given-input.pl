@@ -45,6 +45,8 @@ if ( `echo 'youcandoit' | sort --compress-program gzip 2>/dev/null` =~
 {
     $sort_option = "--compress-program gzip ";
 }
+my $sort_has_parallel =
+  `echo 'youcandoit' | sort --parallel 1 2>/dev/null` =~ /youcandoit/;
 
 # get optional parameters
 my $opt_hierarchical = 0;
@@ -373,9 +375,17 @@ if ( $opt_filter && !$opt_hierarchical ) {
     close(INPUT);
 }
 
-# filter files
-print STDERR "Filtering files...\n";
-for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
+# Up to $threads tables are filtered at once.  They split the threads between
+# them, so each binarizer and sort gets $table_threads.
+my $parallel = $#TABLE + 1 < $threads ? $#TABLE + 1 : $threads;
+$parallel = 1 if $parallel < 1;
+my $table_threads = int( $threads / $parallel ) || 1;
+my $table_sort_option = $sort_option;
+$table_sort_option .= "--parallel $table_threads " if $sort_has_parallel;
+
+# filter (and binarize) table $i
+sub filter_table {
+    my ($i) = @_;
     my ( $used, $total ) = ( 0, 0 );
     my $file     = $TABLE[$i];
     my $factors  = $TABLE_FACTORS[$i];
@@ -481,7 +491,7 @@ for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
 
                 #compact phrase table
                 my $cmd =
-"$catcmd $mid_file | LC_ALL=C sort $sort_option -T $tempdir | gzip - > $mid_file.sorted.gz && $binarizer -in $mid_file.sorted.gz -out $new_file -nscores $TABLE_WEIGHTS[$i] -threads $threads && rm $mid_file.sorted.gz";
+"$catcmd $mid_file | LC_ALL=C sort $table_sort_option -T $tempdir | gzip - > $mid_file.sorted.gz && $binarizer -in $mid_file.sorted.gz -out $new_file -nscores $TABLE_WEIGHTS[$i] -threads $table_threads && rm $mid_file.sorted.gz";
                 safesystem($cmd) or die "Can't binarize";
             }
             elsif ( $binarizer =~ /CreateOnDiskPt/ ) {
@@ -497,7 +507,7 @@ for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
             }
             else {
                 my $cmd =
-"$catcmd $mid_file | LC_ALL=C sort $sort_option -T $tempdir | $binarizer -ttable 0 0 - -nscores $TABLE_WEIGHTS[$i] -out $new_file";
+"$catcmd $mid_file | LC_ALL=C sort $table_sort_option -T $tempdir | $binarizer -ttable 0 0 - -nscores $TABLE_WEIGHTS[$i] -out $new_file";
                 safesystem($cmd) or die "Can't binarize";
             }
         }
@@ -517,7 +527,7 @@ for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
             my $cmd;
             if ( $lexbin =~ /processLexicalTableMin/ ) {
                 $cmd =
-"$catcmd $mid_file | LC_ALL=C sort $sort_option -T $tempdir | gzip - > $mid_file.sorted.gz && $lexbin -in $mid_file.sorted.gz -out $new_file -threads $threads && rm $mid_file.sorted.gz";
+"$catcmd $mid_file | LC_ALL=C sort $table_sort_option -T $tempdir | gzip - > $mid_file.sorted.gz && $lexbin -in $mid_file.sorted.gz -out $new_file -threads $table_threads && rm $mid_file.sorted.gz";
             }
             else {
                 $lexbin =~ s/^\s*(\S+)\s.+/$1/;    # no options
@@ -528,6 +538,42 @@ for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
     }
 }
 
+# filter files, up to $parallel tables at a time
+print STDERR "Filtering files...\n";
+my %FILTERING;
+
+sub wait_for_table {
+    my $pid = wait();
+    die "Lost track of the table filtering processes" if $pid < 0;
+    my $file = delete $FILTERING{$pid};
+    return unless $?;
+
+    # stop the other tables, including their binarizers, before giving up
+    kill 'TERM', map { -$_ } keys %FILTERING;
+    1 while wait() > 0;
+    die "Filtering $file failed";
+}
+
+for ( my $i = 0 ; $i <= $#TABLE ; $i++ ) {
+    if ( $parallel <= 1 ) {
+        filter_table($i);
+        next;
+    }
+    wait_for_table() while scalar( keys %FILTERING ) >= $parallel;
+    my $pid = fork();
+    die "Can't fork" unless defined($pid);
+    if ( $pid == 0 ) {
+        # own process group, so that a failure elsewhere can stop the whole
+        # pipeline
+        setpgrp( 0, 0 );
+        filter_table($i);
+        exit 0;
+    }
+    setpgrp( $pid, $pid );
+    $FILTERING{$pid} = $TABLE[$i];
+}
+wait_for_table() while %FILTERING;
+
 # Remove any temporary input files
 unlink values %TMP_INPUT_FILENAME;
 
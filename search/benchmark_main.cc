@@ -0,0 +1,269 @@
+// Measures how fast the incremental search pops edges: builds a synthetic
+// chart of leaf vertices and searches many binary spans over them.  With more
+// than one thread, the edges of each span are divided into parts that are
+// popped ahead in parallel and merged, as moses does with
+// cube-pruning-threads.
+#include "lm/model.hh"
+#include "search/applied.hh"
+#include "search/config.hh"
+#include "search/context.hh"
+#include "search/edge_generator.hh"
+#include "search/edge_part.hh"
+#include "search/rule.hh"
+#include "search/vertex.hh"
+#include "search/vertex_generator.hh"
+#include "util/pool.hh"
+#include "util/usage.hh"
+
+#ifdef WITH_THREADS
+#include "util/pcqueue.hh"
+#include "util/thread_pool.hh"
+#endif
+
+#include <boost/lexical_cast.hpp>
+#include <boost/pool/object_pool.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace search {
+namespace {
+
+typedef lm::ngram::ProbingModel Model;
+
+const std::size_t kLeaves = 50;
+const std::size_t kLeafEdges = 20;
+const std::size_t kSpanEdges = 500;
+// Parts per thread, as in moses.
+const std::size_t kPartsPerThread = 4;
+
+lm::WordIndex RandomWord(const Model &model) {
+  return 1 + std::rand() % (model.GetVocabulary().Bound() - 1);
+}
+
+// Pop like EdgeGenerator::Search, counting the edges popped.
+template <class Output> std::size_t CountingSearch(Context<Model> &context, EdgeGenerator &edges, Output &output) {
+  std::size_t popped = 0;
+  unsigned to_pop = context.PopLimit();
+  while (to_pop > 0 && !edges.Empty()) {
+    PartialEdge got(edges.Pop(context));
+    ++popped;
+    if (got.Valid()) {
+      output.NewHypothesis(got);
+      --to_pop;
+    }
+  }
+  output.FinishedSearch();
+  return popped;
+}
+
+void Leaf(Context<Model> &context, SingleBest &best, Vertex &vertex) {
+  EdgeGenerator edges;
+  std::vector<lm::WordIndex> words;
+  for (std::size_t i = 0; i < kLeafEdges; ++i) {
+    words.clear();
+    words.push_back(RandomWord(context.LanguageModel()));
+    words.push_back(RandomWord(context.LanguageModel()));
+    PartialEdge edge(edges.AllocateEdge(0));
+    ScoreRuleRet scored(ScoreRule(context.LanguageModel(), words, edge.Between()));
+    edge.SetScore(scored.prob * context.LMWeight() - static_cast<Score>(std::rand() % 100) / 10.0);
+    edge.SetNote(Note());
+    edges.AddEdge(edge);
+  }
+  VertexGenerator<SingleBest> gen(context, vertex, best);
+  edges.Search(context, gen);
+}
+
+// words is scratch space.
+void AddSpanEdge(Context<Model> &context, std::vector<Vertex*> &leaves, std::vector<lm::WordIndex> &words, EdgeGenerator &edges) {
+  PartialVertex left(leaves[std::rand() % leaves.size()]->RootAlternate());
+  PartialVertex right(leaves[std::rand() % leaves.size()]->RootAlternate());
+  words.clear();
+  words.push_back(kNonTerminal);
+  words.push_back(RandomWord(context.LanguageModel()));
+  words.push_back(kNonTerminal);
+  PartialEdge edge(edges.AllocateEdge(2));
+  edge.NT()[0] = left;
+  edge.NT()[1] = right;
+  ScoreRuleRet scored(ScoreRule(context.LanguageModel(), words, edge.Between()));
+  edge.SetScore(left.Bound() + right.Bound() + scored.prob * context.LMWeight());
+  edge.SetNote(Note());
+  edges.AddEdge(edge);
+}
+
+std::size_t Span(Context<Model> &context, SingleBest &best, std::vector<Vertex*> &leaves, util::Pool &pool, Vertex &vertex) {
+  EdgeGenerator edges(pool);
+  std::vector<lm::WordIndex> words;
+  for (std::size_t i = 0; i < kSpanEdges; ++i) {
+    AddSpanEdge(context, leaves, words, edges);
+  }
+  VertexGenerator<SingleBest> gen(context, vertex, best);
+  std::size_t popped = CountingSearch(context, edges, gen);
+  // The edges are gone, but the vertex keeps the hypotheses.
+  pool.Reset();
+  return popped;
+}
+
+struct Part {
+  explicit Part(util::Pool &pool) : edges(pool), count(0), share(0) {}
+
+  EdgePart edges;
+  // Edges added.
+  std::size_t count;
+  // Complete hypotheses to pop ahead.
+  std::size_t share;
+};
+
+#ifdef WITH_THREADS
+// Pops parts ahead on the helper threads and reports each finished part.
+class PopHandler {
+  public:
+    typedef Part *Request;
+
+    struct Construct {
+      Context<Model> *context;
+      util::PCQueue<Part*> *done;
+    };
+
+    explicit PopHandler(const Construct &construct) : context_(*construct.context), done_(*construct.done) {}
+
+    void operator()(Part *part) {
+      part->edges.PopAhead(context_, part->share);
+      done_.Produce(part);
+    }
+
+  private:
+    Context<Model> &context_;
+    util::PCQueue<Part*> &done_;
+};
+
+struct Helpers {
+  Helpers(Context<Model> &context, std::size_t threads, std::size_t parts)
+    : done(parts), pool(parts, threads, MakeConstruct(context, done), NULL) {}
+
+  static PopHandler::Construct MakeConstruct(Context<Model> &context, util::PCQueue<Part*> &done) {
+    PopHandler::Construct construct;
+    construct.context = &context;
+    construct.done = &done;
+    return construct;
+  }
+
+  util::PCQueue<Part*> done;
+  util::ThreadPool<PopHandler> pool;
+};
+#else
+struct Helpers {};
+#endif
+
+// Like Span, with the edges divided into one part per pool.  Without
+// helpers, the parts are popped ahead on this thread.
+std::size_t SpanParts(Context<Model> &context, SingleBest &best, std::vector<Vertex*> &leaves, boost::ptr_vector<util::Pool> &pools, Helpers *helpers, Vertex &vertex) {
+  boost::ptr_vector<Part> parts;
+  std::vector<EdgePart*> merge;
+  for (std::size_t i = 0; i < pools.size(); ++i) {
+    parts.push_back(new Part(pools[i]));
+    merge.push_back(&parts.back().edges);
+  }
+  // Divide as evenly as moses does with one left hand side per part.
+  std::vector<lm::WordIndex> words;
+  for (std::size_t i = 0; i < kSpanEdges; ++i) {
+    Part &part = parts[i % parts.size()];
+    AddSpanEdge(context, leaves, words, part.edges.Edges());
+    ++part.count;
+  }
+  // Each part pops ahead its share of the pop limit.
+  const std::size_t limit = context.PopLimit();
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    parts[i].share = std::max<std::size_t>(1, (limit * parts[i].count + kSpanEdges - 1) / kSpanEdges);
+  }
+
+  context.SetConcurrent(true);
+#ifdef WITH_THREADS
+  if (helpers) {
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+      helpers->pool.Produce(&parts[i]);
+    }
+    Part *finished;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+      helpers->done.Consume(finished);
+    }
+  } else
+#endif
+  {
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+      parts[i].edges.PopAhead(context, parts[i].share);
+    }
+  }
+  context.SetConcurrent(false);
+
+  VertexGenerator<SingleBest> gen(context, vertex, best);
+  MergeParts(context, merge, gen);
+  std::size_t popped = 0;
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    popped += parts[i].edges.NumPopped();
+  }
+  parts.clear();
+  for (std::size_t i = 0; i < pools.size(); ++i) {
+    pools[i].Reset();
+  }
+  return popped;
+}
+
+void Run(const char *lm, unsigned pop_limit, std::size_t spans, std::size_t threads) {
+  Model model(lm);
+  Config config(1.0, pop_limit, NBestConfig(1));
+  Context<Model> context(config, model);
+  SingleBest best;
+  boost::object_pool<Vertex> vertex_pool;
+
+  std::vector<Vertex*> leaves;
+  for (std::size_t i = 0; i < kLeaves; ++i) {
+    leaves.push_back(vertex_pool.construct());
+    Leaf(context, best, *leaves.back());
+  }
+
+  util::Pool pool;
+  boost::ptr_vector<util::Pool> pools;
+  for (std::size_t i = 0; threads > 1 && i < threads * kPartsPerThread; ++i) {
+    pools.push_back(new util::Pool());
+  }
+  boost::scoped_ptr<Helpers> helpers;
+#ifdef WITH_THREADS
+  if (threads > 1) helpers.reset(new Helpers(context, threads, pools.size()));
+#endif
+
+  std::size_t popped = 0;
+  double start = util::WallTime();
+  for (std::size_t i = 0; i < spans; ++i) {
+    Vertex &vertex = *vertex_pool.construct();
+    popped += pools.empty()
+      ? Span(context, best, leaves, pool, vertex)
+      : SpanParts(context, best, leaves, pools, helpers.get(), vertex);
+  }
+  double elapsed = util::WallTime() - start;
+  std::cout << popped << " edges in " << elapsed << " s: " << (static_cast<double>(popped) / elapsed) << " edges/sec" << std::endl;
+}
+
+} // namespace
+} // namespace search
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 5) {
+    std::cerr << "Usage: " << argv[0] << " lm [pop_limit [spans [threads]]]\n"
+      "Measures edges popped per second by the incremental search on a synthetic\n"
+      "chart scored with the language model lm.  With more than one thread, the\n"
+      "edges of each span are divided into parts popped in parallel and merged,\n"
+      "like cube-pruning-threads in moses.\n";
+    return 1;
+  }
+  unsigned pop_limit = argc > 2 ? boost::lexical_cast<unsigned>(argv[2]) : 1000;
+  std::size_t spans = argc > 3 ? boost::lexical_cast<std::size_t>(argv[3]) : 1000;
+  std::size_t threads = argc > 4 ? boost::lexical_cast<std::size_t>(argv[4]) : 1;
+  std::srand(1);
+  search::Run(argv[1], pop_limit, spans, threads);
+  util::PrintUsage(std::cerr);
+}
@@ -10,7 +10,7 @@ namespace search {
 
 class ContextBase {
   public:
-    explicit ContextBase(const Config &config) : config_(config) {}
+    explicit ContextBase(const Config &config) : config_(config), concurrent_(false) {}
 
     VertexNode *NewVertexNode() {
       VertexNode *ret = vertex_node_pool_.construct();
@@ -28,10 +28,16 @@ class ContextBase {
 
     const Config &GetConfig() const { return config_; }
 
+    // Set while several threads pop edges over the same vertices.
+    bool Concurrent() const { return concurrent_; }
+    void SetConcurrent(bool to) { concurrent_ = to; }
+
   private:
     boost::object_pool<VertexNode> vertex_node_pool_;
 
     Config config_;
+
+    bool concurrent_;
 };
 
 template <class Model> class Context : public ContextBase {
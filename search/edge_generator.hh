@@ -18,7 +18,11 @@ template <class Model> class Context;
 
 class EdgeGenerator {
   public:
-    EdgeGenerator() {}
+    EdgeGenerator() : partial_edge_pool_(own_pool_) {}
+
+    // Allocate edges from pool, for instance one that is reset and reused by
+    // the next search.  The edges live until the pool is reset or freed.
+    explicit EdgeGenerator(util::Pool &pool) : partial_edge_pool_(pool) {}
 
     PartialEdge AllocateEdge(Arity arity) {
       return PartialEdge(partial_edge_pool_, arity);
@@ -30,6 +34,9 @@ class EdgeGenerator {
 
     bool Empty() const { return generate_.empty(); }
 
+    // Score of the edge that Pop will take.  Must not be Empty().
+    Score Top() const { return generate_.top().GetScore(); }
+
     // Pop.  If there's a complete hypothesis, return it.  Otherwise return an invalid PartialEdge.
     template <class Model> PartialEdge Pop(Context<Model> &context);
 
@@ -46,7 +53,8 @@ class EdgeGenerator {
     }
 
   private:
-    util::Pool partial_edge_pool_;
+    util::Pool own_pool_;
+    util::Pool &partial_edge_pool_;
 
     typedef std::priority_queue<PartialEdge> Generate;
     Generate generate_;
@@ -0,0 +1,95 @@
+#ifndef SEARCH_EDGE_PART__
+#define SEARCH_EDGE_PART__
+
+#include "search/context.hh"
+#include "search/edge_generator.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace search {
+
+/* One part of a search whose edges were divided so that the parts can be
+ * popped on different threads.  In moses, the edges of a span are divided by
+ * left hand side, so each part feeds a different vertex.
+ *
+ * PopAhead pops this part alone, recording the score that each pop took.
+ * MergeParts then replays the parts in the order that one EdgeGenerator
+ * holding all the edges would have popped them (ties aside) and hands the
+ * complete hypotheses to the output.  The parts share the vertices below, so
+ * pop on several threads only while the context is Concurrent().
+ */
+class EdgePart {
+  public:
+    explicit EdgePart(util::Pool &pool) : edges_(pool), next_(0), complete_(0) {}
+
+    EdgeGenerator &Edges() { return edges_; }
+
+    // Edges popped so far, including those MergeParts did not use.
+    std::size_t NumPopped() const { return steps_.size(); }
+
+    // Pop until there are complete hypotheses or the queue is empty.
+    template <class Model> void PopAhead(Context<Model> &context, std::size_t complete) {
+      while (complete_ < complete && !edges_.Empty()) {
+        Step(context);
+      }
+    }
+
+  private:
+    template <class Model, class Output> friend void MergeParts(Context<Model> &context, const std::vector<EdgePart*> &parts, Output &output);
+
+    template <class Model> void Step(Context<Model> &context) {
+      Popped popped;
+      popped.top = edges_.Top();
+      popped.got = edges_.Pop(context);
+      if (popped.got.Valid()) ++complete_;
+      steps_.push_back(popped);
+    }
+
+    // Is there another step for MergeParts?  Pops one more if needed.
+    template <class Model> bool Ready(Context<Model> &context) {
+      if (next_ == steps_.size()) {
+        if (edges_.Empty()) return false;
+        Step(context);
+      }
+      return true;
+    }
+
+    struct Popped {
+      Score top;
+      PartialEdge got;
+    };
+
+    EdgeGenerator edges_;
+
+    std::vector<Popped> steps_;
+    // Steps already taken by MergeParts.
+    std::size_t next_;
+    // Complete hypotheses in steps_.
+    std::size_t complete_;
+};
+
+// Like EdgeGenerator::Search over the union of parts.  Call on one thread.
+template <class Model, class Output> void MergeParts(Context<Model> &context, const std::vector<EdgePart*> &parts, Output &output) {
+  unsigned to_pop = context.PopLimit();
+  while (to_pop > 0) {
+    EdgePart *best = NULL;
+    for (std::vector<EdgePart*>::const_iterator i = parts.begin(); i != parts.end(); ++i) {
+      if (!(*i)->Ready(context)) continue;
+      if (!best || (*i)->steps_[(*i)->next_].top > best->steps_[best->next_].top) {
+        best = *i;
+      }
+    }
+    if (!best) break;
+    PartialEdge got(best->steps_[best->next_++].got);
+    if (got.Valid()) {
+      output.NewHypothesis(got);
+      --to_pop;
+    }
+  }
+  output.FinishedSearch();
+}
+
+} // namespace search
+
+#endif // SEARCH_EDGE_PART__
@@ -0,0 +1,271 @@
+#include "search/edge_part.hh"
+
+#include "lm/model.hh"
+#include "lm/state.hh"
+#include "search/applied.hh"
+#include "search/config.hh"
+#include "search/context.hh"
+#include "search/edge_generator.hh"
+#include "search/rule.hh"
+#include "search/vertex.hh"
+#include "search/vertex_generator.hh"
+#include "util/pool.hh"
+
+#define BOOST_TEST_MODULE EdgePartTest
+#include <boost/test/unit_test.hpp>
+#include <boost/pool/object_pool.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/thread.hpp>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+namespace search {
+namespace {
+
+typedef lm::ngram::ProbingModel Model;
+
+const char *TestLocation() {
+  return boost::unit_test::framework::master_test_suite().argv[1];
+}
+
+// A deterministic stand-in for rand().
+class Random {
+  public:
+    Random() : state_(1) {}
+
+    std::size_t Next(std::size_t bound) {
+      state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+      return (state_ >> 33) % bound;
+    }
+
+  private:
+    uint64_t state_;
+};
+
+// A binary rule over two leaves.
+struct SpanEdge {
+  std::size_t left, right;
+  lm::WordIndex word;
+  Score noise;
+};
+
+struct Hypothesis {
+  Score score;
+  const void *note;
+  uint64_t state;
+
+  bool operator==(const Hypothesis &other) const {
+    return score == other.score && note == other.note && state == other.state;
+  }
+
+  bool operator!=(const Hypothesis &other) const {
+    return !(*this == other);
+  }
+
+  // An arbitrary order among ties.
+  bool operator<(const Hypothesis &other) const {
+    if (note != other.note) return note < other.note;
+    return state < other.state;
+  }
+};
+
+std::ostream &operator<<(std::ostream &o, const Hypothesis &h) {
+  return o << "(" << h.score << ", " << h.note << ", " << h.state << ")";
+}
+
+// Output that records the hypotheses in the order they were found.
+class Recorder {
+  public:
+    Recorder() : finished(false) {}
+
+    void NewHypothesis(PartialEdge partial) {
+      Hypothesis h;
+      h.score = partial.GetScore();
+      h.note = partial.GetNote().vp;
+      h.state = hash_value(partial.CompletedState());
+      hypotheses.push_back(h);
+    }
+
+    void FinishedSearch() { finished = true; }
+
+    std::vector<Hypothesis> hypotheses;
+    bool finished;
+};
+
+// Leaf vertices and binary edges over them, scored with the test model.
+class Chart {
+  public:
+    Chart(const Model &model, unsigned pop_limit)
+      : config_(1.0, pop_limit, NBestConfig(1)), context_(config_, model) {
+      Random random;
+      const lm::WordIndex bound = model.GetVocabulary().Bound();
+      std::vector<lm::WordIndex> words;
+      for (std::size_t leaf = 0; leaf < 10; ++leaf) {
+        EdgeGenerator edges;
+        for (std::size_t i = 0; i < 8; ++i) {
+          words.clear();
+          words.push_back(1 + random.Next(bound - 1));
+          words.push_back(1 + random.Next(bound - 1));
+          PartialEdge edge(edges.AllocateEdge(0));
+          ScoreRuleRet scored(ScoreRule(model, words, edge.Between()));
+          // Distinct scores, so the order of hypotheses has no ties.
+          edge.SetScore(scored.prob - static_cast<Score>(random.Next(100)) / 10.0 - (leaf * 8 + i) * 0.0001);
+          edge.SetNote(Note());
+          edges.AddEdge(edge);
+        }
+        leaves_.push_back(vertex_pool_.construct());
+        VertexGenerator<SingleBest> gen(context_, *leaves_.back(), best_);
+        edges.Search(context_, gen);
+      }
+      for (std::size_t i = 0; i < 200; ++i) {
+        SpanEdge edge;
+        edge.left = random.Next(leaves_.size());
+        edge.right = random.Next(leaves_.size());
+        edge.word = 1 + random.Next(bound - 1);
+        edge.noise = -static_cast<Score>(random.Next(50)) / 10.0 - i * 0.00003;
+        span_.push_back(edge);
+      }
+    }
+
+    Context<Model> &GetContext() { return context_; }
+
+    std::size_t Size() const { return span_.size(); }
+
+    // Adds the i-th span edge.
+    void Add(std::size_t i, EdgeGenerator &edges) {
+      const SpanEdge &from = span_[i];
+      PartialEdge edge(edges.AllocateEdge(2));
+      edge.NT()[0] = leaves_[from.left]->RootAlternate();
+      edge.NT()[1] = leaves_[from.right]->RootAlternate();
+      std::vector<lm::WordIndex> words;
+      words.push_back(kNonTerminal);
+      words.push_back(from.word);
+      words.push_back(kNonTerminal);
+      ScoreRuleRet scored(ScoreRule(context_.LanguageModel(), words, edge.Between()));
+      edge.SetScore(edge.NT()[0].Bound() + edge.NT()[1].Bound() + scored.prob + from.noise);
+      Note note;
+      note.vp = &from;
+      edge.SetNote(note);
+      edges.AddEdge(edge);
+    }
+
+  private:
+    Config config_;
+    Context<Model> context_;
+    SingleBest best_;
+    boost::object_pool<Vertex> vertex_pool_;
+    std::vector<Vertex*> leaves_;
+    std::vector<SpanEdge> span_;
+};
+
+std::vector<Hypothesis> SearchAll(Chart &chart) {
+  EdgeGenerator edges;
+  for (std::size_t i = 0; i < chart.Size(); ++i) {
+    chart.Add(i, edges);
+  }
+  Recorder recorder;
+  edges.Search(chart.GetContext(), recorder);
+  BOOST_CHECK(recorder.finished);
+  return recorder.hypotheses;
+}
+
+void PopAhead(Chart *chart, EdgePart *part, std::size_t share) {
+  part->PopAhead(chart->GetContext(), share);
+}
+
+// Divides the edges into parts round robin, pops share complete hypotheses
+// ahead in each part, on a thread per part if threaded, and merges.
+std::vector<Hypothesis> SearchParts(Chart &chart, std::size_t count, std::size_t share, bool threaded) {
+  boost::ptr_vector<util::Pool> pools;
+  boost::ptr_vector<EdgePart> parts;
+  std::vector<EdgePart*> merge;
+  for (std::size_t i = 0; i < count; ++i) {
+    pools.push_back(new util::Pool());
+    parts.push_back(new EdgePart(pools.back()));
+    merge.push_back(&parts.back());
+  }
+  for (std::size_t i = 0; i < chart.Size(); ++i) {
+    chart.Add(i, parts[i % count].Edges());
+  }
+  chart.GetContext().SetConcurrent(threaded);
+#ifdef WITH_THREADS
+  if (threaded) {
+    boost::thread_group threads;
+    for (std::size_t i = 0; i < count; ++i) {
+      threads.create_thread(boost::bind(&PopAhead, &chart, &parts[i], share));
+    }
+    threads.join_all();
+  } else
+#endif
+  {
+    for (std::size_t i = 0; i < count; ++i) {
+      PopAhead(&chart, &parts[i], share);
+    }
+  }
+  chart.GetContext().SetConcurrent(false);
+  Recorder recorder;
+  MergeParts(chart.GetContext(), merge, recorder);
+  BOOST_CHECK(recorder.finished);
+  return recorder.hypotheses;
+}
+
+// MergeParts pops in the same order as one EdgeGenerator except for ties,
+// so runs of hypotheses with the same score are sorted here.  When the pop
+// limit cuts through a run, the two may pick different hypotheses, so the
+// last run is dropped.
+std::vector<Hypothesis> Canonical(std::vector<Hypothesis> hypotheses, unsigned pop_limit) {
+  for (std::size_t begin = 0, end; begin < hypotheses.size(); begin = end) {
+    for (end = begin + 1; end < hypotheses.size() && hypotheses[end].score == hypotheses[begin].score; ++end) {}
+    std::sort(hypotheses.begin() + begin, hypotheses.begin() + end);
+  }
+  if (hypotheses.size() == pop_limit) {
+    while (hypotheses.size() > 1 && hypotheses[hypotheses.size() - 2].score == hypotheses.back().score) {
+      hypotheses.pop_back();
+    }
+    hypotheses.pop_back();
+  }
+  return hypotheses;
+}
+
+void CheckParts(unsigned pop_limit, bool threaded) {
+  Model model(TestLocation());
+  Chart chart(model, pop_limit);
+  const std::vector<Hypothesis> all(SearchAll(chart));
+  BOOST_REQUIRE(!all.empty());
+  BOOST_CHECK(all.size() <= pop_limit);
+  const std::vector<Hypothesis> expected(Canonical(all, pop_limit));
+  const std::size_t counts[] = {1, 2, 3, 8};
+  for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    const std::size_t count = counts[c];
+    // Nothing popped ahead, an even share, and more than needed.
+    const std::size_t shares[] = {0, pop_limit / count + 1, pop_limit};
+    for (std::size_t s = 0; s < sizeof(shares) / sizeof(shares[0]); ++s) {
+      BOOST_TEST_MESSAGE("parts " << count << " share " << shares[s]);
+      std::vector<Hypothesis> got(Canonical(SearchParts(chart, count, shares[s], threaded), pop_limit));
+      BOOST_CHECK_EQUAL_COLLECTIONS(got.begin(), got.end(), expected.begin(), expected.end());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(merge_matches_search) {
+  CheckParts(50, false);
+}
+
+// A pop limit above the number of hypotheses, so every queue runs empty.
+BOOST_AUTO_TEST_CASE(merge_matches_exhausted_search) {
+  CheckParts(100000, false);
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(merge_matches_threaded_search) {
+  CheckParts(50, true);
+  CheckParts(500, true);
+}
+#endif
+
+} // namespace
+} // namespace search
@@ -4,6 +4,11 @@
 
 #include <boost/unordered_map.hpp>
 
+#ifdef WITH_THREADS
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include <algorithm>
 #include <functional>
 #include <cassert>
@@ -201,4 +206,21 @@ void VertexNode::BuildExtend() {
   }
 }
 
+#ifdef WITH_THREADS
+namespace {
+// Nodes are locked by address, which is cheaper than a mutex in every node.
+const std::size_t kBuildLocks = 64;
+boost::mutex build_locks[kBuildLocks];
+} // namespace
+#endif
+
+void VertexNode::BuildExtendShared() {
+  // A leaf never changes, so it needs no lock.
+  if (hypos_.size() <= 1) return;
+#ifdef WITH_THREADS
+  boost::lock_guard<boost::mutex> lock(build_locks[(reinterpret_cast<uintptr_t>(this) / sizeof(VertexNode)) % kBuildLocks]);
+#endif
+  BuildExtend();
+}
+
 } // namespace search
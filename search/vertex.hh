@@ -54,6 +54,9 @@ class VertexNode {
 
     void BuildExtend();
 
+    // BuildExtend for a node that other threads may extend at the same time.
+    void BuildExtendShared();
+
     // Should only happen to a root node when the entire vertex is empty.
     bool Empty() const {
       return hypos_.empty() && extend_.empty();
@@ -123,9 +126,14 @@ class PartialVertex {
     unsigned char Niceness() const { return back_->Niceness(); }
 
     // Split into continuation and alternative, rendering this the continuation.
-    bool Split(PartialVertex &alternative) {
+    // Pass concurrent if other threads may split the same vertex.
+    bool Split(PartialVertex &alternative, bool concurrent = false) {
       assert(!Complete());
-      back_->BuildExtend();
+      if (concurrent) {
+        back_->BuildExtendShared();
+      } else {
+        back_->BuildExtend();
+      }
       bool ret;
       if (index_ + 1 < back_->Size()) {
         alternative.index_ = index_ + 1;
@@ -10,15 +10,28 @@
 #include <list>
 #include <vector>
 #include <set>
+#include <map>
+#include <deque>
 #include <algorithm>
 #include <cstring>
+#include <cctype>
+#include <cstdlib>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 #include "cmd.h"
+#include "phrase-extract/InputFileStream.h"
+#include "phrase-extract/OutputFileStream.h"
 
 using namespace std;
 
 const int MAX_WORD = 10000;  // maximum lengthsource/target strings
 const int MAX_M = 400;       // maximum length of source strings
 const int MAX_N = 400;       // maximum length of target strings
+const size_t CHUNK_SIZE = 10000; // sentences handed to a worker thread at once
 
 enum Alignment {
   UNION = 1,
@@ -58,55 +71,106 @@ Enum_T BoolEnum [] = {
 
 // global variables and constants
 
-int* fa; //counters of covered foreign positions
-int* ea; //counters of covered english positions
-int** A; //alignment matrix with information symmetric/direct/inverse alignments
-
 int verbose=0;
 
-//read an alignment pair from the input stream.
+//scratch space of the grow heuristics, one per thread
+struct GrowMatrix {
+  GrowMatrix() : fa(MAX_M+1), ea(MAX_N+1), A(MAX_N+1, vector<int>(MAX_M+1)) {}
+
+  vector<int> fa; //counters of covered foreign positions
+  vector<int> ea; //counters of covered english positions
+  vector<vector<int> > A; //alignment matrix with information symmetric/direct/inverse alignments
+};
+
+//direct and inverse alignment of one sentence pair, as read by getals()
+struct AlignmentPair {
+  int m, n;
+  vector<int> a, b;
+};
+
+typedef vector<AlignmentPair> Chunk;
+
+//which alignment to compute
+struct Settings {
+  int alignment;
+  bool diagonal, isfinal, bothuncovered;
+};
+
+//whitespace tokenizer over the text of a chunk of sentence pairs
+class BalInput
+{
+public:
+  explicit BalInput(const string& text) : m_p(text.c_str()) {}
+
+  //next token, false at the end of the text
+  bool word(const char*& begin, size_t& len) {
+    begin = m_p;
+    len = 0;
+    while (isspace((unsigned char)*m_p)) m_p++;
+    if (!*m_p) return false;
+    begin = m_p;
+    while (*m_p && !isspace((unsigned char)*m_p)) m_p++;
+    len = m_p - begin;
+    return true;
+  }
+
+  bool number(int& value) {
+    const char* begin;
+    size_t len;
+    value = 0;
+    if (!word(begin,len)) return false;
+    char* end;
+    value = strtol(begin,&end,10);
+    return end == begin + len;
+  }
+
+private:
+  const char* m_p;
+};
 
-int lc = 0;
+//read an alignment pair from the input.
+//lc counts the pairs read, for error messages.
 
-int getals(istream& inp,int& m, int *a,int& n, int *b)
+int getals(BalInput& inp,int& lc,int& m, int *a,int& n, int *b)
 {
-  char w[MAX_WORD], dummy[10];
+  const char* w;
+  size_t len;
   int i,j,freq;
-  if (inp >> freq) {
+  if (inp.number(freq)) {
     ++lc;
     //target sentence
-    inp >> n;
+    inp.number(n);
     assert(n<MAX_N);
     for (i=1; i<=n; i++) {
-      inp >> setw(MAX_WORD) >> w;
-      if (strlen(w)>=MAX_WORD-1) {
-        cerr << lc << ": target len=" << strlen(w) << " is not less than MAX_WORD-1="
+      inp.word(w,len);
+      if (len>=MAX_WORD-1) {
+        cerr << lc << ": target len=" << len << " is not less than MAX_WORD-1="
              << MAX_WORD-1 << endl;
-        assert(strlen(w)<MAX_WORD-1);
+        assert(len<MAX_WORD-1);
       }
     }
 
-    inp >> dummy; //# separator
+    inp.word(w,len); //# separator
     // inverse alignment
-    for (i=1; i<=n; i++) inp >> b[i];
+    for (i=1; i<=n; i++) inp.number(b[i]);
 
     //source sentence
-    inp >> m;
+    inp.number(m);
     assert(m<MAX_M);
     for (j=1; j<=m; j++) {
-      inp >> setw(MAX_WORD) >> w;
-      if (strlen(w)>=MAX_WORD-1) {
-        cerr << lc << ": source len=" << strlen(w) << " is not less than MAX_WORD-1="
+      inp.word(w,len);
+      if (len>=MAX_WORD-1) {
+        cerr << lc << ": source len=" << len << " is not less than MAX_WORD-1="
              << MAX_WORD-1 << endl;
-        assert(strlen(w)<MAX_WORD-1);
+        assert(len<MAX_WORD-1);
       }
     }
 
-    inp >> dummy; //# separator
+    inp.word(w,len); //# separator
 
     // direct alignment
     for (j=1; j<=m; j++) {
-      inp >> a[j];
+      inp.number(a[j]);
       assert(0<=a[j] && a[j]<=n);
     }
 
@@ -143,7 +207,6 @@ int prunionalignment(ostream& out,int m,int *a,int n,int* b)
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
 
   return 1;
 }
@@ -168,7 +231,6 @@ int printersect(ostream& out,int m,int *a,int n,int* b)
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
 
   return 1;
 }
@@ -192,7 +254,6 @@ int printtgttosrc(ostream& out,int m,int *a,int n,int* b)
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
 
   return 1;
 }
@@ -216,7 +277,6 @@ int printsrctotgt(ostream& out,int m,int *a,int n,int* b)
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
 
   return 1;
 }
@@ -227,7 +287,7 @@ int printsrctotgt(ostream& out,int m,int *a,int n,int* b)
 //to represent the grow alignment as the unionalignment of a
 //directed and inverted alignment
 
-int printgrow(ostream& out,int m,int *a,int n,int* b, bool diagonal=false,bool isfinal=false,bool bothuncovered=false)
+int printgrow(ostream& out,GrowMatrix& matrix,int m,int *a,int n,int* b, bool diagonal=false,bool isfinal=false,bool bothuncovered=false)
 {
 
   ostringstream sout;
@@ -256,13 +316,16 @@ int printgrow(ostream& out,int m,int *a,int n,int* b, bool diagonal=false,bool i
 
   //covered foreign and english positions
 
+  int *fa = &matrix.fa[0];
+  int *ea = &matrix.ea[0];
   memset(fa,0,(m+1)*sizeof(int));
   memset(ea,0,(n+1)*sizeof(int));
 
   //matrix to quickly check if one point is in the symmetric
   //alignment (value=2), direct alignment (=1) and inverse alignment
 
-  for (int i=1; i<=n; i++) memset(A[i],0,(m+1)*sizeof(int));
+  vector<vector<int> > &A = matrix.A;
+  for (int i=1; i<=n; i++) memset(&A[i][0],0,(m+1)*sizeof(int));
 
   set <pair <int,int> > currentpoints; //symmetric alignment
   set <pair <int,int> > unionalignment; //union alignment
@@ -378,12 +441,168 @@ int printgrow(ostream& out,int m,int *a,int n,int* b, bool diagonal=false,bool i
     str.replace(str.length()-1,1,"\n");
 
   out << str;
-  out.flush();
   return 1;
+}
 
-  return 1;
+//parse the sentence pairs in text
+size_t readchunk(const string& text, int& lc, Chunk& chunk)
+{
+  BalInput inp(text);
+  int a[MAX_M],b[MAX_N],m,n;
+  a[0]=b[0]=0;
+  chunk.clear();
+  while (getals(inp,lc,m,a,n,b)) {
+    chunk.push_back(AlignmentPair());
+    AlignmentPair &pair = chunk.back();
+    pair.m=m;
+    pair.n=n;
+    pair.a.assign(a,a+m+1);
+    pair.b.assign(b,b+n+1);
+  }
+  return chunk.size();
+}
+
+//read the text of up to size sentence pairs without parsing it;
+//giza2bal.pl writes each pair on three lines and an empty line for
+//each pair it skips
+bool readtext(istream& inp, string& text, size_t size)
+{
+  string line;
+  size_t lines=0;
+  text.clear();
+  while (lines < 3*size && getline(inp,line)) {
+    text += line;
+    text += '\n';
+    if (line.find_first_not_of(" \t\r") != string::npos)
+      lines++;
+  }
+  return !text.empty();
+}
+
+//symmetrize the alignments of a chunk
+void printchunk(ostream& out, const Settings& settings, Chunk& chunk, GrowMatrix& matrix)
+{
+  for (size_t s=0; s<chunk.size(); s++) {
+    int m=chunk[s].m, n=chunk[s].n;
+    int *a=&chunk[s].a[0], *b=&chunk[s].b[0];
+    switch (settings.alignment) {
+    case UNION:
+      prunionalignment(out,m,a,n,b);
+      break;
+    case INTERSECT:
+      printersect(out,m,a,n,b);
+      break;
+    case GROW:
+      printgrow(out,matrix,m,a,n,b,settings.diagonal,settings.isfinal,settings.bothuncovered);
+      break;
+    case TGTTOSRC:
+      printtgttosrc(out,m,a,n,b);
+      break;
+    case SRCTOTGT:
+      printsrctotgt(out,m,a,n,b);
+      break;
+    default:
+      throw runtime_error("Unknown alignment");
+    }
+  }
 }
 
+#ifdef WITH_THREADS
+//Reads the input in chunks of sentences, which worker threads parse and
+//symmetrize, each with its own matrix, and writes the results in input
+//order.
+class ParallelSymal
+{
+public:
+  ParallelSymal(const Settings& settings, ostream& out)
+    : m_settings(settings), m_out(out), m_read(0), m_written(0), m_sents(0), m_eof(false) {}
+
+  size_t Run(istream& inp, size_t threads) {
+    boost::thread_group workers;
+    for (size_t t=0; t<threads; t++)
+      workers.create_thread(boost::bind(&ParallelSymal::Work, this));
+
+    string text;
+    while (readtext(inp,text,CHUNK_SIZE)) {
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_jobs.push_back(make_pair(m_read++, string()));
+        m_jobs.back().second.swap(text);
+        m_cond.notify_all();
+      }
+      //bound the number of chunks held in memory
+      Write(2*threads);
+    }
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      m_eof = true;
+      m_cond.notify_all();
+    }
+    Write(0);
+    workers.join_all();
+    return m_sents;
+  }
+
+private:
+  void Work() {
+    GrowMatrix matrix;
+    Chunk chunk;
+    for (;;) {
+      pair<size_t, string> job;
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (m_jobs.empty() && !m_eof) m_cond.wait(lock);
+        if (m_jobs.empty()) return;
+        job.first = m_jobs.front().first;
+        job.second.swap(m_jobs.front().second);
+        m_jobs.pop_front();
+      }
+      int lc = job.first * CHUNK_SIZE;
+      readchunk(job.second,lc,chunk);
+      ostringstream out;
+      printchunk(out,m_settings,chunk,matrix);
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_done[job.first] = out.str();
+        m_sents += chunk.size();
+        m_cond.notify_all();
+      }
+    }
+  }
+
+  //write finished chunks in order until at most pending chunks are left
+  void Write(size_t pending) {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    for (;;) {
+      map<size_t, string>::iterator it = m_done.find(m_written);
+      if (it != m_done.end()) {
+        string text;
+        text.swap(it->second);
+        m_done.erase(it);
+        lock.unlock();
+        m_out << text;
+        lock.lock();
+        m_written++;
+      } else if (m_read - m_written > pending) {
+        m_cond.wait(lock);
+      } else {
+        return;
+      }
+    }
+  }
+
+  const Settings &m_settings;
+  ostream &m_out;
+
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+  deque<pair<size_t, string> > m_jobs;
+  map<size_t, string> m_done;
+  size_t m_read, m_written, m_sents;
+  bool m_eof;
+};
+#endif
+
 } // namespace
 
 
@@ -399,6 +618,7 @@ int main(int argc, char** argv)
   int diagonal=false;
   int isfinal=false;
   int bothuncovered=false;
+  int threads=1;
 
 
   DeclareParams("a", CMDENUMTYPE,  &alignment, AlignEnum,
@@ -411,6 +631,8 @@ int main(int argc, char** argv)
                 "both", CMDENUMTYPE,  &bothuncovered, BoolEnum,
                 "i", CMDSTRINGTYPE, &input,
                 "o", CMDSTRINGTYPE, &output,
+                "t", CMDINTTYPE, &threads,
+                "threads", CMDINTTYPE, &threads,
                 "v", CMDENUMTYPE,  &verbose, BoolEnum,
                 "verbose", CMDENUMTYPE,  &verbose, BoolEnum,
 
@@ -419,95 +641,95 @@ int main(int argc, char** argv)
   GetParams(&argc, &argv, NULL);
 
   if (alignment==0) {
-    cerr << "usage: symal [-i=<inputfile>] [-o=<outputfile>] -a=[u|i|g] -d=[yes|no] -b=[yes|no] -f=[yes|no] \n"
-         << "Input file or std must be in .bal format (see script giza2bal.pl).\n";
+    cerr << "usage: symal [-i=<inputfile>] [-o=<outputfile>] -a=[u|i|g] -d=[yes|no] -b=[yes|no] -f=[yes|no] [-t=<threads>]\n"
+         << "Input file or std must be in .bal format (see script giza2bal.pl).\n"
+         << "Input and output files ending in .gz are (de)compressed.\n";
 
     exit(1);
   }
 
+  //cin and cout are read and written in bulk; unsynchronized they do
+  //not lock stdio for every character once threads are running
+  std::ios::sync_with_stdio(false);
+
   istream *inp = &std::cin;
   ostream *out = &std::cout;
 
   try {
     if (input) {
-      fstream *fin = new fstream(input,ios::in);
-      if (!fin->is_open()) throw runtime_error("cannot open " + string(input));
-      inp = fin;
+      inp = new Moses::InputFileStream(input);
     }
 
     if (output) {
-      fstream *fout = new fstream(output,ios::out);
-      if (!fout->is_open()) throw runtime_error("cannot open " + string(output));
+      Moses::OutputFileStream *fout = new Moses::OutputFileStream();
+      if (!fout->Open(output)) throw runtime_error("cannot open " + string(output));
       out = fout;
     }
 
-    int a[MAX_M],b[MAX_N],m,n;
-    fa=new int[MAX_M+1];
-    ea=new int[MAX_N+1];
-
+#ifndef WITH_THREADS
+    if (threads > 1) {
+      cerr << "symal: built without threads, using one thread\n";
+      threads = 1;
+    }
+#endif
 
-    int sents = 0;
-    A=new int *[MAX_N+1];
-    for (int i=1; i<=MAX_N; i++) A[i]=new int[MAX_M+1];
+    Settings settings;
+    settings.alignment = alignment;
+    settings.diagonal = diagonal;
+    settings.isfinal = isfinal;
+    settings.bothuncovered = bothuncovered;
 
     switch (alignment) {
     case UNION:
       cerr << "symal: computing union alignment\n";
-      while(getals(*inp,m,a,n,b)) {
-        prunionalignment(*out,m,a,n,b);
-        sents++;
-      }
-      cerr << "Sents: " << sents << endl;
       break;
     case INTERSECT:
       cerr << "symal: computing intersect alignment\n";
-      while(getals(*inp,m,a,n,b)) {
-        printersect(*out,m,a,n,b);
-        sents++;
-      }
-      cerr << "Sents: " << sents << endl;
       break;
     case GROW:
       cerr << "symal: computing grow alignment: diagonal ("
            << diagonal << ") final ("<< isfinal << ")"
            <<  "both-uncovered (" << bothuncovered <<")\n";
-
-      while(getals(*inp,m,a,n,b))
-        printgrow(*out,m,a,n,b,diagonal,isfinal,bothuncovered);
-
       break;
     case TGTTOSRC:
       cerr << "symal: computing target-to-source alignment\n";
-
-      while(getals(*inp,m,a,n,b)) {
-        printtgttosrc(*out,m,a,n,b);
-        sents++;
-      }
-      cerr << "Sents: " << sents << endl;
       break;
     case SRCTOTGT:
       cerr << "symal: computing source-to-target alignment\n";
-
-      while(getals(*inp,m,a,n,b)) {
-        printsrctotgt(*out,m,a,n,b);
-        sents++;
-      }
-      cerr << "Sents: " << sents << endl;
       break;
     default:
       throw runtime_error("Unknown alignment");
     }
 
-    delete [] fa;
-    delete [] ea;
-    for (int i=1; i<=MAX_N; i++) delete [] A[i];
-    delete [] A;
+    size_t sents = 0;
+#ifdef WITH_THREADS
+    if (threads > 1) {
+      ParallelSymal symal(settings, *out);
+      sents = symal.Run(*inp, threads);
+    } else
+#endif
+    {
+      GrowMatrix matrix;
+      Chunk chunk;
+      string text;
+      int lc = 0;
+      while (readtext(*inp,text,CHUNK_SIZE)) {
+        readchunk(text,lc,chunk);
+        printchunk(*out,settings,chunk,matrix);
+        sents += chunk.size();
+      }
+    }
+
+    if (alignment != GROW)
+      cerr << "Sents: " << sents << endl;
 
     if (inp != &std::cin) {
       delete inp;
     }
     if (out != &std::cout) {
-      delete inp;
+      delete out;
+    } else {
+      out->flush();
     }
   } catch (const std::exception &e) {
     cerr << e.what() << std::endl;
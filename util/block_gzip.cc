@@ -0,0 +1,314 @@
+#include "util/block_gzip.hh"
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/read_compressed.hh"
+#include "util/scoped.hh"
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace util {
+
+namespace {
+
+const std::size_t kTrailerSize = 8;
+// Deflated blocks must fit the 32-bit size in the header.
+const std::size_t kMaximumBlockSize = 1 << 30;
+
+void PutLittle16(uint8_t *to, uint32_t value) {
+  to[0] = value & 0xff;
+  to[1] = (value >> 8) & 0xff;
+}
+
+void PutLittle32(uint8_t *to, uint32_t value) {
+  PutLittle16(to, value);
+  PutLittle16(to + 2, value >> 16);
+}
+
+uint32_t GetLittle32(const uint8_t *from) {
+  return static_cast<uint32_t>(from[0]) | (static_cast<uint32_t>(from[1]) << 8) | (static_cast<uint32_t>(from[2]) << 16) | (static_cast<uint32_t>(from[3]) << 24);
+}
+
+// Header fields before the member size.
+const uint8_t kHeader[16] = {
+  0x1f, 0x8b, // magic
+  8, // deflate
+  4, // FEXTRA
+  0, 0, 0, 0, // no modification time
+  0, // extra flags
+  255, // unknown OS
+  8, 0, // length of the extra field
+  'P', 'G', // subfield ID
+  4, 0 // length of the subfield
+};
+
+void DeflateMember(const std::string &in, int level, std::string &out) {
+#ifdef HAVE_ZLIB
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // Raw deflate: this code writes the gzip header and trailer itself.
+  UTIL_THROW_IF(Z_OK != deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY), GZException, "Failed to initialize zlib for compression.");
+  std::size_t bound = deflateBound(&stream, in.size());
+  out.resize(kBlockGZipHeaderSize + bound + kTrailerSize);
+  stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(in.data()));
+  stream.avail_in = in.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[kBlockGZipHeaderSize]);
+  stream.avail_out = bound;
+  int result = deflate(&stream, Z_FINISH);
+  std::size_t deflated = stream.total_out;
+  deflateEnd(&stream);
+  UTIL_THROW_IF(result != Z_STREAM_END, GZException, "zlib failed to compress a block, code " << result);
+
+  std::size_t size = kBlockGZipHeaderSize + deflated + kTrailerSize;
+  uint8_t *header = reinterpret_cast<uint8_t*>(&out[0]);
+  memcpy(header, kHeader, sizeof(kHeader));
+  PutLittle32(header + sizeof(kHeader), size);
+  uint8_t *trailer = header + kBlockGZipHeaderSize + deflated;
+  PutLittle32(trailer, crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(in.data()), in.size()));
+  PutLittle32(trailer + 4, in.size());
+  out.resize(size);
+#else
+  UTIL_THROW(CompressedException, "Block gzip needs gzip support, which was not compiled in.");
+#endif
+}
+
+} // namespace
+
+uint32_t BlockGZipMemberSize(const void *header_void) {
+  const uint8_t *header = static_cast<const uint8_t*>(header_void);
+  // Modification time, extra flags, and OS may be anything.
+  if (memcmp(header, kHeader, 4) || memcmp(header + 10, kHeader + 10, sizeof(kHeader) - 10)) return 0;
+  uint32_t size = GetLittle32(header + sizeof(kHeader));
+  return size >= kBlockGZipHeaderSize + kTrailerSize ? size : 0;
+}
+
+void InflateBlockGZipMember(const void *member_void, std::size_t member_size, std::string &out) {
+  const uint8_t *member = static_cast<const uint8_t*>(member_void);
+  UTIL_THROW_IF(member_size < kBlockGZipHeaderSize + kTrailerSize, GZException, "Truncated gzip member");
+  const uint8_t *trailer = member + member_size - kTrailerSize;
+  uint32_t expect_crc = GetLittle32(trailer);
+  uint32_t expect_size = GetLittle32(trailer + 4);
+  UTIL_THROW_IF(expect_size > kMaximumBlockSize, GZException, "Block gzip member claims to inflate to " << expect_size << " bytes");
+#ifdef HAVE_ZLIB
+
+  // One more byte so that the output pointer is valid for empty members.
+  out.resize(expect_size + 1);
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  UTIL_THROW_IF(Z_OK != inflateInit2(&stream, -15), GZException, "Failed to initialize zlib.");
+  stream.next_in = const_cast<Bytef*>(member + kBlockGZipHeaderSize);
+  stream.avail_in = member_size - kBlockGZipHeaderSize - kTrailerSize;
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  int result = inflate(&stream, Z_FINISH);
+  std::size_t inflated = stream.total_out;
+  inflateEnd(&stream);
+  UTIL_THROW_IF(result != Z_STREAM_END, GZException, "zlib encountered " << (stream.msg ? stream.msg : "an error") << " code " << result << " in a block gzip member");
+  UTIL_THROW_IF(inflated != expect_size, GZException, "Block gzip member inflated to " << inflated << " bytes, not " << expect_size);
+  out.resize(expect_size);
+  UTIL_THROW_IF(expect_crc != crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(out.data()), out.size()), GZException, "CRC mismatch in block gzip member");
+#else
+  UTIL_THROW(CompressedException, "This looks like a gzip file but gzip support was not compiled in.");
+#endif
+}
+
+#ifdef WITH_THREADS
+// Deflates blocks on worker threads.  Members are written by the thread
+// calling Write, in the order the blocks were submitted.
+class BlockGZipWriter::Pool {
+  public:
+    Pool(BlockGZipWriter &writer, std::size_t threads) : writer_(writer), stop_(false) {
+      for (std::size_t i = 0; i < threads; ++i) {
+        workers_.create_thread(boost::bind(&Pool::Work, this));
+      }
+      max_pending_ = 2 * threads;
+    }
+
+    ~Pool() {
+      {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      work_ready_.notify_all();
+      workers_.join_all();
+      for (std::size_t i = 0; i < pending_.size(); ++i) delete pending_[i];
+      for (std::size_t i = 0; i < free_.size(); ++i) delete free_[i];
+    }
+
+    // Takes the contents of block, leaving it empty.
+    void Submit(std::string &block) {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      Block *entry;
+      if (free_.empty()) {
+        entry = new Block();
+      } else {
+        entry = free_.back();
+        free_.pop_back();
+      }
+      entry->in.swap(block);
+      block.clear();
+      entry->done = false;
+      pending_.push_back(entry);
+      work_.push_back(entry);
+      work_ready_.notify_one();
+      WriteCompleted(lock, max_pending_);
+    }
+
+    void Finish() {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      WriteCompleted(lock, 0);
+    }
+
+  private:
+    struct Block {
+      std::string in, out, error;
+      bool done;
+    };
+
+    // Write members in order, waiting until at most keep are pending.
+    void WriteCompleted(boost::unique_lock<boost::mutex> &lock, std::size_t keep) {
+      while (!pending_.empty()) {
+        Block *front = pending_.front();
+        if (!front->done) {
+          if (pending_.size() <= keep) return;
+          block_done_.wait(lock);
+          continue;
+        }
+        pending_.pop_front();
+        // Owned here until it is back on free_, so a throw does not leak it.
+        util::scoped_ptr<Block> owned(front);
+        // Blocks are only touched by workers while pending and not done.
+        lock.unlock();
+        UTIL_THROW_IF(!front->error.empty(), GZException, front->error);
+        writer_.WriteMember(front->out, front->in.size());
+        lock.lock();
+        free_.push_back(owned.release());
+      }
+    }
+
+    void Work() {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (true) {
+        while (work_.empty() && !stop_) work_ready_.wait(lock);
+        if (work_.empty()) return;
+        Block *block = work_.front();
+        work_.pop_front();
+        lock.unlock();
+        try {
+          DeflateMember(block->in, writer_.level_, block->out);
+        } catch (const std::exception &e) {
+          block->error = e.what();
+        }
+        lock.lock();
+        block->done = true;
+        block_done_.notify_all();
+      }
+    }
+
+    BlockGZipWriter &writer_;
+
+    boost::mutex mutex_;
+    boost::condition_variable work_ready_, block_done_;
+    std::deque<Block*> pending_, work_;
+    std::vector<Block*> free_;
+    std::size_t max_pending_;
+    bool stop_;
+
+    boost::thread_group workers_;
+};
+#else // WITH_THREADS
+class BlockGZipWriter::Pool {};
+#endif // WITH_THREADS
+
+BlockGZipWriter::BlockGZipWriter(int fd, std::size_t threads, int level, std::size_t block_size, int index)
+  : file_(fd), index_(index), level_(level), block_size_(block_size),
+    compressed_offset_(0), uncompressed_offset_(0), wrote_(false), closed_(false) {
+#ifndef HAVE_ZLIB
+  UTIL_THROW(CompressedException, "Block gzip needs gzip support, which was not compiled in.");
+#endif
+  UTIL_THROW_IF(!block_size_ || block_size_ > kMaximumBlockSize, GZException, "Block gzip block size " << block_size_ << " is out of range");
+  block_.reserve(block_size_);
+#ifdef WITH_THREADS
+  if (threads > 1) pool_.reset(new Pool(*this, threads));
+#endif
+}
+
+BlockGZipWriter::~BlockGZipWriter() {
+  try {
+    Close();
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    abort();
+  }
+}
+
+void BlockGZipWriter::Write(const void *data_void, std::size_t size) {
+  const char *data = static_cast<const char*>(data_void);
+  while (size) {
+    std::size_t take = std::min(size, block_size_ - block_.size());
+    block_.append(data, take);
+    data += take;
+    size -= take;
+    if (block_.size() == block_size_) Submit();
+  }
+}
+
+void BlockGZipWriter::Close() {
+  if (closed_) return;
+  closed_ = true;
+  if (!block_.empty() || !wrote_) Submit();
+#ifdef WITH_THREADS
+  if (pool_.get()) {
+    pool_->Finish();
+    pool_.reset();
+  }
+#endif
+  file_.reset();
+  index_.reset();
+}
+
+void BlockGZipWriter::Submit() {
+#ifdef WITH_THREADS
+  if (pool_.get()) {
+    pool_->Submit(block_);
+    block_.reserve(block_size_);
+    return;
+  }
+#endif
+  DeflateMember(block_, level_, member_);
+  WriteMember(member_, block_.size());
+  block_.clear();
+}
+
+void BlockGZipWriter::WriteMember(const std::string &member, std::size_t uncompressed) {
+  if (index_.get() != -1) {
+    BlockGZipIndexEntry entry;
+    entry.compressed_offset = compressed_offset_;
+    entry.uncompressed_offset = uncompressed_offset_;
+    WriteOrThrow(index_.get(), &entry, sizeof(entry));
+  }
+  WriteOrThrow(file_.get(), member.data(), member.size());
+  compressed_offset_ += member.size();
+  uncompressed_offset_ += uncompressed;
+  wrote_ = true;
+}
+
+} // namespace util
@@ -0,0 +1,90 @@
+#ifndef UTIL_BLOCK_GZIP_H
+#define UTIL_BLOCK_GZIP_H
+
+/* Block gzip: the output is cut into blocks and each block is deflated as a
+ * gzip member of its own.  Concatenated members are standard gzip, so gzip,
+ * zcat and zlib's gzread decode these files unchanged.  Because members are
+ * independent, they can be deflated concurrently, and ReadCompressed
+ * inflates them concurrently too.
+ *
+ * Each member's header carries an extra field (subfield "PG", 4 bytes) with
+ * the size in bytes of the whole member, header and trailer included, so a
+ * reader can find the next member without inflating this one.
+ *
+ * Optionally the writer also produces a side index with one
+ * BlockGZipIndexEntry per member, to seek to a member directly.
+ */
+
+#include "util/file.hh"
+#include "util/scoped.hh"
+
+#include <cstddef>
+#include <string>
+
+#include <stdint.h>
+
+namespace util {
+
+// Size of the header that each member starts with.
+const std::size_t kBlockGZipHeaderSize = 20;
+
+// Returns the size of the member that header starts, or 0 if header is not
+// the header of a block gzip member.  header must have kBlockGZipHeaderSize
+// bytes.
+uint32_t BlockGZipMemberSize(const void *header);
+
+// Inflates the member of member_size bytes at member into out.  Throws
+// GZException if the member is corrupt.
+void InflateBlockGZipMember(const void *member, std::size_t member_size, std::string &out);
+
+// One entry of the side index, in host byte order.
+struct BlockGZipIndexEntry {
+  uint64_t compressed_offset;
+  uint64_t uncompressed_offset;
+};
+
+class BlockGZipWriter {
+  public:
+    static const std::size_t kDefaultBlockSize = 1 << 20;
+
+    /* Takes ownership of fd.  If index is not -1, it receives one
+     * BlockGZipIndexEntry per member and is owned as well.  With more than
+     * one thread, members are deflated by that many threads and written in
+     * order as they complete.
+     */
+    explicit BlockGZipWriter(int fd, std::size_t threads = 1, int level = 6, std::size_t block_size = kDefaultBlockSize, int index = -1);
+
+    // Calls Close.
+    ~BlockGZipWriter();
+
+    void Write(const void *data, std::size_t size);
+
+    // Write the last block and wait for all members.  Does nothing the second
+    // time.  An empty file gets one empty member, so it is still valid gzip.
+    void Close();
+
+  private:
+    void Submit();
+
+    void WriteMember(const std::string &member, std::size_t uncompressed);
+
+    class Pool;
+
+    scoped_fd file_, index_;
+    const int level_;
+    const std::size_t block_size_;
+
+    std::string block_, member_;
+    uint64_t compressed_offset_, uncompressed_offset_;
+    bool wrote_, closed_;
+
+    scoped_ptr<Pool> pool_;
+
+    // No copying.
+    BlockGZipWriter(const BlockGZipWriter &);
+    void operator=(const BlockGZipWriter &);
+};
+
+} // namespace util
+
+#endif // UTIL_BLOCK_GZIP_H
@@ -0,0 +1,40 @@
+#ifndef UTIL_BLOCK_GZIP_SINK_H
+#define UTIL_BLOCK_GZIP_SINK_H
+
+#include "util/block_gzip.hh"
+#include "util/file.hh"
+
+#include <boost/iostreams/concepts.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <cstddef>
+#include <ios>
+
+namespace util {
+
+/* A boost::iostreams sink that writes a file in block gzip, for streams such
+ * as a filtering_ostream.  Streams keep copies of their sinks, so copies share
+ * the writer.
+ */
+class BlockGZipSink : public boost::iostreams::sink {
+  public:
+    // Creates file, throwing if that fails.
+    BlockGZipSink(const char *file, std::size_t threads)
+      : writer_(new BlockGZipWriter(CreateOrThrow(file), threads)) {}
+
+    std::streamsize write(const char *data, std::streamsize size) {
+      writer_->Write(data, size);
+      return size;
+    }
+
+    // Write the rest of the file.  Call when the stream is done with the sink,
+    // so that errors are thrown here instead of lost in a destructor.
+    void Close() { writer_->Close(); }
+
+  private:
+    boost::shared_ptr<BlockGZipWriter> writer_;
+};
+
+} // namespace util
+
+#endif // UTIL_BLOCK_GZIP_SINK_H
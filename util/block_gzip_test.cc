@@ -0,0 +1,153 @@
+#include "util/block_gzip.hh"
+
+#include "util/file.hh"
+#include "util/read_compressed.hh"
+
+#define BOOST_TEST_MODULE BlockGZipTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace util {
+namespace {
+
+const uint32_t kSize4 = 100000 / 4;
+
+void WriteNumbers(BlockGZipWriter &writer) {
+  // Odd write sizes so writes straddle blocks.
+  for (uint32_t i = 0; i < kSize4; i += 3) {
+    uint32_t values[3] = {i, i + 1, i + 2};
+    writer.Write(values, sizeof(uint32_t) * std::min<uint32_t>(3, kSize4 - i));
+  }
+}
+
+void VerifyNumbers(ReadCompressed &reader) {
+  for (uint32_t i = 0; i < kSize4; ++i) {
+    uint32_t got;
+    BOOST_REQUIRE_EQUAL(sizeof(uint32_t), reader.ReadOrEOF(&got, sizeof(uint32_t)));
+    BOOST_CHECK_EQUAL(i, got);
+  }
+}
+
+void VerifyEOF(ReadCompressed &reader) {
+  char ignored;
+  BOOST_CHECK_EQUAL((std::size_t)0, reader.Read(&ignored, 1));
+  BOOST_CHECK_EQUAL((std::size_t)0, reader.Read(&ignored, 1));
+}
+
+// Returns a duplicate of fd that reads from the beginning.
+int Rewind(int fd) {
+  scoped_fd dup(DupOrThrow(fd));
+  SeekOrThrow(dup.get(), 0);
+  return dup.release();
+}
+
+void RoundTrip(std::size_t threads) {
+  scoped_fd file(MakeTemp("block_gzip_test"));
+  {
+    BlockGZipWriter writer(DupOrThrow(file.get()), threads, 6, 1000);
+    WriteNumbers(writer);
+  }
+  ReadCompressed reader(Rewind(file.get()));
+  VerifyNumbers(reader);
+  VerifyEOF(reader);
+}
+
+BOOST_AUTO_TEST_CASE(SingleThread) {
+  RoundTrip(1);
+}
+
+BOOST_AUTO_TEST_CASE(Threads) {
+  RoundTrip(3);
+}
+
+BOOST_AUTO_TEST_CASE(Empty) {
+  scoped_fd file(MakeTemp("block_gzip_test"));
+  BlockGZipWriter(DupOrThrow(file.get()), 2).Close();
+  BOOST_CHECK(SizeFile(file.get()) > 0);
+  ReadCompressed reader(Rewind(file.get()));
+  VerifyEOF(reader);
+}
+
+BOOST_AUTO_TEST_CASE(Index) {
+  scoped_fd file(MakeTemp("block_gzip_test")), index(MakeTemp("block_gzip_test"));
+  {
+    BlockGZipWriter writer(DupOrThrow(file.get()), 2, 6, 1000, DupOrThrow(index.get()));
+    WriteNumbers(writer);
+  }
+  uint64_t index_size = SizeFile(index.get());
+  BOOST_REQUIRE_EQUAL((uint64_t)0, index_size % sizeof(BlockGZipIndexEntry));
+  std::vector<BlockGZipIndexEntry> entries(index_size / sizeof(BlockGZipIndexEntry));
+  BOOST_REQUIRE_EQUAL((std::size_t)(kSize4 * sizeof(uint32_t) + 999) / 1000, entries.size());
+  ErsatzPRead(index.get(), &entries[0], index_size, 0);
+
+  uint64_t file_size = SizeFile(file.get());
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    BOOST_CHECK_EQUAL(i * 1000, entries[i].uncompressed_offset);
+    char header[kBlockGZipHeaderSize];
+    ErsatzPRead(file.get(), header, kBlockGZipHeaderSize, entries[i].compressed_offset);
+    uint64_t end = (i + 1 == entries.size()) ? file_size : entries[i + 1].compressed_offset;
+    BOOST_CHECK_EQUAL(end - entries[i].compressed_offset, BlockGZipMemberSize(header));
+  }
+
+  // Inflate the second member on its own.
+  std::string member(entries[2].compressed_offset - entries[1].compressed_offset, 0);
+  ErsatzPRead(file.get(), &member[0], member.size(), entries[1].compressed_offset);
+  std::string inflated;
+  InflateBlockGZipMember(member.data(), member.size(), inflated);
+  BOOST_REQUIRE_EQUAL((std::size_t)1000, inflated.size());
+  uint32_t first;
+  memcpy(&first, inflated.data(), sizeof(uint32_t));
+  BOOST_CHECK_EQUAL((uint32_t)250, first);
+
+  // Corruption is detected.
+  member[member.size() / 2] ^= 0x55;
+  BOOST_CHECK_THROW(InflateBlockGZipMember(member.data(), member.size(), inflated), GZException);
+}
+
+// Block gzip is ordinary gzip, and ordinary gzip may follow it.
+BOOST_AUTO_TEST_CASE(Gzip) {
+  char name[] = "tempXXXXXX";
+  scoped_fd file(mkstemp(name));
+  BOOST_REQUIRE(file.get() > 0);
+  {
+    BlockGZipWriter writer(DupOrThrow(file.get()), 2, 6, 1000);
+    WriteNumbers(writer);
+  }
+  std::string command("gzip -dc <\"");
+  command += name;
+  command += "\" | cmp - \"";
+  command += name;
+  command += ".expect\"";
+  {
+    scoped_fd expect(CreateOrThrow((std::string(name) + ".expect").c_str()));
+    for (uint32_t i = 0; i < kSize4; ++i) {
+      WriteOrThrow(expect.get(), &i, sizeof(uint32_t));
+    }
+  }
+  BOOST_CHECK_EQUAL(0, system(command.c_str()));
+
+  command = "echo foo | gzip >>\"";
+  command += name;
+  command += "\"";
+  BOOST_REQUIRE_EQUAL(0, system(command.c_str()));
+  ReadCompressed reader(Rewind(file.get()));
+  VerifyNumbers(reader);
+  char foo[4];
+  BOOST_REQUIRE_EQUAL((std::size_t)4, reader.ReadOrEOF(foo, 4));
+  BOOST_CHECK_EQUAL("foo\n", std::string(foo, 4));
+  VerifyEOF(reader);
+
+  BOOST_CHECK(!unlink(name));
+  BOOST_CHECK(!unlink((std::string(name) + ".expect").c_str()));
+}
+
+} // namespace
+} // namespace util
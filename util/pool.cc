@@ -11,6 +11,7 @@ namespace util {
 Pool::Pool() {
   current_ = NULL;
   current_end_ = NULL;
+  total_ = 0;
 }
 
 Pool::~Pool() {
@@ -24,12 +25,26 @@ void Pool::FreeAll() {
   free_list_.clear();
   current_ = NULL;
   current_end_ = NULL;
+  total_ = 0;
+}
+
+void Pool::Reset() {
+  if (free_list_.size() > 1) {
+    std::size_t total = total_;
+    FreeAll();
+    free_list_.push_back(MallocOrThrow(total));
+    total_ = total;
+  }
+  if (free_list_.empty()) return;
+  current_ = static_cast<uint8_t*>(free_list_.front());
+  current_end_ = current_ + total_;
 }
 
 void *Pool::More(std::size_t size) {
   std::size_t amount = std::max(static_cast<size_t>(32) << free_list_.size(), size);
   uint8_t *ret = static_cast<uint8_t*>(MallocOrThrow(amount));
   free_list_.push_back(ret);
+  total_ += amount;
   current_ = ret + size;
   current_end_ = ret + amount;
   return ret;
@@ -0,0 +1,51 @@
+#include "util/pool.hh"
+
+#define BOOST_TEST_MODULE PoolTest
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+
+namespace util {
+namespace {
+
+BOOST_AUTO_TEST_CASE(Allocate) {
+  Pool pool;
+  char *first = static_cast<char*>(pool.Allocate(10));
+  char *second = static_cast<char*>(pool.Allocate(10));
+  memset(first, 1, 10);
+  memset(second, 2, 10);
+  BOOST_CHECK_EQUAL(1, first[9]);
+  BOOST_CHECK_EQUAL(2, second[0]);
+}
+
+BOOST_AUTO_TEST_CASE(ResetReuses) {
+  Pool pool;
+  void *first = pool.Allocate(16);
+  pool.Reset();
+  BOOST_CHECK_EQUAL(first, pool.Allocate(16));
+}
+
+BOOST_AUTO_TEST_CASE(ResetConsolidates) {
+  Pool pool;
+  // Grow to several blocks.
+  for (unsigned i = 0; i < 1000; ++i) {
+    memset(pool.Allocate(100), 0, 100);
+  }
+  pool.Reset();
+  // The same allocations now fit in the one block left.
+  char *begin = static_cast<char*>(pool.Allocate(100));
+  char *last = begin;
+  for (unsigned i = 1; i < 1000; ++i) {
+    last = static_cast<char*>(pool.Allocate(100));
+  }
+  BOOST_CHECK_EQUAL(begin + 999 * 100, last);
+}
+
+BOOST_AUTO_TEST_CASE(ResetEmpty) {
+  Pool pool;
+  pool.Reset();
+  BOOST_CHECK(pool.Allocate(8));
+}
+
+} // namespace
+} // namespace util
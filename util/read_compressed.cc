@@ -1,5 +1,6 @@
 #include "util/read_compressed.hh"
 
+#include "util/block_gzip.hh"
 #include "util/file.hh"
 #include "util/have.hh"
 #include "util/scoped.hh"
@@ -16,6 +17,12 @@
 #include <zlib.h>
 #endif
 
+#if defined(HAVE_ZLIB) && defined(WITH_THREADS)
+#include "util/thread_pool.hh"
+#include <deque>
+#include <vector>
+#endif
+
 #ifdef HAVE_BZLIB
 #include <bzlib.h>
 #endif
@@ -206,6 +213,142 @@ class GZip {
 };
 #endif // HAVE_ZLIB
 
+#if defined(HAVE_ZLIB) && defined(WITH_THREADS)
+struct BlockGZipMember {
+  BlockGZipMember() : done(0) {}
+
+  std::string compressed, inflated, error;
+  Semaphore done;
+};
+
+class InflateMember {
+  public:
+    typedef BlockGZipMember *Request;
+
+    explicit InflateMember(int) {}
+
+    void operator()(BlockGZipMember *member) {
+      try {
+        InflateBlockGZipMember(member->compressed.data(), member->compressed.size(), member->inflated);
+      } catch (const std::exception &e) {
+        member->error = e.what();
+      }
+      member->done.post();
+    }
+};
+
+/* Block gzip members (see util/block_gzip.hh) record their size, so this
+ * reads members ahead and inflates them on a thread pool, returning them in
+ * order.  The first bytes that do not start a block gzip member go back to
+ * ReadFactory, so block gzip may be followed by ordinary gzip.
+ */
+class ParallelGZip : public ReadBase {
+  public:
+    // already_data starts with the header of the first member.
+    ParallelGZip(int fd, const void *already_data, std::size_t already_size, std::size_t threads)
+      : file_(fd), pool_(2 * threads, threads, 0, NULL), max_pending_(2 * threads),
+        current_(NULL), offset_(0),
+        already_(static_cast<const char*>(already_data), already_size), already_offset_(0),
+        ended_(false) {}
+
+    ~ParallelGZip() {
+      // Workers may still be inflating.
+      for (std::size_t i = 0; i < pending_.size(); ++i) {
+        WaitSemaphore(pending_[i]->done);
+        delete pending_[i];
+      }
+      delete current_;
+      for (std::size_t i = 0; i < free_.size(); ++i) delete free_[i];
+    }
+
+    std::size_t Read(void *to, std::size_t amount, ReadCompressed &thunk) {
+      while (!current_ || offset_ == current_->inflated.size()) {
+        if (current_) {
+          free_.push_back(current_);
+          current_ = NULL;
+        }
+        Fill(thunk);
+        if (pending_.empty()) {
+          ReplaceThis(ReadFactory(file_.release(), ReadCount(thunk), leftover_.data(), leftover_.size(), true), thunk);
+          return Current(thunk)->Read(to, amount, thunk);
+        }
+        current_ = pending_.front();
+        pending_.pop_front();
+        WaitSemaphore(current_->done);
+        UTIL_THROW_IF(!current_->error.empty(), GZException, current_->error);
+        offset_ = 0;
+      }
+      std::size_t sending = std::min<std::size_t>(amount, current_->inflated.size() - offset_);
+      memcpy(to, current_->inflated.data() + offset_, sending);
+      offset_ += sending;
+      return sending;
+    }
+
+  private:
+    // Read members and queue them until max_pending_ are in flight.
+    void Fill(ReadCompressed &thunk) {
+      while (!ended_ && pending_.size() < max_pending_) {
+        char header[kBlockGZipHeaderSize];
+        std::size_t got = ReadInput(header, kBlockGZipHeaderSize, thunk);
+        uint32_t size;
+        if (got < kBlockGZipHeaderSize || !(size = BlockGZipMemberSize(header))) {
+          leftover_.assign(header, got);
+          leftover_.append(already_, already_offset_, std::string::npos);
+          ended_ = true;
+          return;
+        }
+        BlockGZipMember *member;
+        if (free_.empty()) {
+          member = new BlockGZipMember();
+        } else {
+          member = free_.back();
+          free_.pop_back();
+        }
+        member->error.clear();
+        member->compressed.resize(size);
+        memcpy(&member->compressed[0], header, kBlockGZipHeaderSize);
+        if (ReadInput(&member->compressed[kBlockGZipHeaderSize], size - kBlockGZipHeaderSize, thunk) != size - kBlockGZipHeaderSize) {
+          free_.push_back(member);
+          UTIL_THROW(GZException, "Truncated block gzip member");
+        }
+        pending_.push_back(member);
+        pool_.Produce(member);
+      }
+    }
+
+    // Bytes the factory already read come first, then the file.
+    std::size_t ReadInput(char *to, std::size_t amount, ReadCompressed &thunk) {
+      std::size_t from_already = std::min<std::size_t>(amount, already_.size() - already_offset_);
+      memcpy(to, already_.data() + already_offset_, from_already);
+      already_offset_ += from_already;
+      std::size_t got = ReadOrEOF(file_.get(), to + from_already, amount - from_already);
+      ReadCount(thunk) += got;
+      return from_already + got;
+    }
+
+    scoped_fd file_;
+
+    ThreadPool<InflateMember> pool_;
+    const std::size_t max_pending_;
+
+    std::deque<BlockGZipMember*> pending_;
+    std::vector<BlockGZipMember*> free_;
+
+    BlockGZipMember *current_;
+    std::size_t offset_;
+
+    std::string already_;
+    std::size_t already_offset_;
+
+    std::string leftover_;
+    bool ended_;
+};
+
+std::size_t InflateThreads() {
+  return std::min<std::size_t>(8, boost::thread::hardware_concurrency());
+}
+#endif // HAVE_ZLIB && WITH_THREADS
+
 #ifdef HAVE_BZLIB
 class BZip {
   public:
@@ -379,6 +522,21 @@ ReadBase *ReadFactory(int fd, uint64_t &raw_amount, const void *already_data, co
   switch (DetectMagic(&header[0], header.size())) {
     case UTIL_GZIP:
 #ifdef HAVE_ZLIB
+#ifdef WITH_THREADS
+      // FEXTRA is set on block gzip members.
+      if (header.size() >= 4 && (header[3] & 4) && InflateThreads() > 1) {
+        if (header.size() < kBlockGZipHeaderSize) {
+          std::size_t original = header.size();
+          header.resize(kBlockGZipHeaderSize);
+          std::size_t got = ReadOrEOF(fd, &header[original], kBlockGZipHeaderSize - original);
+          raw_amount += got;
+          header.resize(original + got);
+        }
+        if (header.size() >= kBlockGZipHeaderSize && BlockGZipMemberSize(header.data())) {
+          return new ParallelGZip(hold.release(), header.data(), header.size(), InflateThreads());
+        }
+      }
+#endif
       return new StreamCompressed<GZip>(hold.release(), header.data(), header.size());
 #else
       UTIL_THROW(CompressedException, "This looks like a gzip file but gzip support was not compiled in.");
@@ -49,6 +49,9 @@ struct ChainConfig {
  */
 struct SortConfig {
 
+  /** Constructs a single-threaded configuration; the sizes must be set. */
+  SortConfig() : threads(1) {}
+
   /** Filename prefix where temporary files should be placed. */
   std::string temp_prefix;
 
@@ -57,6 +60,12 @@ struct SortConfig {
 
   /** Total memory to use when running alone. */
   std::size_t total_memory;
+
+  /**
+   * Threads used to sort each block and to run each merge pass.  They share
+   * the memory above; more threads do not use more memory.
+   */
+  std::size_t threads;
 };
 
 }} // namespaces
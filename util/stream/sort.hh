@@ -29,10 +29,13 @@
 #include "util/scoped.hh"
 #include "util/sized_iterator.hh"
 
+#include <boost/thread/thread.hpp>
+
 #include <algorithm>
 #include <iostream>
 #include <queue>
 #include <string>
+#include <vector>
 
 namespace util {
 namespace stream {
@@ -43,6 +46,11 @@ struct NeverCombine {
   }
 };
 
+// Merge passes can only be split by key range if the output size is known
+// in advance, so sorts with a combiner merge on one thread.
+inline bool CanPartitionMerge(const NeverCombine &) { return true; }
+template <class Combine> bool CanPartitionMerge(const Combine &) { return false; }
+
 // Manage the offsets of sorted blocks in a file.
 class Offsets {
   public:
@@ -217,6 +225,132 @@ template <class Compare> class MergeQueue {
     const std::size_t entry_size_;
 };
 
+/* Merges sorted runs of one file into a single run of another file on
+ * several threads.  The key space is cut at entries sampled from the longest
+ * run and each thread merges the pieces of all runs between two cuts, writing
+ * them where that key range starts in the output.  There is no combiner, so
+ * the output is exactly as long as the input and the threads need not wait
+ * for each other.
+ */
+template <class Compare> class PartitionedMerge {
+  public:
+    struct Run {
+      uint64_t offset, size;
+    };
+
+    PartitionedMerge(int in, int out, std::size_t entry_size, const Compare &compare)
+      : in_(in), out_(out), entry_size_(entry_size), compare_(compare) {}
+
+    /* Merge runs into the output starting at out_offset.  Each run has
+     * per_buffer bytes of read_buffer, as a single-threaded merge would; the
+     * threads split it, and write_memory bytes of write_buffer, between them.
+     */
+    void Merge(const std::vector<Run> &runs, uint64_t out_offset, std::size_t threads, uint8_t *read_buffer, std::size_t per_buffer, uint8_t *write_buffer, std::size_t write_memory) const {
+      // Keep at least one entry of buffer per thread.
+      threads = std::max<std::size_t>(1, std::min(threads, std::min(per_buffer, write_memory) / entry_size_));
+
+      // Cut every run at the same keys, so equal entries stay in one piece.
+      std::size_t longest = 0;
+      for (std::size_t r = 1; r < runs.size(); ++r) {
+        if (runs[r].size > runs[longest].size) longest = r;
+      }
+      const uint64_t longest_entries = runs[longest].size / entry_size_;
+      if (longest_entries < threads) threads = 1;
+      // cuts[r * (threads + 1) + t] is the first entry of run r for thread t.
+      std::vector<uint64_t> cuts(runs.size() * (threads + 1));
+      std::string splitter(entry_size_, 0);
+      for (std::size_t r = 0; r < runs.size(); ++r) {
+        cuts[r * (threads + 1) + threads] = runs[r].size / entry_size_;
+      }
+      for (std::size_t t = 1; t < threads; ++t) {
+        ErsatzPRead(in_, &splitter[0], entry_size_, runs[longest].offset + (longest_entries * t / threads) * entry_size_);
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+          cuts[r * (threads + 1) + t] = LowerBound(runs[r], cuts[r * (threads + 1) + t - 1], splitter.data());
+        }
+      }
+
+      const std::size_t thread_read = (per_buffer / threads) - (per_buffer / threads) % entry_size_;
+      const std::size_t thread_write = (write_memory / threads) - (write_memory / threads) % entry_size_;
+      boost::thread_group workers;
+      for (std::size_t t = 0; t < threads; ++t) {
+        Piece piece(*this, thread_read, write_buffer + t * thread_write, thread_write);
+        piece.out_offset = out_offset;
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+          const uint64_t *run_cuts = &cuts[r * (threads + 1)];
+          piece.out_offset += run_cuts[t] * entry_size_;
+          Run part;
+          part.offset = runs[r].offset + run_cuts[t] * entry_size_;
+          part.size = (run_cuts[t + 1] - run_cuts[t]) * entry_size_;
+          if (!part.size) continue;
+          piece.runs.push_back(part);
+          piece.buffers.push_back(read_buffer);
+          read_buffer += static_cast<std::size_t>(std::min<uint64_t>(part.size, thread_read));
+        }
+        if (t + 1 == threads) {
+          piece();
+        } else {
+          workers.create_thread(piece);
+        }
+      }
+      workers.join_all();
+    }
+
+  private:
+    // Index of the first entry of run at or after from that is not less than key.
+    uint64_t LowerBound(const Run &run, uint64_t from, const void *key) const {
+      uint64_t to = run.size / entry_size_;
+      std::string entry(entry_size_, 0);
+      while (from < to) {
+        uint64_t middle = from + (to - from) / 2;
+        ErsatzPRead(in_, &entry[0], entry_size_, run.offset + middle * entry_size_);
+        if (compare_(entry.data(), key)) {
+          from = middle + 1;
+        } else {
+          to = middle;
+        }
+      }
+      return from;
+    }
+
+    // What one thread merges.
+    struct Piece {
+      Piece(const PartitionedMerge &merge, std::size_t read_size, uint8_t *write, std::size_t write_size)
+        : merge_(&merge), read_size_(read_size), write_(write), write_size_(write_size) {}
+
+      void operator()() {
+        const std::size_t entry_size = merge_->entry_size_;
+        MergeQueue<Compare> queue(merge_->in_, read_size_, entry_size, merge_->compare_);
+        for (std::size_t r = 0; r < runs.size(); ++r) {
+          queue.Push(buffers[r], runs[r].offset, runs[r].size);
+        }
+        uint8_t *out = write_;
+        uint8_t *const out_end = write_ + write_size_;
+        for (; !queue.Empty(); queue.Pop()) {
+          memcpy(out, queue.Top(), entry_size);
+          if ((out += entry_size) == out_end) {
+            ErsatzPWrite(merge_->out_, write_, write_size_, out_offset);
+            out_offset += write_size_;
+            out = write_;
+          }
+        }
+        ErsatzPWrite(merge_->out_, write_, out - write_, out_offset);
+      }
+
+      std::vector<Run> runs;
+      std::vector<uint8_t*> buffers;
+      uint64_t out_offset;
+
+      const PartitionedMerge *merge_;
+      std::size_t read_size_;
+      uint8_t *write_;
+      std::size_t write_size_;
+    };
+
+    const int in_, out_;
+    const std::size_t entry_size_;
+    const Compare compare_;
+};
+
 /* A worker object that merges.  If the number of pieces to merge exceeds the
  * arity, it outputs multiple sorted blocks, recording to out_offsets.
  * However, users will only every see a single sorted block out output because
@@ -354,11 +488,48 @@ template <class Compare, class Combine> class OwningMergingReader : public Mergi
     Offsets offsets_;
 };
 
+/* Sorts [begin, end) on up to threads threads.  The range is split with
+ * nth_element until there is a piece per thread and the pieces are sorted
+ * concurrently.  Everything happens in place, so a block needs no more memory
+ * than the chain gave it.
+ */
+template <class Compare> void SortBlock(SizedIterator begin, SizedIterator end, const SizedCompare<Compare> &compare, std::size_t threads);
+
+template <class Compare> class SortBlockTask {
+  public:
+    SortBlockTask(SizedIterator begin, SizedIterator end, const SizedCompare<Compare> &compare, std::size_t threads)
+      : begin_(begin), end_(end), compare_(compare), threads_(threads) {}
+
+    void operator()() {
+      SortBlock(begin_, end_, compare_, threads_);
+    }
+
+  private:
+    SizedIterator begin_, end_;
+    SizedCompare<Compare> compare_;
+    std::size_t threads_;
+};
+
+template <class Compare> void SortBlock(SizedIterator begin, SizedIterator end, const SizedCompare<Compare> &compare, std::size_t threads) {
+  // Below this many entries per thread, starting threads costs more than it saves.
+  const std::ptrdiff_t kMinimumPiece = 4096;
+  if (threads < 2 || end - begin < 2 * kMinimumPiece) {
+    std::sort(begin, end, compare);
+    return;
+  }
+  std::size_t left_threads = threads / 2;
+  SizedIterator middle(begin + static_cast<std::ptrdiff_t>(static_cast<uint64_t>(end - begin) * left_threads / threads));
+  std::nth_element(begin, middle, end, compare);
+  boost::thread left(SortBlockTask<Compare>(begin, middle, compare, left_threads));
+  SortBlock(middle, end, compare, threads - left_threads);
+  left.join();
+}
+
 // Don't use this directly.  Worker that sorts blocks.
 template <class Compare> class BlockSorter {
   public:
-    BlockSorter(Offsets &offsets, const Compare &compare) :
-      offsets_(&offsets), compare_(compare) {}
+    BlockSorter(Offsets &offsets, const Compare &compare, std::size_t threads = 1) :
+      offsets_(&offsets), compare_(compare), threads_(threads) {}
 
     void Run(const ChainPosition &position) {
       const std::size_t entry_size = position.GetChain().EntrySize();
@@ -368,12 +539,12 @@ template <class Compare> class BlockSorter {
         void *end = static_cast<uint8_t*>(link->Get()) + link->ValidSize();
 #if defined(_WIN32) || defined(_WIN64)
         std::stable_sort
-#else
-        std::sort
-#endif
           (SizedIt(link->Get(), entry_size),
            SizedIt(end, entry_size),
            compare_);
+#else
+        SortBlock(SizedIt(link->Get(), entry_size), SizedIt(end, entry_size), compare_, threads_);
+#endif
       }
       offsets_->FinishedAppending();
     }
@@ -381,6 +552,7 @@ template <class Compare> class BlockSorter {
   private:
     Offsets *offsets_;
     SizedCompare<Compare> compare_;
+    std::size_t threads_;
 };
 
 class BadSortConfig : public Exception {
@@ -404,7 +576,8 @@ template <class Compare, class Combine = NeverCombine> class Sort {
       config_.buffer_size -= config_.buffer_size % entry_size_;
       UTIL_THROW_IF(!config_.buffer_size, BadSortConfig, "Sort buffer too small");
       UTIL_THROW_IF(config_.total_memory < config_.buffer_size * 4, BadSortConfig, "Sorting memory " << config_.total_memory << " is too small for four buffers (two read and two write).");
-      in >> BlockSorter<Compare>(offsets_, compare_) >> WriteAndRecycle(data_.get());
+      if (!config_.threads) config_.threads = 1;
+      in >> BlockSorter<Compare>(offsets_, compare_, config_.threads) >> WriteAndRecycle(data_.get());
     }
 
     uint64_t Size() const {
@@ -444,15 +617,19 @@ template <class Compare, class Combine = NeverCombine> class Sort {
           reading_memory = static_cast<std::size_t>(size);
         }
         SeekOrThrow(fd_in, 0);
-        chain >>
-          MergingReader<Compare, Combine>(
-              fd_in,
-              offsets_in, offsets_out,
-              config_.buffer_size,
-              reading_memory,
-              compare_, combine_) >>
-          WriteAndRecycle(fd_out);
-        chain.Wait();
+        if (config_.threads > 1 && CanPartitionMerge(combine_)) {
+          PartitionedPass(fd_in, offsets_in, fd_out, offsets_out, reading_memory);
+        } else {
+          chain >>
+            MergingReader<Compare, Combine>(
+                fd_in,
+                offsets_in, offsets_out,
+                config_.buffer_size,
+                reading_memory,
+                compare_, combine_) >>
+            WriteAndRecycle(fd_out);
+          chain.Wait();
+        }
         offsets_out->FinishedAppending();
         ResizeOrThrow(fd_in, 0);
         offsets_in->Reset();
@@ -524,6 +701,43 @@ template <class Compare, class Combine = NeverCombine> class Sort {
     }
 
   private:
+    /* One merge pass with the same grouping of blocks and the same memory as
+     * MergingReader followed by double-buffered writing, but each group is
+     * merged by config_.threads threads.
+     */
+    void PartitionedPass(int fd_in, Offsets *offsets_in, int fd_out, Offsets *offsets_out, std::size_t reading_memory) {
+      const std::size_t write_memory = 2 * config_.buffer_size;
+      scoped_malloc buffer(MallocOrThrow(reading_memory + write_memory));
+      uint8_t *const read_buffer = static_cast<uint8_t*>(buffer.get());
+      PartitionedMerge<Compare> merge(fd_in, fd_out, entry_size_, compare_);
+      std::vector<typename PartitionedMerge<Compare>::Run> runs;
+      uint64_t out_offset = 0;
+      while (offsets_in->RemainingBlocks()) {
+        uint64_t per_buffer = static_cast<uint64_t>(std::max<std::size_t>(
+            config_.buffer_size,
+            static_cast<std::size_t>((static_cast<uint64_t>(reading_memory) / offsets_in->RemainingBlocks()))));
+        per_buffer -= per_buffer % entry_size_;
+
+        runs.clear();
+        uint64_t used = 0, total = 0;
+        while (offsets_in->RemainingBlocks() && used + std::min(per_buffer, offsets_in->PeekSize()) <= reading_memory) {
+          typename PartitionedMerge<Compare>::Run run;
+          run.offset = offsets_in->TotalOffset();
+          run.size = offsets_in->NextSize();
+          runs.push_back(run);
+          used += std::min(run.size, per_buffer);
+          total += run.size;
+        }
+        if (runs.size() < 2 && offsets_in->RemainingBlocks()) {
+          std::cerr << "Bug in sort implementation: not merging at least two stripes." << std::endl;
+          abort();
+        }
+        merge.Merge(runs, out_offset, config_.threads, read_buffer, static_cast<std::size_t>(per_buffer), read_buffer + reading_memory, write_memory);
+        offsets_out->Append(total);
+        out_offset += total;
+      }
+    }
+
     SortConfig config_;
 
     scoped_fd data_;
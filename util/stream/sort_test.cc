@@ -59,4 +59,36 @@ BOOST_AUTO_TEST_CASE(FromShuffled) {
   BOOST_CHECK(!sorted);
 }
 
+BOOST_AUTO_TEST_CASE(Threaded) {
+  std::vector<uint64_t> shuffled;
+  shuffled.reserve(kSize);
+  for (uint64_t i = 0; i < kSize; ++i) {
+    shuffled.push_back(i);
+  }
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+
+  // Blocks large enough to be split between threads.
+  ChainConfig config;
+  config.entry_size = 8;
+  config.total_memory = 3 * 80000;
+  config.block_count = 3;
+
+  // Still several merge passes.
+  SortConfig merge_config;
+  merge_config.temp_prefix = "sort_test_temp";
+  merge_config.buffer_size = 800;
+  merge_config.total_memory = 3300;
+  merge_config.threads = 3;
+
+  Chain chain(config);
+  chain >> Putter(shuffled);
+  BlockingSort(chain, merge_config, CompareUInt64(), NeverCombine());
+  Stream sorted;
+  chain >> sorted >> kRecycle;
+  for (uint64_t i = 0; i < kSize; ++i, ++sorted) {
+    BOOST_CHECK_EQUAL(i, *static_cast<const uint64_t*>(sorted.Get()));
+  }
+  BOOST_CHECK(!sorted);
+}
+
 }}} // namespaces
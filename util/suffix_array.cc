@@ -0,0 +1,372 @@
+#include "util/suffix_array.hh"
+
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/scoped.hh"
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/thread.hpp>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace util {
+namespace {
+
+const char kMagic[8] = {'m', 'o', 's', 'e', 's', 'S', 'A', '\0'};
+const uint32_t kVersion = 1;
+
+const unsigned kDigitBits = 16;
+const std::size_t kBuckets = 1 << kDigitBits;
+// Below this many positions per thread, the histograms cost more than they save.
+const std::size_t kMinPerThread = 1 << 16;
+
+typedef boost::function<void (std::size_t)> BlockFunction;
+
+// Runs function(t) for t in [0, threads), the first on the calling thread.
+void RunBlocks(std::size_t threads, const BlockFunction &function) {
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    boost::thread_group group;
+    for (std::size_t t = 1; t < threads; ++t) {
+      group.create_thread(boost::bind(function, t));
+    }
+    function(0);
+    group.join_all();
+    return;
+  }
+#endif
+  for (std::size_t t = 0; t < threads; ++t) {
+    function(t);
+  }
+}
+
+struct Group {
+  uint32_t begin, end;
+};
+
+class CompareKey {
+  public:
+    CompareKey(const uint32_t *rank, std::size_t size, std::size_t h) : rank_(rank), size_(size), h_(h) {}
+
+    uint32_t Key(uint32_t position) const {
+      return position + h_ < size_ ? rank_[position + h_] + 1 : 0;
+    }
+
+    bool operator()(uint32_t a, uint32_t b) const {
+      return Key(a) < Key(b);
+    }
+
+  private:
+    const uint32_t *rank_;
+    std::size_t size_, h_;
+};
+
+// Groups at most this big are sorted as (key, position) pairs; larger ones
+// in place so that the memory stays bounded by the work arrays.
+const std::size_t kMaxPairSort = 1 << 20;
+
+class Builder {
+  public:
+    Builder(std::size_t size, std::size_t threads, const std::string &temp_prefix)
+      : size_(size), threads_(threads), histogram_(threads * kBuckets), next_groups_(threads), pairs_(threads) {
+      Allocate(temp_prefix, order_memory_);
+      Allocate(temp_prefix, rank_memory_);
+      order_ = static_cast<uint32_t*>(order_memory_.get());
+      rank_ = static_cast<uint32_t*>(rank_memory_.get());
+    }
+
+    void Build(const uint32_t *text, uint32_t *sa) {
+      sa_ = sa;
+      uint32_t max_word = 0;
+      for (std::size_t i = 0; i < size_; ++i) {
+        rank_[i] = text[i];
+        max_word = std::max(max_word, text[i]);
+        order_[i] = i;
+      }
+      SortByRank(max_word);
+      // rank by the first word
+      for (std::size_t k = 0, head = 0, previous = 0; k < size_; ++k) {
+        uint32_t word = order_[k];
+        if (k && word != previous) head = k;
+        previous = word;
+        order_[k] = head;
+      }
+      for (std::size_t k = 0; k < size_; ++k) {
+        rank_[sa_[k]] = order_[k];
+      }
+      for (std::size_t k = 0; k < size_;) {
+        Group group;
+        group.begin = k;
+        while (++k < size_ && order_[k] == group.begin) {}
+        group.end = k;
+        if (group.end - group.begin > 1) groups_.push_back(group);
+      }
+      for (std::size_t h = 1; !groups_.empty(); h *= 2) {
+        Refine(h);
+      }
+    }
+
+  private:
+    void Allocate(const std::string &temp_prefix, scoped_memory &to) {
+      std::size_t bytes = size_ * sizeof(uint32_t);
+      if (temp_prefix.empty()) {
+        HugeMalloc(bytes, false, to);
+      } else {
+        scoped_fd file(MakeTemp(temp_prefix));
+        to.reset(MapZeroedWrite(file.get(), bytes), bytes, scoped_memory::MMAP_ALLOCATED);
+      }
+    }
+
+    std::size_t BlockBegin(std::size_t t) const {
+      return size_ * t / threads_;
+    }
+
+    // Stable LSD radix sort of order_ by rank_ into sa_, then the first word
+    // of each suffix into order_.
+    void SortByRank(uint32_t max_key) {
+      unsigned passes = 1;
+      while (passes * kDigitBits < 32 && (max_key >> (passes * kDigitBits))) ++passes;
+      uint32_t *from = order_, *to = sa_;
+      for (unsigned p = 0; p < passes; ++p) {
+        from_ = from;
+        to_ = to;
+        shift_ = p * kDigitBits;
+        RunBlocks(threads_, boost::bind(&Builder::CountDigits, this, _1));
+        std::size_t offset = 0;
+        for (std::size_t digit = 0; digit < kBuckets; ++digit) {
+          for (std::size_t t = 0; t < threads_; ++t) {
+            std::size_t &count = histogram_[t * kBuckets + digit];
+            std::size_t here = count;
+            count = offset;
+            offset += here;
+          }
+        }
+        RunBlocks(threads_, boost::bind(&Builder::ScatterDigits, this, _1));
+        std::swap(from, to);
+      }
+      if (from != sa_) std::memcpy(sa_, from, size_ * sizeof(uint32_t));
+      for (std::size_t k = 0; k < size_; ++k) {
+        order_[k] = rank_[sa_[k]];
+      }
+    }
+
+    uint32_t Digit(uint32_t position) const {
+      return (rank_[position] >> shift_) & (kBuckets - 1);
+    }
+
+    void CountDigits(std::size_t t) {
+      std::size_t *histogram = &histogram_[t * kBuckets];
+      std::fill(histogram, histogram + kBuckets, 0);
+      for (std::size_t i = BlockBegin(t); i < BlockBegin(t + 1); ++i) {
+        ++histogram[Digit(from_[i])];
+      }
+    }
+
+    void ScatterDigits(std::size_t t) {
+      std::size_t *offsets = &histogram_[t * kBuckets];
+      for (std::size_t i = BlockBegin(t); i < BlockBegin(t + 1); ++i) {
+        to_[offsets[Digit(from_[i])]++] = from_[i];
+      }
+    }
+
+    /* Each group holds the suffixes that share their first h words and is
+     * ranked by where it starts in sa_.  Sorting a group by the rank h words
+     * later orders it by 2h words.  Groups are independent, so threads take
+     * runs of them of about equal size: first all sort and note the new
+     * ranks in order_, then all write them to rank_.
+     */
+    void Refine(std::size_t h) {
+      h_ = h;
+      group_begin_.assign(1, 0);
+      std::size_t total = 0;
+      for (std::size_t g = 0; g < groups_.size(); ++g) {
+        total += groups_[g].end - groups_[g].begin;
+      }
+      std::size_t seen = 0;
+      for (std::size_t g = 0; g < groups_.size(); ++g) {
+        seen += groups_[g].end - groups_[g].begin;
+        if (seen * threads_ >= total * group_begin_.size() && group_begin_.size() < threads_) {
+          group_begin_.push_back(g + 1);
+        }
+      }
+      group_begin_.resize(threads_ + 1, groups_.size());
+      RunBlocks(threads_, boost::bind(&Builder::SortGroups, this, _1));
+      RunBlocks(threads_, boost::bind(&Builder::WriteGroupRanks, this, _1));
+      groups_.clear();
+      for (std::size_t t = 0; t < threads_; ++t) {
+        groups_.insert(groups_.end(), next_groups_[t].begin(), next_groups_[t].end());
+        next_groups_[t].clear();
+      }
+    }
+
+    void SortGroups(std::size_t t) {
+      CompareKey compare(rank_, size_, h_);
+      std::vector<std::pair<uint32_t, uint32_t> > &pairs = pairs_[t];
+      for (std::size_t g = group_begin_[t]; g < group_begin_[t + 1]; ++g) {
+        const Group &group = groups_[g];
+        uint32_t *begin = sa_ + group.begin, *end = sa_ + group.end;
+        if (end - begin <= static_cast<std::ptrdiff_t>(kMaxPairSort)) {
+          pairs.clear();
+          for (uint32_t *i = begin; i != end; ++i) {
+            pairs.push_back(std::make_pair(compare.Key(*i), *i));
+          }
+          std::sort(pairs.begin(), pairs.end());
+          for (std::size_t i = 0; i < pairs.size(); ++i) {
+            begin[i] = pairs[i].second;
+          }
+        } else {
+          std::sort(begin, end, compare);
+        }
+        // split into new groups
+        Group split;
+        split.begin = group.begin;
+        uint32_t key = compare.Key(*begin);
+        for (std::size_t k = group.begin; k <= group.end; ++k) {
+          uint32_t next = (k == group.end) ? 0 : compare.Key(sa_[k]);
+          if (k == group.end || next != key) {
+            split.end = k;
+            if (split.end - split.begin > 1) next_groups_[t].push_back(split);
+            split.begin = k;
+            key = next;
+          }
+          if (k != group.end) order_[k] = split.begin;
+        }
+      }
+    }
+
+    void WriteGroupRanks(std::size_t t) {
+      for (std::size_t g = group_begin_[t]; g < group_begin_[t + 1]; ++g) {
+        for (std::size_t k = groups_[g].begin; k < groups_[g].end; ++k) {
+          rank_[sa_[k]] = order_[k];
+        }
+      }
+    }
+
+    const std::size_t size_;
+    const std::size_t threads_;
+
+    scoped_memory order_memory_, rank_memory_;
+    uint32_t *order_, *rank_, *sa_;
+
+    // state of the current radix pass
+    std::vector<std::size_t> histogram_;
+    const uint32_t *from_;
+    uint32_t *to_;
+    unsigned shift_;
+
+    // state of the current refinement
+    std::size_t h_;
+    std::vector<Group> groups_;
+    std::vector<std::size_t> group_begin_;
+    std::vector<std::vector<Group> > next_groups_;
+    std::vector<std::vector<std::pair<uint32_t, uint32_t> > > pairs_;
+};
+
+struct Layout {
+  explicit Layout(const SuffixArrayFileHeader &header) {
+    uint64_t at = Align(sizeof(SuffixArrayFileHeader));
+    text = Advance(at, header.size * sizeof(uint32_t));
+    index = Advance(at, header.size * sizeof(uint32_t));
+    word_in_sentence = Advance(at, header.size);
+    sentence = Advance(at, header.size * sizeof(uint32_t));
+    sentence_length = Advance(at, header.sentence_count);
+    uint64_t documents = header.has_documents ? header.document_count : 0;
+    document = Advance(at, documents * sizeof(uint32_t));
+    document_name = Advance(at, documents * sizeof(uint32_t));
+    document_name_buffer = Advance(at, header.has_documents ? header.document_name_length : 0);
+    total = at;
+  }
+
+  static uint64_t Align(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+  }
+
+  static uint64_t Advance(uint64_t &at, uint64_t bytes) {
+    uint64_t ret = at;
+    at = Align(at + bytes);
+    return ret;
+  }
+
+  uint64_t text, index, word_in_sentence, sentence, sentence_length;
+  uint64_t document, document_name, document_name_buffer;
+  uint64_t total;
+};
+
+void WriteSection(int fd, uint64_t &at, uint64_t offset, const void *data, uint64_t bytes) {
+  const char zeros[8] = {0};
+  WriteOrThrow(fd, zeros, offset - at);
+  WriteOrThrow(fd, data, bytes);
+  at = offset + bytes;
+}
+
+} // namespace
+
+void BuildSuffixArray(const uint32_t *text, std::size_t size, uint32_t *sa, std::size_t threads, const std::string &temp_prefix) {
+  if (!size) return;
+  UTIL_THROW_IF(size > std::numeric_limits<uint32_t>::max(), Exception, "Suffix arrays are limited to 2^32 positions, not " << size);
+  threads = std::max<std::size_t>(1, std::min(threads, size / kMinPerThread + 1));
+  Builder(size, threads, temp_prefix).Build(text, sa);
+}
+
+void WriteSuffixArrayFile(const char *name, SuffixArrayFile &file) {
+  SuffixArrayFileHeader &header = file.header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  Layout layout(header);
+  scoped_fd fd(CreateOrThrow(name));
+  uint64_t at = 0;
+  WriteSection(fd.get(), at, 0, &header, sizeof(header));
+  WriteSection(fd.get(), at, layout.text, file.text, header.size * sizeof(uint32_t));
+  WriteSection(fd.get(), at, layout.index, file.index, header.size * sizeof(uint32_t));
+  WriteSection(fd.get(), at, layout.word_in_sentence, file.word_in_sentence, header.size);
+  WriteSection(fd.get(), at, layout.sentence, file.sentence, header.size * sizeof(uint32_t));
+  WriteSection(fd.get(), at, layout.sentence_length, file.sentence_length, header.sentence_count);
+  if (header.has_documents) {
+    WriteSection(fd.get(), at, layout.document, file.document, header.document_count * sizeof(uint32_t));
+    WriteSection(fd.get(), at, layout.document_name, file.document_name, header.document_count * sizeof(uint32_t));
+    WriteSection(fd.get(), at, layout.document_name_buffer, file.document_name_buffer, header.document_name_length);
+  }
+  WriteSection(fd.get(), at, layout.total, NULL, 0);
+}
+
+bool IsSuffixArrayFile(const char *name) {
+  scoped_FILE file(std::fopen(name, "rb"));
+  if (!file.get()) return false;
+  char magic[sizeof(kMagic)];
+  return std::fread(magic, 1, sizeof(magic), file.get()) == sizeof(magic) && !std::memcmp(magic, kMagic, sizeof(magic));
+}
+
+void MapSuffixArrayFile(const char *name, SuffixArrayFile &file, scoped_memory &mapping, LoadMethod method) {
+  scoped_fd fd(OpenReadOrThrow(name));
+  SuffixArrayFileHeader &header = file.header;
+  ReadOrThrow(fd.get(), &header, sizeof(header));
+  UTIL_THROW_IF(std::memcmp(header.magic, kMagic, sizeof(kMagic)), Exception, name << " is not a suffix array file");
+  UTIL_THROW_IF(header.version != kVersion, Exception, name << " has suffix array format version " << header.version << " but this build reads version " << kVersion);
+  Layout layout(header);
+  UTIL_THROW_IF(SizeOrThrow(fd.get()) < layout.total, Exception, name << " is truncated");
+  MapRead(method, fd.get(), 0, layout.total, mapping);
+  const char *base = mapping.begin();
+  file.text = reinterpret_cast<const uint32_t*>(base + layout.text);
+  file.index = reinterpret_cast<const uint32_t*>(base + layout.index);
+  file.word_in_sentence = base + layout.word_in_sentence;
+  file.sentence = reinterpret_cast<const uint32_t*>(base + layout.sentence);
+  file.sentence_length = base + layout.sentence_length;
+  if (header.has_documents) {
+    file.document = reinterpret_cast<const uint32_t*>(base + layout.document);
+    file.document_name = reinterpret_cast<const uint32_t*>(base + layout.document_name);
+    file.document_name_buffer = base + layout.document_name_buffer;
+  } else {
+    file.document = file.document_name = NULL;
+    file.document_name_buffer = NULL;
+  }
+}
+
+} // namespace util
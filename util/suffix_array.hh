@@ -0,0 +1,73 @@
+#ifndef UTIL_SUFFIX_ARRAY_H
+#define UTIL_SUFFIX_ARRAY_H
+
+/* Suffix arrays over word IDs, as used by biconcor and the fuzzy-match
+ * translation memory.
+ *
+ * BuildSuffixArray radix sorts the positions by their first word and then
+ * doubles the sorted prefix length, re-sorting only the groups of suffixes
+ * that still tie by the rank of the words that follow (Larsson and Sadakane).
+ * There are no string comparisons and rounds get cheaper as groups resolve.
+ *
+ * The on-disk format keeps the text, the suffix array and the per-word
+ * sentence information as aligned sections of one file, so a tool can
+ * memory map it and use the arrays in place.
+ */
+
+#include "util/mmap.hh"
+
+#include <cstddef>
+#include <string>
+
+#include <stdint.h>
+
+namespace util {
+
+/* Sorts the suffixes of text[0, size) and writes their start positions to
+ * sa.  Words compare by value; a suffix that runs out of text sorts before
+ * every longer suffix sharing its words.  text and sa may be the same array.
+ *
+ * The radix sort and the group sorts are split over threads.  The work
+ * arrays take twice the size of the text; if temp_prefix is not empty they
+ * are mapped from unlinked files with that prefix, so the operating system
+ * can page them out instead of needing that much RAM.
+ */
+void BuildSuffixArray(const uint32_t *text, std::size_t size, uint32_t *sa, std::size_t threads = 1, const std::string &temp_prefix = std::string());
+
+struct SuffixArrayFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t has_documents;
+  // words, including one end of sentence marker per sentence
+  uint64_t size;
+  uint64_t sentence_count;
+  uint64_t document_count;
+  uint64_t document_name_length;
+};
+
+// Sections of a suffix array file.  The document sections are only present
+// if header.has_documents is set.
+struct SuffixArrayFile {
+  SuffixArrayFileHeader header;
+  const uint32_t *text;
+  const uint32_t *index;
+  const char *word_in_sentence;
+  const uint32_t *sentence;
+  const char *sentence_length;
+  const uint32_t *document;
+  const uint32_t *document_name;
+  const char *document_name_buffer;
+};
+
+// Fills in magic and version and writes all sections.
+void WriteSuffixArrayFile(const char *name, SuffixArrayFile &file);
+
+// Whether the file starts with the suffix array file magic.
+bool IsSuffixArrayFile(const char *name);
+
+// Maps the file into mapping and points the sections of file into it.
+void MapSuffixArrayFile(const char *name, SuffixArrayFile &file, scoped_memory &mapping, LoadMethod method = LAZY);
+
+} // namespace util
+
+#endif // UTIL_SUFFIX_ARRAY_H
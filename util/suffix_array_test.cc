@@ -0,0 +1,131 @@
+#include "util/suffix_array.hh"
+
+#include "util/file.hh"
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#define BOOST_TEST_MODULE SuffixArrayTest
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace util {
+namespace {
+
+struct CompareSuffix {
+  explicit CompareSuffix(const std::vector<uint32_t> &text) : text_(text) {}
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    return std::lexicographical_compare(text_.begin() + a, text_.end(), text_.begin() + b, text_.end());
+  }
+
+  const std::vector<uint32_t> &text_;
+};
+
+std::vector<uint32_t> Naive(const std::vector<uint32_t> &text) {
+  std::vector<uint32_t> sa(text.size());
+  for (std::size_t i = 0; i < sa.size(); ++i) sa[i] = i;
+  std::sort(sa.begin(), sa.end(), CompareSuffix(text));
+  return sa;
+}
+
+std::vector<uint32_t> Build(const std::vector<uint32_t> &text, std::size_t threads, const std::string &temp_prefix = std::string()) {
+  std::vector<uint32_t> sa(text.size());
+  if (!text.empty()) BuildSuffixArray(&text[0], text.size(), &sa[0], threads, temp_prefix);
+  return sa;
+}
+
+std::vector<uint32_t> Random(std::size_t size, uint32_t vocab) {
+  boost::mt19937 rng(size);
+  boost::uniform_int<uint32_t> range(0, vocab - 1);
+  boost::variate_generator<boost::mt19937&, boost::uniform_int<uint32_t> > gen(rng, range);
+  std::vector<uint32_t> text(size);
+  for (std::size_t i = 0; i < size; ++i) text[i] = gen();
+  return text;
+}
+
+BOOST_AUTO_TEST_CASE(Small) {
+  // banana
+  uint32_t words[] = {1, 0, 2, 0, 2, 0};
+  std::vector<uint32_t> text(words, words + 6);
+  uint32_t expect[] = {5, 3, 1, 0, 4, 2};
+  std::vector<uint32_t> sa(Build(text, 1));
+  BOOST_CHECK_EQUAL_COLLECTIONS(expect, expect + 6, sa.begin(), sa.end());
+  BOOST_CHECK(Build(std::vector<uint32_t>(), 1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(Repeats) {
+  // one long repeat needs many doubling rounds
+  std::vector<uint32_t> text(1000, 7);
+  text.push_back(3);
+  text.insert(text.end(), 1000, 7);
+  std::vector<uint32_t> sa(Build(text, 1));
+  BOOST_CHECK(Naive(text) == sa);
+}
+
+BOOST_AUTO_TEST_CASE(RandomThreads) {
+  std::vector<uint32_t> text(Random(300000, 5));
+  // large word IDs take two radix passes
+  text[17] = 100000;
+  std::vector<uint32_t> expect(Naive(text));
+  BOOST_CHECK(expect == Build(text, 1));
+  BOOST_CHECK(expect == Build(text, 3));
+}
+
+BOOST_AUTO_TEST_CASE(InPlace) {
+  std::vector<uint32_t> text(Random(5000, 50));
+  std::vector<uint32_t> expect(Naive(text));
+  BuildSuffixArray(&text[0], text.size(), &text[0], 2);
+  BOOST_CHECK(expect == text);
+}
+
+BOOST_AUTO_TEST_CASE(TempFiles) {
+  std::vector<uint32_t> text(Random(20000, 3));
+  std::string prefix("/tmp/");
+  NormalizeTempPrefix(prefix);
+  BOOST_CHECK(Naive(text) == Build(text, 2, prefix));
+}
+
+BOOST_AUTO_TEST_CASE(File) {
+  uint32_t text[] = {2, 3, 1, 2, 1};
+  uint32_t index[] = {4, 2, 0, 3, 1};
+  char word_in_sentence[] = {0, 1, 0, 0, 0};
+  uint32_t sentence[] = {0, 0, 0, 1, 0};
+  char sentence_length[] = {2, 1};
+  SuffixArrayFile file;
+  file.header.has_documents = 0;
+  file.header.size = 5;
+  file.header.sentence_count = 2;
+  file.header.document_count = 0;
+  file.header.document_name_length = 0;
+  file.text = text;
+  file.index = index;
+  file.word_in_sentence = word_in_sentence;
+  file.sentence = sentence;
+  file.sentence_length = sentence_length;
+
+  std::string name("/tmp/suffix_array_test");
+  WriteSuffixArrayFile(name.c_str(), file);
+  BOOST_CHECK(IsSuffixArrayFile(name.c_str()));
+  BOOST_CHECK(!IsSuffixArrayFile("/dev/null"));
+
+  SuffixArrayFile loaded;
+  scoped_memory mapping;
+  MapSuffixArrayFile(name.c_str(), loaded, mapping);
+  BOOST_CHECK_EQUAL(5, loaded.header.size);
+  BOOST_CHECK_EQUAL(2, loaded.header.sentence_count);
+  BOOST_CHECK_EQUAL_COLLECTIONS(text, text + 5, loaded.text, loaded.text + 5);
+  BOOST_CHECK_EQUAL_COLLECTIONS(index, index + 5, loaded.index, loaded.index + 5);
+  BOOST_CHECK_EQUAL_COLLECTIONS(word_in_sentence, word_in_sentence + 5, loaded.word_in_sentence, loaded.word_in_sentence + 5);
+  BOOST_CHECK_EQUAL_COLLECTIONS(sentence, sentence + 5, loaded.sentence, loaded.sentence + 5);
+  BOOST_CHECK_EQUAL_COLLECTIONS(sentence_length, sentence_length + 2, loaded.sentence_length, loaded.sentence_length + 2);
+  BOOST_CHECK(!loaded.document);
+  std::remove(name.c_str());
+}
+
+} // namespace
+} // namespace util